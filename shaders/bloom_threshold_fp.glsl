@@ -0,0 +1,54 @@
+#version 400
+
+// Bloom bright pass, downsampling the scene to half size on the way: the four diagonal taps of the
+// dual filter, each averaging four texels, weighted down by their brightness so a single very bright
+// texel does not flicker as the camera moves. What is left above the threshold goes into the bloom
+
+// Passed from the vertex shader
+in vec2 uv0;
+
+// Passed from outside
+uniform sampler2D texture_map;
+uniform vec2 source_size;
+uniform float threshold;
+uniform float knee;
+
+vec3 Sample(vec2 uv) {
+	// Level 0 only, the taps are placed on its texels and the scene texture has mipmaps that would blur them further
+	return textureLod(texture_map, uv, 0.0).rgb;
+}
+
+float Brightness(vec3 color) {
+	return max(color.r, max(color.g, color.b));
+}
+
+void main() {
+	vec2 texel = 1.0 / source_size;
+
+	vec3 taps[4];
+	taps[0] = Sample(uv0 + vec2(-texel.x, -texel.y));
+	taps[1] = Sample(uv0 + vec2(texel.x, -texel.y));
+	taps[2] = Sample(uv0 + vec2(-texel.x, texel.y));
+	taps[3] = Sample(uv0 + vec2(texel.x, texel.y));
+
+	vec3 sum = vec3(0.0);
+	float weights = 0.0;
+
+	for (int i = 0; i < 4; i++) {
+		float weight = 1.0 / (1.0 + Brightness(taps[i]));
+
+		sum += taps[i] * weight;
+		weights += weight;
+	}
+
+	vec3 color = sum / weights;
+
+	// Quadratic ramp over the knee below the threshold, then linear
+	float brightness = Brightness(color);
+	float soft = clamp(brightness - threshold + knee, 0.0, 2.0 * knee);
+	soft = soft * soft / (4.0 * knee + 1e-4);
+
+	float contribution = max(soft, brightness - threshold) / max(brightness, 1e-4);
+
+	gl_FragColor = vec4(color * contribution, 1.0);
+}
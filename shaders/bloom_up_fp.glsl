@@ -0,0 +1,31 @@
+#version 400
+
+// Bloom upsampling step: the lower level through the ring of the dual filter, added to this level
+
+// Passed from the vertex shader
+in vec2 uv0;
+
+// Passed from outside
+uniform sampler2D texture_map;
+uniform sampler2D level_map;
+uniform vec2 source_size;
+uniform float offset;
+
+vec3 Sample(vec2 uv) {
+	return textureLod(texture_map, uv, 0.0).rgb;
+}
+
+void main() {
+	vec2 halfTexel = 0.5 / source_size * offset;
+
+	vec3 sum = Sample(uv0 + vec2(-halfTexel.x * 2.0, 0.0));
+	sum += Sample(uv0 + vec2(-halfTexel.x, halfTexel.y)) * 2.0;
+	sum += Sample(uv0 + vec2(0.0, halfTexel.y * 2.0));
+	sum += Sample(uv0 + vec2(halfTexel.x, halfTexel.y)) * 2.0;
+	sum += Sample(uv0 + vec2(halfTexel.x * 2.0, 0.0));
+	sum += Sample(uv0 + vec2(halfTexel.x, -halfTexel.y)) * 2.0;
+	sum += Sample(uv0 + vec2(0.0, -halfTexel.y * 2.0));
+	sum += Sample(uv0 + vec2(-halfTexel.x, -halfTexel.y)) * 2.0;
+
+	gl_FragColor = vec4(sum / 12.0 + textureLod(level_map, uv0, 0.0).rgb, 1.0);
+}
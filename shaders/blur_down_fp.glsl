@@ -0,0 +1,29 @@
+#version 400
+
+// Dual filter blur, downsampling step: the center and the four diagonal corners half a texel out,
+// each bilinear tap already averages four texels
+
+// Passed from the vertex shader
+in vec2 uv0;
+
+// Passed from outside
+uniform sampler2D texture_map;
+uniform vec2 source_size;
+uniform float offset;
+
+vec4 Sample(vec2 uv) {
+	// Level 0 only, the taps are placed on its texels and the mipmaps of the scene texture would blur them further
+	return textureLod(texture_map, uv, 0.0);
+}
+
+void main() {
+	vec2 halfTexel = 0.5 / source_size * offset;
+
+	vec4 sum = Sample(uv0) * 4.0;
+	sum += Sample(uv0 - halfTexel);
+	sum += Sample(uv0 + halfTexel);
+	sum += Sample(uv0 + vec2(halfTexel.x, -halfTexel.y));
+	sum += Sample(uv0 - vec2(halfTexel.x, -halfTexel.y));
+
+	gl_FragColor = sum / 8.0;
+}
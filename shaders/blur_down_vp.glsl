@@ -0,0 +1,3 @@
+#version 400
+
+#include "screen_quad.glsl"
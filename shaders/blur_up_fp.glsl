@@ -0,0 +1,30 @@
+#version 400
+
+// Dual filter blur, upsampling step: a ring of eight taps around the texel, the diagonal ones weighted twice
+
+// Passed from the vertex shader
+in vec2 uv0;
+
+// Passed from outside
+uniform sampler2D texture_map;
+uniform vec2 source_size;
+uniform float offset;
+
+vec4 Sample(vec2 uv) {
+	return textureLod(texture_map, uv, 0.0);
+}
+
+void main() {
+	vec2 halfTexel = 0.5 / source_size * offset;
+
+	vec4 sum = Sample(uv0 + vec2(-halfTexel.x * 2.0, 0.0));
+	sum += Sample(uv0 + vec2(-halfTexel.x, halfTexel.y)) * 2.0;
+	sum += Sample(uv0 + vec2(0.0, halfTexel.y * 2.0));
+	sum += Sample(uv0 + vec2(halfTexel.x, halfTexel.y)) * 2.0;
+	sum += Sample(uv0 + vec2(halfTexel.x * 2.0, 0.0));
+	sum += Sample(uv0 + vec2(halfTexel.x, -halfTexel.y)) * 2.0;
+	sum += Sample(uv0 + vec2(0.0, -halfTexel.y * 2.0));
+	sum += Sample(uv0 + vec2(-halfTexel.x, -halfTexel.y)) * 2.0;
+
+	gl_FragColor = sum / 12.0;
+}
@@ -0,0 +1,13 @@
+// Distance fog shared by the lit materials, compile with NO_FOG to disable it
+
+uniform vec3 fogColor;
+uniform float fogDensity;
+uniform float fogFactor;
+
+vec4 ApplyFog(vec4 pixel, float viewDistance) {
+#ifdef NO_FOG
+	return pixel;
+#else
+	return mix(vec4(fogColor, 0.0), pixel, clamp(exp(-pow((viewDistance * fogDensity), fogFactor)), 0.0, 1.0));
+#endif
+}
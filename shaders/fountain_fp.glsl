@@ -9,13 +9,16 @@ in float dist_;
 // Uniform (global) buffer
 uniform sampler2D texture_map;
 
-uniform vec3 fogColor;
-uniform float fogDensity;
-uniform float fogFactor;
+#include "fog.glsl"
+#include "transparency.glsl"
+
+// Highlights of the droplets, only the brightest parts of the texture go above 1 and bloom
+const float sparkle = 2.0;
 
 void main() {
 	// Apply raindrop texture
 	vec4 pixel = texture(texture_map, uv_interp);
+	pixel.rgb *= 1.0 + sparkle * pow(max(max(pixel.r, pixel.g), pixel.b), 4.0);
 
-	gl_FragColor = mix(vec4(fogColor, 0.0), pixel * frag_color, clamp(exp(-pow((dist_ * fogDensity), fogFactor)), 0.0, 1.0));
+	WriteTransparent(ApplyFog(pixel * frag_color, dist_));
 }
\ No newline at end of file
@@ -5,10 +5,12 @@ in vec4 frag_color;
 
 uniform sampler2D texture_map;
 
+#include "transparency.glsl"
+
 void main() {
 	// Use uv coordinates passed through with frag_color vec4
 	vec2 uv_use = vec2(frag_color[0], frag_color[1]);
 	vec4 pixel = texture(texture_map, uv_use);
 
-	gl_FragColor = pixel;
+	WriteTransparent(pixel);
 }
\ No newline at end of file
@@ -0,0 +1,55 @@
+// Point lights of the clustered grid, shared by the lit materials. The lights near the camera are binned
+// on the CPU into clusters of the view frustum, a fragment only visits the lights of its own cluster
+
+// Two texels per light: world position and radius, then color
+uniform samplerBuffer light_data;
+// First index and index count of each cluster
+uniform usamplerBuffer light_clusters;
+uniform usamplerBuffer light_indices;
+
+uniform int light_count;
+// Clusters along x, y and z
+uniform ivec3 light_grid;
+// Pixel to tile, and log of the view depth to slice
+uniform vec2 light_tile_scale;
+uniform vec2 light_slice;
+
+// Diffuse light reaching a surface from the point lights
+vec3 PointLights(vec3 worldPosition, vec3 worldNormal, float viewDepth) {
+	if (light_count == 0) {
+		return vec3(0.0);
+	}
+
+	int slice = int(log(max(viewDepth, 1e-4)) * light_slice.x + light_slice.y);
+
+	// Past the grid nothing was binned
+	if (slice >= light_grid.z) {
+		return vec3(0.0);
+	}
+
+	ivec2 tile = clamp(ivec2(gl_FragCoord.xy * light_tile_scale), ivec2(0), light_grid.xy - 1);
+	int cluster = (max(slice, 0) * light_grid.y + tile.y) * light_grid.x + tile.x;
+
+	uvec2 range = texelFetch(light_clusters, cluster).xy;
+
+	vec3 normal = normalize(worldNormal);
+	vec3 sum = vec3(0.0);
+
+	for (uint i = 0u; i < range.y; i++) {
+		int index = int(texelFetch(light_indices, int(range.x + i)).r);
+
+		vec4 positionRadius = texelFetch(light_data, index * 2);
+		vec3 color = texelFetch(light_data, index * 2 + 1).rgb;
+
+		vec3 toLight = positionRadius.xyz - worldPosition;
+		float distance = length(toLight);
+
+		// Inverse square, brought smoothly down to 0 at the radius
+		float fade = clamp(1.0 - pow(distance / positionRadius.w, 4.0), 0.0, 1.0);
+		float attenuation = fade * fade / (distance * distance + 1.0);
+
+		sum += color * attenuation * max(dot(normal, toLight / max(distance, 1e-4)), 0.0);
+	}
+
+	return sum;
+}
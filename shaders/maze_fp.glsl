@@ -10,9 +10,7 @@ in float dist;
 uniform sampler2D texture_map;
 uniform float timer;
 
-uniform vec3 fogColor;
-uniform float fogDensity;
-uniform float fogFactor;
+#include "fog.glsl"
 
 const vec3 light = vec3(2.0, 1.5, 2.0);
 
@@ -23,5 +21,5 @@ void main() {
 	float diffuse = 0.6 * max(0.0, dot(normalize(normal), normalize(light)));
 	float amb = 0.4;
 
-	gl_FragColor = mix(vec4(fogColor, 0.0), pixel * diffuse + pixel * amb, clamp(exp(-pow((dist * fogDensity), fogFactor)), 0.0, 1.0));
+	gl_FragColor = ApplyFog(pixel * diffuse + pixel * amb, dist);
 }
\ No newline at end of file
@@ -0,0 +1,12 @@
+// Attributes passed from mesh_vertex.glsl
+in vec3 position_interp;
+in vec3 world_interp;
+in vec3 normal_interp;
+in vec4 color_interp;
+in vec2 uv_interp;
+#ifdef NORMAL_MAP
+in vec4 tangent_interp;
+#endif
+in vec3 light_pos;
+
+in float dist;
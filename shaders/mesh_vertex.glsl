@@ -0,0 +1,58 @@
+// Vertex program shared by the textured, shiny and water materials
+
+// Vertex buffer
+in vec3 vertex;
+in vec3 normal;
+in vec3 color;
+in vec2 uv;
+#ifdef NORMAL_MAP
+// Tangent, and the sign of the bitangent in w
+in vec4 tangent;
+#endif
+
+// Uniform (global) buffer
+uniform mat4 world_mat;
+uniform mat4 view_mat;
+uniform mat4 projection_mat;
+uniform mat4 normal_mat;
+
+// Attributes forwarded to the fragment shader
+out vec3 position_interp;
+out vec3 world_interp;
+out vec3 normal_interp;
+out vec4 color_interp;
+out vec2 uv_interp;
+#ifdef NORMAL_MAP
+out vec4 tangent_interp;
+#endif
+out vec3 light_pos;
+
+out float dist;
+
+// Material attributes (constants)
+uniform vec3 light_position = vec3(-0.5, -0.5, 1.5);
+
+void main() {
+	vec4 world = world_mat * vec4(vertex, 1.0);
+	vec4 viewWorld = view_mat * world;
+
+	dist = length(viewWorld.xyz);
+
+	gl_Position = projection_mat * viewWorld;
+
+	position_interp = vec3(viewWorld);
+	world_interp = vec3(world);
+	
+	normal_interp = vec3(normal_mat * vec4(normal, 0.0));
+
+	color_interp = vec4(color, 1.0);
+
+	uv_interp = uv;
+
+#ifdef NORMAL_MAP
+	// Packed tangents read the sign as -1/3 under the normalization rules before GL 4.2
+	tangent_interp = vec4(normalize(mat3(world_mat) * tangent.xyz), tangent.w < 0.0 ? -1.0 : 1.0);
+#endif
+
+	light_pos = vec3(view_mat * vec4(light_position, 1.0));
+}
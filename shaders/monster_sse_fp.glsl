@@ -6,45 +6,39 @@ in vec2 uv0;
 // Passed from outside
 uniform float timer;
 uniform sampler2D texture_map;
+// Distance to the monster as a fraction of the distance the effect starts at
 uniform float proximity;
 
+// Blurred scene from the post processing chain, at half resolution
+uniform sampler2D blur_map;
+
+#include "tone_mapping.glsl"
+
 void main() {
 	vec4 pixel;
 	vec2 pos = uv0;
 
 	pixel = texture(texture_map, uv0);
+	pixel.rgb = AddBloom(pixel.rgb, uv0);
 	
-	if(proximity <= 20) {
+	if(proximity <= 1.0) {
 		// start a timer at start of screen effect
 		float timerstart = timer;
 
-		// blur effect via covolution
-		float blur_weight = 9;
-		vec4 sum = vec4(0.0);
-		float dist = ((20 - proximity) * 0.001);
-	
 		// create timestamps where dark edges "burst" to simulate a heartbeat effect
 		float heartbeat = abs(sin(6.28 * ((abs(mod(timerstart, 3) - 2) + (mod(timerstart, 3)) - 2) / 2))) * 0.1;
 
 		float edges = (abs(0.5 - uv0.x)) + (abs(0.5 - uv0.y)); // value between 0 and 1 representing proximity to center of screen
 
-		// start on edges of screen
-		float totalblur = ((abs(0.5 - uv0.x)) + (abs(0.5 - uv0.y))) * dist;
-
-		// texture lookups for blur
-		sum += texture(texture_map, uv0);
-		sum += texture(texture_map, vec2((uv0.x - totalblur), uv0.y));
-		sum += texture(texture_map, vec2((uv0.x - totalblur), uv0.y + totalblur));
-		sum += texture(texture_map, vec2(uv0.x, (uv0.y + totalblur)));
-		sum += texture(texture_map, vec2((uv0.x + totalblur), uv0.y + totalblur));
-		sum += texture(texture_map, vec2((uv0.x + totalblur), uv0.y));
-		sum += texture(texture_map, vec2((uv0.x + totalblur), uv0.y - totalblur));
-		sum += texture(texture_map, vec2(uv0.x, uv0.y - totalblur));
-		sum += texture(texture_map, vec2(uv0.x - totalblur, uv0.y - totalblur));
-	
-		// divide by 9 (number of adjacent pixels checked per pixel) and subtract to get dark effect
-		pixel = (sum / blur_weight) - (heartbeat * edges);
+		// start on edges of screen, blurring more as the monster gets closer
+		float totalblur = clamp(edges * (1.0 - proximity) * 2.0, 0.0, 1.0);
+
+		// blend towards the blurred scene, tone map and subtract to get dark effect
+		pixel = mix(pixel, texture(blur_map, uv0), totalblur);
+		pixel.rgb = ToneMap(pixel.rgb) - (heartbeat * edges);
+	} else {
+		pixel.rgb = ToneMap(pixel.rgb);
 	}
 
 	gl_FragColor = pixel;
-}
\ No newline at end of file
+}
@@ -0,0 +1,21 @@
+// Normal of the surface in world space, bent by the tangent space normal map when the material is compiled
+// with NORMAL_MAP. The frame is rebuilt the way MikkTSpace bakes it: bitangent from the interpolated
+// normal and tangent, neither normalized before the map is applied
+
+#ifdef NORMAL_MAP
+uniform sampler2D normal_map;
+#endif
+
+vec3 SurfaceNormal(vec2 uv) {
+#ifdef NORMAL_MAP
+	vec3 normal = normal_interp;
+	vec3 tangent = tangent_interp.xyz;
+	vec3 bitangent = tangent_interp.w * cross(normal, tangent);
+
+	vec3 mapped = texture(normal_map, uv).xyz * 2.0 - 1.0;
+
+	return normalize(mapped.x * tangent + mapped.y * bitangent + mapped.z * normal);
+#else
+	return normalize(normal_interp);
+#endif
+}
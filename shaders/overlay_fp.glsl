@@ -7,9 +7,12 @@ in vec2 uv0;
 uniform sampler2D texture_map;
 uniform sampler2D overlay;
 
+#include "tone_mapping.glsl"
+
 void main() {
 	vec4 scene = texture(texture_map, uv0);
 	vec4 addOverlay = texture(overlay, vec2(uv0.x, 1.0 - uv0.y));
 	
-	gl_FragColor = scene + addOverlay;
+	// The overlay is already in display range
+	gl_FragColor = vec4(ToneMap(AddBloom(scene.rgb, uv0)), 1.0) + addOverlay;
 }
\ No newline at end of file
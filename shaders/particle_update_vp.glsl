@@ -0,0 +1,116 @@
+#version 400
+
+// Particle simulation step, the outputs are captured into the other state buffer with transform feedback
+#pragma feedback out_vertex out_normal out_color
+
+// Particle state: position, velocity, and (age, lifetime, seed)
+in vec3 vertex;
+in vec3 normal;
+in vec3 color;
+
+out vec3 out_vertex;
+out vec3 out_normal;
+out vec3 out_color;
+
+uniform float timer;
+uniform float delta_time;
+
+// Emitter
+uniform vec3 emitter_position;
+uniform float emitter_radius;
+uniform vec3 emitter_direction;
+uniform float emitter_spread;
+uniform float emitter_speed;
+uniform vec2 emitter_lifetime;
+
+// Forces
+uniform vec3 gravity;
+uniform float drag;
+uniform vec3 wind;
+uniform vec3 attractor;
+uniform float attractor_strength;
+uniform vec3 player_position;
+uniform float player_radius;
+
+// Collisions with the terrain (one texel per world unit) and a flat ground
+uniform sampler2D height_map;
+uniform bool use_height_map;
+uniform float height_map_size;
+uniform float ground_height;
+uniform float bounce;
+
+// Random number in [0, 1) from the particle seed and a stream index
+float Random(float seed, float stream) {
+	return fract(sin(seed * 12.9898 + stream * 78.233) * 43758.5453);
+}
+
+vec3 RandomVector(float seed, float stream) {
+	return vec3(Random(seed, stream), Random(seed, stream + 1.0), Random(seed, stream + 2.0)) * 2.0 - 1.0;
+}
+
+void main() {
+	vec3 position = vertex;
+	vec3 velocity = normal;
+
+	float age = color.x + delta_time;
+	float lifetime = color.y;
+	float seed = color.z;
+
+	if ((color.x < 0.0 && age >= 0.0) || age >= lifetime) {
+		// Spawn, or respawn a dead particle, with a new seed every time
+		seed = Random(seed, timer);
+
+		position = emitter_position + RandomVector(seed, 1.0) * emitter_radius;
+
+		vec3 direction = emitter_direction + RandomVector(seed, 4.0) * emitter_spread;
+
+		if (length(direction) < 0.0001) {
+			direction = vec3(0.0, 1.0, 0.0);
+		}
+
+		velocity = normalize(direction) * emitter_speed * mix(0.75, 1.25, Random(seed, 7.0));
+
+		age = 0.0;
+		lifetime = mix(emitter_lifetime.x, emitter_lifetime.y, Random(seed, 8.0));
+	} else if (age >= 0.0) {
+		// Gravity and gusts of wind
+		vec3 acceleration = gravity + wind * (0.6 + 0.4 * sin(timer * 0.7 + position.x * 0.3 + position.z * 0.2));
+
+		// Spring towards the attractor
+		acceleration += (attractor - position) * attractor_strength;
+
+		// Pushed out of the way by the player
+		vec3 away = position - player_position;
+		float distance = length(away);
+
+		if (distance < player_radius && distance > 0.0001) {
+			acceleration += away / distance * (player_radius - distance) * 40.0;
+		}
+
+		velocity += acceleration * delta_time;
+		velocity *= max(0.0, 1.0 - drag * delta_time);
+
+		position += velocity * delta_time;
+
+		// Land on the ground, bouncing back up and losing speed along it
+		float ground = ground_height;
+
+		if (use_height_map) {
+			ground = max(ground, texture(height_map, (position.xz + 0.5) / height_map_size).r);
+		}
+
+		if (position.y < ground) {
+			position.y = ground;
+
+			if (velocity.y < 0.0) {
+				velocity.y = -velocity.y * bounce;
+			}
+
+			velocity.xz *= bounce;
+		}
+	}
+
+	out_vertex = position;
+	out_normal = velocity;
+	out_color = vec3(age, lifetime, seed);
+}
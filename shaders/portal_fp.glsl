@@ -6,6 +6,13 @@ in vec4 frag_color;
 // Uniform (global) buffer
 uniform sampler2D texture_map;
 
+#include "transparency.glsl"
+
+// Brightness of the stars, above 1 so they bloom
+const float emission = 3.0;
+
 void main() {
-	gl_FragColor = texture(texture_map, frag_color.xy) * vec4(frag_color.x * 1.1, frag_color.y, 0.2, 1.0);
+	vec4 pixel = texture(texture_map, frag_color.xy) * vec4(frag_color.x * 1.1, frag_color.y, 0.2, 1.0);
+
+	WriteTransparent(vec4(pixel.rgb * emission, pixel.a));
 }
\ No newline at end of file
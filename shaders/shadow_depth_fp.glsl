@@ -0,0 +1,6 @@
+#version 400
+
+// Depth only, nothing to write
+
+void main() {
+}
@@ -0,0 +1,14 @@
+#version 400
+
+// Depth of a shadow caster in one cascade, the position is all that is needed
+
+// Vertex buffer
+in vec3 vertex;
+
+// Uniform (global) buffer
+uniform mat4 world_mat;
+uniform mat4 shadow_mat;
+
+void main() {
+	gl_Position = shadow_mat * world_mat * vec4(vertex, 1.0);
+}
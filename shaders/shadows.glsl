@@ -0,0 +1,53 @@
+// Cascaded shadows of the directional light, shared by the lit materials.
+// The cascade is picked by view depth and sampled with percentage closer filtering
+
+#define SHADOW_MAX_CASCADES 4
+
+uniform sampler2DArrayShadow shadow_map;
+
+// Cascades in use, 0 when shadows are off
+uniform int shadow_cascades;
+// World to light clip space, view depth the cascade ends at and world size of its texels
+uniform mat4 shadow_mats[SHADOW_MAX_CASCADES];
+uniform float shadow_splits[SHADOW_MAX_CASCADES];
+uniform float shadow_texel_sizes[SHADOW_MAX_CASCADES];
+// Toward the light, in world space
+uniform vec3 shadow_light;
+
+// 1 where lit, 0 in full shadow
+float Shadow(vec3 worldPosition, vec3 worldNormal, float viewDepth) {
+	if (shadow_cascades == 0 || viewDepth > shadow_splits[shadow_cascades - 1]) {
+		return 1.0;
+	}
+
+	int cascade = 0;
+
+	while (cascade < shadow_cascades - 1 && viewDepth > shadow_splits[cascade]) {
+		cascade++;
+	}
+
+	// Look up from slightly off the surface, further at grazing angles, against shadow acne
+	vec3 normal = normalize(worldNormal);
+	float grazing = 1.0 - clamp(dot(normal, normalize(shadow_light)), 0.0, 1.0);
+	vec3 position = worldPosition + normal * shadow_texel_sizes[cascade] * (1.0 + 2.0 * grazing);
+
+	vec4 coordinates = shadow_mats[cascade] * vec4(position, 1.0);
+	coordinates.xyz = coordinates.xyz / coordinates.w * 0.5 + 0.5;
+
+	// 4x4 taps between texels, each a bilinear 2x2 comparison, for a 5x5 texel filter
+	vec2 texel = 1.0 / vec2(textureSize(shadow_map, 0).xy);
+	float lit = 0.0;
+
+	for (float y = -1.5; y <= 1.5; y += 1.0) {
+		for (float x = -1.5; x <= 1.5; x += 1.0) {
+			lit += texture(shadow_map, vec4(coordinates.xy + vec2(x, y) * texel, cascade, coordinates.z));
+		}
+	}
+
+	lit /= 16.0;
+
+	// Fade out toward the end of the last cascade instead of stopping at a line
+	float end = shadow_splits[shadow_cascades - 1];
+
+	return mix(lit, 1.0, smoothstep(end * 0.9, end, viewDepth));
+}
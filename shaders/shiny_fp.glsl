@@ -1,25 +1,21 @@
 #version 400
 
-// Attributes passed from the vertex shader
-in vec3 position_interp;
-in vec3 normal_interp;
-in vec4 color_interp;
-in vec2 uv_interp;
-in vec3 light_pos;
-
-in float dist;
+#include "mesh_inputs.glsl"
 
 // Uniform (global) buffer
 uniform sampler2D texture_map;
 
-uniform vec3 fogColor;
-uniform float fogDensity;
-uniform float fogFactor;
+#include "fog.glsl"
+#include "shadows.glsl"
+#include "lights.glsl"
 
 uniform float timer;
 
 const vec3 light = vec3(0.3, 1.2, 1.0);
 
+// The gem glows on top of its lighting, above 1 so it blooms
+const float emission = 0.5;
+
 void main() {
 	// Retrieve texture value
 	vec4 pixel = vec4(1.0, 0.0, 0.0, 1.0) * length(texture(texture_map, uv_interp + vec2(0.0, timer * 0.1))) + vec4(0.0, 1.0, 0.0, 1.0) * 
@@ -27,7 +23,10 @@ void main() {
 	+ vec4(0.0, 0.0, 1.0, 1.0) * length(texture(texture_map, uv_interp + vec2(0.0, 2.0 + timer * 0.3)));
 
 	float diffuse = 0.6 * max(0.0, dot(normalize(normal_interp), normalize(light)));
+	diffuse *= Shadow(world_interp, normal_interp, -position_interp.z);
 	float amb = 0.4;
 
-	gl_FragColor = mix(vec4(fogColor, 0.0), pixel * diffuse + pixel * amb, clamp(exp(-pow((dist * fogDensity), fogFactor)), 0.0, 1.0));
+	vec3 lights = PointLights(world_interp, normal_interp, -position_interp.z);
+
+	gl_FragColor = ApplyFog(pixel * diffuse + pixel * amb + vec4(pixel.rgb * (emission + lights), 0.0), dist);
 }
\ No newline at end of file
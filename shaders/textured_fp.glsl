@@ -1,20 +1,14 @@
 #version 400
 
-// Attributes passed from the vertex shader
-in vec3 position_interp;
-in vec3 normal_interp;
-in vec4 color_interp;
-in vec2 uv_interp;
-in vec3 light_pos;
-
-in float dist;
+#include "mesh_inputs.glsl"
 
 // Uniform (global) buffer
 uniform sampler2D texture_map;
 
-uniform vec3 fogColor;
-uniform float fogDensity;
-uniform float fogFactor;
+#include "fog.glsl"
+#include "shadows.glsl"
+#include "lights.glsl"
+#include "normal_mapping.glsl"
 
 const vec3 light = vec3(0.3, 1.2, 1.0);
 
@@ -22,8 +16,13 @@ void main() {
 	// Retrieve texture value
 	vec4 pixel = texture(texture_map, uv_interp);
 
-	float diffuse = 0.6 * max(0.0, dot(normalize(normal_interp), normalize(light)));
+	vec3 normal = SurfaceNormal(uv_interp);
+
+	float diffuse = 0.6 * max(0.0, dot(normal, normalize(light)));
+	diffuse *= Shadow(world_interp, normal_interp, -position_interp.z);
 	float amb = 0.4;
 
-	gl_FragColor = mix(vec4(fogColor, 0.0), pixel * diffuse + pixel * amb, clamp(exp(-pow((dist * fogDensity), fogFactor)), 0.0, 1.0));
+	vec3 lights = PointLights(world_interp, normal, -position_interp.z);
+
+	gl_FragColor = ApplyFog(pixel * diffuse + pixel * amb + vec4(pixel.rgb * lights, 0.0), dist);
 }
\ No newline at end of file
@@ -0,0 +1,20 @@
+// The scene is linear HDR, brought into the displayable range here after the bloom is added.
+// Colors the display can show pass unchanged so the art keeps its look, brighter ones are scaled back by their
+// largest channel so they keep their hue instead of clipping towards white or yellow
+
+// Passed from outside
+uniform sampler2D bloom_map;
+uniform float bloom_intensity;
+uniform float exposure;
+
+vec3 AddBloom(vec3 color, vec2 uv) {
+	return color + textureLod(bloom_map, uv, 0.0).rgb * bloom_intensity;
+}
+
+vec3 ToneMap(vec3 color) {
+	color = max(color * exposure, 0.0);
+
+	float peak = max(color.r, max(color.g, color.b));
+
+	return peak > 1.0 ? color / peak : color;
+}
@@ -0,0 +1,16 @@
+// Output of the transparent materials, weighted blended order independent transparency.
+// Fragments are added into an accumulation target and multiply a revealage target, transparency_fp.glsl
+// resolves them over the opaque scene, so transparent geometry can be drawn in any order
+
+layout(location = 0) out vec4 accumulation;
+layout(location = 1) out float revealage;
+
+void WriteTransparent(vec4 color) {
+	float alpha = clamp(color.a, 0.0, 1.0);
+
+	// Closer and more opaque fragments count more
+	float weight = clamp(pow(min(1.0, alpha * 10.0) + 0.01, 3.0) * 1e8 * pow(1.0 - gl_FragCoord.z * 0.9, 3.0), 1e-2, 3e3);
+
+	accumulation = vec4(color.rgb * alpha, alpha) * weight;
+	revealage = alpha;
+}
@@ -0,0 +1,27 @@
+#version 400
+
+// Resolve the transparent pass, blended over the opaque scene with (GL_ONE_MINUS_SRC_ALPHA, GL_SRC_ALPHA)
+
+// Passed from outside
+uniform sampler2D accumulation_map;
+uniform sampler2D revealage_map;
+
+void main() {
+	ivec2 texel = ivec2(gl_FragCoord.xy);
+
+	float revealage = texelFetch(revealage_map, texel, 0).r;
+
+	// Nothing transparent covers this pixel
+	if (revealage >= 1.0) {
+		discard;
+	}
+
+	vec4 accumulation = texelFetch(accumulation_map, texel, 0);
+
+	// Keep the average finite where many bright fragments overlap
+	if (isinf(max(max(abs(accumulation.r), abs(accumulation.g)), abs(accumulation.b)))) {
+		accumulation.rgb = vec3(accumulation.a);
+	}
+
+	gl_FragColor = vec4(accumulation.rgb / clamp(accumulation.a, 1e-4, 5e4), revealage);
+}
@@ -1,21 +1,12 @@
 #version 130
 
-// Attributes passed from the vertex shader
-in vec3 position_interp;
-in vec3 normal_interp;
-in vec4 color_interp;
-in vec2 uv_interp;
-in vec3 light_pos;
-
-in float dist;
+#include "mesh_inputs.glsl"
 
 // Uniform (global) buffer
 uniform sampler2D texture_map;
 uniform float timer;
 
-uniform vec3 fogColor;
-uniform float fogDensity;
-uniform float fogFactor;
+#include "fog.glsl"
 
 void main() {
 	// Retrieve texture value
@@ -39,5 +30,5 @@ void main() {
 	
 	vec4 outcol = vec4(red, green, blue, 1.0);
 
-	gl_FragColor = mix(vec4(fogColor, 0.0), outcol, clamp(exp(-pow((dist * fogDensity), fogFactor)), 0.0, 1.0));
+	gl_FragColor = ApplyFog(outcol, dist);
 }
\ No newline at end of file
@@ -0,0 +1,1060 @@
+#include <iostream>
+#include <algorithm>
+#include <iomanip>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <cstdlib>
+#include <functional>
+#include <string>
+#include <cstring>
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include "benchmark.h"
+#include "terrain.h"
+#include "spatial_hash.h"
+#include "collision_world.h"
+#include "flow_field.h"
+#include "navigation_graph.h"
+#include "job_system.h"
+#include "particle_simulation.h"
+#include "light_clusters.h"
+#include "mesh_cooker.h"
+#include "vertex_layout.h"
+#include "procedural_geometry.h"
+#include "path_config.h"
+
+#ifdef __AVX2__
+#define SIMD_WIDTH 8
+#else
+#define SIMD_WIDTH 4
+#endif
+
+namespace Game {
+	// Best time of a few runs, in milliseconds
+	static double Time(const std::function<void()>& function, int runs = 3) {
+		double best = 1e30;
+
+		for (int i = 0; i < runs; i++) {
+			auto start = std::chrono::high_resolution_clock::now();
+			function();
+			auto end = std::chrono::high_resolution_clock::now();
+
+			best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+		}
+
+		return best;
+	}
+
+	// The original serial generator: rand(), glm::distance and glm::pow per sample, then four cross products
+	// per normal inside a fixed window
+	static void ReferenceTerrain(int size, std::vector<float>& heights, std::vector<glm::vec3>& normals) {
+		for (int i = 0; i < size; i++) {
+			for (int j = 0; j < size; j++) {
+				float rand1 = ((double)rand() / (RAND_MAX));
+
+				float height = 2.0f * glm::pow(glm::max(0.0f, 20.0f - (glm::distance(glm::vec2(size / 2.0f, size / 2.0f), glm::vec2(i, j)) - 1.25f * rand1)), 0.9f);
+
+				heights[i * size + j] = height / 4.0f;
+			}
+		}
+
+		for (int i = 33; i < size - 33; i++) {
+			for (int j = 33; j < size - 33; j++) {
+				glm::vec3 curvec(j, heights[i * size + j], i);
+
+				glm::vec3 cross1 = glm::cross(glm::vec3(j + 1, heights[(i + 1) * size + j + 1] / 4, i + 1) - curvec, glm::vec3(j + 1, heights[i * size + j + 1] / 4, i) - curvec);
+				glm::vec3 cross2 = glm::cross(glm::vec3(j - 1, heights[(i + 1) * size + j - 1] / 4, i + 1) - curvec, glm::vec3(j, heights[(i + 1) * size + j] / 4, i + 1) - curvec);
+				glm::vec3 cross3 = glm::cross(glm::vec3(j - 1, heights[(i - 1) * size + j - 1] / 4, i - 1) - curvec, glm::vec3(j - 1, heights[i * size + j - 1] / 4, i) - curvec);
+				glm::vec3 cross4 = glm::cross(glm::vec3(j + 1, heights[(i + 1) * size + j + 1] / 4, i + 1) - curvec, glm::vec3(j, heights[(i - 1) * size + j] / 4, i - 1) - curvec);
+
+				normals[i * size + j] = glm::normalize(cross1 + cross2 + cross3 + cross4);
+			}
+		}
+	}
+
+	static void BenchmarkTerrain() {
+		const int sizes[] = { 110, 512, 1024, 2048, 4096 };
+
+		int threads = glm::max(1, (int)std::thread::hardware_concurrency());
+
+		std::cout << "Terrain generation (heights + normals), " << threads << " threads" << std::endl;
+		std::cout << std::setw(8) << "size" << std::setw(14) << "reference ms" << std::setw(14) << "1 thread ms" << std::setw(14) << "parallel ms" << std::setw(10) << "speedup" << std::setw(14) << "deterministic" << std::endl;
+
+		for (int size : sizes) {
+			std::vector<float> heights(size * size), normals(size * size * 3);
+			std::vector<float> parallelHeights(size * size), parallelNormals(size * size * 3);
+			std::vector<glm::vec3> referenceNormals(size * size, glm::vec3(0.0f, 1.0f, 0.0f));
+
+			double reference = Time([&]() {
+				ReferenceTerrain(size, heights, referenceNormals);
+			});
+
+			double serial = Time([&]() {
+				Terrain::GenerateHeights(size, 0, heights.data(), 1);
+				Terrain::ComputeNormals(size, heights.data(), normals.data(), 1);
+			});
+
+			double parallel = Time([&]() {
+				Terrain::GenerateHeights(size, 0, parallelHeights.data(), threads);
+				Terrain::ComputeNormals(size, parallelHeights.data(), parallelNormals.data(), threads);
+			});
+
+			bool deterministic = heights == parallelHeights && normals == parallelNormals;
+
+			std::cout << std::fixed << std::setprecision(2);
+			std::cout << std::setw(8) << size << std::setw(14) << reference << std::setw(14) << serial << std::setw(14) << parallel << std::setw(9) << reference / parallel << "x" << std::setw(14) << (deterministic ? "yes" : "NO") << std::endl;
+		}
+
+		std::cout << std::endl;
+	}
+
+	static void BenchmarkHeightQueries() {
+		const int counts[] = { 10000, 100000, 1000000 };
+
+		Terrain terrain;
+		terrain.CreateHeightfield(1024);
+
+		std::cout << "Terrain height queries on a 1024 map, million queries per second" << std::endl;
+		std::cout << std::setw(10) << "queries" << std::setw(12) << "scalar" << std::setw(12) << "batch" << std::setw(16) << "batch+normal" << std::setw(12) << "max error" << std::endl;
+
+		for (int count : counts) {
+			std::vector<float> x(count), z(count), heights(count), scalarHeights(count);
+			std::vector<glm::vec3> normals(count);
+
+			// Random points, a few of them off the map
+			srand(1);
+
+			for (int i = 0; i < count; i++) {
+				x[i] = ((float)rand() / RAND_MAX) * 1030.0f - 3.0f;
+				z[i] = ((float)rand() / RAND_MAX) * 1030.0f - 3.0f;
+			}
+
+			double scalar = Time([&]() {
+				for (int i = 0; i < count; i++) {
+					scalarHeights[i] = terrain.GetHeightAt(x[i], z[i]);
+				}
+			});
+
+			double batch = Time([&]() {
+				terrain.GetHeightsAt(count, x.data(), z.data(), heights.data());
+			});
+
+			double batchNormals = Time([&]() {
+				terrain.GetHeightsAt(count, x.data(), z.data(), heights.data(), normals.data());
+			});
+
+			float error = 0.0f;
+
+			for (int i = 0; i < count; i++) {
+				error = glm::max(error, glm::abs(heights[i] - scalarHeights[i]));
+			}
+
+			std::cout << std::setw(10) << count << std::setw(12) << count / scalar / 1000.0 << std::setw(12) << count / batch / 1000.0 << std::setw(16) << count / batchNormals / 1000.0 << std::setw(12) << std::scientific << error << std::fixed << std::endl;
+		}
+
+		std::cout << std::endl;
+	}
+
+	static void BenchmarkBroadphase() {
+		const int counts[] = { 100, 1000, 10000, 100000 };
+		const int queries = 100000;
+
+		std::cout << "Prop collisions, nanoseconds per point query" << std::endl;
+		std::cout << std::setw(10) << "props" << std::setw(12) << "linear" << std::setw(14) << "spatial hash" << std::setw(10) << "match" << std::endl;
+
+		for (int count : counts) {
+			// Props scattered at constant density, a third of them boxes
+			float extent = glm::sqrt((float)count) * 6.0f;
+
+			struct Prop {
+				bool isPoint;
+				glm::vec2 position;
+				glm::vec3 size;
+			};
+
+			std::vector<Prop> props(count);
+			SpatialHash hash;
+
+			srand(2);
+
+			for (int i = 0; i < count; i++) {
+				props[i].isPoint = i % 3 != 0;
+				props[i].position = glm::vec2(((float)rand() / RAND_MAX) * extent, ((float)rand() / RAND_MAX) * extent);
+				props[i].size = glm::vec3(0.5f + ((float)rand() / RAND_MAX) * 1.5f, 0.5f + ((float)rand() / RAND_MAX) * 1.5f, 0.0f);
+
+				if (props[i].isPoint) {
+					hash.AddCircle(props[i].position, props[i].size.x);
+				} else {
+					hash.AddBox(props[i].position, glm::vec2(props[i].size.x, props[i].size.y));
+				}
+			}
+
+			hash.Build();
+
+			std::vector<glm::vec2> points(queries);
+
+			for (int i = 0; i < queries; i++) {
+				points[i] = glm::vec2(((float)rand() / RAND_MAX) * extent, ((float)rand() / RAND_MAX) * extent);
+			}
+
+			// The linear scan gets fewer queries on large scenes to keep the run short
+			int linearQueries = glm::min(queries, 100000000 / count);
+
+			std::vector<char> linearHits(linearQueries), hashHits(queries);
+
+			double linear = Time([&]() {
+				for (int q = 0; q < linearQueries; q++) {
+					bool hit = false;
+
+					for (int i = 0; i < props.size(); i++) {
+						Prop c = props[i];
+
+						if (c.isPoint && glm::distance(points[q], c.position) < c.size.x) {
+							hit = true;
+							break;
+						} else if (!c.isPoint && points[q].x < c.position.x + c.size.x && points[q].x > c.position.x - c.size.x && points[q].y < c.position.y + c.size.y && points[q].y > c.position.y - c.size.y) {
+							hit = true;
+							break;
+						}
+					}
+
+					linearHits[q] = hit;
+				}
+			}, 1);
+
+			double hashed = Time([&]() {
+				for (int q = 0; q < queries; q++) {
+					hashHits[q] = hash.Overlaps(points[q]);
+				}
+			});
+
+			bool match = std::equal(linearHits.begin(), linearHits.end(), hashHits.begin());
+
+			std::cout << std::setw(10) << count << std::setw(12) << linear * 1e6 / linearQueries << std::setw(14) << hashed * 1e6 / queries << std::setw(10) << (match ? "yes" : "NO") << std::endl;
+		}
+
+		std::cout << std::endl;
+	}
+
+	static void BenchmarkCollisionWorld() {
+		const int sizes[] = { 55, 256, 1024 };
+		const int queries = 200000;
+
+		std::cout << "Collision world, million queries per second (random walls, one prop per 8 cells)" << std::endl;
+		std::cout << std::setw(10) << "grid" << std::setw(12) << "overlap" << std::setw(14) << "short sweep" << std::setw(14) << "long sweep" << std::setw(12) << "slide" << std::endl;
+
+		for (int size : sizes) {
+			CollisionWorld world;
+
+			srand(3);
+
+			std::vector<bool> walls(size * size);
+
+			for (int i = 0; i < size * size; i++) {
+				walls[i] = rand() % 100 < 30;
+			}
+
+			world.SetGrid(size, size, 2.0f, walls);
+
+			for (int i = 0; i < size * size / 8; i++) {
+				glm::vec2 position(((float)rand() / RAND_MAX) * size * 2.0f, ((float)rand() / RAND_MAX) * size * 2.0f);
+
+				if (i % 2) {
+					world.AddCircle(position, 0.5f + ((float)rand() / RAND_MAX));
+				} else {
+					world.AddBox(position, glm::vec2(0.5f, 1.0f));
+				}
+			}
+
+			world.Build();
+
+			// Moves at player speed, and long sweeps across several cells
+			std::vector<glm::vec2> starts(queries), steps(queries), ends(queries);
+
+			for (int i = 0; i < queries; i++) {
+				float angle = ((float)rand() / RAND_MAX) * 2.0f * glm::pi<float>();
+
+				starts[i] = glm::vec2(((float)rand() / RAND_MAX) * size * 2.0f, ((float)rand() / RAND_MAX) * size * 2.0f);
+				steps[i] = starts[i] + glm::vec2(glm::cos(angle), glm::sin(angle)) * 0.1f;
+				ends[i] = starts[i] + glm::vec2(glm::cos(angle), glm::sin(angle)) * 10.0f;
+			}
+
+			int hits = 0;
+
+			double overlap = Time([&]() {
+				for (int i = 0; i < queries; i++) {
+					hits += world.Overlaps(starts[i], 0.5f);
+				}
+			});
+
+			double shortSweep = Time([&]() {
+				for (int i = 0; i < queries; i++) {
+					hits += world.Sweep(starts[i], steps[i], 0.5f).hit;
+				}
+			});
+
+			double longSweep = Time([&]() {
+				for (int i = 0; i < queries; i++) {
+					hits += world.Sweep(starts[i], ends[i], 0.5f).hit;
+				}
+			});
+
+			double slide = Time([&]() {
+				for (int i = 0; i < queries; i++) {
+					hits += world.Move(starts[i], steps[i], 0.5f).x > 0.0f;
+				}
+			});
+
+			std::cout << std::setw(10) << size << std::setw(12) << queries / overlap / 1000.0 << std::setw(14) << queries / shortSweep / 1000.0 << std::setw(14) << queries / longSweep / 1000.0 << std::setw(12) << queries / slide / 1000.0 << std::endl;
+		}
+
+		std::cout << std::endl;
+	}
+
+	// Perfect maze on the odd cells of a size x size grid (size odd), walls everywhere else, like CreateMaze
+	static void GenerateMaze(int size, std::vector<bool>& walls) {
+		walls.assign(size * size, true);
+
+		std::vector<int> stack;
+
+		walls[1 * size + 1] = false;
+		stack.push_back(1 * size + 1);
+
+		while (!stack.empty()) {
+			int current = stack.back();
+
+			int x = current % size;
+			int y = current / size;
+
+			int options[4];
+			int count = 0;
+
+			if (x + 2 < size - 1 && walls[current + 2]) options[count++] = 2;
+			if (x - 2 > 0 && walls[current - 2]) options[count++] = -2;
+			if (y + 2 < size - 1 && walls[current + 2 * size]) options[count++] = 2 * size;
+			if (y - 2 > 0 && walls[current - 2 * size]) options[count++] = -2 * size;
+
+			if (count == 0) {
+				stack.pop_back();
+				continue;
+			}
+
+			int offset = options[rand() % count];
+
+			walls[current + offset / 2] = false;
+			walls[current + offset] = false;
+
+			stack.push_back(current + offset);
+		}
+
+		// Knock out some extra walls so there are loops
+		for (int i = 0; i < size * size / 20; i++) {
+			int x = 1 + rand() % (size - 2);
+			int y = 1 + rand() % (size - 2);
+
+			walls[y * size + x] = false;
+		}
+	}
+
+	static void BenchmarkFlowField() {
+		const int sizes[] = { 55, 255, 1023, 2047 };
+		const int agents = 1000;
+
+		std::cout << "Flow field over a maze, " << agents << " agents" << std::endl;
+		std::cout << std::setw(10) << "maze" << std::setw(14) << "rebuild ms" << std::setw(16) << "ns per agent" << std::setw(16) << "agents arrive" << std::endl;
+
+		for (int size : sizes) {
+			std::vector<bool> walls;
+
+			srand(4);
+			GenerateMaze(size, walls);
+
+			FlowField field;
+			field.SetGrid(size, size, 2.0f, walls);
+
+			// Open cells to put targets and agents on
+			std::vector<glm::vec2> open;
+
+			for (int i = 0; i < size * size; i++) {
+				if (!walls[i]) {
+					open.push_back(glm::vec2(i % size, i / size) * 2.0f);
+				}
+			}
+
+			// Every run moves the target to another cell, so the field is always rebuilt
+			int run = 0;
+
+			double rebuild = Time([&]() {
+				field.Update(open[(run++ * 7919) % open.size()]);
+			}, 5);
+
+			std::vector<glm::vec2> positions(agents);
+
+			for (int i = 0; i < agents; i++) {
+				positions[i] = open[rand() % open.size()];
+			}
+
+			glm::vec2 sum(0.0f);
+
+			double query = Time([&]() {
+				for (int i = 0; i < agents; i++) {
+					sum += field.GetDirection(positions[i]);
+				}
+			}, 20);
+
+			// Walk a few agents cell by cell and check they reach the target in the promised number of steps
+			int arrived = 0;
+			int tested = glm::min(agents, 50);
+
+			for (int i = 0; i < tested; i++) {
+				glm::vec2 position = positions[i];
+
+				int steps = field.GetDistance(position);
+
+				for (int s = 0; s < steps && field.GetDistance(position) > 0; s++) {
+					position = glm::round((position + field.GetDirection(position) * 2.0f) / 2.0f) * 2.0f;
+				}
+
+				arrived += field.GetDistance(position) == 0;
+			}
+
+			std::cout << std::setw(10) << size << std::setw(14) << rebuild << std::setw(16) << query * 1e6 / agents << std::setw(11) << arrived << " / " << tested << std::endl;
+		}
+
+		std::cout << std::endl;
+	}
+
+	static void BenchmarkNavigation() {
+		const int sizes[] = { 55, 255, 1023 };
+		const int paths = 2000;
+
+		int threads = glm::max(1, (int)std::thread::hardware_concurrency());
+
+		std::cout << "Hierarchical paths over a maze (16 cell clusters), microseconds per path, " << threads << " workers" << std::endl;
+		std::cout << std::setw(10) << "maze" << std::setw(12) << "build ms" << std::setw(12) << "grid BFS" << std::setw(12) << "HPA*" << std::setw(12) << "cached" << std::setw(12) << "batched" << std::setw(12) << "hit rate" << std::endl;
+
+		for (int size : sizes) {
+			std::vector<bool> walls;
+
+			srand(5);
+			GenerateMaze(size, walls);
+
+			NavigationGraph graph;
+			graph.SetGrid(size, size, 2.0f, walls, 16);
+
+			double build = Time([&]() {
+				graph.Build();
+			}, 1);
+
+			std::vector<glm::vec2> open;
+
+			for (int i = 0; i < size * size; i++) {
+				if (!walls[i]) {
+					open.push_back(glm::vec2(i % size, i / size) * 2.0f);
+				}
+			}
+
+			std::vector<glm::vec2> starts(paths), goals(paths);
+
+			for (int i = 0; i < paths; i++) {
+				starts[i] = open[rand() % open.size()];
+				goals[i] = open[rand() % open.size()];
+			}
+
+			std::vector<glm::vec2> waypoints;
+
+			// Baseline: a full grid search per agent
+			FlowField field;
+			field.SetGrid(size, size, 2.0f, walls);
+
+			int bfsPaths = glm::min(paths, 200);
+
+			double bfs = Time([&]() {
+				for (int i = 0; i < bfsPaths; i++) {
+					field.Update(goals[i]);
+				}
+			}, 1);
+
+			// Every request new, then the same requests again as agents asking for a new path from
+			// roughly where they were
+			graph.ClearCache();
+
+			double hierarchical = Time([&]() {
+				for (int i = 0; i < paths; i++) {
+					graph.FindPath(starts[i], goals[i], waypoints);
+				}
+			}, 1);
+
+			double cached = Time([&]() {
+				for (int i = 0; i < paths; i++) {
+					graph.FindPath(starts[i], goals[i], waypoints);
+				}
+			}, 1);
+
+			float hitRate = (float)graph.GetCacheHits() / glm::max(1, graph.GetCacheHits() + graph.GetCacheMisses());
+
+			// All requests at once, serviced by the workers
+			graph.ClearCache();
+			graph.Start(threads);
+
+			double batched = Time([&]() {
+				std::vector<int> tickets(paths);
+
+				for (int i = 0; i < paths; i++) {
+					tickets[i] = graph.RequestPath(starts[i], goals[i]);
+				}
+
+				bool found;
+
+				for (int i = 0; i < paths; i++) {
+					while (!graph.GetPath(tickets[i], waypoints, found)) {
+						std::this_thread::yield();
+					}
+				}
+			}, 1);
+
+			graph.Stop();
+
+			std::cout << std::setw(10) << size << std::setw(12) << build << std::setw(12) << bfs * 1000.0 / bfsPaths << std::setw(12) << hierarchical * 1000.0 / paths << std::setw(12) << cached * 1000.0 / paths << std::setw(12) << batched * 1000.0 / paths << std::setw(11) << hitRate * 100.0f << "%" << std::endl;
+		}
+
+		std::cout << std::endl;
+	}
+
+	static void BenchmarkJobs() {
+		const int jobCount = 100000;
+		const int queries = 1000000;
+
+		int cores = glm::max(1, (int)std::thread::hardware_concurrency());
+
+		Terrain terrain;
+		terrain.CreateHeightfield(1024);
+
+		std::vector<float> x(queries), z(queries), heights(queries);
+
+		srand(1);
+
+		for (int i = 0; i < queries; i++) {
+			x[i] = ((float)rand() / RAND_MAX) * 1024.0f;
+			z[i] = ((float)rand() / RAND_MAX) * 1024.0f;
+		}
+
+		double serial = Time([&]() {
+			terrain.GetHeightsAt(queries, x.data(), z.data(), heights.data());
+		});
+
+		std::cout << "Job system, nanoseconds per empty job and milliseconds for " << queries << " height queries split in 4096 point jobs (" << serial << " ms on one thread)" << std::endl;
+		std::cout << std::setw(10) << "threads" << std::setw(12) << "empty job" << std::setw(12) << "dependent" << std::setw(14) << "parallel for" << std::endl;
+
+		for (int threads = 1; threads <= cores * 2; threads *= 2) {
+			JobSystem jobs;
+			jobs.Start(threads);
+
+			// Independent jobs under one counter
+			double empty = Time([&]() {
+				JobCounter counter;
+
+				for (int i = 0; i < jobCount; i++) {
+					jobs.Run([]() {}, &counter);
+				}
+
+				jobs.Wait(&counter);
+			});
+
+			// A chain of groups, each waiting for the previous one
+			double dependent = Time([&]() {
+				std::vector<JobCounter> counters(jobCount / 100);
+
+				for (int i = 0; i < counters.size(); i++) {
+					for (int j = 0; j < 100; j++) {
+						jobs.Run([]() {}, &counters[i], i > 0 ? &counters[i - 1] : NULL);
+					}
+				}
+
+				jobs.Wait(&counters.back());
+			});
+
+			double parallel = Time([&]() {
+				jobs.ParallelFor(queries, 4096, [&](int first, int last) {
+					terrain.GetHeightsAt(last - first, x.data() + first, z.data() + first, heights.data() + first);
+				});
+			});
+
+			std::cout << std::setw(10) << threads << std::setw(12) << empty * 1e6 / jobCount << std::setw(12) << dependent * 1e6 / jobCount << std::setw(14) << parallel << std::endl;
+		}
+
+		std::cout << std::endl;
+	}
+
+	static void BenchmarkParticles() {
+		const int counts[] = { 10000, 100000, 1000000 };
+		const float deltaTime = 1.0f / 60.0f;
+
+		Terrain terrain;
+		terrain.CreateHeightfield(256);
+
+		// Fountain in the middle of the terrain, particles falling back onto it around the player
+		ParticleEmitter emitter = { glm::vec3(128.0f, 2.0f, 128.0f), 0.5f, glm::vec3(0.0f, 1.0f, 0.0f), 0.35f, 9.0f, 1.0f, 2.0f };
+		ParticleForces forces = { glm::vec3(0.0f, -9.8f, 0.0f), 0.1f, glm::vec3(1.5f, 0.0f, 0.5f), glm::vec3(128.0f, 2.0f, 128.0f), 0.05f, glm::vec3(129.0f, 1.0f, 128.0f), 2.0f, 0.0f, 0.4f };
+
+		std::cout << "CPU particles on one core, million particles per second per step (" << SIMD_WIDTH << " wide)" << std::endl;
+		std::cout << std::setw(10) << "particles" << std::setw(12) << "scalar" << std::setw(12) << "SIMD" << std::setw(10) << "speedup" << std::setw(12) << "alive" << std::setw(14) << "max error" << std::endl;
+
+		for (int count : counts) {
+			ParticleSimulation simulation;
+			simulation.Create(count, 2.0f, 1);
+			simulation.SetTerrain(&terrain);
+
+			// Run until every particle has been spawned at least once
+			float time = 0.0f;
+
+			for (int step = 0; step < 150; step++, time += deltaTime) {
+				simulation.Simulate(emitter, forces, deltaTime, time);
+			}
+
+			// One step of both from the same state
+			ParticleSimulation scalarSimulation = simulation;
+			ParticleSimulation simdSimulation = simulation;
+
+			scalarSimulation.SimulateScalar(emitter, forces, deltaTime, time);
+			simdSimulation.Simulate(emitter, forces, deltaTime, time);
+
+			float error = 0.0f;
+
+			for (int i = 0; i < count; i++) {
+				error = glm::max(error, glm::length(scalarSimulation.GetPosition(i) - simdSimulation.GetPosition(i)));
+				error = glm::max(error, glm::length(scalarSimulation.GetVelocity(i) - simdSimulation.GetVelocity(i)));
+			}
+
+			const int steps = 10;
+
+			double scalar = Time([&]() {
+				for (int step = 0; step < steps; step++) {
+					scalarSimulation.SimulateScalar(emitter, forces, deltaTime, time + step * deltaTime);
+				}
+			});
+
+			double simd = Time([&]() {
+				for (int step = 0; step < steps; step++) {
+					simdSimulation.Simulate(emitter, forces, deltaTime, time + step * deltaTime);
+				}
+			});
+
+			std::cout << std::setw(10) << count << std::setw(12) << count * steps / scalar / 1000.0 << std::setw(12) << count * steps / simd / 1000.0 << std::setw(9) << scalar / simd << "x" << std::setw(12) << simulation.GetAliveCount() << std::setw(14) << std::scientific << error << std::fixed << std::endl;
+		}
+
+		std::cout << std::endl;
+	}
+
+	static void BenchmarkParticleSort() {
+		const int count = 100000;
+		const int threads = glm::max(1, (int)std::thread::hardware_concurrency());
+
+		// Particles spread around the fountain, seen from the side
+		ParticleEmitter emitter = { glm::vec3(0.0f, 0.0f, 0.0f), 20.0f, glm::vec3(0.0f, 1.0f, 0.0f), 1.0f, 2.0f, 5.0f, 10.0f };
+		ParticleForces forces = { glm::vec3(0.0f), 0.0f, glm::vec3(0.0f), glm::vec3(0.0f), 0.0f, glm::vec3(0.0f, -100.0f, 0.0f), 0.0f, -100.0f, 0.0f };
+
+		ParticleSimulation simulation;
+		simulation.Create(count, 0.01f, 1);
+		simulation.Simulate(emitter, forces, 0.02f, 1.0f);
+
+		glm::mat4 view = glm::lookAt(glm::vec3(30.0f, 5.0f, 10.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+		std::vector<float> depths(count);
+		std::vector<int> reference(count), serialOrder, parallelOrder;
+
+		for (int i = 0; i < count; i++) {
+			depths[i] = -(view * glm::vec4(simulation.GetPosition(i), 1.0f)).z;
+		}
+
+		double comparison = Time([&]() {
+			for (int i = 0; i < count; i++) {
+				reference[i] = i;
+			}
+
+			std::stable_sort(reference.begin(), reference.end(), [&](int a, int b) {
+				return depths[a] > depths[b];
+			});
+		});
+
+		double radix = Time([&]() {
+			simulation.SortByDepth(view, serialOrder);
+		});
+
+		JobSystem jobs;
+		jobs.Start(threads);
+
+		double parallel = Time([&]() {
+			simulation.SortByDepth(view, parallelOrder, &jobs);
+		});
+
+		jobs.Stop();
+
+		std::cout << "Sorting " << count << " particles back to front, milliseconds (" << threads << " threads)" << std::endl;
+		std::cout << std::setw(14) << "stable_sort" << std::setw(12) << "radix" << std::setw(16) << "parallel radix" << std::setw(14) << "radix match" << std::setw(16) << "parallel match" << std::endl;
+		std::cout << std::setw(14) << comparison << std::setw(12) << radix << std::setw(16) << parallel << std::setw(14) << (serialOrder == reference ? "yes" : "NO") << std::setw(16) << (parallelOrder == reference ? "yes" : "NO") << std::endl;
+
+		std::cout << std::endl;
+	}
+
+	static void BenchmarkLightClusters() {
+		const int counts[] = { 64, 256, 1024, 4096 };
+		const int threads = glm::max(1, (int)std::thread::hardware_concurrency());
+
+		// Player in the maze looking across it at 1920x1080, lights scattered over the map at head height
+		glm::mat4 view = glm::lookAt(glm::vec3(5.0f, 1.0f, 5.0f), glm::vec3(55.0f, 1.0f, 55.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+		glm::mat4 projection = glm::perspective(glm::radians(60.0f), 1920.0f / 1080.0f, 0.001f, 1000.0f);
+
+		JobSystem jobs;
+		jobs.Start(threads);
+
+		std::cout << "Light clusters " << LIGHT_CLUSTERS_X << "x" << LIGHT_CLUSTERS_Y << "x" << LIGHT_CLUSTERS_Z << ", milliseconds (" << threads << " threads)" << std::endl;
+		std::cout << std::setw(8) << "lights" << std::setw(10) << "serial" << std::setw(10) << "parallel" << std::setw(14) << "avg/cluster" << std::setw(14) << "max/cluster" << std::setw(10) << "match" << std::endl;
+
+		for (int count : counts) {
+			std::srand(1);
+
+			std::vector<PointLight> lights(count);
+
+			for (int i = 0; i < count; i++) {
+				lights[i].position = glm::vec3(std::rand() % 1100 / 10.0f, 0.5f + std::rand() % 20 / 10.0f, std::rand() % 1100 / 10.0f);
+				lights[i].radius = 2.0f + std::rand() % 60 / 10.0f;
+				lights[i].color = glm::vec3(1.0f);
+			}
+
+			LightClusters clusters;
+			LightGrid serialGrid, parallelGrid;
+
+			double serial = Time([&]() {
+				clusters.Build(lights, view, projection, serialGrid);
+			});
+
+			double parallel = Time([&]() {
+				clusters.Build(lights, view, projection, parallelGrid, &jobs);
+			});
+
+			// Conservative and tight: a light reaching points sampled through a cluster must be in it, and a light
+			// in it must touch the box around it. Checked light by light on the smaller counts
+			bool match = serialGrid.clusters == parallelGrid.clusters && serialGrid.indices == parallelGrid.indices;
+			int largest = 0;
+
+			for (int z = 0; z < LIGHT_CLUSTERS_Z; z++) {
+				for (int y = 0; y < LIGHT_CLUSTERS_Y; y++) {
+					for (int x = 0; x < LIGHT_CLUSTERS_X; x++) {
+						int cluster = (z * LIGHT_CLUSTERS_Y + y) * LIGHT_CLUSTERS_X + x;
+
+						unsigned int first = parallelGrid.clusters[cluster * 2];
+						unsigned int size = parallelGrid.clusters[cluster * 2 + 1];
+
+						largest = glm::max(largest, (int)size);
+
+						if (count > 1024 || !match) {
+							continue;
+						}
+
+						std::vector<bool> isListed(count, false);
+
+						for (unsigned int i = first; i < first + size; i++) {
+							isListed[parallelGrid.indices[i]] = true;
+						}
+
+						glm::vec3 min, max;
+						clusters.GetClusterBounds(x, y, z, min, max);
+
+						for (int i = 0; i < count && match; i++) {
+							glm::vec3 center = glm::vec3(view * glm::vec4(lights[i].position, 1.0f));
+							float radius = lights[i].radius;
+
+							if (isListed[i]) {
+								glm::vec3 closest = glm::clamp(center, min, max);
+								match = glm::dot(closest - center, closest - center) <= radius * radius;
+								continue;
+							}
+
+							// Points of the cluster: corners and middles of its tile at three depths
+							for (int k = 0; k < 27 && match; k++) {
+								float depth = -glm::mix(max.z, min.z, (k / 9) * 0.5f);
+
+								glm::vec2 ndc = glm::vec2(-1.0f + 2.0f * (x + (k % 3) * 0.5f) / LIGHT_CLUSTERS_X, -1.0f + 2.0f * (y + (k / 3 % 3) * 0.5f) / LIGHT_CLUSTERS_Y);
+								glm::vec3 point(ndc.x * depth / projection[0][0], ndc.y * depth / projection[1][1], -depth);
+
+								match = glm::distance(point, center) > radius;
+							}
+						}
+					}
+				}
+			}
+
+			float average = parallelGrid.indices.size() / (float)(LIGHT_CLUSTERS_X * LIGHT_CLUSTERS_Y * LIGHT_CLUSTERS_Z);
+
+			std::cout << std::setw(8) << count << std::setw(10) << serial << std::setw(10) << parallel << std::setw(14) << average << std::setw(14) << largest << std::setw(10) << (count > 1024 ? "-" : match ? "yes" : "NO") << std::endl;
+		}
+
+		jobs.Stop();
+
+		std::cout << std::endl;
+	}
+
+	static void BenchmarkVertexFormats() {
+		const char* models[] = { "bench", "cross", "crow", "duggrave", "fountain", "gem", "grave", "pillar1", "pillar2", "pillar3", "rock1", "rock2", "rock3", "shrine1", "shrine2", "stage", "water" };
+
+		const VertexLayout* floats = VertexLayout::GetFloats(MESH_VERTEX_ATTRIBUTES);
+
+		std::cout << "Vertex buffers of the shipped models, bytes (11 floats per corner before cooking, then " << floats->GetStride() << " and " << VertexLayout::GetPacked().GetStride() << " per vertex)" << std::endl;
+		std::cout << std::setw(10) << "model" << std::setw(10) << "corners" << std::setw(10) << "vertices" << std::setw(10) << "original" << std::setw(10) << "floats" << std::setw(10) << "packed" << std::setw(14) << "position err" << std::setw(14) << "normal err" << std::endl;
+
+		size_t totalOriginal = 0, totalFloats = 0, totalPacked = 0;
+		double encodeTime = 0.0;
+
+		for (int i = 0; i < sizeof(models) / sizeof(models[0]); i++) {
+			std::string filename = std::string(MATERIAL_DIRECTORY) + "/" + models[i] + ".obj";
+
+			TriMesh mesh;
+			bool hasNormals;
+
+			try {
+				load_obj(filename.c_str(), mesh, hasNormals);
+			} catch (std::string) {
+				std::cout << std::setw(10) << models[i] << "  not found" << std::endl;
+				continue;
+			}
+
+			CookedMesh cooked;
+			CookMesh(mesh, hasNormals, cooked);
+
+			int vertices = (int)(cooked.vertices.size() / MESH_VERTEX_ATTRIBUTES);
+
+			VertexLayout packed = VertexLayout::GetPacked();
+			std::vector<unsigned char> data;
+
+			encodeTime += Time([&]() {
+				packed.Encode(cooked.vertices.data(), vertices, MESH_VERTEX_ATTRIBUTES, data);
+			});
+
+			// Largest error of the decoded positions against the size of the model, and of the normals in degrees
+
+			const glm::mat4& decode = packed.GetPositionDecode();
+			const VertexAttribute& normalAttribute = packed.GetAttribute(1);
+
+			glm::vec3 min(1e30f), max(-1e30f);
+			float positionError = 0.0f, normalError = 0.0f;
+
+			for (int j = 0; j < vertices; j++) {
+				const GLfloat* source = &cooked.vertices[j * MESH_VERTEX_ATTRIBUTES];
+				const unsigned char* vertex = &data[j * packed.GetStride()];
+
+				unsigned short stored[3];
+				std::memcpy(stored, vertex, sizeof(stored));
+
+				glm::vec3 position(source[0], source[1], source[2]);
+				glm::vec3 decoded = glm::vec3(decode * glm::vec4(stored[0] / 65535.0f, stored[1] / 65535.0f, stored[2] / 65535.0f, 1.0f));
+
+				min = glm::min(min, position);
+				max = glm::max(max, position);
+				positionError = glm::max(positionError, glm::length(decoded - position));
+
+				unsigned int bits;
+				std::memcpy(&bits, vertex + normalAttribute.offset, sizeof(bits));
+
+				glm::vec3 normal(source[3], source[4], source[5]);
+				glm::vec3 unpacked;
+
+				for (int k = 0; k < 3; k++) {
+					int value = (int)((bits >> (k * 10)) & 1023);
+					unpacked[k] = glm::max((value >= 512 ? value - 1024 : value) / 511.0f, -1.0f);
+				}
+
+				if (glm::length(normal) > 0.0f) {
+					float cosine = glm::clamp(glm::dot(glm::normalize(normal), glm::normalize(unpacked)), -1.0f, 1.0f);
+					normalError = glm::max(normalError, glm::degrees(glm::acos(cosine)));
+				}
+			}
+
+			size_t original = mesh.face.size() * 3 * 11 * sizeof(GLfloat);
+			size_t asFloats = vertices * floats->GetStride();
+			size_t asPacked = data.size();
+
+			totalOriginal += original;
+			totalFloats += asFloats;
+			totalPacked += asPacked;
+
+			float extent = glm::max(glm::max(max.x - min.x, max.y - min.y), max.z - min.z);
+
+			std::cout << std::setw(10) << models[i] << std::setw(10) << mesh.face.size() * 3 << std::setw(10) << vertices << std::setw(10) << original << std::setw(10) << asFloats << std::setw(10) << asPacked << std::setw(14) << positionError / extent << std::setw(14) << normalError << std::endl;
+		}
+
+		std::cout << std::setw(10) << "total" << std::setw(30) << totalOriginal << std::setw(10) << totalFloats << std::setw(10) << totalPacked << std::endl;
+
+		if (totalPacked > 0) {
+			std::cout << "Packed is " << totalOriginal / (double)totalPacked << "x smaller than the original buffers and " << totalFloats / (double)totalPacked << "x smaller than the cooked floats, encoded in " << encodeTime << " ms" << std::endl;
+		}
+
+		std::cout << std::endl;
+	}
+
+	static void BenchmarkMeshLods() {
+		const char* models[] = { "fountain", "stage", "shrine1", "shrine2", "rock1", "pillar1" };
+
+		std::cout << "Levels of detail of the larger models, triangles and largest error against the size of the model" << std::endl;
+		std::cout << std::setw(10) << "model" << std::setw(12) << "simplify ms";
+
+		for (int i = 0; i < MESH_LOD_LEVELS; i++) {
+			std::cout << std::setw(10) << "lod " + std::to_string(i) << std::setw(10) << "error";
+		}
+
+		std::cout << std::endl;
+
+		for (int i = 0; i < sizeof(models) / sizeof(models[0]); i++) {
+			std::string filename = std::string(MATERIAL_DIRECTORY) + "/" + models[i] + ".obj";
+
+			TriMesh mesh;
+			bool hasNormals;
+
+			try {
+				load_obj(filename.c_str(), mesh, hasNormals);
+			} catch (std::string) {
+				std::cout << std::setw(10) << models[i] << "  not found" << std::endl;
+				continue;
+			}
+
+			CookedMesh cooked;
+			CookMesh(mesh, hasNormals, cooked);
+
+			double time = Time([&]() {
+				AddMeshLods(cooked);
+			});
+
+			glm::vec3 min(1e30f), max(-1e30f);
+
+			for (int j = 0; j < cooked.vertices.size(); j += MESH_VERTEX_ATTRIBUTES) {
+				glm::vec3 position(cooked.vertices[j], cooked.vertices[j + 1], cooked.vertices[j + 2]);
+
+				min = glm::min(min, position);
+				max = glm::max(max, position);
+			}
+
+			float extent = glm::max(glm::max(max.x - min.x, max.y - min.y), max.z - min.z);
+
+			std::cout << std::setw(10) << models[i] << std::setw(12) << time;
+
+			for (int j = 0; j < cooked.lods.size(); j++) {
+				std::cout << std::setw(10) << cooked.lods[j].count / 3 << std::setw(10) << cooked.lods[j].error / extent;
+			}
+
+			std::cout << std::endl;
+		}
+
+		std::cout << std::endl;
+	}
+
+	static void BenchmarkGeometryArena() {
+		const int counts[] = { 5, 64, 512 };
+		const int threads = glm::max(1, (int)std::thread::hardware_concurrency());
+
+		JobSystem jobs;
+		jobs.Start(threads);
+
+		CylinderGenerator cylinder;
+
+		std::cout << "Cylinders of varied sizes and sides packed into one arena, milliseconds (" << threads << " threads)" << std::endl;
+		std::cout << std::setw(8) << "shapes" << std::setw(12) << "vertices" << std::setw(12) << "indices" << std::setw(10) << "serial" << std::setw(10) << "parallel" << std::setw(10) << "ranges" << std::setw(10) << "shapes" << std::setw(10) << "match" << std::endl;
+
+		for (int count : counts) {
+			std::vector<GeometryKey> keys(count);
+
+			for (int i = 0; i < count; i++) {
+				keys[i].generator = "Cylinder";
+				keys[i].parameters = { 2.0f, 1.0f - i * 0.5f / count, (float)(2 + i % 31), (float)(4 + i % 29) };
+			}
+
+			// Every key asked for twice, the cache keeps one of each
+			GeometryCache cache;
+
+			for (int k = 0; k < 2; k++) {
+				for (int i = 0; i < count; i++) {
+					cache.Request(keys[i]);
+				}
+			}
+
+			std::vector<GLfloat> serialVertices, parallelVertices;
+			std::vector<GLuint> serialIndices, parallelIndices;
+			std::vector<GeneratedGeometry> serialShapes, parallelShapes;
+
+			double serial = Time([&]() {
+				cache.Generate(serialVertices, serialIndices, serialShapes);
+			});
+
+			double parallel = Time([&]() {
+				cache.Generate(parallelVertices, parallelIndices, parallelShapes, &jobs);
+			});
+
+			// The shapes follow each other without gaps, and each one only points at its own vertices
+			bool ranges = serialShapes.size() == count;
+			GLuint nextVertex = 0, nextIndex = 0;
+
+			for (int i = 0; i < serialShapes.size(); i++) {
+				const GeneratedGeometry& shape = serialShapes[i];
+
+				ranges = ranges && shape.firstVertex == nextVertex && shape.firstIndex == nextIndex;
+
+				for (int j = 0; j < shape.count; j++) {
+					GLuint index = serialIndices[shape.firstIndex + j];
+
+					ranges = ranges && index >= shape.firstVertex && index < shape.firstVertex + shape.vertexCount;
+				}
+
+				nextVertex += shape.vertexCount;
+				nextIndex += shape.count;
+			}
+
+			ranges = ranges && nextVertex * GENERATED_VERTEX_ATTRIBUTES == serialVertices.size() && nextIndex == serialIndices.size();
+
+			// Each shape is what its generator makes on its own, moved to its place in the arena
+			bool shapes = ranges;
+
+			for (int i = 0; shapes && i < count; i++) {
+				const GeneratedGeometry& shape = serialShapes[i];
+
+				std::vector<GLfloat> vertices(shape.vertexCount * GENERATED_VERTEX_ATTRIBUTES);
+				std::vector<GLuint> indices(shape.count);
+
+				cylinder.Generate(keys[i].parameters, vertices.data(), indices.data());
+
+				shapes = std::equal(vertices.begin(), vertices.end(), serialVertices.begin() + shape.firstVertex * GENERATED_VERTEX_ATTRIBUTES);
+
+				for (int j = 0; shapes && j < shape.count; j++) {
+					shapes = indices[j] + shape.firstVertex == serialIndices[shape.firstIndex + j];
+				}
+			}
+
+			bool match = serialVertices == parallelVertices && serialIndices == parallelIndices && parallelShapes.size() == serialShapes.size();
+
+			for (int i = 0; match && i < serialShapes.size(); i++) {
+				match = parallelShapes[i].firstVertex == serialShapes[i].firstVertex && parallelShapes[i].firstIndex == serialShapes[i].firstIndex && parallelShapes[i].min == serialShapes[i].min && parallelShapes[i].max == serialShapes[i].max;
+			}
+
+			std::cout << std::setw(8) << count << std::setw(12) << serialVertices.size() / GENERATED_VERTEX_ATTRIBUTES << std::setw(12) << serialIndices.size() << std::setw(10) << serial << std::setw(10) << parallel << std::setw(10) << (ranges ? "yes" : "NO") << std::setw(10) << (shapes ? "yes" : "NO") << std::setw(10) << (match ? "yes" : "NO") << std::endl;
+		}
+
+		jobs.Stop();
+
+		std::cout << std::endl;
+	}
+
+	void RunBenchmarks() {
+		BenchmarkTerrain();
+		BenchmarkHeightQueries();
+		BenchmarkBroadphase();
+		BenchmarkCollisionWorld();
+		BenchmarkFlowField();
+		BenchmarkNavigation();
+		BenchmarkJobs();
+		BenchmarkParticles();
+		BenchmarkParticleSort();
+		BenchmarkLightClusters();
+		BenchmarkVertexFormats();
+		BenchmarkMeshLods();
+		BenchmarkGeometryArena();
+	}
+}
@@ -0,0 +1,9 @@
+#ifndef BENCHMARK_H_
+#define BENCHMARK_H_
+
+namespace Game {
+	// Time the CPU side systems at several problem sizes and print the results, run with -benchmark
+	void RunBenchmarks();
+}
+
+#endif
@@ -10,6 +10,34 @@
 namespace Game {
 	const float MOUSE_SENSITIVITY = 0.002f;
 
+	Frustum::Frustum() {}
+
+	Frustum::Frustum(const glm::mat4& viewProjection) {
+		// Extract the planes from the rows of the matrix (Gribb and Hartmann)
+
+		glm::mat4 m = glm::transpose(viewProjection);
+
+		planes[0] = m[3] + m[0]; // Left
+		planes[1] = m[3] - m[0]; // Right
+		planes[2] = m[3] + m[1]; // Bottom
+		planes[3] = m[3] - m[1]; // Top
+		planes[4] = m[3] + m[2]; // Near
+		planes[5] = m[3] - m[2]; // Far
+	}
+
+	bool Frustum::IsBoxVisible(glm::vec3 min, glm::vec3 max) const {
+		for (int i = 0; i < 6; i++) {
+			// Test the corner of the box furthest along the plane normal
+			glm::vec3 corner(planes[i].x > 0.0f ? max.x : min.x, planes[i].y > 0.0f ? max.y : min.y, planes[i].z > 0.0f ? max.z : min.z);
+
+			if (glm::dot(glm::vec3(planes[i]), corner) + planes[i].w < 0.0f) {
+				return false;
+			}
+		}
+
+		return true;
+	}
+
 	Camera::Camera() {}
 
 	Camera::~Camera() {}
@@ -80,6 +108,20 @@ namespace Game {
 		glUniformMatrix4fv(projectionMatrix, 1, GL_FALSE, glm::value_ptr(Camera::projectionMatrix));
 	}
 
+	glm::mat4 Camera::GetViewMatrix() {
+		SetupViewMatrix();
+
+		return viewMatrix;
+	}
+
+	glm::mat4 Camera::GetProjectionMatrix() {
+		return projectionMatrix;
+	}
+
+	Frustum Camera::GetFrustum() {
+		return Frustum(GetProjectionMatrix() * GetViewMatrix());
+	}
+
 	// Only used in gameplay phase
 	void Camera::Look(float x, float y, float width, float height) {
 		if (mouseStart) {
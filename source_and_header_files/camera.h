@@ -8,6 +8,17 @@
 #include <GLFW/glfw3.h>
 
 namespace Game {
+	// Planes of a view frustum, used for culling
+	struct Frustum {
+		glm::vec4 planes[6];
+
+		Frustum();
+		Frustum(const glm::mat4& viewProjection);
+
+		// Returns true if the axis aligned box is at least partly inside the frustum
+		bool IsBoxVisible(glm::vec3 min, glm::vec3 max) const;
+	};
+
 	class Camera {
 
 	public:
@@ -34,6 +45,12 @@ namespace Game {
 
 		void SetupShader(GLuint program);
 
+		glm::mat4 GetViewMatrix();
+		glm::mat4 GetProjectionMatrix();
+
+		// Returns the frustum of the current view, in world space
+		Frustum GetFrustum();
+
 		// Rotate the camera based on mouse input
 		void Look(float x, float y, float width, float height);
 
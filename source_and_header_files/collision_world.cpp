@@ -0,0 +1,277 @@
+#include <stdexcept>
+#include <string>
+#include <algorithm>
+#include "collision_world.h"
+
+namespace Game {
+	// Distance kept from surfaces after a hit, so the next sweep does not start touching
+	const float COLLISION_SKIN = 0.001f;
+
+	CollisionWorld::CollisionWorld() {}
+
+	CollisionWorld::~CollisionWorld() {}
+
+	void CollisionWorld::SetGrid(int width, int height, float cellSize, const std::vector<bool>& solid) {
+		if (solid.size() != width * height) {
+			throw(std::string("Collision world error: grid size does not match its cells"));
+		}
+
+		CollisionWorld::width = width;
+		CollisionWorld::height = height;
+		CollisionWorld::cellSize = cellSize;
+		CollisionWorld::solid = solid;
+	}
+
+	int CollisionWorld::AddCircle(glm::vec2 center, float radius, bool isDynamic) {
+		return props.AddCircle(center, radius, isDynamic);
+	}
+
+	int CollisionWorld::AddBox(glm::vec2 center, glm::vec2 halfExtents, bool isDynamic) {
+		return props.AddBox(center, halfExtents, isDynamic);
+	}
+
+	SpatialHash& CollisionWorld::GetProps() {
+		return props;
+	}
+
+	void CollisionWorld::Build() {
+		props.Build();
+	}
+
+	bool CollisionWorld::IsSolid(int x, int y) const {
+		// Nothing walks off the edge of the grid
+		if (x < 0 || x >= width || y < 0 || y >= height) {
+			return true;
+		}
+
+		return solid[y * width + x];
+	}
+
+	bool CollisionWorld::Overlaps(glm::vec2 center, float radius) const {
+		int x1 = (int)glm::floor((center.x - radius) / cellSize + 0.5f);
+		int x2 = (int)glm::floor((center.x + radius) / cellSize + 0.5f);
+		int y1 = (int)glm::floor((center.y - radius) / cellSize + 0.5f);
+		int y2 = (int)glm::floor((center.y + radius) / cellSize + 0.5f);
+
+		float half = cellSize / 2.0f;
+
+		for (int y = y1; y <= y2; y++) {
+			for (int x = x1; x <= x2; x++) {
+				if (!IsSolid(x, y)) {
+					continue;
+				}
+
+				glm::vec2 outside = glm::max(glm::abs(center - glm::vec2(x * cellSize, y * cellSize)) - glm::vec2(half, half), glm::vec2(0.0f));
+
+				if (glm::dot(outside, outside) < radius * radius) {
+					return true;
+				}
+			}
+		}
+
+		return props.Overlaps(center, radius);
+	}
+
+	CollisionWorld::Hit CollisionWorld::Sweep(glm::vec2 start, glm::vec2 end, float radius) const {
+		Hit hit;
+
+		hit.hit = false;
+		hit.time = 1.0f;
+		hit.normal = glm::vec2(0.0f);
+
+		glm::vec2 delta = end - start;
+
+		// Everything the circle can touch lies in the bounds of the move
+		glm::vec2 min = glm::min(start, end) - glm::vec2(radius, radius);
+		glm::vec2 max = glm::max(start, end) + glm::vec2(radius, radius);
+
+		// Grid cells
+
+		int x1 = (int)glm::floor(min.x / cellSize + 0.5f);
+		int x2 = (int)glm::floor(max.x / cellSize + 0.5f);
+		int y1 = (int)glm::floor(min.y / cellSize + 0.5f);
+		int y2 = (int)glm::floor(max.y / cellSize + 0.5f);
+
+		glm::vec2 half(cellSize / 2.0f, cellSize / 2.0f);
+
+		for (int y = y1; y <= y2; y++) {
+			for (int x = x1; x <= x2; x++) {
+				if (IsSolid(x, y)) {
+					SweepBox(start, delta, radius, glm::vec2(x * cellSize, y * cellSize), half, hit);
+				}
+			}
+		}
+
+		// Props
+
+		std::vector<int> ids;
+		props.Query(min, max, ids);
+
+		for (int i = 0; i < ids.size(); i++) {
+			const SpatialHash::Collider& collider = props.GetCollider(ids[i]);
+
+			if (collider.isCircle) {
+				SweepCircle(start, delta, radius, collider.center, collider.halfExtents.x, hit);
+			} else {
+				SweepBox(start, delta, radius, collider.center, collider.halfExtents, hit);
+			}
+		}
+
+		return hit;
+	}
+
+	glm::vec2 CollisionWorld::Move(glm::vec2 start, glm::vec2 end, float radius, int iterations) const {
+		glm::vec2 position = start;
+		glm::vec2 target = end;
+
+		for (int i = 0; i < iterations; i++) {
+			Hit hit = Sweep(position, target, radius);
+
+			if (!hit.hit) {
+				return target;
+			}
+
+			// Stop at the contact, slightly off the surface
+			glm::vec2 contact = position + (target - position) * hit.time + hit.normal * COLLISION_SKIN;
+
+			// Keep the part of the remaining move that runs along the surface
+			glm::vec2 remaining = target - contact;
+			remaining -= hit.normal * glm::dot(remaining, hit.normal);
+
+			position = contact;
+			target = contact + remaining;
+
+			if (glm::dot(remaining, remaining) < COLLISION_SKIN * COLLISION_SKIN) {
+				return position;
+			}
+		}
+
+		// Out of iterations, only take the slide if it is free
+		return Overlaps(target, radius) ? position : target;
+	}
+
+	void CollisionWorld::SweepCircle(glm::vec2 start, glm::vec2 delta, float radius, glm::vec2 center, float circleRadius, Hit& hit) {
+		// Ray against the circle grown by the moving radius: |start + delta * t - center| = radius + circleRadius
+
+		glm::vec2 offset = start - center;
+		float r = radius + circleRadius;
+
+		float a = glm::dot(delta, delta);
+		float b = glm::dot(offset, delta);
+		float c = glm::dot(offset, offset) - r * r;
+
+		if (c < 0.0f) {
+			// Already touching, only block moves that go further in
+			if (b < 0.0f && glm::dot(offset, offset) > 0.0f) {
+				hit.hit = true;
+				hit.time = 0.0f;
+				hit.normal = glm::normalize(offset);
+			}
+
+			return;
+		}
+
+		float discriminant = b * b - a * c;
+
+		if (a == 0.0f || b >= 0.0f || discriminant < 0.0f) {
+			return;
+		}
+
+		float t = (-b - glm::sqrt(discriminant)) / a;
+
+		if (t >= 0.0f && t <= hit.time) {
+			hit.hit = true;
+			hit.time = t;
+			hit.normal = glm::normalize(offset + delta * t);
+		}
+	}
+
+	void CollisionWorld::SweepBox(glm::vec2 start, glm::vec2 delta, float radius, glm::vec2 center, glm::vec2 halfExtents, Hit& hit) {
+		// Ray against the box grown by the moving radius, with rounded corners
+
+		glm::vec2 offset = start - center;
+
+		// Already touching, only block moves that go further in
+		glm::vec2 closest = glm::clamp(offset, -halfExtents, halfExtents);
+		glm::vec2 away = offset - closest;
+
+		if (glm::dot(away, away) <= radius * radius) {
+			glm::vec2 normal;
+
+			if (glm::dot(away, away) > 0.0f) {
+				normal = glm::normalize(away);
+			} else {
+				// Center inside the box, push out through the closest face
+				glm::vec2 depth = halfExtents - glm::abs(offset);
+				normal = depth.x < depth.y ? glm::vec2(offset.x < 0.0f ? -1.0f : 1.0f, 0.0f) : glm::vec2(0.0f, offset.y < 0.0f ? -1.0f : 1.0f);
+			}
+
+			if (glm::dot(delta, normal) < 0.0f) {
+				hit.hit = true;
+				hit.time = 0.0f;
+				hit.normal = normal;
+			}
+
+			return;
+		}
+
+		// Slabs of the grown box
+
+		glm::vec2 grown = halfExtents + glm::vec2(radius, radius);
+
+		float enter = -1e30f;
+		float exit = 1.0f;
+		int axis = -1;
+
+		for (int i = 0; i < 2; i++) {
+			if (delta[i] == 0.0f) {
+				if (glm::abs(offset[i]) > grown[i]) {
+					return;
+				}
+
+				continue;
+			}
+
+			float t1 = (-grown[i] - offset[i]) / delta[i];
+			float t2 = (grown[i] - offset[i]) / delta[i];
+
+			if (t1 > t2) {
+				std::swap(t1, t2);
+			}
+
+			if (t1 > enter) {
+				enter = t1;
+				axis = i;
+			}
+
+			exit = glm::min(exit, t2);
+
+			if (enter > exit) {
+				return;
+			}
+		}
+
+		if (axis < 0 || exit < 0.0f || enter > hit.time) {
+			return;
+		}
+
+		// Starting inside the grown box without touching means starting next to a corner
+		enter = glm::max(enter, 0.0f);
+
+		glm::vec2 point = offset + delta * enter;
+
+		// Entering through a corner of the grown box, the real shape there is a circle around the corner
+		if (glm::abs(point.x) > halfExtents.x && glm::abs(point.y) > halfExtents.y) {
+			glm::vec2 corner(point.x < 0.0f ? -halfExtents.x : halfExtents.x, point.y < 0.0f ? -halfExtents.y : halfExtents.y);
+
+			SweepCircle(start, delta, radius, center + corner, 0.0f, hit);
+
+			return;
+		}
+
+		hit.hit = true;
+		hit.time = enter;
+		hit.normal = glm::vec2(0.0f);
+		hit.normal[axis] = delta[axis] < 0.0f ? 1.0f : -1.0f;
+	}
+}
@@ -0,0 +1,64 @@
+#ifndef COLLISION_WORLD_H_
+#define COLLISION_WORLD_H_
+
+#include <vector>
+#include <glm/glm.hpp>
+#include "spatial_hash.h"
+
+namespace Game {
+	// All static geometry the player and the monster collide with, on the ground plane (x, z).
+	// Holds a grid of solid cells (the maze) and a broadphase of prop colliders, and moves circles through them
+	class CollisionWorld {
+
+	public:
+		// Result of a swept circle query
+		struct Hit {
+			bool hit;
+
+			// Fraction of the move done before touching, in [0, 1]
+			float time;
+			// Points away from the surface that was hit
+			glm::vec2 normal;
+		};
+
+		CollisionWorld();
+		~CollisionWorld();
+
+		// Solid cells, indexed [y * width + x]. Cell (x, y) is a box of side cellSize centered at (x, y) * cellSize
+		void SetGrid(int width, int height, float cellSize, const std::vector<bool>& solid);
+
+		// Props, see SpatialHash
+		int AddCircle(glm::vec2 center, float radius, bool isDynamic = false);
+		int AddBox(glm::vec2 center, glm::vec2 halfExtents, bool isDynamic = false);
+		SpatialHash& GetProps();
+
+		// Pack the static props, call once they are all added
+		void Build();
+
+		// Returns true if the circle overlaps a solid cell or a prop
+		bool Overlaps(glm::vec2 center, float radius) const;
+
+		// First contact of a circle moving from start to end
+		Hit Sweep(glm::vec2 start, glm::vec2 end, float radius) const;
+
+		// Move a circle from start towards end, sliding along whatever it hits. Returns where it stops
+		glm::vec2 Move(glm::vec2 start, glm::vec2 end, float radius, int iterations = 3) const;
+
+	private:
+		int width = 0;
+		int height = 0;
+		float cellSize = 1.0f;
+
+		std::vector<bool> solid;
+
+		SpatialHash props;
+
+		bool IsSolid(int x, int y) const;
+
+		// Sweep against a single shape, keeps the earliest hit
+		static void SweepCircle(glm::vec2 start, glm::vec2 delta, float radius, glm::vec2 center, float circleRadius, Hit& hit);
+		static void SweepBox(glm::vec2 start, glm::vec2 delta, float radius, glm::vec2 center, glm::vec2 halfExtents, Hit& hit);
+	};
+}
+
+#endif
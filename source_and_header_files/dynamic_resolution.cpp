@@ -0,0 +1,67 @@
+#include <cmath>
+#include <glm/glm.hpp>
+#include "dynamic_resolution.h"
+
+namespace Game {
+	// Frames averaged before the scale can change again, covers the latency of the GPU timer queries
+	const int SETTLE_FRAMES = 20;
+
+	// Aim a little below the target so small spikes do not drop frames, and only scale up with room to spare
+	const float TARGET_HEADROOM = 0.85f;
+	const float SCALE_DOWN_ABOVE = 0.95f;
+	const float SCALE_UP_BELOW = 0.7f;
+
+	// Largest changes in one step, scaling up is slower to avoid going back and forth
+	const float MAX_SCALE_DOWN = 0.15f;
+	const float MAX_SCALE_UP = 0.05f;
+
+	// Scales are rounded to sixteenths
+	const float SCALE_STEP = 1.0f / 16.0f;
+
+	DynamicResolution::DynamicResolution() {}
+
+	DynamicResolution::~DynamicResolution() {}
+
+	void DynamicResolution::SetTarget(float milliseconds) {
+		target = milliseconds;
+	}
+
+	void DynamicResolution::SetScaleRange(float minScale, float maxScale) {
+		DynamicResolution::minScale = minScale;
+		DynamicResolution::maxScale = glm::max(minScale, maxScale);
+
+		scale = glm::clamp(scale, DynamicResolution::minScale, DynamicResolution::maxScale);
+	}
+
+	void DynamicResolution::AddFrameTime(float milliseconds) {
+		average = frames == 0 ? milliseconds : glm::mix(average, milliseconds, 0.1f);
+		frames++;
+
+		if (frames < SETTLE_FRAMES) {
+			return;
+		}
+
+		if (average < target * SCALE_DOWN_ABOVE && average > target * SCALE_UP_BELOW) {
+			return;
+		}
+
+		// The cost of a frame grows with the pixel count, the square of the scale
+		float wanted = scale * std::sqrt(target * TARGET_HEADROOM / glm::max(average, 0.001f));
+		wanted = glm::clamp(wanted, scale - MAX_SCALE_DOWN, scale + MAX_SCALE_UP);
+		wanted = glm::clamp(std::round(wanted / SCALE_STEP) * SCALE_STEP, minScale, maxScale);
+
+		if (wanted != scale) {
+			// Measure again at the new size
+			scale = wanted;
+			frames = 0;
+		}
+	}
+
+	float DynamicResolution::GetScale() const {
+		return scale;
+	}
+
+	float DynamicResolution::GetAverageFrameTime() const {
+		return average;
+	}
+}
@@ -0,0 +1,40 @@
+#ifndef DYNAMIC_RESOLUTION_H_
+#define DYNAMIC_RESOLUTION_H_
+
+namespace Game {
+	// Picks the render scale from measured GPU frame times, lowering it when frames take longer than the target
+	// and raising it back when there is time to spare. The scale moves in steps and only after the average
+	// settled, so the render targets are not reallocated every frame
+	class DynamicResolution {
+
+	public:
+		DynamicResolution();
+		~DynamicResolution();
+
+		// GPU time a frame should take
+		void SetTarget(float milliseconds);
+		// Range the scale can move in, the scale is clamped into it
+		void SetScaleRange(float minScale, float maxScale);
+
+		// Add the GPU time of a drawn frame
+		void AddFrameTime(float milliseconds);
+
+		// Fraction of the window size to render at
+		float GetScale() const;
+		// Average GPU time since the scale last changed
+		float GetAverageFrameTime() const;
+
+	private:
+		float target = 1000.0f / 60.0f;
+
+		float minScale = 0.5f;
+		float maxScale = 1.0f;
+		float scale = 1.0f;
+
+		float average = 0.0f;
+		// Frames measured at the current scale
+		int frames = 0;
+	};
+}
+
+#endif
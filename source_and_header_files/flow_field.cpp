@@ -0,0 +1,167 @@
+#include <stdexcept>
+#include <string>
+#include "flow_field.h"
+
+namespace Game {
+	FlowField::FlowField() {}
+
+	FlowField::~FlowField() {}
+
+	void FlowField::SetGrid(int width, int height, float cellSize, const std::vector<bool>& solid) {
+		if (solid.size() != width * height) {
+			throw(std::string("Flow field error: grid size does not match its cells"));
+		}
+
+		FlowField::width = width;
+		FlowField::height = height;
+		FlowField::cellSize = cellSize;
+
+		emptyDistances.resize(width * height);
+
+		for (int i = 0; i < width * height; i++) {
+			emptyDistances[i] = solid[i] ? -2 : -1;
+		}
+
+		distances = emptyDistances;
+		queue.resize(width * height);
+
+		targetCell = -1;
+	}
+
+	int FlowField::GetCell(glm::vec2 position) const {
+		int x = (int)glm::floor(position.x / cellSize + 0.5f);
+		int y = (int)glm::floor(position.y / cellSize + 0.5f);
+
+		if (x < 0 || x >= width || y < 0 || y >= height) {
+			return -1;
+		}
+
+		return y * width + x;
+	}
+
+	bool FlowField::Update(glm::vec2 target) {
+		int cell = GetCell(target);
+
+		if (cell == targetCell) {
+			return false;
+		}
+
+		targetCell = cell;
+
+		distances = emptyDistances;
+
+		if (cell < 0 || distances[cell] == -2) {
+			return true;
+		}
+
+		// Breadth first search out from the target over open cells, four neighbours. Directions are
+		// worked out per agent from these distances, so a rebuild touches each cell once
+
+		int head = 0;
+		int tail = 0;
+
+		distances[cell] = 0;
+		queue[tail++] = cell;
+
+		while (head < tail) {
+			int current = queue[head++];
+			int distance = distances[current] + 1;
+
+			int x = current % width;
+
+			// Unreached open cells are -1, solid cells are -2
+			if (x > 0 && distances[current - 1] == -1) {
+				distances[current - 1] = distance;
+				queue[tail++] = current - 1;
+			}
+
+			if (x < width - 1 && distances[current + 1] == -1) {
+				distances[current + 1] = distance;
+				queue[tail++] = current + 1;
+			}
+
+			if (current >= width && distances[current - width] == -1) {
+				distances[current - width] = distance;
+				queue[tail++] = current - width;
+			}
+
+			if (current < (height - 1) * width && distances[current + width] == -1) {
+				distances[current + width] = distance;
+				queue[tail++] = current + width;
+			}
+		}
+
+		return true;
+	}
+
+	int FlowField::GetNext(int cell) const {
+		if (distances[cell] <= 0) {
+			return -1;
+		}
+
+		int x = cell % width;
+		int y = cell / width;
+
+		int best = -1;
+		float bestDistance = distances[cell];
+
+		// Closest neighbour, diagonals only when both sides are open so agents don't cut wall corners
+		for (int dy = -1; dy <= 1; dy++) {
+			for (int dx = -1; dx <= 1; dx++) {
+				int nx = x + dx;
+				int ny = y + dy;
+
+				if ((dx == 0 && dy == 0) || nx < 0 || nx >= width || ny < 0 || ny >= height) {
+					continue;
+				}
+
+				int n = ny * width + nx;
+
+				if (distances[n] < 0 || (dx != 0 && dy != 0 && (distances[y * width + nx] < 0 || distances[ny * width + x] < 0))) {
+					continue;
+				}
+
+				// Diagonal steps save a step on both axes
+				float distance = distances[n] + ((dx != 0 && dy != 0) ? 0.5f : 0.0f);
+
+				if (distance < bestDistance) {
+					best = n;
+					bestDistance = distance;
+				}
+			}
+		}
+
+		return best;
+	}
+
+	glm::vec2 FlowField::GetDirection(glm::vec2 position) const {
+		int cell = GetCell(position);
+
+		int next = cell < 0 ? -1 : GetNext(cell);
+
+		if (next < 0) {
+			return glm::vec2(0.0f);
+		}
+
+		// Head for the center of the next cell rather than along a fixed direction, so agents
+		// that are off center don't catch on walls
+		glm::vec2 center = glm::vec2(next % width, next / width) * cellSize;
+		glm::vec2 direction = center - position;
+
+		if (glm::dot(direction, direction) == 0.0f) {
+			return glm::vec2(0.0f);
+		}
+
+		return glm::normalize(direction);
+	}
+
+	int FlowField::GetDistance(glm::vec2 position) const {
+		int cell = GetCell(position);
+
+		if (cell < 0) {
+			return -1;
+		}
+
+		return glm::max(distances[cell], -1);
+	}
+}
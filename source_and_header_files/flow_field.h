@@ -0,0 +1,50 @@
+#ifndef FLOW_FIELD_H_
+#define FLOW_FIELD_H_
+
+#include <vector>
+#include <glm/glm.hpp>
+
+namespace Game {
+	// Distance field over a grid of solid cells towards a single target, used to steer any number of
+	// agents chasing it. Uses the same grid layout as CollisionWorld: cell (x, y) is centered at (x, y) * cellSize
+	class FlowField {
+
+	public:
+		FlowField();
+		~FlowField();
+
+		// Solid cells, indexed [y * width + x]
+		void SetGrid(int width, int height, float cellSize, const std::vector<bool>& solid);
+
+		// Rebuild the field if the target moved to another cell, returns true if it was rebuilt
+		bool Update(glm::vec2 target);
+
+		// Unit direction an agent at position should move in, zero if the target can't be reached from there
+		// or the agent shares the target's cell
+		glm::vec2 GetDirection(glm::vec2 position) const;
+
+		// Number of steps from the cell at position to the target, -1 if unreachable
+		int GetDistance(glm::vec2 position) const;
+
+	private:
+		int width = 0;
+		int height = 0;
+		float cellSize = 1.0f;
+
+		// Per cell: steps to the target, -1 if unreachable and -2 for solid cells
+		std::vector<int> distances;
+		// Distances before a rebuild, only the solid cells are marked
+		std::vector<int> emptyDistances;
+
+		// Reused between rebuilds
+		std::vector<int> queue;
+
+		int targetCell = -1;
+
+		int GetCell(glm::vec2 position) const;
+		// Neighbour of a reached cell that is closest to the target, -1 if none
+		int GetNext(int cell) const;
+	};
+}
+
+#endif
@@ -0,0 +1,111 @@
+#ifndef FRAME_PACKET_H_
+#define FRAME_PACKET_H_
+
+#define GLEW_STATIC
+
+#include <string>
+#include <vector>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include "resource.h"
+#include "particle_system.h"
+#include "shadow_map.h"
+#include "light_clusters.h"
+
+namespace Game {
+	// One piece of geometry to draw, copied out of the scene so it can be drawn while the scene changes
+	struct DrawItem {
+		GLuint arrayBuffer;
+		GLuint elementArrayBuffer;
+		GLsizei size;
+		// In indices, where the level of detail starts
+		GLuint firstIndex;
+		// Index count at full detail, for the triangle report
+		GLsizei fullSize;
+		GLint baseVertex;
+		GLenum mode;
+		// Attributes of the vertices, quantized positions are decoded by the world matrix
+		const VertexLayout* layout;
+
+		// Particles are drawn from the latest state buffer, known once the frame's steps ran
+		const ParticleSystem* particles;
+
+		// The program is looked up when drawing, a shader reload may swap it
+		const Resource* material;
+		GLuint texture;
+		// Bound with texture when not 0
+		GLuint normalMap;
+
+		bool isSkybox;
+		// Drawn in the transparent pass, after every opaque item
+		bool isBlended;
+
+		// Cascades the item casts a shadow into, one bit each, for the items of the shadow pass
+		unsigned int shadowCascades;
+
+		glm::mat4 worldMatrix;
+		glm::mat4 normalMatrix;
+	};
+
+	// Simulation step of a particle system, run on the GPU before the frame is drawn
+	struct ParticleStep {
+		ParticleSystem* particles;
+		const Resource* material;
+
+		// In world space
+		ParticleEmitter emitter;
+		ParticleForces forces;
+
+		// Terrain height texture to collide with, 0 for none
+		GLuint heightMap;
+		int heightMapSize;
+	};
+
+	// Everything the render thread needs to draw a frame. Filled by the game thread, then only read
+	struct FramePacket {
+		// Size of the window framebuffer
+		int width;
+		int height;
+
+		// The scene is drawn at this fraction of the window size, then scaled to the window.
+		// With a target frame time the render thread lowers the scale as needed to hold it, 0 to keep the scale
+		float renderScale;
+		float minRenderScale;
+		float targetFrameTime;
+
+		glm::mat4 viewMatrix;
+		glm::mat4 projectionMatrix;
+		glm::vec3 cameraPosition;
+
+		// Time the frame was simulated at, and since the previous frame
+		float time;
+		float deltaTime;
+
+		std::vector<ParticleStep> particleSteps;
+
+		// Scene nodes in drawing order
+		std::vector<DrawItem> items;
+
+		// Directional light shadows, drawn before the scene, and the opaque items casting them
+		ShadowCascades shadows;
+		std::vector<DrawItem> shadowItems;
+
+		// Point lights binned into the clusters of the camera
+		LightGrid lights;
+
+		// Screen space effect applied when displaying the frame, with its parameter and an optional overlay texture
+		const Resource* effect;
+		float effectParameter;
+		GLuint overlay;
+		// Halvings the scene is blurred over for the effect, 0 when it does not use the blur
+		int blurLevels;
+
+		// Print the GPU times of the screen passes every GPU_TIME_REPORT_FRAMES frames
+		bool reportGpuTimes;
+
+		// Shader files changed since the previous packet, reloaded before drawing
+		std::vector<std::string> changedShaders;
+	};
+}
+
+#endif
@@ -12,14 +12,46 @@ namespace Game {
 	const bool DISABLE_ENEMY = false;
 	const bool DISABLE_MAZE_COLLISIONS = false;
 
+	// Recompile shaders when their sources change on disk
+	const bool ENABLE_SHADER_HOT_RELOAD = true;
+
 	const std::string MUSIC = std::string(MATERIAL_DIRECTORY) + std::string("/music.wav");
 
 	const int FPS = 60;
 
 	const std::string WINDOW_TITLE = "The Maze";
 
-	const unsigned int WINDOW_WIDTH = FRAME_BUFFER_WIDTH;
-	const unsigned int WINDOW_HEIGHT = FRAME_BUFFER_HEIGHT;
+	const unsigned int WINDOW_WIDTH = 1920;
+	const unsigned int WINDOW_HEIGHT = 1080;
+
+	// Fraction of the window size the scene is drawn at, above 1 to supersample
+	const float RENDER_SCALE = 1.0f;
+
+	// Lower the render scale down to the minimum when the GPU cannot keep up with FPS
+	const bool ENABLE_DYNAMIC_RESOLUTION = true;
+	const float MIN_RENDER_SCALE = 0.5f;
+
+	// Halvings of the scene blurred for the monster proximity effect, each one doubles the blur radius
+	const int PROXIMITY_BLUR_LEVELS = 4;
+	// Distance at which the proximity effect starts
+	const float PROXIMITY_DISTANCE = 20.0f;
+
+	// Directional light shadows: cascades (0 to 4, 0 for none), texels along each side of a cascade, and
+	// the view distance they reach. Can be changed while running with SceneGraph::SetShadows
+	const int SHADOW_CASCADES = 3;
+	const int SHADOW_RESOLUTION = 2048;
+	const float SHADOW_DISTANCE = 80.0f;
+
+	// Point lights: the torches on the shrines, and the glow of the gems and the portal
+	const glm::vec3 TORCH_COLOR(4.0f, 2.2f, 0.8f);
+	const float TORCH_RADIUS = 8.0f;
+	const glm::vec3 GEM_LIGHT_COLOR(0.6f, 1.2f, 2.0f);
+	const float GEM_LIGHT_RADIUS = 3.0f;
+	const glm::vec3 PORTAL_LIGHT_COLOR(3.0f, 1.5f, 4.0f);
+	const float PORTAL_LIGHT_RADIUS = 6.0f;
+
+	// Print the GPU time of the frame and of every screen pass against its budget every few seconds
+	const bool ENABLE_GPU_TIME_REPORT = false;
 
 	const bool WINDOW_FULL_SCREEN = false;
 
@@ -34,13 +66,32 @@ namespace Game {
 
 	const float PLAYER_MOVE_SPEED = 0.1f;
 
+	// Size of the player and the monster when colliding with walls and props
+	const float PLAYER_RADIUS = 0.1f;
+	const float MONSTER_RADIUS = 0.5f;
+
+	// How far the player moves from the goal of the monster's path before a new one is found, one maze cell
+	const float MONSTER_REPATH_DISTANCE = 2.0f;
+	// How close the monster gets to a waypoint before heading for the next one
+	const float MONSTER_WAYPOINT_DISTANCE = 0.5f;
+
+	// Cylinders for the branches of the trees, numbered from the thinnest up, the thinner the fewer sides.
+	// Thicker levels share the last one
+	const int TREE_BRANCH_LEVELS = 4;
+
 	Game::Game() {}
 
 	Game::~Game() {
+		// The render thread may still be drawing if the game loop threw
+		renderThread.Stop();
+
 		glfwTerminate();
 	}
 
 	void Game::Initialize() {
+		// Workers for the per frame jobs, this thread is kept for drawing
+		jobs.Start();
+
 		InitializeWindow();
 		InitializeView();
 		InitializeEventHandlers();
@@ -49,6 +100,87 @@ namespace Game {
 	void Game::SetupResources() {
 		std::string filename;
 
+		// Materials/Shaders
+		// Compiles are only submitted here so the driver works on them while the rest of the assets load
+		{
+			// Load skybox shader
+			filename = std::string(MATERIAL_DIRECTORY) + std::string("/skybox");
+			resourceManager.LoadResource(ResourceType::Material, "SkyboxShader", filename.c_str());
+
+			// Load textured shader (default)
+			filename = std::string(MATERIAL_DIRECTORY) + std::string("/textured");
+			resourceManager.LoadResource(ResourceType::Material, "TexturedShader", filename.c_str());
+			// Normal mapped permutation, for cooked meshes
+			resourceManager.GetMaterialVariant("TexturedShader", "NORMAL_MAP");
+
+			// Load maze shader
+			filename = std::string(MATERIAL_DIRECTORY) + std::string("/maze");
+			resourceManager.LoadResource(ResourceType::Material, "MazeShader", filename.c_str());
+
+			// Load overlay shader
+			filename = std::string(MATERIAL_DIRECTORY) + std::string("/overlay");
+			resourceManager.LoadResource(ResourceType::Material, "OverlayShader", filename.c_str());
+
+			// Load fountain shader
+			filename = std::string(MATERIAL_DIRECTORY) + std::string("/fountain");
+			resourceManager.LoadResource(ResourceType::Material, "FountainShader", filename.c_str());
+
+			// Load shiny shader
+			filename = std::string(MATERIAL_DIRECTORY) + std::string("/shiny");
+			resourceManager.LoadResource(ResourceType::Material, "ShinyShader", filename.c_str());
+
+			// Load water shader
+			filename = std::string(MATERIAL_DIRECTORY) + std::string("/water");
+			resourceManager.LoadResource(ResourceType::Material, "WaterShader", filename.c_str());
+
+			// Load monster shader
+			filename = std::string(MATERIAL_DIRECTORY) + std::string("/monster");
+			resourceManager.LoadResource(ResourceType::Material, "MonsterShader", filename.c_str());
+
+			// Load leaves shader
+			filename = std::string(MATERIAL_DIRECTORY) + std::string("/leaf");
+			resourceManager.LoadResource(ResourceType::Material, "LeavesShader", filename.c_str());
+
+			// Load proximity shader
+			filename = std::string(MATERIAL_DIRECTORY) + std::string("/monster_sse");
+			resourceManager.LoadResource(ResourceType::Material, "ProximityShader", filename.c_str());
+
+			// Load portal shader
+			filename = std::string(MATERIAL_DIRECTORY) + std::string("/portal");
+			resourceManager.LoadResource(ResourceType::Material, "PortalShader", filename.c_str());
+
+			// Load blur chain shaders
+			filename = std::string(MATERIAL_DIRECTORY) + std::string("/blur_down");
+			resourceManager.LoadResource(ResourceType::Material, "BlurDownShader", filename.c_str());
+
+			filename = std::string(MATERIAL_DIRECTORY) + std::string("/blur_up");
+			resourceManager.LoadResource(ResourceType::Material, "BlurUpShader", filename.c_str());
+
+			// Load bloom shaders
+			filename = std::string(MATERIAL_DIRECTORY) + std::string("/bloom_threshold");
+			resourceManager.LoadResource(ResourceType::Material, "BloomThresholdShader", filename.c_str());
+
+			filename = std::string(MATERIAL_DIRECTORY) + std::string("/bloom_up");
+			resourceManager.LoadResource(ResourceType::Material, "BloomUpShader", filename.c_str());
+
+			// Load shadow caster depth shader
+			filename = std::string(MATERIAL_DIRECTORY) + std::string("/shadow_depth");
+			resourceManager.LoadResource(ResourceType::Material, "ShadowDepthShader", filename.c_str());
+
+			// Load transparency resolve shader
+			filename = std::string(MATERIAL_DIRECTORY) + std::string("/transparency");
+			resourceManager.LoadResource(ResourceType::Material, "TransparencyShader", filename.c_str());
+
+			// Load particle simulation step (transform feedback only)
+			filename = std::string(MATERIAL_DIRECTORY) + std::string("/particle_update");
+			resourceManager.LoadResource(ResourceType::Material, "ParticleUpdateShader", filename.c_str());
+
+			// Watch the shader sources for changes
+			if (ENABLE_SHADER_HOT_RELOAD) {
+				shaderWatcher.Start(MATERIAL_DIRECTORY);
+			}
+		}
+
 		// World
 		{
 			// Create terrain and maze resources
@@ -69,16 +201,20 @@ namespace Game {
 
 			// Particles
 
-			resourceManager.CreateFountainParticles("FountainParticles");
-			resourceManager.CreateLeafParticles(500);
-			resourceManager.CreateMonsterParticles(300);
+			resourceManager.CreateParticleSystem("FountainParticles", 20000, 2.0f);
+			resourceManager.CreateParticleSystem("LeafParticles", 500, 25.0f);
+			resourceManager.CreateParticleSystem("MonsterParticles", 300, 3.0f);
 			resourceManager.CreateLineParticles("Portal", 1000);
 		}
 
 		// Models
 		{
-			// Cylinder
-			resourceManager.CreateCylinder("Cylinder", 2.0f, 1.0f, 32.0f, 32.0f);
+			// Tree trunk and branches, generated together with the other procedural shapes below
+			resourceManager.CreateCylinder("Cylinder", 2.0f, 1.0f, 32, 32);
+
+			for (int i = 1; i <= TREE_BRANCH_LEVELS; i++) {
+				resourceManager.CreateCylinder("Branch" + std::to_string(i), 2.0f, 1.0f, 32, 4 + 4 * i);
+			}
 
 			// Crow
 			filename = std::string(MATERIAL_DIRECTORY) + std::string("/crow.obj");
@@ -145,55 +281,14 @@ namespace Game {
 			// Create bench resource
 			filename = std::string(MATERIAL_DIRECTORY) + std::string("/bench.obj");
 			resourceManager.LoadResource(ResourceType::Mesh, "Bench", filename.c_str());
-		}
-
-		// Materials/Shaders
-		{
-			// Load skybox shader
-			filename = std::string(MATERIAL_DIRECTORY) + std::string("/skybox");
-			resourceManager.LoadResource(ResourceType::Material, "SkyboxShader", filename.c_str());
-
-			// Load textured shader (default)
-			filename = std::string(MATERIAL_DIRECTORY) + std::string("/textured");
-			resourceManager.LoadResource(ResourceType::Material, "TexturedShader", filename.c_str());
-
-			// Load maze shader
-			filename = std::string(MATERIAL_DIRECTORY) + std::string("/maze");
-			resourceManager.LoadResource(ResourceType::Material, "MazeShader", filename.c_str());
-
-			// Load overlay shader
-			filename = std::string(MATERIAL_DIRECTORY) + std::string("/overlay");
-			resourceManager.LoadResource(ResourceType::Material, "OverlayShader", filename.c_str());
-
-			// Load fountain shader
-			filename = std::string(MATERIAL_DIRECTORY) + std::string("/fountain");
-			resourceManager.LoadResource(ResourceType::Material, "FountainShader", filename.c_str());
-
-			// Load shiny shader
-			filename = std::string(MATERIAL_DIRECTORY) + std::string("/shiny");
-			resourceManager.LoadResource(ResourceType::Material, "ShinyShader", filename.c_str());
-
-			// Load water shader
-			filename = std::string(MATERIAL_DIRECTORY) + std::string("/water");
-			resourceManager.LoadResource(ResourceType::Material, "WaterShader", filename.c_str());
 
-			// Load monster shader
-			filename = std::string(MATERIAL_DIRECTORY) + std::string("/monster");
-			resourceManager.LoadResource(ResourceType::Material, "MonsterShader", filename.c_str());
-
-			// Load leaves shader
-			filename = std::string(MATERIAL_DIRECTORY) + std::string("/leaf");
-			resourceManager.LoadResource(ResourceType::Material, "LeavesShader", filename.c_str());
-
-			// Load proximity shader
-			filename = std::string(MATERIAL_DIRECTORY) + std::string("/monster_sse");
-			resourceManager.LoadResource(ResourceType::Material, "ProximityShader", filename.c_str());
-
-			// Load portal shader
-			filename = std::string(MATERIAL_DIRECTORY) + std::string("/portal");
-			resourceManager.LoadResource(ResourceType::Material, "PortalShader", filename.c_str());
+			// Procedural shapes, generated side by side into one buffer
+			resourceManager.BuildGeometry(&jobs);
 		}
 
+		// Check the materials the driver already finished, the others keep compiling while the textures load
+		resourceManager.CollectReadyMaterials();
+
 		// Textures
 		{
 			// Load title texture
@@ -231,6 +326,7 @@ namespace Game {
 			// Load rock texture
 			filename = std::string(MATERIAL_DIRECTORY) + std::string("/rock.png");
 			resourceManager.LoadResource(ResourceType::Texture, "RockTexture", filename.c_str());
+			resourceManager.CreateNormalMap("RockNormalMap", filename.c_str());
 
 			// Load crow texture
 			filename = std::string(MATERIAL_DIRECTORY) + std::string("/crow.png");
@@ -261,13 +357,23 @@ namespace Game {
 			resourceManager.LoadResource(ResourceType::Texture, "LeafTexture", filename.c_str());
 		}
 
-		// Set up texture for screen space effects
-		scene.SetupDrawToTexture();
+		resourceManager.CollectReadyMaterials();
+
+		// Set up texture for screen space effects, resized by the render thread as needed
+		int width, height;
+
+		glfwGetFramebufferSize(window, &width, &height);
+		scene.SetupDrawToTexture(width, height);
+		scene.SetTransparencyMaterial(resourceManager.GetResource("TransparencyShader"));
+		scene.SetShadowMaterial(resourceManager.GetResource("ShadowDepthShader"));
+		scene.SetShadows(SHADOW_CASCADES, SHADOW_RESOLUTION, SHADOW_DISTANCE);
+		scene.SetBlurMaterials(resourceManager.GetResource("BlurDownShader"), resourceManager.GetResource("BlurUpShader"));
+		scene.SetBloomMaterials(resourceManager.GetResource("BloomThresholdShader"), resourceManager.GetResource("BloomUpShader"));
 	}
 
 	void Game::SetupScene() {
 		// Create terrain and maze
-		CreateInstance("Terrain", "Terrain", "TexturedShader", "TerrainTexture");
+		scene.AddNode(new TerrainNode("Terrain", resourceManager.GetTerrain(), resourceManager.GetResource("TexturedShader"), resourceManager.GetResource("TerrainTexture")));
 		CreateInstance("Maze", "Maze", "MazeShader", "MazeTexture");
 
 		CreateInstance("Skybox", "Skybox", "SkyboxShader", "SkyboxTexture");
@@ -276,6 +382,24 @@ namespace Game {
 		Collision c;
 		Gem g;
 
+		// Maze walls, shared by collisions and the monster's navigation
+		std::vector<bool> walls(MAP_SIZE * MAP_SIZE);
+
+		if (!DISABLE_MAZE_COLLISIONS) {
+			for (int y = 0; y < MAP_SIZE; y++) {
+				for (int x = 0; x < MAP_SIZE; x++) {
+					walls[y * MAP_SIZE + x] = resourceManager.IsMazeWall(x, y);
+				}
+			}
+		}
+
+		world.SetGrid(MAP_SIZE, MAP_SIZE, 2.0f, walls);
+		monsterField.SetGrid(MAP_SIZE, MAP_SIZE, 2.0f, walls);
+
+		navigation.SetGrid(MAP_SIZE, MAP_SIZE, 2.0f, walls);
+		navigation.Build();
+		navigation.Start();
+
 		// Center tree
 		CreateTree(5);
 
@@ -283,46 +407,75 @@ namespace Game {
 		c.position = glm::vec2(55.0f, 55.0f);
 		c.size = glm::vec3(1.0f, 0.0f, 0.0f);
 
-		collisions.push_back(c);
+		AddCollision(c);
 
 		// Crow
 		s = CreateCrow("Crow1", "CrowBody", "TexturedShader", "CrowTexture");
 		s = CreateCrow("Crow2", "CrowBody", "TexturedShader", "CrowTexture");
 		s = CreateCrow("Crow3", "CrowBody", "TexturedShader", "CrowTexture");
 
-		// Enemy
-		s = CreateInstance("Monster", "MonsterParticles", "MonsterShader", "MonsterTexture");
-		s->SetPosition(glm::vec3(110.0f, 2.0f, 110.0f));
+		// Enemy, a swarm held together by a spring towards its center
+		{
+			ParticleNode* p = CreateParticles("Monster", "MonsterParticles", "MonsterShader", "MonsterTexture");
+			p->SetPosition(glm::vec3(104.0f, 2.0f, 104.0f));
+
+			ParticleEmitter emitter = { glm::vec3(0.0f), 0.8f, glm::vec3(0.0f), 1.0f, 1.0f, 1.0f, 3.0f };
+			ParticleForces forces = { glm::vec3(0.0f), 1.0f, glm::vec3(0.0f), glm::vec3(0.0f), 6.0f, glm::vec3(0.0f), 0.6f, -1000.0f, 0.5f };
+
+			p->SetEmitter(emitter);
+			p->SetForces(forces);
+		}
 
-		// Leaves
-		s = CreateInstance("Leaves", "LeafParticles", "LeavesShader", "LeafTexture");
-		s->SetPosition(glm::vec3(55.0f, 13.0f, 55.0f));
+		// Leaves falling from the tree, drifting with the wind until they settle on the ground
+		{
+			ParticleNode* p = CreateParticles("Leaves", "LeafParticles", "LeavesShader", "LeafTexture");
+			p->SetPosition(glm::vec3(55.0f, 13.0f, 55.0f));
+
+			ParticleEmitter emitter = { glm::vec3(0.0f), 4.0f, glm::vec3(0.0f, -1.0f, 0.0f), 0.5f, 0.3f, 12.0f, 25.0f };
+			ParticleForces forces = { glm::vec3(0.0f, -0.3f, 0.0f), 1.5f, glm::vec3(0.4f, 0.0f, 0.2f), glm::vec3(0.0f), 0.0f, glm::vec3(0.0f), 0.6f, -1000.0f, 0.0f };
+
+			p->SetEmitter(emitter);
+			p->SetForces(forces);
+		}
 
 		// Rocks
 		{
-			for (int i = 0; i < 20; i++) {
+			const int numRocks = 20;
+
+			SceneNode* rocks[numRocks];
+			float x[numRocks], z[numRocks], heights[numRocks];
+
+			for (int i = 0; i < numRocks; i++) {
 				float r1 = ((float)rand() / (float)RAND_MAX) * 2.0f * glm::pi<float>();
 				float r2 = 7.0f + rand() % 16;
 				int r3 = rand() % 3;
 
 				if (r3 == 0) {
-					s = CreateInstance("Rock", "Rock1", "TexturedShader", "RockTexture");
+					rocks[i] = CreateInstance("Rock", "Rock1", "TexturedShader+NORMAL_MAP", "RockTexture");
 				} else if (r3 == 1) {
-					s = CreateInstance("Rock", "Rock2", "TexturedShader", "RockTexture");
+					rocks[i] = CreateInstance("Rock", "Rock2", "TexturedShader+NORMAL_MAP", "RockTexture");
 				} else {
-					s = CreateInstance("Rock", "Rock3", "TexturedShader", "RockTexture");
+					rocks[i] = CreateInstance("Rock", "Rock3", "TexturedShader+NORMAL_MAP", "RockTexture");
 				}
 
-				glm::vec2 pos = glm::vec2(55.0f + glm::cos((float)r1) * r2, 55.0f + glm::sin((float)r1) * r2);
+				rocks[i]->SetNormalMap(resourceManager.GetResource("RockNormalMap"));
 
-				s->SetPosition(glm::vec3(pos.x, resourceManager.GetTerrainHeightAt(pos.x, pos.y) - 0.1f, pos.y));
-				s->Scale(glm::vec3(0.5f, 0.5f, 0.5f));
+				x[i] = 55.0f + glm::cos((float)r1) * r2;
+				z[i] = 55.0f + glm::sin((float)r1) * r2;
+			}
+
+			// Snap all rocks to the ground at once
+			resourceManager.GetTerrainHeightsAt(numRocks, x, z, heights);
+
+			for (int i = 0; i < numRocks; i++) {
+				rocks[i]->SetPosition(glm::vec3(x[i], heights[i] - 0.1f, z[i]));
+				rocks[i]->Scale(glm::vec3(0.5f, 0.5f, 0.5f));
 
 				c.isPoint = true;
-				c.position = glm::vec2(pos.x, pos.y);
+				c.position = glm::vec2(x[i], z[i]);
 				c.size = glm::vec3(1.0f, 0.0f, 0.0f);
 
-				collisions.push_back(c);
+				AddCollision(c);
 			}
 		}
 
@@ -351,7 +504,7 @@ namespace Game {
 					c.position = glm::vec2(s->GetPosition().x, s->GetPosition().z);
 					c.size = glm::vec3(0.25f, 0.0f, 0.0f);
 
-					collisions.push_back(c);
+					AddCollision(c);
 
 					s = CreateInstance("Grave", "Grave", "TexturedShader", "TerrainTexture");
 					s->SetPosition(glm::vec3(5.0f + i * 2.0f, -0.02f, 6.0f + j * 4.0f));
@@ -383,7 +536,7 @@ namespace Game {
 					c.position = glm::vec2(s->GetPosition().x, s->GetPosition().z);
 					c.size = glm::vec3(0.4f, 0.0f, 0.0f);
 
-					collisions.push_back(c);
+					AddCollision(c);
 				}
 			}
 
@@ -395,14 +548,21 @@ namespace Game {
 			c.position = glm::vec2(s->GetPosition().x, s->GetPosition().z);
 			c.size = glm::vec3(2.0f, 0.0f, 0.0f);
 
-			collisions.push_back(c);
+			AddCollision(c);
 
 			s = CreateInstance("FountainWater", "WaterHole", "WaterShader", "TerrainTexture");
 			s->SetPosition(glm::vec3(98.5f, 0.0f, 98.5f));
 			s->Scale(glm::vec3(1.85f, 1.0f, 1.85f));
 
-			s = CreateInstance("FountainParticles", "FountainParticles", "FountainShader", "DropTexture");
-			s->SetPosition(glm::vec3(98.5f, 0.0f, 98.5f));
+			// Drops thrown up from the top of the fountain, splashing on the water
+			ParticleNode* p = CreateParticles("FountainParticles", "FountainParticles", "FountainShader", "DropTexture");
+			p->SetPosition(glm::vec3(98.5f, 0.0f, 98.5f));
+
+			ParticleEmitter emitter = { glm::vec3(0.0f, 1.5f, 0.0f), 0.2f, glm::vec3(0.0f, 1.0f, 0.0f), 1.0f, 1.5f, 1.5f, 2.0f };
+			ParticleForces forces = { glm::vec3(0.0f, -1.5f, 0.0f), 0.0f, glm::vec3(0.2f, 0.0f, 0.1f), glm::vec3(0.0f), 0.0f, glm::vec3(0.0f), 0.6f, 0.0f, 0.3f };
+
+			p->SetEmitter(emitter);
+			p->SetForces(forces);
 		}
 
 		// Theater
@@ -418,7 +578,7 @@ namespace Game {
 					c.position = glm::vec2(s->GetPosition().x, s->GetPosition().z);
 					c.size = glm::vec3(0.4f, 1.2f, 1.0f);
 
-					collisions.push_back(c);
+					AddCollision(c);
 				}
 			}
 
@@ -430,7 +590,8 @@ namespace Game {
 			c.position = glm::vec2(10.0f, 94.0f);
 			c.size = glm::vec3(0.5f, 0.5f, 0.5f);
 
-			collisions.push_back(c);
+			AddCollision(c);
+			AddTorch(glm::vec3(10.0f, 1.5f, 94.0f));
 
 			s = CreateInstance("Shrine", "Shrine1", "TexturedShader", "RockTexture");
 			s->SetPosition(glm::vec3(16.0f, 0.0f, 94.0f));
@@ -440,7 +601,8 @@ namespace Game {
 			c.position = glm::vec2(16.0f, 94.0f);
 			c.size = glm::vec3(0.5f, 0.5f, 0.5f);
 
-			collisions.push_back(c);
+			AddCollision(c);
+			AddTorch(glm::vec3(16.0f, 1.5f, 94.0f));
 
 			s = CreateInstance("Stage", "Stage", "TexturedShader", "WoodTexture");
 			s->SetPosition(glm::vec3(5.0f, 0.0f, 100.0f));
@@ -450,7 +612,7 @@ namespace Game {
 			c.position = glm::vec2(5.0f, 100.0f);
 			c.size = glm::vec3(2.5f, 5.1f, 5.0f);
 
-			collisions.push_back(c);
+			AddCollision(c);
 		}
 
 		// Shrine
@@ -471,7 +633,7 @@ namespace Game {
 				c.position = glm::vec2(s->GetPosition().x, s->GetPosition().z);
 				c.size = glm::vec3(1.0f, 0.0f, 0.0f);
 
-				collisions.push_back(c);
+				AddCollision(c);
 			}
 
 			s = CreateInstance("Shrine", "Shrine2", "TexturedShader", "RockTexture");
@@ -482,7 +644,8 @@ namespace Game {
 			c.position = glm::vec2(99.5f, 8.5f);
 			c.size = glm::vec3(1.1f, 1.1f, 1.1f);
 
-			collisions.push_back(c);
+			AddCollision(c);
+			AddTorch(glm::vec3(99.5f, 2.0f, 8.5f));
 		}
 
 		// Place gems throughout the maze
@@ -502,6 +665,7 @@ namespace Game {
 
 			g.id = i;
 			g.location = glm::vec2(x * 2.0f, z * 2.0f);
+			g.light = scene.AddLight({ glm::vec3(x * 2.0f, 0.8f, z * 2.0f), GEM_LIGHT_RADIUS, GEM_LIGHT_COLOR });
 
 			gems.push_back(g);
 		}
@@ -519,61 +683,60 @@ namespace Game {
 		s->SetPosition(glm::vec3(x * 2.0f, 0.5f, z * 2.0f));
 		s->SetScale(glm::vec3(0.75f, 0.75f, 0.75f));
 
+		scene.AddLight({ glm::vec3(x * 2.0f, 1.0f, z * 2.0f), PORTAL_LIGHT_RADIUS, PORTAL_LIGHT_COLOR });
+
+		// Pack the colliders of the props placed above
+		world.Build();
+
 		// Play music
 		PlaySound(TEXT(MUSIC.c_str()), NULL, SND_ASYNC | SND_LOOP);
 	}
 
 	void Game::MainLoop() {
-		while (!glfwWindowShouldClose(window)) {
-			// Maintain consistent framerate
-			if (1.0f / (float)FPS > glfwGetTime() - lastFrame) {
-				continue;
-			}
+		// From here on only the render thread uses GL, so the resources the frames refer to are looked up first
 
-			lastFrame = glfwGetTime();
+		resourceManager.CollectMaterials();
 
-			// Crows
-			{
-				SceneNode* crow1 = scene.GetNode("Crow1");
-				SceneNode* crow2 = scene.GetNode("Crow2");
-				SceneNode* crow3 = scene.GetNode("Crow3");
+		const Resource* overlayShader = resourceManager.GetResource("OverlayShader");
+		const Resource* proximityShader = resourceManager.GetResource("ProximityShader");
 
-				float crowPositionAngle1 = 10.0f + glfwGetTime() * 0.25f;
-				float crowPositionAngle2 = 70.0f + glfwGetTime() * 0.23f;
-				float crowPositionAngle3 = 30.0f + glfwGetTime() * 0.3f;
+		GLuint titleTexture = resourceManager.GetResource("TitleTexture")->GetResource();
+		GLuint lossTexture = resourceManager.GetResource("LossTexture")->GetResource();
+		GLuint winTexture = resourceManager.GetResource("WinTexture")->GetResource();
+		GLuint pausedTexture = resourceManager.GetResource("PausedTexture")->GetResource();
 
-				crow1->SetPosition(glm::vec3(55.0f + glm::cos(crowPositionAngle1) * 25.0f, 25.0f, 55.0f + glm::sin(crowPositionAngle1) * 25.0f));
-				crow2->SetPosition(glm::vec3(55.0f + -glm::cos(crowPositionAngle2) * 30.0f, 30.0f, 55.0f + glm::sin(crowPositionAngle2) * 30.0f));
-				crow3->SetPosition(glm::vec3(55.0f + glm::cos(crowPositionAngle3) * 20.0f, 35.0f, 55.0f + glm::sin(crowPositionAngle3) * 20.0f));
+		renderThread.Start(window, &scene, &resourceManager);
 
-				float crowViewAngle1 = glm::acos(cos(crowPositionAngle1)) * (glm::sin(crowPositionAngle1) > 0 ? -1 : 1);
-				float crowViewAngle2 = glm::acos(cos(crowPositionAngle2)) * (glm::sin(crowPositionAngle2) > 0 ? -1 : 1);
-				float crowViewAngle3 = glm::acos(cos(crowPositionAngle3)) * (glm::sin(crowPositionAngle3) > 0 ? -1 : 1);
-
-				glm::quat base = (glm::normalize(glm::angleAxis(glm::radians(90.0f), glm::vec3(1.0f, 0.0f, 0.0f))));
-
-				crow1->SetOrientation(glm::normalize(glm::angleAxis(crowViewAngle1, CAMERA_UP)));
-				crow1->Rotate(base);
+		while (!glfwWindowShouldClose(window)) {
+			// Maintain consistent framerate
+			if (1.0f / (float)FPS > glfwGetTime() - lastFrame) {
+				continue;
+			}
 
-				crow2->SetOrientation(glm::normalize(glm::angleAxis(-crowViewAngle2, CAMERA_UP)));
-				crow2->Rotate(base);
+			// Time since the previous frame for the particle simulation, a stall counts as one long frame
+			float deltaTime = glm::min((float)(glfwGetTime() - lastFrame), 0.1f);
 
-				crow3->SetOrientation(glm::normalize(glm::angleAxis(crowViewAngle3, CAMERA_UP)));
-				crow3->Rotate(base);
-			}
+			lastFrame = glfwGetTime();
 
-			// Gems
+			// Animation and AI run as jobs while this thread handles the player, the transforms are evaluated
+			// once they are all done
+			JobCounter simulation;
 
-			glm::quat gemOrientation = glm::normalize(glm::angleAxis((float)glfwGetTime(), glm::vec3(0.0f, 1.0f, 0.0f)));
+			float time = (float)glfwGetTime();
 
-			for (int i = 0; i < gems.size(); i++) {
-				std::string name = "Gem" + std::to_string(i);
+			jobs.Run([this, time]() {
+				AnimateCrows(time);
+			}, &simulation);
 
-				SceneNode* s = scene.GetNode(name);
+			jobs.Run([this, time]() {
+				AnimateGems(time);
+			}, &simulation);
 
-				// Rotate gem
-				s->SetOrientation(gemOrientation);
-			}
+			// Screen space effect and overlay for the phase
+			const Resource* effect = overlayShader;
+			float effectParameter = 0.0f;
+			GLuint overlay = 0;
+			int blurLevels = 0;
 
 			// Start screen
 			if (phase == 0) {
@@ -587,37 +750,26 @@ namespace Game {
 
 				camera.SetOrientation(glm::angleAxis(viewAngle + 1.25f * glm::pi<float>(), CAMERA_UP));
 
-				// Move skybox to player position
-				scene.GetNode("Skybox")->SetPosition(camera.GetPosition());
-
 				// Draw title text
-				scene.DrawToTexture(&camera);
-				scene.DisplayTexture(resourceManager.GetResource("OverlayShader")->GetResource(), 0.0f, resourceManager.GetResource("TitleTexture")->GetResource());
+				overlay = titleTexture;
 
 				// Gameplay
 			} else if (phase == 1) {
 				// Have monster track player, and activate screenspace effect if nearby
 
-				SceneNode* monster = scene.GetNode("Monster");
+				float distance = glm::distance(camera.GetPosition(), scene.GetNode("Monster")->GetPosition());
 
-				glm::vec3 direction = camera.GetPosition() - monster->GetPosition();
+				glm::vec3 playerPosition = camera.GetPosition();
 
-				float distance = glm::distance(camera.GetPosition(), monster->GetPosition());
-
-				// Move monster
-				monster->SetPosition(monster->GetPosition() + glm::normalize(direction) * PLAYER_MOVE_SPEED * 0.4f);
-				monster->SetPosition(glm::vec3(monster->GetPosition().x, 1.0f + resourceManager.GetTerrainHeightAt(monster->GetPosition().x, monster->GetPosition().z), monster->GetPosition().z));
+				jobs.Run([this, playerPosition]() {
+					MoveMonster(playerPosition);
+				}, &simulation);
 
 				// Check proximity and change game state to game over if it gets too close
 				if (distance <= 1.0f) {
 					phase = 2;
 				}
 
-				// Hide enemy
-				if (DISABLE_ENEMY) {
-					monster->SetPosition(glm::vec3(-100.0f, -100.0f, -100.0f));
-				}
-
 				// Used to calculate collisions
 				glm::vec3 nextPosition = camera.GetPosition();
 
@@ -632,16 +784,17 @@ namespace Game {
 					nextPosition += camera.GetSide() * PLAYER_MOVE_SPEED;
 				}
 
-				// Check for collisions
-				if (CheckCollisions(glm::vec2(nextPosition.x, nextPosition.z))) {
-					nextPosition = camera.GetPosition();
-				} else {
-					CheckGems(glm::vec2(nextPosition.x, nextPosition.z));
+				// Check for collisions, sliding along walls and props
+				glm::vec2 position = world.Move(glm::vec2(camera.GetPosition().x, camera.GetPosition().z), glm::vec2(nextPosition.x, nextPosition.z), PLAYER_RADIUS);
 
-					// If the player is at the portal they win
-					if (glm::distance(camera.GetPosition(), scene.GetNode("Portal")->GetPosition()) < 1.5f) {
-						phase = 3;
-					}
+				nextPosition.x = position.x;
+				nextPosition.z = position.y;
+
+				CheckGems(position);
+
+				// If the player is at the portal they win
+				if (glm::distance(camera.GetPosition(), scene.GetNode("Portal")->GetPosition()) < 1.5f) {
+					phase = 3;
 				}
 
 				// Set player height
@@ -650,47 +803,197 @@ namespace Game {
 				// Move player
 				camera.SetPosition(nextPosition);
 
-				// Move skybox to player position
-				scene.GetNode("Skybox")->SetPosition(camera.GetPosition());
+				// The shader only knows the distance relative to where the effect starts
+				effect = proximityShader;
+				effectParameter = distance / PROXIMITY_DISTANCE;
 
-				// Render scene
-				scene.DrawToTexture(&camera);
-				scene.DisplayTexture(resourceManager.GetResource("ProximityShader")->GetResource(), distance);
+				// The effect blends towards a blurred scene once the monster is near
+				if (distance <= PROXIMITY_DISTANCE) {
+					blurLevels = PROXIMITY_BLUR_LEVELS;
+				}
 
 				// Loss screen
 			} else if (phase == 2) {
-				// Move skybox to player position
-				scene.GetNode("Skybox")->SetPosition(camera.GetPosition());
-
-				// Draw paused text
-				scene.DrawToTexture(&camera);
-				scene.DisplayTexture(resourceManager.GetResource("OverlayShader")->GetResource(), 0.0f, resourceManager.GetResource("LossTexture")->GetResource());
+				overlay = lossTexture;
 
 				// Win screen
 			} else if (phase == 3) {
-				// Move skybox to player position
-				scene.GetNode("Skybox")->SetPosition(camera.GetPosition());
-
-				// Draw paused text
-				scene.DrawToTexture(&camera);
-				scene.DisplayTexture(resourceManager.GetResource("OverlayShader")->GetResource(), 0.0f, resourceManager.GetResource("WinTexture")->GetResource());
+				overlay = winTexture;
 
 				// Paused
 			} else {
-				// Move skybox to player position
-				scene.GetNode("Skybox")->SetPosition(camera.GetPosition());
+				overlay = pausedTexture;
+			}
+
+			// Move skybox to player position
+			scene.GetNode("Skybox")->SetPosition(camera.GetPosition());
+
+			AnimateLights(time);
+
+			// Transforms and culling, once the animation and AI jobs are done
+			JobCounter transforms;
+
+			jobs.Run([this]() {
+				scene.Update(&camera, &jobs);
+			}, &transforms, &simulation);
+
+			jobs.Wait(&transforms);
+
+			// Hand the frame to the render thread, waits if it is still busy with the frame before last
+			FramePacket* packet = renderThread.BeginFrame();
 
-				// Draw paused text
-				scene.DrawToTexture(&camera);
-				scene.DisplayTexture(resourceManager.GetResource("OverlayShader")->GetResource(), 0.0f, resourceManager.GetResource("PausedTexture")->GetResource());
+			glfwGetFramebufferSize(window, &packet->width, &packet->height);
+
+			packet->renderScale = RENDER_SCALE;
+			packet->minRenderScale = MIN_RENDER_SCALE;
+			packet->targetFrameTime = ENABLE_DYNAMIC_RESOLUTION ? 1000.0f / FPS : 0.0f;
+
+			packet->time = time;
+			packet->deltaTime = deltaTime;
+
+			scene.Collect(&camera, packet);
+
+			packet->effect = effect;
+			packet->effectParameter = effectParameter;
+			packet->overlay = overlay;
+			packet->blurLevels = blurLevels;
+			packet->reportGpuTimes = ENABLE_GPU_TIME_REPORT;
+
+			// Changed shaders are recompiled by the render thread
+			packet->changedShaders.clear();
+
+			if (ENABLE_SHADER_HOT_RELOAD) {
+				packet->changedShaders = shaderWatcher.GetChangedFiles();
 			}
 
-			// Push buffer drawn in the background onto the display
-			glfwSwapBuffers(window);
+			renderThread.SubmitFrame(packet);
 
 			// Update other events like input handling
 			glfwPollEvents();
 		}
+
+		renderThread.Stop();
+	}
+
+	void Game::AnimateCrows(float time) {
+		SceneNode* crow1 = scene.GetNode("Crow1");
+		SceneNode* crow2 = scene.GetNode("Crow2");
+		SceneNode* crow3 = scene.GetNode("Crow3");
+
+		float crowPositionAngle1 = 10.0f + time * 0.25f;
+		float crowPositionAngle2 = 70.0f + time * 0.23f;
+		float crowPositionAngle3 = 30.0f + time * 0.3f;
+
+		crow1->SetPosition(glm::vec3(55.0f + glm::cos(crowPositionAngle1) * 25.0f, 25.0f, 55.0f + glm::sin(crowPositionAngle1) * 25.0f));
+		crow2->SetPosition(glm::vec3(55.0f + -glm::cos(crowPositionAngle2) * 30.0f, 30.0f, 55.0f + glm::sin(crowPositionAngle2) * 30.0f));
+		crow3->SetPosition(glm::vec3(55.0f + glm::cos(crowPositionAngle3) * 20.0f, 35.0f, 55.0f + glm::sin(crowPositionAngle3) * 20.0f));
+
+		float crowViewAngle1 = glm::acos(cos(crowPositionAngle1)) * (glm::sin(crowPositionAngle1) > 0 ? -1 : 1);
+		float crowViewAngle2 = glm::acos(cos(crowPositionAngle2)) * (glm::sin(crowPositionAngle2) > 0 ? -1 : 1);
+		float crowViewAngle3 = glm::acos(cos(crowPositionAngle3)) * (glm::sin(crowPositionAngle3) > 0 ? -1 : 1);
+
+		glm::quat base = (glm::normalize(glm::angleAxis(glm::radians(90.0f), glm::vec3(1.0f, 0.0f, 0.0f))));
+
+		crow1->SetOrientation(glm::normalize(glm::angleAxis(crowViewAngle1, CAMERA_UP)));
+		crow1->Rotate(base);
+
+		crow2->SetOrientation(glm::normalize(glm::angleAxis(-crowViewAngle2, CAMERA_UP)));
+		crow2->Rotate(base);
+
+		crow3->SetOrientation(glm::normalize(glm::angleAxis(crowViewAngle3, CAMERA_UP)));
+		crow3->Rotate(base);
+	}
+
+	void Game::AnimateGems(float time) {
+		glm::quat gemOrientation = glm::normalize(glm::angleAxis(time, glm::vec3(0.0f, 1.0f, 0.0f)));
+
+		for (int i = 0; i < gems.size(); i++) {
+			std::string name = "Gem" + std::to_string(i);
+
+			SceneNode* s = scene.GetNode(name);
+
+			// Rotate gem
+			s->SetOrientation(gemOrientation);
+		}
+	}
+
+	void Game::AnimateLights(float time) {
+		for (int i = 0; i < torches.size(); i++) {
+			const Torch& torch = torches[i];
+
+			// Sum of unrelated waves, offset per torch so they do not flicker together
+			float phase = time * 7.0f + i * 1.7f;
+			float flicker = 0.85f + 0.1f * glm::sin(phase) + 0.05f * glm::sin(phase * 2.3f + 0.5f);
+
+			PointLight light = scene.GetLight(torch.light);
+			light.color = torch.color * flicker;
+			light.radius = torch.radius * (0.95f + 0.05f * flicker);
+
+			scene.SetLight(torch.light, light);
+		}
+	}
+
+	void Game::MoveMonster(glm::vec3 playerPosition) {
+		SceneNode* monster = scene.GetNode("Monster");
+
+		// Hide enemy
+		if (DISABLE_ENEMY) {
+			monster->SetPosition(glm::vec3(-100.0f, -100.0f, -100.0f));
+			return;
+		}
+
+		glm::vec3 direction = playerPosition - monster->GetPosition();
+
+		glm::vec2 monsterPosition = glm::vec2(monster->GetPosition().x, monster->GetPosition().z);
+		glm::vec2 goal = glm::vec2(playerPosition.x, playerPosition.z);
+
+		// Ask for a new path once the player left the goal of the last one, the old path is followed meanwhile
+		if (monsterTicket < 0 && glm::distance(goal, monsterGoal) > MONSTER_REPATH_DISTANCE) {
+			monsterTicket = navigation.RequestPath(monsterPosition, goal);
+			monsterGoal = goal;
+		}
+
+		std::vector<glm::vec2> waypoints;
+		bool found;
+
+		if (monsterTicket >= 0 && navigation.GetPath(monsterTicket, waypoints, found)) {
+			monsterTicket = -1;
+
+			monsterPath.swap(waypoints);
+			monsterWaypoint = 0;
+
+			if (!found) {
+				monsterPath.clear();
+			}
+		}
+
+		// Skip the waypoints already reached
+		while (monsterWaypoint < monsterPath.size() && glm::distance(monsterPosition, monsterPath[monsterWaypoint]) < MONSTER_WAYPOINT_DISTANCE) {
+			monsterWaypoint++;
+		}
+
+		glm::vec2 step(0.0f);
+
+		if (monsterWaypoint < monsterPath.size()) {
+			step = glm::normalize(monsterPath[monsterWaypoint] - monsterPosition) * PLAYER_MOVE_SPEED * 0.4f;
+		} else {
+			// No path yet, or its end was reached: follow the maze towards the player, the field is only rebuilt
+			// when the player changes cell
+			monsterField.Update(goal);
+
+			step = monsterField.GetDirection(monsterPosition) * PLAYER_MOVE_SPEED * 0.4f;
+		}
+
+		// Straight at the player once in the same cell
+		if (step == glm::vec2(0.0f)) {
+			glm::vec3 straight = glm::normalize(direction) * PLAYER_MOVE_SPEED * 0.4f;
+			step = glm::vec2(straight.x, straight.z);
+		}
+
+		// Move monster, sliding along walls
+		monsterPosition = world.Move(monsterPosition, monsterPosition + step, MONSTER_RADIUS);
+
+		monster->SetPosition(glm::vec3(monsterPosition.x, 1.0f + resourceManager.GetTerrainHeightAt(monsterPosition.x, monsterPosition.y), monsterPosition.y));
 	}
 
 	void Game::InitializeWindow() {
@@ -852,8 +1155,7 @@ namespace Game {
 	}
 
 	void Game::ResizeCallback(GLFWwindow* window, int width, int height) {
-		// Set up viewport and camera projection based on new window size
-		glViewport(0, 0, width, height);
+		// Set up camera projection based on new window size, the render thread follows the viewport size
 
 		// Get user data with a pointer to the game class
 		Game* game = (Game*)glfwGetWindowUserPointer(window);
@@ -862,6 +1164,32 @@ namespace Game {
 		game->camera.SetProjection(CAMERA_FOV, CAMERA_NEAR_PLANE, CAMERA_FAR_PLANE, width, height);
 	}
 
+	ParticleNode* Game::CreateParticles(std::string entityName, std::string particlesName, std::string materialName, std::string textureName) {
+		ParticleSystem* particles = resourceManager.GetParticleSystem(particlesName);
+
+		if (!particles) {
+			throw(std::string("Could not find particle system \"") + particlesName + std::string("\""));
+		}
+
+		Resource* material = resourceManager.GetResource(materialName);
+
+		if (!material) {
+			throw(std::string("Could not find resource \"") + materialName + std::string("\""));
+		}
+
+		Resource* texture = resourceManager.GetResource(textureName);
+
+		if (!texture) {
+			throw(std::string("Could not find resource \"") + textureName + std::string("\""));
+		}
+
+		ParticleNode* node = new ParticleNode(entityName, particles, resourceManager.GetResource("ParticleUpdateShader"), material, texture, resourceManager.GetTerrain());
+
+		scene.AddNode(node);
+
+		return node;
+	}
+
 	SceneNode* Game::CreateInstance(std::string entityName, std::string objectName, std::string materialName, std::string textureName) {
 		Resource* geometry = resourceManager.GetResource(objectName);
 
@@ -922,7 +1250,7 @@ namespace Game {
 		else {
 			// 2 Branches
 			for (int j = -1; j < 2; j += 2) {
-				SceneNode* branch = CreateBranchInstance("Branch", "Cylinder", "TexturedShader");
+				SceneNode* branch = CreateBranchInstance("Branch", "Branch" + std::to_string(glm::min(i, TREE_BRANCH_LEVELS)), "TexturedShader");
 
 				branch->SetParent(parent);
 
@@ -1014,41 +1342,22 @@ namespace Game {
 		return body;
 	}
 
-	bool Game::CheckCollisions(glm::vec2 position) {
-		glm::vec2 mazeCheck = glm::vec2(glm::round(camera.GetPosition().x / 2.0f), glm::round(camera.GetPosition().z / 2.0f));
-		glm::vec3 mazePosition = glm::vec3(position.x, 0.0f, position.y);
-
-		if (!DISABLE_MAZE_COLLISIONS) {
-			if (resourceManager.GetMazeCollisions(mazeCheck.x - 1, mazeCheck.y, mazePosition)) {
-				return true;
-			} else if (resourceManager.GetMazeCollisions(mazeCheck.x + 1, mazeCheck.y, mazePosition)) {
-				return true;
-			} else if (resourceManager.GetMazeCollisions(mazeCheck.x, mazeCheck.y - 1, mazePosition)) {
-				return true;
-			} else if (resourceManager.GetMazeCollisions(mazeCheck.x, mazeCheck.y + 1, mazePosition)) {
-				return true;
-			} else if (resourceManager.GetMazeCollisions(mazeCheck.x - 1, mazeCheck.y - 1, mazePosition)) {
-				return true;
-			} else if (resourceManager.GetMazeCollisions(mazeCheck.x - 1, mazeCheck.y + 1, mazePosition)) {
-				return true;
-			} else if (resourceManager.GetMazeCollisions(mazeCheck.x + 1, mazeCheck.y - 1, mazePosition)) {
-				return true;
-			} else if (resourceManager.GetMazeCollisions(mazeCheck.x + 1, mazeCheck.y + 1, mazePosition)) {
-				return true;
-			}
+	void Game::AddCollision(const Collision& c) {
+		if (c.isPoint) {
+			world.AddCircle(c.position, c.size.x);
+		} else {
+			world.AddBox(c.position, glm::vec2(c.size.x, c.size.y));
 		}
+	}
 
-		for (int i = 0; i < collisions.size(); i++) {
-			Collision c = collisions[i];
+	void Game::AddTorch(glm::vec3 position) {
+		Torch torch;
 
-			if (c.isPoint && glm::distance(position, c.position) < c.size.x) {
-				return true;
-			} else if (position.x < c.position.x + c.size.x && position.x > c.position.x - c.size.x && position.y < c.position.y + c.size.y && position.y > c.position.y - c.size.y) {
-				return true;
-			}
-		}
+		torch.color = TORCH_COLOR;
+		torch.radius = TORCH_RADIUS;
+		torch.light = scene.AddLight({ position, TORCH_RADIUS, TORCH_COLOR });
 
-		return false;
+		torches.push_back(torch);
 	}
 
 	void Game::CheckGems(glm::vec2 position) {
@@ -1061,6 +1370,13 @@ namespace Game {
 				// Hide gem outside of bounds
 				s->SetPosition(glm::vec3(-10.0f, -10.0f, -10.0f));
 
+				// Put its light out
+				PointLight light = scene.GetLight(gems[i].light);
+				light.color = glm::vec3(0.0f);
+				light.radius = 0.0f;
+
+				scene.SetLight(gems[i].light, light);
+
 				return;
 			}
 		}
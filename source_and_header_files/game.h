@@ -12,6 +12,14 @@
 #include "scene_graph.h"
 #include "resource_manager.h"
 #include "camera.h"
+#include "shader_watcher.h"
+#include "terrain_node.h"
+#include "particle_node.h"
+#include "collision_world.h"
+#include "flow_field.h"
+#include "navigation_graph.h"
+#include "job_system.h"
+#include "render_thread.h"
 #include <vector>
 
 namespace Game {
@@ -28,6 +36,17 @@ namespace Game {
 		struct Gem {
 			int id;
 			glm::vec2 location;
+
+			// Point light glowing around the gem
+			int light;
+		};
+
+		// Point light flickering like a flame
+		struct Torch {
+			int light;
+
+			glm::vec3 color;
+			float radius;
 		};
 
 	public:
@@ -44,12 +63,21 @@ namespace Game {
 	private:
 		GLFWwindow* window = NULL;
 
+		// Runs animation, AI and scene updates next to the drawing thread
+		JobSystem jobs;
+
 		ResourceManager resourceManager;
 
 		SceneGraph scene;
 
 		Camera camera;
 
+		// Watches the shader sources for hot reloading
+		ShaderWatcher shaderWatcher;
+
+		// Draws the frames produced by MainLoop
+		RenderThread renderThread;
+
 		// Movement
 
 		double lastFrame = 0.0f;
@@ -70,8 +98,24 @@ namespace Game {
 
 		float pauseBuffer = 0.0f;
 
-		std::vector<Collision> collisions;
+		// Maze walls and props the player and the monster can't walk through
+		CollisionWorld world;
+
+		// Paths of the monster through the maze towards the player, found by the navigation workers
+		NavigationGraph navigation;
+
+		// Request for the next path of the monster, -1 if none is being found
+		int monsterTicket = -1;
+		// Player position the path was asked for, far away so the first frame asks for one
+		glm::vec2 monsterGoal = glm::vec2(-1000.0f);
+		std::vector<glm::vec2> monsterPath;
+		int monsterWaypoint = 0;
+
+		// Steers the monster until it has a path
+		FlowField monsterField;
+
 		std::vector<Gem> gems;
+		std::vector<Torch> torches;
 
 		void InitializeWindow();
 		void InitializeView();
@@ -83,6 +127,8 @@ namespace Game {
 		static void ResizeCallback(GLFWwindow* window, int width, int height);
 
 		SceneNode* CreateInstance(std::string entityName, std::string objectName, std::string materialName, std::string textureName = std::string(""));
+		// Node drawing a particle system created by the resource manager, colliding with the terrain
+		ParticleNode* CreateParticles(std::string entityName, std::string particlesName, std::string materialName, std::string textureName);
 
 		// Create tree
 
@@ -94,9 +140,20 @@ namespace Game {
 		// Create crow
 		SceneNode* CreateCrow(std::string entityName, std::string objectName, std::string materialName, std::string textureName = std::string(""));
 
-		// Check for collisions with objects
+		// Per frame jobs
+
+		void AnimateCrows(float time);
+		void AnimateGems(float time);
+		// Flicker the torches, on the main thread before the scene bins the lights
+		void AnimateLights(float time);
+		// Move the monster towards where the player was at the start of the frame
+		void MoveMonster(glm::vec3 playerPosition);
+
+		// Collisions with objects
 
-		bool CheckCollisions(glm::vec2 position);
+		void AddCollision(const Collision& c);
+		// Torch light above a position
+		void AddTorch(glm::vec3 position);
 		void CheckGems(glm::vec2 position);
 	};
 }
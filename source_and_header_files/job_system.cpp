@@ -0,0 +1,258 @@
+#include <glm/glm.hpp>
+#include "job_system.h"
+
+namespace Game {
+	// Queue of the current thread, set for the workers of a system
+	static thread_local const JobSystem* currentSystem = NULL;
+	static thread_local int currentQueue = 0;
+
+	JobCounter::JobCounter() {
+		count = 0;
+	}
+
+	JobCounter::~JobCounter() {}
+
+	bool JobCounter::IsDone() const {
+		return count == 0;
+	}
+
+	JobSystem::JobSystem() {
+		queued = 0;
+
+		// Shared by every thread that is not a worker
+		queues.push_back(new Queue());
+	}
+
+	JobSystem::~JobSystem() {
+		Stop();
+
+		delete queues[0];
+	}
+
+	void JobSystem::Start(int threads) {
+		Stop();
+
+		if (threads <= 0) {
+			threads = glm::max(1, (int)std::thread::hardware_concurrency());
+		}
+
+		running = true;
+
+		for (int i = 1; i < threads; i++) {
+			queues.push_back(new Queue());
+		}
+
+		for (int i = 1; i < threads; i++) {
+			workers.push_back(std::thread(&JobSystem::Work, this, i));
+		}
+	}
+
+	void JobSystem::Stop() {
+		{
+			std::lock_guard<std::mutex> lock(sleepMutex);
+
+			running = false;
+		}
+
+		sleepCondition.notify_all();
+
+		for (int i = 0; i < workers.size(); i++) {
+			workers[i].join();
+		}
+
+		workers.clear();
+
+		// Whatever was left runs here, jobs held back by a counter are queued as their dependencies finish
+		while (Job* job = Pop(0)) {
+			Execute(job);
+		}
+
+		for (int i = 1; i < queues.size(); i++) {
+			delete queues[i];
+		}
+
+		queues.resize(1);
+	}
+
+	int JobSystem::GetThreadCount() const {
+		return (int)queues.size();
+	}
+
+	void JobSystem::Run(std::function<void()> function, JobCounter* counter, JobCounter* dependency) {
+		Job* job = new Job();
+		job->function = function;
+		job->counter = counter;
+
+		if (counter) {
+			counter->count++;
+		}
+
+		if (dependency) {
+			std::lock_guard<std::mutex> lock(dependency->mutex);
+
+			// Queued by the last job of the dependency instead
+			if (dependency->count > 0) {
+				dependency->waiting.push_back(job);
+				return;
+			}
+		}
+
+		Push(job);
+	}
+
+	void JobSystem::Wait(JobCounter* counter) {
+		int index = GetQueueIndex();
+
+		while (counter->count > 0) {
+			Job* job = Pop(index);
+
+			if (job) {
+				Execute(job);
+			} else {
+				std::this_thread::yield();
+			}
+		}
+
+		// The job that finished the counter may still hold its lock
+		std::lock_guard<std::mutex> lock(counter->mutex);
+	}
+
+	void JobSystem::ParallelFor(int count, int grain, const std::function<void(int, int)>& function) {
+		if (count <= 0) {
+			return;
+		}
+
+		if (grain <= 0) {
+			grain = glm::max(1, count / (GetThreadCount() * 4));
+		}
+
+		// Nothing to split
+		if (grain >= count) {
+			function(0, count);
+			return;
+		}
+
+		JobCounter counter;
+
+		for (int first = 0; first < count; first += grain) {
+			int last = glm::min(first + grain, count);
+
+			Run([&function, first, last]() {
+				function(first, last);
+			}, &counter);
+		}
+
+		Wait(&counter);
+	}
+
+	int JobSystem::GetQueueIndex() const {
+		return currentSystem == this ? currentQueue : 0;
+	}
+
+	void JobSystem::Push(Job* job) {
+		Queue* queue = queues[GetQueueIndex()];
+
+		{
+			std::lock_guard<std::mutex> lock(queue->mutex);
+
+			queue->jobs.push_back(job);
+		}
+
+		queued++;
+
+		// Taking the lock makes sure a worker checking for jobs either sees this one or gets the notification
+		{
+			std::lock_guard<std::mutex> lock(sleepMutex);
+		}
+
+		sleepCondition.notify_one();
+	}
+
+	Job* JobSystem::Pop(int index) {
+		// Newest own job first, its data is most likely still in the cache
+		{
+			Queue* queue = queues[index];
+			std::lock_guard<std::mutex> lock(queue->mutex);
+
+			if (!queue->jobs.empty()) {
+				Job* job = queue->jobs.back();
+				queue->jobs.pop_back();
+
+				queued--;
+
+				return job;
+			}
+		}
+
+		// Oldest job of another thread, those tend to be the largest
+		for (int i = 1; i < queues.size(); i++) {
+			Queue* queue = queues[(index + i) % queues.size()];
+			std::lock_guard<std::mutex> lock(queue->mutex);
+
+			if (!queue->jobs.empty()) {
+				Job* job = queue->jobs.front();
+				queue->jobs.pop_front();
+
+				queued--;
+
+				return job;
+			}
+		}
+
+		return NULL;
+	}
+
+	void JobSystem::Execute(Job* job) {
+		job->function();
+
+		JobCounter* counter = job->counter;
+
+		delete job;
+
+		if (!counter) {
+			return;
+		}
+
+		// Last job of the group releases the jobs waiting for it. The lock is held until the counter is no
+		// longer touched, Wait takes it before returning so the counter can live on the waiting stack
+		std::vector<Job*> released;
+
+		{
+			std::lock_guard<std::mutex> lock(counter->mutex);
+
+			if (--counter->count > 0) {
+				return;
+			}
+
+			released.swap(counter->waiting);
+		}
+
+		for (int i = 0; i < released.size(); i++) {
+			Push(released[i]);
+		}
+	}
+
+	void JobSystem::Work(int index) {
+		currentSystem = this;
+		currentQueue = index;
+
+		while (true) {
+			Job* job = Pop(index);
+
+			if (job) {
+				Execute(job);
+				continue;
+			}
+
+			std::unique_lock<std::mutex> lock(sleepMutex);
+
+			sleepCondition.wait(lock, [this]() {
+				return !running || queued > 0;
+			});
+
+			if (!running && queued == 0) {
+				return;
+			}
+		}
+	}
+}
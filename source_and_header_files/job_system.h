@@ -0,0 +1,99 @@
+#ifndef JOB_SYSTEM_H_
+#define JOB_SYSTEM_H_
+
+#include <atomic>
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <functional>
+#include <condition_variable>
+
+namespace Game {
+	class JobCounter;
+
+	// Unit of work queued on the job system
+	struct Job {
+		std::function<void()> function;
+
+		// Decremented once the function returns, may be NULL
+		JobCounter* counter;
+	};
+
+	// Number of unfinished jobs in a group. Jobs can be held back until a counter reaches zero
+	class JobCounter {
+
+	public:
+		JobCounter();
+		~JobCounter();
+
+		// Returns true once every job added to the counter has finished
+		bool IsDone() const;
+
+	private:
+		friend class JobSystem;
+
+		std::atomic<int> count;
+
+		// Jobs to queue once the count reaches zero
+		std::mutex mutex;
+		std::vector<Job*> waiting;
+	};
+
+	// Pool of worker threads with one job queue each. A thread pushes and pops its own jobs at the back of its
+	// queue, and steals from the front of the others once it runs out.
+	// The threads waiting on a counter run jobs in the meantime, so jobs can start and wait for other jobs
+	class JobSystem {
+
+	public:
+		JobSystem();
+		~JobSystem();
+
+		// Start the workers, threads includes the calling thread (0 uses every core)
+		void Start(int threads = 0);
+		// Finish the queued jobs and join the workers
+		void Stop();
+
+		// Threads running jobs, including the one that started the system
+		int GetThreadCount() const;
+
+		// Queue a job. The counter, if any, is incremented now and decremented once the job has finished.
+		// A job with a dependency is held back until the dependency counter reaches zero
+		void Run(std::function<void()> function, JobCounter* counter = NULL, JobCounter* dependency = NULL);
+
+		// Run jobs on the calling thread until the counter reaches zero
+		void Wait(JobCounter* counter);
+
+		// Call function(first, last) over ranges of at most grain items covering [0, count) in parallel, and wait
+		// for all of them. A grain of 0 picks one that gives every thread a few ranges
+		void ParallelFor(int count, int grain, const std::function<void(int, int)>& function);
+
+	private:
+		// Jobs of one thread, the first one is shared by the threads that are not workers
+		struct Queue {
+			std::mutex mutex;
+			std::deque<Job*> jobs;
+		};
+
+		std::vector<Queue*> queues;
+		std::vector<std::thread> workers;
+
+		// Jobs sitting in the queues, idle workers sleep while there are none
+		std::atomic<int> queued;
+		std::mutex sleepMutex;
+		std::condition_variable sleepCondition;
+		bool running = false;
+
+		// Queue of the calling thread
+		int GetQueueIndex() const;
+
+		void Push(Job* job);
+		// Pop from the back of the own queue, or steal from the front of another one. Returns NULL if all are empty
+		Job* Pop(int index);
+		void Execute(Job* job);
+
+		void Work(int index);
+	};
+}
+
+#endif
@@ -0,0 +1,175 @@
+#include <algorithm>
+#include "light_clusters.h"
+
+namespace Game {
+	// Tiles or slices a light range covers on its side of the frustum, clamped to the grid
+	static void GetRange(float low, float high, int count, int& first, int& last) {
+		first = glm::clamp((int)glm::floor((low * 0.5f + 0.5f) * count), 0, count - 1);
+		last = glm::clamp((int)glm::floor((high * 0.5f + 0.5f) * count), 0, count - 1);
+	}
+
+	// Smallest and largest of value / depth between the depths
+	static float MinOverDepth(float value, float nearDepth, float farDepth) {
+		return value >= 0.0f ? value / farDepth : value / nearDepth;
+	}
+
+	static float MaxOverDepth(float value, float nearDepth, float farDepth) {
+		return value >= 0.0f ? value / nearDepth : value / farDepth;
+	}
+
+	LightClusters::LightClusters() {}
+
+	LightClusters::~LightClusters() {}
+
+	void LightClusters::SetDepthRange(float nearDepth, float farDepth) {
+		LightClusters::nearDepth = glm::max(nearDepth, 1e-3f);
+		LightClusters::farDepth = glm::max(farDepth, LightClusters::nearDepth * 2.0f);
+	}
+
+	void LightClusters::GetClusterBounds(int x, int y, int z, glm::vec3& min, glm::vec3& max) const {
+		float sliceNear = sliceDepths[z];
+		float sliceFar = sliceDepths[z + 1];
+
+		// Tile edges at depth 1, they scale with the depth
+		float left = (-1.0f + 2.0f * x / LIGHT_CLUSTERS_X) * tanX;
+		float right = (-1.0f + 2.0f * (x + 1) / LIGHT_CLUSTERS_X) * tanX;
+		float bottom = (-1.0f + 2.0f * y / LIGHT_CLUSTERS_Y) * tanY;
+		float top = (-1.0f + 2.0f * (y + 1) / LIGHT_CLUSTERS_Y) * tanY;
+
+		min = glm::vec3(glm::min(left * sliceNear, left * sliceFar), glm::min(bottom * sliceNear, bottom * sliceFar), -sliceFar);
+		max = glm::vec3(glm::max(right * sliceNear, right * sliceFar), glm::max(top * sliceNear, top * sliceFar), -sliceNear);
+	}
+
+	void LightClusters::Build(const std::vector<PointLight>& lights, const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix, LightGrid& grid, JobSystem* jobs) {
+		tanX = 1.0f / projectionMatrix[0][0];
+		tanY = 1.0f / projectionMatrix[1][1];
+
+		grid.nearDepth = nearDepth;
+		grid.farDepth = farDepth;
+
+		// Exponential slices keep the clusters about as deep as they are wide
+		for (int z = 0; z <= LIGHT_CLUSTERS_Z; z++) {
+			sliceDepths[z] = nearDepth * glm::pow(farDepth / nearDepth, z / (float)LIGHT_CLUSTERS_Z);
+		}
+
+		// Light data, and the lights in view space for binning
+
+		grid.lights.resize(lights.size() * 2);
+		viewLights.resize(lights.size());
+
+		for (int i = 0; i < lights.size(); i++) {
+			grid.lights[i * 2] = glm::vec4(lights[i].position, lights[i].radius);
+			grid.lights[i * 2 + 1] = glm::vec4(lights[i].color, 0.0f);
+
+			viewLights[i] = glm::vec4(glm::vec3(viewMatrix * glm::vec4(lights[i].position, 1.0f)), lights[i].radius);
+		}
+
+		// Slices write their own clusters and index lists
+
+		grid.clusters.resize(LIGHT_CLUSTERS_X * LIGHT_CLUSTERS_Y * LIGHT_CLUSTERS_Z * 2);
+
+		if (jobs) {
+			jobs->ParallelFor(LIGHT_CLUSTERS_Z, 1, [&](int first, int last) {
+				for (int z = first; z < last; z++) {
+					BuildSlice(z, grid);
+				}
+			});
+		} else {
+			for (int z = 0; z < LIGHT_CLUSTERS_Z; z++) {
+				BuildSlice(z, grid);
+			}
+		}
+
+		// Join the slice lists, the clusters of a slice start at the indices of the slices before
+
+		unsigned int base = 0;
+
+		for (int z = 0; z < LIGHT_CLUSTERS_Z; z++) {
+			for (int i = 0; i < LIGHT_CLUSTERS_X * LIGHT_CLUSTERS_Y; i++) {
+				grid.clusters[(z * LIGHT_CLUSTERS_X * LIGHT_CLUSTERS_Y + i) * 2] += base;
+			}
+
+			base += (unsigned int)sliceIndices[z].size();
+		}
+
+		grid.indices.resize(base);
+
+		for (int z = 0, offset = 0; z < LIGHT_CLUSTERS_Z; z++) {
+			std::copy(sliceIndices[z].begin(), sliceIndices[z].end(), grid.indices.begin() + offset);
+			offset += (int)sliceIndices[z].size();
+		}
+	}
+
+	void LightClusters::BuildSlice(int z, LightGrid& grid) {
+		const int tiles = LIGHT_CLUSTERS_X * LIGHT_CLUSTERS_Y;
+
+		std::vector<unsigned int>& indices = sliceIndices[z];
+		std::vector<unsigned int>& hits = sliceHits[z];
+		hits.clear();
+
+		float sliceNear = sliceDepths[z];
+		float sliceFar = sliceDepths[z + 1];
+
+		// Lights per tile of the slice
+		unsigned int counts[tiles] = {};
+
+		// Every light reaching the slice is tested against the boxes of the tiles it can touch, in light order
+		// so the lists come out sorted
+
+		for (int i = 0; i < viewLights.size(); i++) {
+			glm::vec3 center = glm::vec3(viewLights[i]);
+			float radius = viewLights[i].w;
+
+			float closest = glm::max(-center.z - radius, sliceNear);
+			float farthest = glm::min(-center.z + radius, sliceFar);
+
+			if (closest > farthest) {
+				continue;
+			}
+
+			// Tiles covered by the box around the sphere over the depths it spans in the slice, divided by the
+			// depth as the projection does
+
+			int firstX, lastX, firstY, lastY;
+			GetRange(MinOverDepth(center.x - radius, closest, farthest) / tanX, MaxOverDepth(center.x + radius, closest, farthest) / tanX, LIGHT_CLUSTERS_X, firstX, lastX);
+			GetRange(MinOverDepth(center.y - radius, closest, farthest) / tanY, MaxOverDepth(center.y + radius, closest, farthest) / tanY, LIGHT_CLUSTERS_Y, firstY, lastY);
+
+			for (int y = firstY; y <= lastY; y++) {
+				for (int x = firstX; x <= lastX; x++) {
+					glm::vec3 min, max;
+					GetClusterBounds(x, y, z, min, max);
+
+					glm::vec3 nearest = glm::clamp(center, min, max);
+
+					if (glm::dot(nearest - center, nearest - center) <= radius * radius) {
+						counts[y * LIGHT_CLUSTERS_X + x]++;
+
+						hits.push_back(y * LIGHT_CLUSTERS_X + x);
+						hits.push_back(i);
+					}
+				}
+			}
+		}
+
+		// Counting sort of the hits by tile. Offsets are within the slice, moved past the earlier slices once
+		// they are all done
+
+		unsigned int offsets[tiles];
+		unsigned int offset = 0;
+
+		for (int i = 0; i < tiles; i++) {
+			offsets[i] = offset;
+
+			grid.clusters[(z * tiles + i) * 2] = offset;
+			grid.clusters[(z * tiles + i) * 2 + 1] = counts[i];
+
+			offset += counts[i];
+		}
+
+		indices.resize(offset);
+
+		for (int i = 0; i < hits.size(); i += 2) {
+			indices[offsets[hits[i]]++] = hits[i + 1];
+		}
+	}
+}
@@ -0,0 +1,78 @@
+#ifndef LIGHT_CLUSTERS_H_
+#define LIGHT_CLUSTERS_H_
+
+#include <vector>
+#include <glm/glm.hpp>
+#include "job_system.h"
+
+// Clusters along each axis of the view frustum: tiles across the screen, and slices in depth that get
+// longer with the distance
+#define LIGHT_CLUSTERS_X 16
+#define LIGHT_CLUSTERS_Y 9
+#define LIGHT_CLUSTERS_Z 24
+
+namespace Game {
+	// Light shining in every direction, fading out to nothing at its radius
+	struct PointLight {
+		// In world space
+		glm::vec3 position;
+		float radius;
+
+		// Linear, above 1 for bright lights
+		glm::vec3 color;
+	};
+
+	// Lights of a frame binned into the clusters, laid out like the texture buffers of lights.glsl
+	struct LightGrid {
+		// Two texels per light: world position and radius, then color
+		std::vector<glm::vec4> lights;
+		// First index and index count of each cluster, x fastest then y then z
+		std::vector<unsigned int> clusters;
+		// Lights of every cluster, one cluster after the other
+		std::vector<unsigned int> indices;
+
+		// View depths the slices cover
+		float nearDepth;
+		float farDepth;
+	};
+
+	// Bins point lights into a froxel grid of the camera frustum, so a fragment only shades the lights of its
+	// cluster. Depth slices are binned in parallel, each writes its own part of the lists
+	class LightClusters {
+
+	public:
+		LightClusters();
+		~LightClusters();
+
+		// View depths the slices cover, lights beyond them are left out
+		void SetDepthRange(float nearDepth, float farDepth);
+
+		// Bin the lights into the clusters of a camera with a perspective projection, split over the jobs when given
+		void Build(const std::vector<PointLight>& lights, const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix, LightGrid& grid, JobSystem* jobs = NULL);
+
+		// View space bounds of a cluster of the last Build
+		void GetClusterBounds(int x, int y, int z, glm::vec3& min, glm::vec3& max) const;
+
+	private:
+		float nearDepth = 0.1f;
+		float farDepth = 200.0f;
+
+		// Half extents of the frustum at depth 1, from the last projection
+		float tanX = 0.0f;
+		float tanY = 0.0f;
+
+		// Depth each slice starts at, and the end of the last one
+		float sliceDepths[LIGHT_CLUSTERS_Z + 1];
+
+		// Scratch: lights in view space, the lights of each slice sorted by cluster, and the unsorted
+		// (tile, light) pairs of each slice
+		std::vector<glm::vec4> viewLights;
+		std::vector<unsigned int> sliceIndices[LIGHT_CLUSTERS_Z];
+		std::vector<unsigned int> sliceHits[LIGHT_CLUSTERS_Z];
+
+		// Bin one depth slice into its clusters and sliceIndices
+		void BuildSlice(int z, LightGrid& grid);
+	};
+}
+
+#endif
@@ -1,9 +1,17 @@
 #include <iostream>
 #include <exception>
+#include <cstring>
 #include "game.h"
+#include "benchmark.h"
+
+// Main function that builds and runs the game, or times the CPU side systems with -benchmark
+int main(int argc, char* argv[]) {
+	if (argc > 1 && strcmp(argv[1], "-benchmark") == 0) {
+		Game::RunBenchmarks();
+
+		return 0;
+	}
 
-// Main function that builds and runs the game
-int main() {
 	Game::Game game;
 
 	try {
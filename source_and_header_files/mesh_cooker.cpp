@@ -0,0 +1,328 @@
+#include <map>
+#include <tuple>
+#include <cstring>
+#include <fstream>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "mesh_cooker.h"
+#include "mesh_simplifier.h"
+
+namespace Game {
+	// Bumped whenever the cooked layout or the cooking changes, older files are cooked again
+	const unsigned int MESH_COOKED_VERSION = 2;
+
+	// Meshes with fewer triangles are not simplified any further
+	const int LOD_MIN_TRIANGLES = 32;
+	// A level has to drop at least this share of the triangles of the one before to be kept
+	const float LOD_MIN_REDUCTION = 0.2f;
+
+	// Start of a cooked file, the source size and time tell when it is out of date
+	struct CookedHeader {
+		char magic[4];
+		unsigned int version;
+		long long sourceSize;
+		long long sourceTime;
+		unsigned int vertexCount;
+		unsigned int indexCount;
+		unsigned int lodCount;
+	};
+
+	// Size and modification time of a file, false if it does not exist
+	static bool GetFileStamp(const std::string& filename, long long& size, long long& time) {
+		struct stat info;
+
+		if (stat(filename.c_str(), &info) != 0) {
+			return false;
+		}
+
+		size = (long long)info.st_size;
+		time = (long long)info.st_mtime;
+
+		return true;
+	}
+
+	// Any unit vector perpendicular to the normal, for vertices without texture coordinates to follow
+	static glm::vec3 GetPerpendicular(const glm::vec3& normal) {
+		glm::vec3 axis = glm::abs(normal.x) < 0.9f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+
+		return glm::normalize(axis - normal * glm::dot(normal, axis));
+	}
+
+	void CookMesh(const TriMesh& mesh, bool hasNormals, CookedMesh& cooked) {
+		const int faces = (int)mesh.face.size();
+
+		// Tangent of each face from its texture coordinates, and whether the mapping is mirrored
+
+		std::vector<glm::vec3> faceTangents(faces, glm::vec3(0.0f));
+		std::vector<int> faceSigns(faces, 1);
+
+		for (int i = 0; i < faces; i++) {
+			const Face& face = mesh.face[i];
+
+			if (face.t[0] < 0 || face.t[1] < 0 || face.t[2] < 0) {
+				continue;
+			}
+
+			glm::vec3 edge1 = mesh.position[face.i[1]] - mesh.position[face.i[0]];
+			glm::vec3 edge2 = mesh.position[face.i[2]] - mesh.position[face.i[0]];
+
+			glm::vec2 delta1 = mesh.tex_coord[face.t[1]] - mesh.tex_coord[face.t[0]];
+			glm::vec2 delta2 = mesh.tex_coord[face.t[2]] - mesh.tex_coord[face.t[0]];
+
+			float determinant = delta1.x * delta2.y - delta2.x * delta1.y;
+
+			// Texture coordinates all on a line
+			if (glm::abs(determinant) < 1e-12f) {
+				continue;
+			}
+
+			faceTangents[i] = (edge1 * delta2.y - edge2 * delta1.y) / determinant;
+
+			// Tangent, bitangent and normal are left handed where the texture is mirrored
+			faceSigns[i] = determinant < 0.0f ? -1 : 1;
+		}
+
+		// Weld the corners. Mirrored faces get their own vertices so a vertex never has to average two
+		// handednesses, as MikkTSpace splits them
+
+		std::map<std::tuple<int, int, int, int>, GLuint> welded;
+
+		std::vector<int> positions;
+		std::vector<int> normals;
+		std::vector<int> texCoords;
+		std::vector<int> signs;
+
+		cooked.indices.resize(faces * 3);
+
+		for (int i = 0; i < faces; i++) {
+			for (int j = 0; j < 3; j++) {
+				const Face& face = mesh.face[i];
+
+				// Without normals in the file they were computed per position
+				int normal = hasNormals ? face.n[j] : face.i[j];
+
+				std::tuple<int, int, int, int> key(face.i[j], normal, face.t[j], faceSigns[i]);
+				std::map<std::tuple<int, int, int, int>, GLuint>::iterator it = welded.find(key);
+
+				if (it == welded.end()) {
+					it = welded.insert(std::make_pair(key, (GLuint)positions.size())).first;
+
+					positions.push_back(face.i[j]);
+					normals.push_back(normal);
+					texCoords.push_back(face.t[j]);
+					signs.push_back(faceSigns[i]);
+				}
+
+				cooked.indices[i * 3 + j] = it->second;
+			}
+		}
+
+		const int vertices = (int)positions.size();
+
+		std::vector<glm::vec3> vertexNormals(vertices, glm::vec3(0.0f));
+
+		for (int i = 0; i < vertices; i++) {
+			if (normals[i] >= 0 && glm::length(mesh.normal[normals[i]]) > 0.0f) {
+				vertexNormals[i] = glm::normalize(mesh.normal[normals[i]]);
+			}
+		}
+
+		// Sum the face tangents in the plane of each vertex normal, weighted by the angle of the face at the
+		// vertex so the result does not depend on how the faces around it were split
+
+		std::vector<glm::vec3> tangents(vertices, glm::vec3(0.0f));
+
+		for (int i = 0; i < faces; i++) {
+			if (faceTangents[i] == glm::vec3(0.0f)) {
+				continue;
+			}
+
+			for (int j = 0; j < 3; j++) {
+				GLuint vertex = cooked.indices[i * 3 + j];
+
+				glm::vec3 corner = mesh.position[mesh.face[i].i[j]];
+				glm::vec3 edge1 = mesh.position[mesh.face[i].i[(j + 1) % 3]] - corner;
+				glm::vec3 edge2 = mesh.position[mesh.face[i].i[(j + 2) % 3]] - corner;
+
+				if (glm::length(edge1) <= 0.0f || glm::length(edge2) <= 0.0f) {
+					continue;
+				}
+
+				float angle = glm::acos(glm::clamp(glm::dot(glm::normalize(edge1), glm::normalize(edge2)), -1.0f, 1.0f));
+
+				glm::vec3 normal = vertexNormals[vertex];
+				glm::vec3 tangent = faceTangents[i] - normal * glm::dot(normal, faceTangents[i]);
+
+				if (glm::length(tangent) > 0.0f) {
+					tangents[vertex] += glm::normalize(tangent) * angle;
+				}
+			}
+		}
+
+		// Interleave the vertices
+
+		cooked.vertices.assign(vertices * MESH_VERTEX_ATTRIBUTES, 0.0f);
+
+		for (int i = 0; i < vertices; i++) {
+			GLfloat* att = &cooked.vertices[i * MESH_VERTEX_ATTRIBUTES];
+
+			// Position
+			glm::vec3 position = mesh.position[positions[i]];
+
+			att[0] = position.x;
+			att[1] = position.y;
+			att[2] = position.z;
+
+			// Normal, as the file gave it
+			if (normals[i] >= 0) {
+				att[3] = mesh.normal[normals[i]].x;
+				att[4] = mesh.normal[normals[i]].y;
+				att[5] = mesh.normal[normals[i]].z;
+			}
+
+			// No color in (6, 7, 8)
+			// Texture coordinates
+
+			if (texCoords[i] >= 0) {
+				att[9] = mesh.tex_coord[texCoords[i]].x;
+				att[10] = mesh.tex_coord[texCoords[i]].y;
+			}
+
+			// Tangent frame, any perpendicular to the normal where the texture gives none
+
+			glm::vec3 normal = vertexNormals[i];
+			glm::vec3 tangent = tangents[i] - normal * glm::dot(normal, tangents[i]);
+
+			if (glm::length(tangent) > 1e-6f) {
+				tangent = glm::normalize(tangent);
+			} else if (normal != glm::vec3(0.0f)) {
+				tangent = GetPerpendicular(normal);
+			} else {
+				tangent = glm::vec3(1.0f, 0.0f, 0.0f);
+			}
+
+			att[MESH_TANGENT_OFFSET + 0] = tangent.x;
+			att[MESH_TANGENT_OFFSET + 1] = tangent.y;
+			att[MESH_TANGENT_OFFSET + 2] = tangent.z;
+			att[MESH_TANGENT_OFFSET + 3] = (float)signs[i];
+		}
+
+		// Full detail only, until AddMeshLods
+		cooked.lods.assign(1, { 0, (GLsizei)cooked.indices.size(), 0.0f });
+	}
+
+	void AddMeshLods(CookedMesh& cooked) {
+		// Levels from an earlier call are simplified again from the full mesh
+		if (cooked.lods.size() > 0) {
+			cooked.indices.resize(cooked.lods[0].count);
+		}
+
+		std::vector<GLuint> full(cooked.indices);
+
+		cooked.lods.clear();
+		cooked.lods.push_back({ 0, (GLsizei)full.size(), 0.0f });
+
+		std::vector<GLuint> previous(full), simplified;
+
+		while (cooked.lods.size() < MESH_LOD_LEVELS) {
+			int triangles = (int)previous.size() / 3;
+
+			if (triangles < LOD_MIN_TRIANGLES) {
+				break;
+			}
+
+			SimplifyMesh(cooked.vertices, MESH_VERTEX_ATTRIBUTES, previous, triangles / 2, simplified);
+
+			if (simplified.size() == 0 || simplified.size() / 3 > triangles * (1.0f - LOD_MIN_REDUCTION)) {
+				break;
+			}
+
+			MeshLod lod;
+			lod.first = (GLuint)cooked.indices.size();
+			lod.count = (GLsizei)simplified.size();
+			// Measured against the full mesh, so a coarser level never claims less error than a finer one
+			lod.error = glm::max(GetMeshDeviation(cooked.vertices, MESH_VERTEX_ATTRIBUTES, full, simplified), cooked.lods.back().error);
+
+			cooked.indices.insert(cooked.indices.end(), simplified.begin(), simplified.end());
+			cooked.lods.push_back(lod);
+
+			previous.swap(simplified);
+		}
+	}
+
+	bool LoadCookedMesh(const std::string& filename, const std::string& source, CookedMesh& cooked) {
+		long long sourceSize, sourceTime;
+
+		if (!GetFileStamp(source, sourceSize, sourceTime)) {
+			return false;
+		}
+
+		std::ifstream f(filename.c_str(), std::ios::in | std::ios::binary);
+
+		if (f.fail()) {
+			return false;
+		}
+
+		CookedHeader header;
+		f.read((char*)&header, sizeof(header));
+
+		if (!f || std::memcmp(header.magic, "MESH", 4) != 0 || header.version != MESH_COOKED_VERSION ||
+			header.sourceSize != sourceSize || header.sourceTime != sourceTime || header.lodCount == 0) {
+			return false;
+		}
+
+		cooked.vertices.resize((size_t)header.vertexCount * MESH_VERTEX_ATTRIBUTES);
+		cooked.indices.resize(header.indexCount);
+		cooked.lods.resize(header.lodCount);
+
+		f.read((char*)cooked.vertices.data(), cooked.vertices.size() * sizeof(GLfloat));
+		f.read((char*)cooked.indices.data(), cooked.indices.size() * sizeof(GLuint));
+		f.read((char*)cooked.lods.data(), cooked.lods.size() * sizeof(MeshLod));
+
+		// Cut short, cook it again
+		if (!f) {
+			return false;
+		}
+
+		for (size_t i = 0; i < cooked.indices.size(); i++) {
+			if (cooked.indices[i] >= header.vertexCount) {
+				return false;
+			}
+		}
+
+		for (size_t i = 0; i < cooked.lods.size(); i++) {
+			if (cooked.lods[i].first + (size_t)cooked.lods[i].count > cooked.indices.size()) {
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	bool SaveCookedMesh(const std::string& filename, const std::string& source, const CookedMesh& cooked) {
+		CookedHeader header;
+
+		if (!GetFileStamp(source, header.sourceSize, header.sourceTime)) {
+			return false;
+		}
+
+		std::memcpy(header.magic, "MESH", 4);
+		header.version = MESH_COOKED_VERSION;
+		header.vertexCount = (unsigned int)(cooked.vertices.size() / MESH_VERTEX_ATTRIBUTES);
+		header.indexCount = (unsigned int)cooked.indices.size();
+		header.lodCount = (unsigned int)cooked.lods.size();
+
+		std::ofstream f(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+
+		if (f.fail()) {
+			return false;
+		}
+
+		f.write((const char*)&header, sizeof(header));
+		f.write((const char*)cooked.vertices.data(), cooked.vertices.size() * sizeof(GLfloat));
+		f.write((const char*)cooked.indices.data(), cooked.indices.size() * sizeof(GLuint));
+		f.write((const char*)cooked.lods.data(), cooked.lods.size() * sizeof(MeshLod));
+
+		return !f.fail();
+	}
+}
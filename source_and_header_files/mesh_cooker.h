@@ -0,0 +1,60 @@
+#ifndef MESH_COOKER_H_
+#define MESH_COOKER_H_
+
+#define GLEW_STATIC
+
+#include <string>
+#include <vector>
+#include <GL/glew.h>
+#include "model_loader.h"
+
+// Floats per vertex of a cooked mesh: position, normal, color, texture coordinates, then the tangent and
+// the sign of the bitangent
+#define MESH_VERTEX_ATTRIBUTES 15
+// Offset of the tangent in a cooked vertex, in floats
+#define MESH_TANGENT_OFFSET 11
+
+// Appended to the source file name for the cooked copy of a mesh
+#define MESH_COOKED_EXTENSION ".cooked"
+
+// Most levels of detail of a mesh, the full one included
+#define MESH_LOD_LEVELS 4
+
+namespace Game {
+	// Range of the index buffer drawing a mesh at one level of detail
+	struct MeshLod {
+		GLuint first;
+		GLsizei count;
+
+		// Largest distance from the full mesh to this level, in model space
+		float error;
+	};
+
+	// Mesh ready to be copied to OpenGL buffers, MESH_VERTEX_ATTRIBUTES floats per vertex
+	struct CookedMesh {
+		std::vector<GLfloat> vertices;
+		std::vector<GLuint> indices;
+
+		// Levels of detail from the full mesh on, each a range of the indices over the same vertices
+		std::vector<MeshLod> lods;
+	};
+
+	// Weld the corners of the faces that share position, normal and texture coordinates into indexed
+	// vertices, and give each a tangent frame the way MikkTSpace does: the tangent of every face is projected
+	// onto the plane of the vertex normal and weighted by the angle of the face at the vertex. The bitangent
+	// is left to the shaders as sign * cross(normal, tangent). With hasNormals false the normals of the mesh
+	// are per position rather than indexed by the faces
+	void CookMesh(const TriMesh& mesh, bool hasNormals, CookedMesh& cooked);
+
+	// Simplify the cooked mesh into up to MESH_LOD_LEVELS - 1 coarser levels, each with half the triangles of
+	// the one before, appended to its indices. Stops early when the mesh is small or will not simplify further
+	void AddMeshLods(CookedMesh& cooked);
+
+	// Read the cooked copy of source, returns false when it is missing, of an older version or older than
+	// the source, so the mesh has to be cooked again
+	bool LoadCookedMesh(const std::string& filename, const std::string& source, CookedMesh& cooked);
+	// Write the cooked copy of source, returns false when the file could not be written
+	bool SaveCookedMesh(const std::string& filename, const std::string& source, const CookedMesh& cooked);
+}
+
+#endif
@@ -0,0 +1,426 @@
+#include <map>
+#include <algorithm>
+#include <glm/glm.hpp>
+#include "mesh_simplifier.h"
+
+namespace Game {
+	// Weight of the planes keeping open edges in place, against the planes of the faces
+	const double BOUNDARY_WEIGHT = 10.0;
+	// Smallest cosine between a face normal before and after a collapse, lower would fold the face over
+	const float FLIP_COSINE = 0.2f;
+
+	// Sum of squared distances to a set of planes, as the symmetric 4x4 matrix of Garland and Heckbert
+	struct Quadric {
+		double a2, ab, ac, ad;
+		double b2, bc, bd;
+		double c2, cd;
+		double d2;
+
+		Quadric() : a2(0), ab(0), ac(0), ad(0), b2(0), bc(0), bd(0), c2(0), cd(0), d2(0) {}
+
+		// Plane a x + b y + c z + d = 0 with a unit normal
+		Quadric(double a, double b, double c, double d, double weight) {
+			a2 = a * a * weight; ab = a * b * weight; ac = a * c * weight; ad = a * d * weight;
+			b2 = b * b * weight; bc = b * c * weight; bd = b * d * weight;
+			c2 = c * c * weight; cd = c * d * weight;
+			d2 = d * d * weight;
+		}
+
+		void Add(const Quadric& q) {
+			a2 += q.a2; ab += q.ab; ac += q.ac; ad += q.ad;
+			b2 += q.b2; bc += q.bc; bd += q.bd;
+			c2 += q.c2; cd += q.cd;
+			d2 += q.d2;
+		}
+
+		double Evaluate(const glm::vec3& p) const {
+			double x = p.x, y = p.y, z = p.z;
+
+			return a2 * x * x + 2.0 * ab * x * y + 2.0 * ac * x * z + 2.0 * ad * x +
+				b2 * y * y + 2.0 * bc * y * z + 2.0 * bd * y +
+				c2 * z * z + 2.0 * cd * z +
+				d2;
+		}
+	};
+
+	// Collapse of one position onto another
+	struct Collapse {
+		double cost;
+		int from;
+		int to;
+
+		bool operator<(const Collapse& other) const {
+			return cost < other.cost;
+		}
+	};
+
+	static glm::vec3 GetPosition(const std::vector<GLfloat>& vertices, int stride, GLuint vertex) {
+		return glm::vec3(vertices[vertex * stride], vertices[vertex * stride + 1], vertices[vertex * stride + 2]);
+	}
+
+	// Closest point of a triangle, from Real-Time Collision Detection
+	static glm::vec3 GetClosestPoint(const glm::vec3& p, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c) {
+		glm::vec3 ab = b - a, ac = c - a, ap = p - a;
+
+		float d1 = glm::dot(ab, ap), d2 = glm::dot(ac, ap);
+		if (d1 <= 0.0f && d2 <= 0.0f) return a;
+
+		glm::vec3 bp = p - b;
+		float d3 = glm::dot(ab, bp), d4 = glm::dot(ac, bp);
+		if (d3 >= 0.0f && d4 <= d3) return b;
+
+		float vc = d1 * d4 - d3 * d2;
+		if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) return a + ab * (d1 / (d1 - d3));
+
+		glm::vec3 cp = p - c;
+		float d5 = glm::dot(ab, cp), d6 = glm::dot(ac, cp);
+		if (d6 >= 0.0f && d5 <= d6) return c;
+
+		float vb = d5 * d2 - d1 * d6;
+		if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) return a + ac * (d2 / (d2 - d6));
+
+		float va = d3 * d6 - d5 * d4;
+		if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f) return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+
+		float denominator = 1.0f / (va + vb + vc);
+
+		return a + ab * (vb * denominator) + ac * (vc * denominator);
+	}
+
+	void SimplifyMesh(const std::vector<GLfloat>& vertices, int stride, const std::vector<GLuint>& indices, int targetTriangles, std::vector<GLuint>& result) {
+		const int vertexCount = (int)(vertices.size() / stride);
+		const int triangleCount = (int)(indices.size() / 3);
+
+		// Positions shared by several vertices, along seams of the normals or texture coordinates, are simplified
+		// as one
+
+		std::map<std::vector<GLfloat>, int> positionIds;
+
+		std::vector<int> positionOf(vertexCount);
+		std::vector<glm::vec3> positions;
+		std::vector<std::vector<GLuint> > verticesAt;
+
+		for (int i = 0; i < vertexCount; i++) {
+			std::vector<GLfloat> key(vertices.begin() + i * stride, vertices.begin() + i * stride + 3);
+			std::map<std::vector<GLfloat>, int>::iterator it = positionIds.find(key);
+
+			if (it == positionIds.end()) {
+				it = positionIds.insert(std::make_pair(key, (int)positions.size())).first;
+
+				positions.push_back(GetPosition(vertices, stride, i));
+				verticesAt.push_back(std::vector<GLuint>());
+			}
+
+			positionOf[i] = it->second;
+			verticesAt[it->second].push_back(i);
+		}
+
+		const int positionCount = (int)positions.size();
+
+		// Triangles over the positions, and the triangles around each position
+
+		std::vector<int> corners(triangleCount * 3);
+		std::vector<bool> alive(triangleCount, true);
+		std::vector<std::vector<int> > around(positionCount);
+
+		int remaining = 0;
+
+		for (int i = 0; i < triangleCount; i++) {
+			for (int j = 0; j < 3; j++) {
+				corners[i * 3 + j] = positionOf[indices[i * 3 + j]];
+			}
+
+			if (corners[i * 3] == corners[i * 3 + 1] || corners[i * 3 + 1] == corners[i * 3 + 2] || corners[i * 3] == corners[i * 3 + 2]) {
+				alive[i] = false;
+				continue;
+			}
+
+			for (int j = 0; j < 3; j++) {
+				around[corners[i * 3 + j]].push_back(i);
+			}
+
+			remaining++;
+		}
+
+		// Quadrics of the planes of the faces around each position, weighted by area so small faces do not
+		// hold back the large ones
+
+		std::vector<Quadric> quadrics(positionCount);
+		std::map<std::pair<int, int>, int> edgeUses;
+
+		for (int i = 0; i < triangleCount; i++) {
+			if (!alive[i]) {
+				continue;
+			}
+
+			glm::vec3 a = positions[corners[i * 3]], b = positions[corners[i * 3 + 1]], c = positions[corners[i * 3 + 2]];
+			glm::vec3 normal = glm::cross(b - a, c - a);
+
+			float area = glm::length(normal) * 0.5f;
+
+			if (area <= 0.0f) {
+				continue;
+			}
+
+			normal = glm::normalize(normal);
+
+			Quadric plane(normal.x, normal.y, normal.z, -glm::dot(normal, a), area);
+
+			for (int j = 0; j < 3; j++) {
+				quadrics[corners[i * 3 + j]].Add(plane);
+
+				int v0 = corners[i * 3 + j], v1 = corners[i * 3 + (j + 1) % 3];
+				edgeUses[std::make_pair(glm::min(v0, v1), glm::max(v0, v1))]++;
+			}
+		}
+
+		// Open edges get a plane through them, upright on their face, so the outline of the mesh stays
+
+		for (int i = 0; i < triangleCount; i++) {
+			if (!alive[i]) {
+				continue;
+			}
+
+			glm::vec3 a = positions[corners[i * 3]], b = positions[corners[i * 3 + 1]], c = positions[corners[i * 3 + 2]];
+			glm::vec3 faceNormal = glm::cross(b - a, c - a);
+
+			if (glm::length(faceNormal) <= 0.0f) {
+				continue;
+			}
+
+			for (int j = 0; j < 3; j++) {
+				int v0 = corners[i * 3 + j], v1 = corners[i * 3 + (j + 1) % 3];
+
+				if (edgeUses[std::make_pair(glm::min(v0, v1), glm::max(v0, v1))] != 1) {
+					continue;
+				}
+
+				glm::vec3 edge = positions[v1] - positions[v0];
+				glm::vec3 normal = glm::cross(edge, faceNormal);
+
+				if (glm::length(normal) <= 0.0f) {
+					continue;
+				}
+
+				normal = glm::normalize(normal);
+
+				Quadric plane(normal.x, normal.y, normal.z, -glm::dot(normal, positions[v0]), BOUNDARY_WEIGHT * glm::dot(edge, edge));
+
+				quadrics[v0].Add(plane);
+				quadrics[v1].Add(plane);
+			}
+		}
+
+		// Passes of the cheapest collapses, each position is touched once per pass so the costs of a pass stay
+		// true while it runs
+
+		std::vector<Collapse> collapses;
+		std::vector<bool> locked(positionCount);
+
+		while (remaining > targetTriangles) {
+			collapses.clear();
+
+			for (int i = 0; i < triangleCount; i++) {
+				if (!alive[i]) {
+					continue;
+				}
+
+				for (int j = 0; j < 3; j++) {
+					int v0 = corners[i * 3 + j], v1 = corners[i * 3 + (j + 1) % 3];
+
+					// Each edge once, from the side where v0 < v1 or from its only face
+					if (v0 > v1 && edgeUses[std::make_pair(v1, v0)] > 1) {
+						continue;
+					}
+
+					Quadric sum = quadrics[v0];
+					sum.Add(quadrics[v1]);
+
+					double toV1 = sum.Evaluate(positions[v1]);
+					double toV0 = sum.Evaluate(positions[v0]);
+
+					Collapse collapse;
+					collapse.cost = std::min(toV0, toV1);
+					collapse.from = toV1 <= toV0 ? v0 : v1;
+					collapse.to = toV1 <= toV0 ? v1 : v0;
+
+					collapses.push_back(collapse);
+				}
+			}
+
+			std::sort(collapses.begin(), collapses.end());
+
+			std::fill(locked.begin(), locked.end(), false);
+
+			int collapsed = 0;
+
+			for (int i = 0; i < collapses.size() && remaining > targetTriangles; i++) {
+				int from = collapses[i].from;
+				int to = collapses[i].to;
+
+				if (locked[from] || locked[to]) {
+					continue;
+				}
+
+				// The faces that stay must not turn over
+
+				bool flips = false;
+
+				for (int j = 0; j < around[from].size() && !flips; j++) {
+					int t = around[from][j];
+
+					if (!alive[t] || corners[t * 3] == to || corners[t * 3 + 1] == to || corners[t * 3 + 2] == to) {
+						continue;
+					}
+
+					glm::vec3 before[3], after[3];
+
+					for (int k = 0; k < 3; k++) {
+						before[k] = positions[corners[t * 3 + k]];
+						after[k] = corners[t * 3 + k] == from ? positions[to] : before[k];
+					}
+
+					glm::vec3 oldNormal = glm::cross(before[1] - before[0], before[2] - before[0]);
+					glm::vec3 newNormal = glm::cross(after[1] - after[0], after[2] - after[0]);
+
+					if (glm::length(oldNormal) <= 0.0f || glm::length(newNormal) <= 0.0f) {
+						flips = glm::length(oldNormal) > 0.0f;
+						continue;
+					}
+
+					flips = glm::dot(glm::normalize(oldNormal), glm::normalize(newNormal)) < FLIP_COSINE;
+				}
+
+				if (flips) {
+					continue;
+				}
+
+				// Move the faces over, the ones along the edge disappear
+
+				for (int j = 0; j < around[from].size(); j++) {
+					int t = around[from][j];
+
+					if (!alive[t]) {
+						continue;
+					}
+
+					for (int k = 0; k < 3; k++) {
+						locked[corners[t * 3 + k]] = true;
+					}
+
+					if (corners[t * 3] == to || corners[t * 3 + 1] == to || corners[t * 3 + 2] == to) {
+						alive[t] = false;
+						remaining--;
+						continue;
+					}
+
+					for (int k = 0; k < 3; k++) {
+						if (corners[t * 3 + k] == from) {
+							corners[t * 3 + k] = to;
+						}
+					}
+
+					around[to].push_back(t);
+				}
+
+				around[from].clear();
+				quadrics[to].Add(quadrics[from]);
+
+				collapsed++;
+			}
+
+			// Nothing left that can go without folding the mesh
+			if (collapsed == 0) {
+				break;
+			}
+
+			// Edge uses of the new faces, for the open edge test of the next pass
+
+			edgeUses.clear();
+
+			for (int i = 0; i < triangleCount; i++) {
+				if (alive[i]) {
+					for (int j = 0; j < 3; j++) {
+						int v0 = corners[i * 3 + j], v1 = corners[i * 3 + (j + 1) % 3];
+						edgeUses[std::make_pair(glm::min(v0, v1), glm::max(v0, v1))]++;
+					}
+				}
+			}
+		}
+
+		// Each corner takes the vertex of its new position that looks most like its old vertex
+
+		result.clear();
+
+		for (int i = 0; i < triangleCount; i++) {
+			if (!alive[i]) {
+				continue;
+			}
+
+			GLuint triangle[3];
+
+			for (int j = 0; j < 3; j++) {
+				GLuint original = indices[i * 3 + j];
+				int position = corners[i * 3 + j];
+
+				if (positionOf[original] == position) {
+					triangle[j] = original;
+					continue;
+				}
+
+				const GLfloat* attributes = &vertices[original * stride];
+				float best = -1e30f;
+
+				for (int k = 0; k < verticesAt[position].size(); k++) {
+					const GLfloat* candidate = &vertices[verticesAt[position][k] * stride];
+
+					float normalMatch = attributes[3] * candidate[3] + attributes[4] * candidate[4] + attributes[5] * candidate[5];
+					float uvDistance = glm::abs(attributes[9] - candidate[9]) + glm::abs(attributes[10] - candidate[10]);
+
+					if (normalMatch - uvDistance > best) {
+						best = normalMatch - uvDistance;
+						triangle[j] = verticesAt[position][k];
+					}
+				}
+			}
+
+			result.push_back(triangle[0]);
+			result.push_back(triangle[1]);
+			result.push_back(triangle[2]);
+		}
+	}
+
+	float GetMeshDeviation(const std::vector<GLfloat>& vertices, int stride, const std::vector<GLuint>& indices, const std::vector<GLuint>& simplified) {
+		if (simplified.size() == 0) {
+			return 0.0f;
+		}
+
+		// Every vertex the mesh uses, once
+		std::vector<bool> used(vertices.size() / stride, false);
+
+		for (int i = 0; i < indices.size(); i++) {
+			used[indices[i]] = true;
+		}
+
+		float deviation = 0.0f;
+
+		for (int i = 0; i < used.size(); i++) {
+			if (!used[i]) {
+				continue;
+			}
+
+			glm::vec3 p = GetPosition(vertices, stride, i);
+			float closest = 1e30f;
+
+			for (int j = 0; j < simplified.size() && closest > deviation; j += 3) {
+				glm::vec3 q = GetClosestPoint(p, GetPosition(vertices, stride, simplified[j]), GetPosition(vertices, stride, simplified[j + 1]), GetPosition(vertices, stride, simplified[j + 2]));
+
+				closest = glm::min(closest, glm::dot(q - p, q - p));
+			}
+
+			deviation = glm::max(deviation, closest);
+		}
+
+		return glm::sqrt(deviation);
+	}
+}
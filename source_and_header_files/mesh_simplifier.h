@@ -0,0 +1,21 @@
+#ifndef MESH_SIMPLIFIER_H_
+#define MESH_SIMPLIFIER_H_
+
+#define GLEW_STATIC
+
+#include <vector>
+#include <GL/glew.h>
+
+namespace Game {
+	// Reduce the triangles of an indexed mesh to about targetTriangles with quadric error metrics. Edges are
+	// collapsed onto one of their ends, so the result indexes the same vertices and can share their buffer.
+	// Vertices at the same position are collapsed together, the corners keep the vertex of their new position
+	// closest in normal and texture coordinates. Vertices have stride floats, the position first, the normal
+	// at 3 and the texture coordinates at 9
+	void SimplifyMesh(const std::vector<GLfloat>& vertices, int stride, const std::vector<GLuint>& indices, int targetTriangles, std::vector<GLuint>& result);
+
+	// Largest distance from the vertices of a mesh to the surface of its simplified version
+	float GetMeshDeviation(const std::vector<GLfloat>& vertices, int stride, const std::vector<GLuint>& indices, const std::vector<GLuint>& simplified);
+}
+
+#endif
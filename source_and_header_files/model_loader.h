@@ -37,6 +37,9 @@ namespace Game {
 	};
 
 	// Helper functions 
+	// Parse an obj file, has_normals is false when the file gives none and they were
+	// computed per position
+	void load_obj(const char* filename, TriMesh& mesh, bool& has_normals);
 	// Trim any character in to_trim from the beginning and end of str
 	void string_trim(std::string str, std::string to_trim);
 	// Split string into substrings according to characters in separator
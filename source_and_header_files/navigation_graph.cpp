@@ -0,0 +1,606 @@
+#include <stdexcept>
+#include <string>
+#include <queue>
+#include <climits>
+#include <algorithm>
+#include "navigation_graph.h"
+
+namespace Game {
+	// How far from walls straight line shortcuts keep, in cells
+	const float NAVIGATION_CLEARANCE = 0.3f;
+
+	NavigationGraph::NavigationGraph() {}
+
+	NavigationGraph::~NavigationGraph() {
+		Stop();
+	}
+
+	void NavigationGraph::SetGrid(int width, int height, float cellSize, const std::vector<bool>& solid, int clusterSize) {
+		if (solid.size() != width * height) {
+			throw(std::string("Navigation graph error: grid size does not match its cells"));
+		}
+
+		if (clusterSize < 2) {
+			throw(std::string("Navigation graph error: clusters must be at least 2 cells wide"));
+		}
+
+		NavigationGraph::width = width;
+		NavigationGraph::height = height;
+		NavigationGraph::cellSize = cellSize;
+		NavigationGraph::solid = solid;
+		NavigationGraph::clusterSize = clusterSize;
+
+		clustersX = (width + clusterSize - 1) / clusterSize;
+		clustersY = (height + clusterSize - 1) / clusterSize;
+	}
+
+	int NavigationGraph::GetCell(glm::vec2 position) const {
+		int x = (int)glm::floor(position.x / cellSize + 0.5f);
+		int y = (int)glm::floor(position.y / cellSize + 0.5f);
+
+		if (x < 0 || x >= width || y < 0 || y >= height) {
+			return -1;
+		}
+
+		return y * width + x;
+	}
+
+	int NavigationGraph::GetCluster(int cell) const {
+		return (cell / width / clusterSize) * clustersX + (cell % width) / clusterSize;
+	}
+
+	int NavigationGraph::GetRegion(glm::vec2 position) const {
+		int cell = GetCell(position);
+
+		return cell < 0 ? -1 : GetCluster(cell);
+	}
+
+	int NavigationGraph::GetCacheHits() const {
+		// The workers count while paths are being found
+		std::lock_guard<std::mutex> lock(cacheMutex);
+
+		return cacheHits;
+	}
+
+	int NavigationGraph::GetCacheMisses() const {
+		std::lock_guard<std::mutex> lock(cacheMutex);
+
+		return cacheMisses;
+	}
+
+	int NavigationGraph::AddNode(int cell) {
+		if (cellNodes[cell] >= 0) {
+			return cellNodes[cell];
+		}
+
+		Node node;
+
+		node.cell = cell;
+		node.cluster = GetCluster(cell);
+
+		nodes.push_back(node);
+
+		cellNodes[cell] = nodes.size() - 1;
+		clusterNodes[node.cluster].push_back(nodes.size() - 1);
+
+		return nodes.size() - 1;
+	}
+
+	void NavigationGraph::Build() {
+		nodes.clear();
+		clusterNodes.assign(clustersX * clustersY, std::vector<int>());
+		cellNodes.assign(width * height, -1);
+
+		// Portals, one in the middle of every open stretch of a border between two clusters
+
+		for (int horizontal = 0; horizontal < 2; horizontal++) {
+			// Borders between columns of clusters, then between rows
+			int borders = horizontal ? clustersY - 1 : clustersX - 1;
+			int length = horizontal ? width : height;
+
+			for (int b = 0; b < borders; b++) {
+				int line = (b + 1) * clusterSize - 1;
+
+				int runStart = -1;
+
+				for (int i = 0; i <= length; i++) {
+					// Cells on both sides of the border
+					int a = horizontal ? line * width + i : i * width + line;
+					int c = horizontal ? a + width : a + 1;
+
+					// A run also ends where the border crosses into the next cluster along it
+					bool open = i < length && !solid[a] && !solid[c] && (runStart < 0 || i / clusterSize == runStart / clusterSize);
+
+					if (open && runStart < 0) {
+						runStart = i;
+					} else if (!open && runStart >= 0) {
+						int middle = (runStart + i - 1) / 2;
+
+						int from = horizontal ? line * width + middle : middle * width + line;
+						int to = horizontal ? from + width : from + 1;
+
+						int n1 = AddNode(from);
+						int n2 = AddNode(to);
+
+						Edge edge;
+
+						edge.cost = 1;
+
+						edge.to = n2;
+						edge.cells.assign(1, to);
+						nodes[n1].edges.push_back(edge);
+
+						edge.to = n1;
+						edge.cells.assign(1, from);
+						nodes[n2].edges.push_back(edge);
+
+						// This cell may start the next run
+						runStart = -1;
+
+						if (i < length && !solid[a] && !solid[c]) {
+							runStart = i;
+						}
+					}
+				}
+			}
+		}
+
+		// Paths between the portals of each cluster
+
+		std::vector<int> distances, parents;
+
+		for (int cluster = 0; cluster < clusterNodes.size(); cluster++) {
+			const std::vector<int>& portals = clusterNodes[cluster];
+
+			for (int i = 0; i < portals.size(); i++) {
+				SearchCluster(nodes[portals[i]].cell, distances, parents);
+
+				for (int j = 0; j < portals.size(); j++) {
+					int cell = nodes[portals[j]].cell;
+
+					if (i == j || distances[GetLocalIndex(cell)] < 0) {
+						continue;
+					}
+
+					Edge edge;
+
+					edge.to = portals[j];
+					edge.cost = distances[GetLocalIndex(cell)];
+
+					GetClusterPath(cell, parents, edge.cells);
+
+					nodes[portals[i]].edges.push_back(edge);
+				}
+			}
+		}
+
+		ClearCache();
+	}
+
+	void NavigationGraph::ClearCache() {
+		std::lock_guard<std::mutex> lock(cacheMutex);
+
+		cache.clear();
+		cacheHits = 0;
+		cacheMisses = 0;
+	}
+
+	int NavigationGraph::GetLocalIndex(int cell) const {
+		return ((cell / width) % clusterSize) * clusterSize + (cell % width) % clusterSize;
+	}
+
+	void NavigationGraph::SearchCluster(int from, std::vector<int>& distances, std::vector<int>& parents) const {
+		distances.assign(clusterSize * clusterSize, -1);
+		parents.assign(clusterSize * clusterSize, -1);
+
+		int cluster = GetCluster(from);
+
+		// Bounds of the cluster in cells
+		int x1 = (cluster % clustersX) * clusterSize;
+		int y1 = (cluster / clustersX) * clusterSize;
+		int x2 = glm::min(x1 + clusterSize, width) - 1;
+		int y2 = glm::min(y1 + clusterSize, height) - 1;
+
+		std::vector<int> queue;
+
+		distances[GetLocalIndex(from)] = 0;
+		queue.push_back(from);
+
+		for (int head = 0; head < queue.size(); head++) {
+			int current = queue[head];
+
+			int x = current % width;
+			int y = current / width;
+
+			const int neighbours[4] = { x > x1 ? current - 1 : -1, x < x2 ? current + 1 : -1, y > y1 ? current - width : -1, y < y2 ? current + width : -1 };
+
+			for (int i = 0; i < 4; i++) {
+				int n = neighbours[i];
+
+				if (n >= 0 && !solid[n] && distances[GetLocalIndex(n)] < 0) {
+					distances[GetLocalIndex(n)] = distances[GetLocalIndex(current)] + 1;
+					parents[GetLocalIndex(n)] = current;
+					queue.push_back(n);
+				}
+			}
+		}
+	}
+
+	void NavigationGraph::GetClusterPath(int cell, const std::vector<int>& parents, std::vector<int>& cells) const {
+		cells.clear();
+
+		for (int current = cell; parents[GetLocalIndex(current)] >= 0; current = parents[GetLocalIndex(current)]) {
+			cells.push_back(current);
+		}
+
+		std::reverse(cells.begin(), cells.end());
+	}
+
+	bool NavigationGraph::FindPortals(int start, int goal, std::vector<int>& portals) const {
+		// A* over the portals, with the start and goal cells as two extra nodes linked to the portals
+		// of their clusters
+
+		const int startNode = nodes.size();
+		const int goalNode = nodes.size() + 1;
+
+		std::vector<int> distances, parents;
+
+		SearchCluster(start, distances, parents);
+
+		std::vector<std::pair<int, int>> startEdges;
+
+		for (int i = 0; i < clusterNodes[GetCluster(start)].size(); i++) {
+			int portal = clusterNodes[GetCluster(start)][i];
+			int distance = distances[GetLocalIndex(nodes[portal].cell)];
+
+			if (distance >= 0) {
+				startEdges.push_back(std::make_pair(portal, distance));
+			}
+		}
+
+		// Cost from each portal of the goal cluster to the goal, -1 if it can't get there
+		SearchCluster(goal, distances, parents);
+
+		std::vector<int> goalCosts(nodes.size(), -1);
+
+		for (int i = 0; i < clusterNodes[GetCluster(goal)].size(); i++) {
+			int portal = clusterNodes[GetCluster(goal)][i];
+
+			goalCosts[portal] = distances[GetLocalIndex(nodes[portal].cell)];
+		}
+
+		glm::ivec2 target(goal % width, goal / width);
+
+		auto heuristic = [&](int cell) {
+			return glm::abs(cell % width - target.x) + glm::abs(cell / width - target.y);
+		};
+
+		std::vector<int> costs(nodes.size() + 2, INT_MAX);
+		std::vector<int> previous(nodes.size() + 2, -1);
+
+		// Ordered by estimated total cost
+		std::priority_queue<std::pair<int, int>, std::vector<std::pair<int, int>>, std::greater<std::pair<int, int>>> open;
+
+		costs[startNode] = 0;
+		open.push(std::make_pair(heuristic(start), startNode));
+
+		while (!open.empty()) {
+			int current = open.top().second;
+			int estimate = open.top().first;
+			open.pop();
+
+			if (current == goalNode) {
+				break;
+			}
+
+			int cell = current == startNode ? start : nodes[current].cell;
+
+			// Skip stale entries
+			if (estimate > costs[current] + heuristic(cell)) {
+				continue;
+			}
+
+			auto relax = [&](int to, int cost) {
+				if (costs[current] + cost < costs[to]) {
+					costs[to] = costs[current] + cost;
+					previous[to] = current;
+
+					open.push(std::make_pair(costs[to] + (to == goalNode ? 0 : heuristic(nodes[to].cell)), to));
+				}
+			};
+
+			if (current == startNode) {
+				for (int i = 0; i < startEdges.size(); i++) {
+					relax(startEdges[i].first, startEdges[i].second);
+				}
+
+				continue;
+			}
+
+			for (int i = 0; i < nodes[current].edges.size(); i++) {
+				relax(nodes[current].edges[i].to, nodes[current].edges[i].cost);
+			}
+
+			if (goalCosts[current] >= 0) {
+				relax(goalNode, goalCosts[current]);
+			}
+		}
+
+		if (previous[goalNode] < 0) {
+			return false;
+		}
+
+		portals.clear();
+
+		for (int current = previous[goalNode]; current != startNode; current = previous[current]) {
+			portals.push_back(current);
+		}
+
+		std::reverse(portals.begin(), portals.end());
+
+		return true;
+	}
+
+	bool NavigationGraph::GetCells(int start, int goal, const std::vector<int>& portals, std::vector<int>& cells) const {
+		std::vector<int> distances, parents, path;
+
+		cells.clear();
+
+		// Start to the first portal
+		SearchCluster(start, distances, parents);
+
+		if (portals.empty() || GetCluster(nodes[portals.front()].cell) != GetCluster(start) || distances[GetLocalIndex(nodes[portals.front()].cell)] < 0) {
+			return false;
+		}
+
+		GetClusterPath(nodes[portals.front()].cell, parents, path);
+		cells.insert(cells.end(), path.begin(), path.end());
+
+		// Between portals, along the edges found by Build
+		for (int i = 0; i + 1 < portals.size(); i++) {
+			const Node& node = nodes[portals[i]];
+
+			int j = 0;
+
+			while (j < node.edges.size() && node.edges[j].to != portals[i + 1]) {
+				j++;
+			}
+
+			if (j == node.edges.size()) {
+				return false;
+			}
+
+			cells.insert(cells.end(), node.edges[j].cells.begin(), node.edges[j].cells.end());
+		}
+
+		// Last portal to the goal, found from the goal side and walked backwards
+		SearchCluster(goal, distances, parents);
+
+		int last = nodes[portals.back()].cell;
+
+		if (GetCluster(last) != GetCluster(goal) || distances[GetLocalIndex(last)] < 0) {
+			return false;
+		}
+
+		for (int current = last; parents[GetLocalIndex(current)] >= 0; ) {
+			current = parents[GetLocalIndex(current)];
+			cells.push_back(current);
+		}
+
+		return true;
+	}
+
+	bool NavigationGraph::FindPath(glm::vec2 start, glm::vec2 goal, std::vector<glm::vec2>& waypoints) {
+		waypoints.clear();
+
+		int startCell = GetCell(start);
+		int goalCell = GetCell(goal);
+
+		if (startCell < 0 || goalCell < 0 || solid[startCell] || solid[goalCell]) {
+			return false;
+		}
+
+		std::vector<int> cells;
+
+		// Same cluster, search it directly
+		if (GetCluster(startCell) == GetCluster(goalCell)) {
+			std::vector<int> distances, parents;
+
+			SearchCluster(startCell, distances, parents);
+
+			if (distances[GetLocalIndex(goalCell)] >= 0) {
+				GetClusterPath(goalCell, parents, cells);
+				Smooth(start, goal, cells, waypoints);
+
+				return true;
+			}
+
+			// The way between them may leave the cluster
+		}
+
+		std::pair<int, int> key(GetCluster(startCell), GetCluster(goalCell));
+		std::vector<int> portals;
+
+		// Reuse the portals of an earlier request between the same clusters, as long as both ends can reach them
+		bool cached = false;
+
+		{
+			std::lock_guard<std::mutex> lock(cacheMutex);
+
+			std::map<std::pair<int, int>, std::vector<int>>::iterator it = cache.find(key);
+
+			if (it != cache.end()) {
+				portals = it->second;
+				cached = true;
+			}
+		}
+
+		if (cached && GetCells(startCell, goalCell, portals, cells)) {
+			std::lock_guard<std::mutex> lock(cacheMutex);
+			cacheHits++;
+		} else {
+			if (!FindPortals(startCell, goalCell, portals) || !GetCells(startCell, goalCell, portals, cells)) {
+				return false;
+			}
+
+			std::lock_guard<std::mutex> lock(cacheMutex);
+
+			cache[key] = portals;
+			cacheMisses++;
+		}
+
+		Smooth(start, goal, cells, waypoints);
+
+		return true;
+	}
+
+	bool NavigationGraph::IsLineClear(glm::vec2 from, glm::vec2 to) const {
+		// Sample the line every quarter cell and check the cells under a small square around each sample
+
+		glm::vec2 a = from / cellSize;
+		glm::vec2 b = to / cellSize;
+
+		int samples = (int)glm::ceil(glm::length(b - a) * 4.0f) + 1;
+
+		for (int i = 0; i <= samples; i++) {
+			glm::vec2 p = a + (b - a) * ((float)i / samples);
+
+			for (int corner = 0; corner < 4; corner++) {
+				float x = p.x + ((corner & 1) ? NAVIGATION_CLEARANCE : -NAVIGATION_CLEARANCE);
+				float y = p.y + ((corner & 2) ? NAVIGATION_CLEARANCE : -NAVIGATION_CLEARANCE);
+
+				int cx = (int)glm::floor(x + 0.5f);
+				int cy = (int)glm::floor(y + 0.5f);
+
+				if (cx < 0 || cx >= width || cy < 0 || cy >= height || solid[cy * width + cx]) {
+					return false;
+				}
+			}
+		}
+
+		return true;
+	}
+
+	void NavigationGraph::Smooth(glm::vec2 start, glm::vec2 goal, const std::vector<int>& cells, std::vector<glm::vec2>& waypoints) const {
+		// Cell centers, ending with the exact goal
+		std::vector<glm::vec2> points;
+
+		for (int i = 0; i < cells.size(); i++) {
+			points.push_back(glm::vec2(cells[i] % width, cells[i] / width) * cellSize);
+		}
+
+		if (points.empty()) {
+			points.push_back(goal);
+		} else {
+			points.back() = goal;
+		}
+
+		// From each waypoint, skip ahead to the furthest point still in a straight line of sight
+		glm::vec2 current = start;
+		int i = 0;
+
+		while (i < points.size()) {
+			int furthest = i;
+
+			while (furthest + 1 < points.size() && IsLineClear(current, points[furthest + 1])) {
+				furthest++;
+			}
+
+			waypoints.push_back(points[furthest]);
+
+			current = points[furthest];
+			i = furthest + 1;
+		}
+	}
+
+	void NavigationGraph::Start(int threads) {
+		if (running) {
+			return;
+		}
+
+		if (threads <= 0) {
+			threads = glm::max(1, (int)std::thread::hardware_concurrency() - 1);
+		}
+
+		running = true;
+
+		for (int i = 0; i < threads; i++) {
+			workers.push_back(std::thread(&NavigationGraph::Run, this));
+		}
+	}
+
+	void NavigationGraph::Stop() {
+		{
+			std::lock_guard<std::mutex> lock(requestMutex);
+			running = false;
+		}
+
+		requestCondition.notify_all();
+
+		for (int i = 0; i < workers.size(); i++) {
+			workers[i].join();
+		}
+
+		workers.clear();
+	}
+
+	int NavigationGraph::RequestPath(glm::vec2 start, glm::vec2 goal) {
+		Request request;
+
+		request.start = start;
+		request.goal = goal;
+
+		{
+			std::lock_guard<std::mutex> lock(requestMutex);
+
+			request.ticket = nextTicket++;
+			requests.push_back(request);
+		}
+
+		requestCondition.notify_one();
+
+		return request.ticket;
+	}
+
+	bool NavigationGraph::GetPath(int ticket, std::vector<glm::vec2>& waypoints, bool& found) {
+		std::lock_guard<std::mutex> lock(requestMutex);
+
+		std::map<int, Result>::iterator it = results.find(ticket);
+
+		if (it == results.end()) {
+			return false;
+		}
+
+		found = it->second.found;
+		waypoints.swap(it->second.waypoints);
+
+		results.erase(it);
+
+		return true;
+	}
+
+	void NavigationGraph::Run() {
+		while (true) {
+			Request request;
+
+			{
+				std::unique_lock<std::mutex> lock(requestMutex);
+
+				requestCondition.wait(lock, [this]() { return !running || !requests.empty(); });
+
+				if (!running) {
+					return;
+				}
+
+				request = requests.front();
+				requests.pop_front();
+			}
+
+			Result result;
+			result.found = FindPath(request.start, request.goal, result.waypoints);
+
+			std::lock_guard<std::mutex> lock(requestMutex);
+			results[request.ticket] = result;
+		}
+	}
+}
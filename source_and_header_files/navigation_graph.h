@@ -0,0 +1,137 @@
+#ifndef NAVIGATION_GRAPH_H_
+#define NAVIGATION_GRAPH_H_
+
+#include <map>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <glm/glm.hpp>
+
+namespace Game {
+	// Hierarchical pathfinding (HPA*) over a grid of solid cells, for agents with their own goals.
+	// The grid is split in square clusters, neighbouring clusters are linked through portals on their shared
+	// border, and the paths between the portals of each cluster are found once when the graph is built.
+	// Uses the same grid layout as CollisionWorld: cell (x, y) is centered at (x, y) * cellSize
+	class NavigationGraph {
+
+	public:
+		NavigationGraph();
+		~NavigationGraph();
+
+		// Solid cells, indexed [y * width + x]. Call Build afterwards
+		void SetGrid(int width, int height, float cellSize, const std::vector<bool>& solid, int clusterSize = 8);
+
+		// Find the portals and the paths between them, clears the path cache
+		void Build();
+
+		// Cluster containing the position, -1 outside the grid
+		int GetRegion(glm::vec2 position) const;
+
+		// Smoothed waypoints from start to goal, the last one is the goal itself. Returns false if there is no path
+		bool FindPath(glm::vec2 start, glm::vec2 goal, std::vector<glm::vec2>& waypoints);
+
+		// Batched requests, serviced by worker threads
+
+		// Start the workers (0 uses every core)
+		void Start(int threads = 0);
+		void Stop();
+
+		// Queue a path request, returns a ticket to collect it with
+		int RequestPath(glm::vec2 start, glm::vec2 goal);
+		// Returns true once the request is done, found tells if there was a path
+		bool GetPath(int ticket, std::vector<glm::vec2>& waypoints, bool& found);
+
+		// Forget the cached portal sequences, and reset the statistics
+		void ClearCache();
+
+		// Path cache statistics since the cache was last cleared
+		int GetCacheHits() const;
+		int GetCacheMisses() const;
+
+	private:
+		// Link to another portal, with the cells walked to get there (excluding the first, including the last)
+		struct Edge {
+			int to;
+			int cost;
+
+			std::vector<int> cells;
+		};
+
+		// Portal cell on the border of a cluster
+		struct Node {
+			int cell;
+			int cluster;
+
+			std::vector<Edge> edges;
+		};
+
+		struct Request {
+			int ticket;
+
+			glm::vec2 start;
+			glm::vec2 goal;
+		};
+
+		struct Result {
+			bool found;
+
+			std::vector<glm::vec2> waypoints;
+		};
+
+		int width = 0;
+		int height = 0;
+		float cellSize = 1.0f;
+		int clusterSize = 8;
+		int clustersX = 0;
+		int clustersY = 0;
+
+		std::vector<bool> solid;
+
+		std::vector<Node> nodes;
+		// Portals of every cluster
+		std::vector<std::vector<int>> clusterNodes;
+		// Portal at each cell, -1 if none
+		std::vector<int> cellNodes;
+
+		// Portal sequence found for each (start cluster, goal cluster), reused by later requests between them
+		mutable std::mutex cacheMutex;
+		std::map<std::pair<int, int>, std::vector<int>> cache;
+		int cacheHits = 0;
+		int cacheMisses = 0;
+
+		// Workers and their queues
+		std::vector<std::thread> workers;
+		std::mutex requestMutex;
+		std::condition_variable requestCondition;
+		std::deque<Request> requests;
+		std::map<int, Result> results;
+		int nextTicket = 0;
+		bool running = false;
+
+		int GetCell(glm::vec2 position) const;
+		int GetCluster(int cell) const;
+		int AddNode(int cell);
+
+		// Breadth first search from a cell without leaving its cluster. Distances and parents are indexed by cell
+		// inside the cluster, -1 where not reached
+		void SearchCluster(int from, std::vector<int>& distances, std::vector<int>& parents) const;
+		// Cells from the search origin to a cell (excluding the origin, including the cell)
+		void GetClusterPath(int cell, const std::vector<int>& parents, std::vector<int>& cells) const;
+		int GetLocalIndex(int cell) const;
+
+		// Portal sequence between two cells in different clusters with A*, start and goal portals included
+		bool FindPortals(int start, int goal, std::vector<int>& portals) const;
+		// Turn a portal sequence into cells, returns false if the ends can't reach the first and last portal
+		bool GetCells(int start, int goal, const std::vector<int>& portals, std::vector<int>& cells) const;
+
+		// Drop waypoints that can be skipped by walking in a straight line
+		void Smooth(glm::vec2 start, glm::vec2 goal, const std::vector<int>& cells, std::vector<glm::vec2>& waypoints) const;
+		bool IsLineClear(glm::vec2 from, glm::vec2 to) const;
+
+		void Run();
+	};
+}
+
+#endif
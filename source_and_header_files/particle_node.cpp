@@ -0,0 +1,57 @@
+#include "particle_node.h"
+
+namespace Game {
+	// GL_POINTS is 0, the cast keeps it from also matching the geometry constructor
+	ParticleNode::ParticleNode(const std::string name, ParticleSystem* particles, const Resource* updateMaterial, const Resource* material, const Resource* texture, const Terrain* terrain) : SceneNode(name, (GLenum)GL_POINTS, material, texture) {
+		ParticleNode::particles = particles;
+		ParticleNode::updateMaterial = updateMaterial;
+		ParticleNode::terrain = terrain;
+
+		emitter = ParticleEmitter();
+		forces = ParticleForces();
+	}
+
+	ParticleNode::~ParticleNode() {}
+
+	void ParticleNode::SetEmitter(const ParticleEmitter& emitter) {
+		ParticleNode::emitter = emitter;
+	}
+
+	void ParticleNode::SetForces(const ParticleForces& forces) {
+		ParticleNode::forces = forces;
+	}
+
+	void ParticleNode::Collect(FramePacket* packet) {
+		DrawItem item = GetDrawItem();
+
+		// Simulation in world space, with the emitter carried along by the node
+
+		ParticleStep step;
+
+		step.particles = particles;
+		step.material = updateMaterial;
+
+		step.emitter = emitter;
+		step.emitter.position = glm::vec3(item.worldMatrix * glm::vec4(emitter.position, 1.0f));
+		step.emitter.direction = glm::mat3(item.worldMatrix) * emitter.direction;
+
+		step.forces = forces;
+		step.forces.attractor = glm::vec3(item.worldMatrix * glm::vec4(forces.attractor, 1.0f));
+		step.forces.player = packet->cameraPosition;
+
+		step.heightMap = terrain ? terrain->GetHeightTexture() : 0;
+		step.heightMapSize = terrain ? terrain->GetSize() : 0;
+
+		packet->particleSteps.push_back(step);
+
+		// Every particle is drawn, the shaders hide the ones not spawned yet
+
+		item.particles = particles;
+		item.size = particles->GetCapacity();
+		item.fullSize = item.size;
+		item.layout = VertexLayout::GetFloats(PARTICLE_ATTRIBUTES);
+		item.isBlended = true;
+
+		packet->items.push_back(item);
+	}
+}
@@ -0,0 +1,40 @@
+#ifndef PARTICLE_NODE_H_
+#define PARTICLE_NODE_H_
+
+#define GLEW_STATIC
+
+#include <string>
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include "scene_node.h"
+#include "particle_system.h"
+#include "terrain.h"
+
+namespace Game {
+	// Scene node drawing a GPU particle system. The emitter and attractor are given relative to the node,
+	// so the particles follow it, and the player position is filled in every frame
+	class ParticleNode : public SceneNode {
+
+	public:
+		// The update material advances the particles, the other one draws them. Particles collide with the
+		// terrain if one is given
+		ParticleNode(const std::string name, ParticleSystem* particles, const Resource* updateMaterial, const Resource* material, const Resource* texture = NULL, const Terrain* terrain = NULL);
+		~ParticleNode();
+
+		void SetEmitter(const ParticleEmitter& emitter);
+		void SetForces(const ParticleForces& forces);
+
+		// Queues the simulation step of the frame and the draw
+		virtual void Collect(FramePacket* packet);
+
+	private:
+		ParticleSystem* particles;
+		const Resource* updateMaterial;
+		const Terrain* terrain;
+
+		ParticleEmitter emitter;
+		ParticleForces forces;
+	};
+}
+
+#endif
@@ -0,0 +1,632 @@
+#include <string>
+#include <cmath>
+#include <algorithm>
+#include <cstring>
+#include <emmintrin.h>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+#include "particle_simulation.h"
+
+// Particles stepped together, their terrain heights are looked up between integrating and colliding
+#define PARTICLE_BLOCK 1024
+
+// Bits of the depth sorted per radix pass
+#define SORT_RADIX_BITS 8
+#define SORT_BUCKETS (1 << SORT_RADIX_BITS)
+
+namespace Game {
+	static inline float Fract(float x) {
+		return x - std::floor(x);
+	}
+
+	// Random number of the shader from the particle seed and a stream index
+	static inline float Random(float seed, float stream) {
+		return Fract(std::sin(seed * 12.9898f + stream * 78.233f) * 43758.5453f);
+	}
+
+	static inline glm::vec3 RandomVector(float seed, float stream) {
+		return glm::vec3(Random(seed, stream), Random(seed, stream + 1.0f), Random(seed, stream + 2.0f)) * 2.0f - 1.0f;
+	}
+
+	// Gravity, wind gusts, the attractor and the push of the player, then drag
+	static inline void Integrate(glm::vec3& position, glm::vec3& velocity, const ParticleForces& forces, float deltaTime, float time) {
+		glm::vec3 acceleration = forces.gravity + forces.wind * (0.6f + 0.4f * std::sin(time * 0.7f + position.x * 0.3f + position.z * 0.2f));
+
+		acceleration += (forces.attractor - position) * forces.attractorStrength;
+
+		glm::vec3 away = position - forces.player;
+		float distance = glm::length(away);
+
+		if (distance < forces.playerRadius && distance > 0.0001f) {
+			acceleration += away / distance * (forces.playerRadius - distance) * 40.0f;
+		}
+
+		velocity += acceleration * deltaTime;
+		velocity *= std::max(0.0f, 1.0f - forces.drag * deltaTime);
+
+		position += velocity * deltaTime;
+	}
+
+	// Land on the ground, bouncing back up and losing speed along it
+	static inline void Collide(glm::vec3& position, glm::vec3& velocity, float ground, float bounce) {
+		if (position.y < ground) {
+			position.y = ground;
+
+			if (velocity.y < 0.0f) {
+				velocity.y = -velocity.y * bounce;
+			}
+
+			velocity.x *= bounce;
+			velocity.z *= bounce;
+		}
+	}
+
+	// sin with the argument reduced to [-pi/2, pi/2] by multiples of pi, then a degree 11 polynomial.
+	// Within a few ulp of std::sin for the arguments the wind gusts use
+	static inline __m128 Sin(__m128 x) {
+		__m128i j = _mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(0.31830988618f)));
+		__m128 n = _mm_cvtepi32_ps(j);
+
+		// pi in three parts so n * pi is exact for the first parts
+		x = _mm_sub_ps(x, _mm_mul_ps(n, _mm_set1_ps(3.140625f)));
+		x = _mm_sub_ps(x, _mm_mul_ps(n, _mm_set1_ps(9.67502593994140625e-4f)));
+		x = _mm_sub_ps(x, _mm_mul_ps(n, _mm_set1_ps(1.509957990978376432e-7f)));
+
+		// sin(x + n pi) = -sin(x) for odd n
+		x = _mm_xor_ps(x, _mm_castsi128_ps(_mm_slli_epi32(j, 31)));
+
+		__m128 x2 = _mm_mul_ps(x, x);
+
+		__m128 p = _mm_set1_ps(-2.5052108385e-8f);
+		p = _mm_add_ps(_mm_mul_ps(p, x2), _mm_set1_ps(2.7557319224e-6f));
+		p = _mm_add_ps(_mm_mul_ps(p, x2), _mm_set1_ps(-1.9841269841e-4f));
+		p = _mm_add_ps(_mm_mul_ps(p, x2), _mm_set1_ps(8.3333333333e-3f));
+		p = _mm_add_ps(_mm_mul_ps(p, x2), _mm_set1_ps(-1.6666666667e-1f));
+
+		return _mm_add_ps(x, _mm_mul_ps(_mm_mul_ps(p, x2), x));
+	}
+
+	static inline __m128 Select(__m128 mask, __m128 a, __m128 b) {
+		return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+	}
+
+#ifdef __AVX2__
+	static inline __m256 Sin(__m256 x) {
+		__m256i j = _mm256_cvtps_epi32(_mm256_mul_ps(x, _mm256_set1_ps(0.31830988618f)));
+		__m256 n = _mm256_cvtepi32_ps(j);
+
+		x = _mm256_sub_ps(x, _mm256_mul_ps(n, _mm256_set1_ps(3.140625f)));
+		x = _mm256_sub_ps(x, _mm256_mul_ps(n, _mm256_set1_ps(9.67502593994140625e-4f)));
+		x = _mm256_sub_ps(x, _mm256_mul_ps(n, _mm256_set1_ps(1.509957990978376432e-7f)));
+
+		x = _mm256_xor_ps(x, _mm256_castsi256_ps(_mm256_slli_epi32(j, 31)));
+
+		__m256 x2 = _mm256_mul_ps(x, x);
+
+		__m256 p = _mm256_set1_ps(-2.5052108385e-8f);
+		p = _mm256_add_ps(_mm256_mul_ps(p, x2), _mm256_set1_ps(2.7557319224e-6f));
+		p = _mm256_add_ps(_mm256_mul_ps(p, x2), _mm256_set1_ps(-1.9841269841e-4f));
+		p = _mm256_add_ps(_mm256_mul_ps(p, x2), _mm256_set1_ps(8.3333333333e-3f));
+		p = _mm256_add_ps(_mm256_mul_ps(p, x2), _mm256_set1_ps(-1.6666666667e-1f));
+
+		return _mm256_add_ps(x, _mm256_mul_ps(_mm256_mul_ps(p, x2), x));
+	}
+#endif
+
+	ParticleSimulation::ParticleSimulation() {}
+
+	ParticleSimulation::~ParticleSimulation() {}
+
+	void ParticleSimulation::Create(int capacity, float maxLifetime, unsigned int seed) {
+		if (capacity < 1) {
+			throw(std::string("Particle simulation error: capacity must be at least 1"));
+		}
+
+		ParticleSimulation::capacity = capacity;
+
+		positionX.assign(capacity, 0.0f);
+		positionY.assign(capacity, 0.0f);
+		positionZ.assign(capacity, 0.0f);
+		velocityX.assign(capacity, 0.0f);
+		velocityY.assign(capacity, 0.0f);
+		velocityZ.assign(capacity, 0.0f);
+		ages.resize(capacity);
+		lifetimes.resize(capacity);
+		seeds.resize(capacity);
+
+		// Unborn particles, taken from the same start state as the GPU buffers
+		std::vector<GLfloat> state;
+		ParticleSystem::GetStartState(capacity, maxLifetime, seed, state);
+
+		for (int i = 0; i < capacity; i++) {
+			ages[i] = state[i * PARTICLE_ATTRIBUTES + 6];
+			lifetimes[i] = state[i * PARTICLE_ATTRIBUTES + 7];
+			seeds[i] = state[i * PARTICLE_ATTRIBUTES + 8];
+		}
+
+		moved.resize(PARTICLE_BLOCK);
+		heights.resize(PARTICLE_BLOCK);
+		spawns.clear();
+	}
+
+	int ParticleSimulation::GetCapacity() const {
+		return capacity;
+	}
+
+	void ParticleSimulation::SetTerrain(const Terrain* terrain) {
+		ParticleSimulation::terrain = terrain;
+	}
+
+	void ParticleSimulation::Spawn(int i, const ParticleEmitter& emitter, float time) {
+		// Spawn, or respawn a dead particle, with a new seed every time
+		float seed = Random(seeds[i], time);
+
+		glm::vec3 position = emitter.position + RandomVector(seed, 1.0f) * emitter.radius;
+
+		glm::vec3 direction = emitter.direction + RandomVector(seed, 4.0f) * emitter.spread;
+
+		if (glm::length(direction) < 0.0001f) {
+			direction = glm::vec3(0.0f, 1.0f, 0.0f);
+		}
+
+		glm::vec3 velocity = glm::normalize(direction) * emitter.speed * glm::mix(0.75f, 1.25f, Random(seed, 7.0f));
+
+		positionX[i] = position.x;
+		positionY[i] = position.y;
+		positionZ[i] = position.z;
+		velocityX[i] = velocity.x;
+		velocityY[i] = velocity.y;
+		velocityZ[i] = velocity.z;
+
+		ages[i] = 0.0f;
+		lifetimes[i] = glm::mix(emitter.minLifetime, emitter.maxLifetime, Random(seed, 8.0f));
+		seeds[i] = seed;
+	}
+
+	void ParticleSimulation::SimulateScalar(const ParticleEmitter& emitter, const ParticleForces& forces, float deltaTime, float time) {
+		for (int i = 0; i < capacity; i++) {
+			float age = ages[i] + deltaTime;
+
+			if ((ages[i] < 0.0f && age >= 0.0f) || age >= lifetimes[i]) {
+				Spawn(i, emitter, time);
+			} else {
+				ages[i] = age;
+
+				if (age >= 0.0f) {
+					glm::vec3 position(positionX[i], positionY[i], positionZ[i]);
+					glm::vec3 velocity(velocityX[i], velocityY[i], velocityZ[i]);
+
+					Integrate(position, velocity, forces, deltaTime, time);
+
+					float ground = forces.groundHeight;
+
+					if (terrain) {
+						ground = std::max(ground, terrain->GetHeightAt(position.x, position.z));
+					}
+
+					Collide(position, velocity, ground, forces.bounce);
+
+					positionX[i] = position.x;
+					positionY[i] = position.y;
+					positionZ[i] = position.z;
+					velocityX[i] = velocity.x;
+					velocityY[i] = velocity.y;
+					velocityZ[i] = velocity.z;
+				}
+			}
+		}
+	}
+
+	void ParticleSimulation::Simulate(const ParticleEmitter& emitter, const ParticleForces& forces, float deltaTime, float time) {
+		// Each block is aged and integrated, then its terrain heights are looked up in one batch and it collides.
+		// Particles to respawn are only recorded, they are spawned one by one at the end
+
+		spawns.clear();
+
+		float damping = std::max(0.0f, 1.0f - forces.drag * deltaTime);
+		float radiusSquared = forces.playerRadius * forces.playerRadius;
+
+		for (int first = 0; first < capacity; first += PARTICLE_BLOCK) {
+			int count = std::min(PARTICLE_BLOCK, capacity - first);
+
+			float* px = positionX.data() + first;
+			float* py = positionY.data() + first;
+			float* pz = positionZ.data() + first;
+			float* vx = velocityX.data() + first;
+			float* vy = velocityY.data() + first;
+			float* vz = velocityZ.data() + first;
+			float* age = ages.data() + first;
+			const float* lifetime = lifetimes.data() + first;
+
+			// Age and integrate
+
+			int i = 0;
+
+#ifdef __AVX2__
+			__m256 zero8 = _mm256_setzero_ps();
+			__m256 dt8 = _mm256_set1_ps(deltaTime);
+
+			for (; i + 8 <= count; i += 8) {
+				__m256 previous = _mm256_loadu_ps(age + i);
+				__m256 a = _mm256_add_ps(previous, dt8);
+
+				_mm256_storeu_ps(age + i, a);
+
+				__m256 spawn = _mm256_or_ps(_mm256_and_ps(_mm256_cmp_ps(previous, zero8, _CMP_LT_OQ), _mm256_cmp_ps(a, zero8, _CMP_GE_OQ)),
+					_mm256_cmp_ps(a, _mm256_loadu_ps(lifetime + i), _CMP_GE_OQ));
+				__m256 move = _mm256_andnot_ps(spawn, _mm256_cmp_ps(a, zero8, _CMP_GE_OQ));
+
+				_mm256_storeu_ps((float*)(moved.data() + i), move);
+
+				int spawnBits = _mm256_movemask_ps(spawn);
+
+				for (int k = 0; spawnBits; k++, spawnBits >>= 1) {
+					if (spawnBits & 1) {
+						spawns.push_back(first + i + k);
+					}
+				}
+
+				if (!_mm256_movemask_ps(move)) {
+					continue;
+				}
+
+				__m256 x = _mm256_loadu_ps(px + i), y = _mm256_loadu_ps(py + i), z = _mm256_loadu_ps(pz + i);
+				__m256 velX = _mm256_loadu_ps(vx + i), velY = _mm256_loadu_ps(vy + i), velZ = _mm256_loadu_ps(vz + i);
+
+				__m256 gust = _mm256_add_ps(_mm256_set1_ps(0.6f), _mm256_mul_ps(_mm256_set1_ps(0.4f),
+					Sin(_mm256_add_ps(_mm256_add_ps(_mm256_set1_ps(time * 0.7f), _mm256_mul_ps(x, _mm256_set1_ps(0.3f))), _mm256_mul_ps(z, _mm256_set1_ps(0.2f))))));
+
+				__m256 strength = _mm256_set1_ps(forces.attractorStrength);
+
+				__m256 ax = _mm256_add_ps(_mm256_add_ps(_mm256_set1_ps(forces.gravity.x), _mm256_mul_ps(_mm256_set1_ps(forces.wind.x), gust)), _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(forces.attractor.x), x), strength));
+				__m256 ay = _mm256_add_ps(_mm256_add_ps(_mm256_set1_ps(forces.gravity.y), _mm256_mul_ps(_mm256_set1_ps(forces.wind.y), gust)), _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(forces.attractor.y), y), strength));
+				__m256 az = _mm256_add_ps(_mm256_add_ps(_mm256_set1_ps(forces.gravity.z), _mm256_mul_ps(_mm256_set1_ps(forces.wind.z), gust)), _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(forces.attractor.z), z), strength));
+
+				// Pushed out of the way by the player
+				__m256 awayX = _mm256_sub_ps(x, _mm256_set1_ps(forces.player.x));
+				__m256 awayY = _mm256_sub_ps(y, _mm256_set1_ps(forces.player.y));
+				__m256 awayZ = _mm256_sub_ps(z, _mm256_set1_ps(forces.player.z));
+
+				__m256 distanceSquared = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(awayX, awayX), _mm256_mul_ps(awayY, awayY)), _mm256_mul_ps(awayZ, awayZ));
+
+				if (_mm256_movemask_ps(_mm256_cmp_ps(distanceSquared, _mm256_set1_ps(radiusSquared), _CMP_LT_OQ))) {
+					__m256 distance = _mm256_sqrt_ps(distanceSquared);
+					__m256 inside = _mm256_and_ps(_mm256_cmp_ps(distance, _mm256_set1_ps(forces.playerRadius), _CMP_LT_OQ), _mm256_cmp_ps(distance, _mm256_set1_ps(0.0001f), _CMP_GT_OQ));
+					__m256 depth = _mm256_sub_ps(_mm256_set1_ps(forces.playerRadius), distance);
+					__m256 forty = _mm256_set1_ps(40.0f);
+
+					ax = _mm256_add_ps(ax, _mm256_and_ps(inside, _mm256_mul_ps(_mm256_mul_ps(_mm256_div_ps(awayX, distance), depth), forty)));
+					ay = _mm256_add_ps(ay, _mm256_and_ps(inside, _mm256_mul_ps(_mm256_mul_ps(_mm256_div_ps(awayY, distance), depth), forty)));
+					az = _mm256_add_ps(az, _mm256_and_ps(inside, _mm256_mul_ps(_mm256_mul_ps(_mm256_div_ps(awayZ, distance), depth), forty)));
+				}
+
+				__m256 damping8 = _mm256_set1_ps(damping);
+
+				__m256 newVelX = _mm256_mul_ps(_mm256_add_ps(velX, _mm256_mul_ps(ax, dt8)), damping8);
+				__m256 newVelY = _mm256_mul_ps(_mm256_add_ps(velY, _mm256_mul_ps(ay, dt8)), damping8);
+				__m256 newVelZ = _mm256_mul_ps(_mm256_add_ps(velZ, _mm256_mul_ps(az, dt8)), damping8);
+
+				_mm256_storeu_ps(vx + i, _mm256_blendv_ps(velX, newVelX, move));
+				_mm256_storeu_ps(vy + i, _mm256_blendv_ps(velY, newVelY, move));
+				_mm256_storeu_ps(vz + i, _mm256_blendv_ps(velZ, newVelZ, move));
+
+				_mm256_storeu_ps(px + i, _mm256_blendv_ps(x, _mm256_add_ps(x, _mm256_mul_ps(newVelX, dt8)), move));
+				_mm256_storeu_ps(py + i, _mm256_blendv_ps(y, _mm256_add_ps(y, _mm256_mul_ps(newVelY, dt8)), move));
+				_mm256_storeu_ps(pz + i, _mm256_blendv_ps(z, _mm256_add_ps(z, _mm256_mul_ps(newVelZ, dt8)), move));
+			}
+#endif
+
+			__m128 zero = _mm_setzero_ps();
+			__m128 dt = _mm_set1_ps(deltaTime);
+
+			for (; i + 4 <= count; i += 4) {
+				__m128 previous = _mm_loadu_ps(age + i);
+				__m128 a = _mm_add_ps(previous, dt);
+
+				_mm_storeu_ps(age + i, a);
+
+				__m128 spawn = _mm_or_ps(_mm_and_ps(_mm_cmplt_ps(previous, zero), _mm_cmpge_ps(a, zero)), _mm_cmpge_ps(a, _mm_loadu_ps(lifetime + i)));
+				__m128 move = _mm_andnot_ps(spawn, _mm_cmpge_ps(a, zero));
+
+				_mm_storeu_ps((float*)(moved.data() + i), move);
+
+				int spawnBits = _mm_movemask_ps(spawn);
+
+				for (int k = 0; spawnBits; k++, spawnBits >>= 1) {
+					if (spawnBits & 1) {
+						spawns.push_back(first + i + k);
+					}
+				}
+
+				if (!_mm_movemask_ps(move)) {
+					continue;
+				}
+
+				__m128 x = _mm_loadu_ps(px + i), y = _mm_loadu_ps(py + i), z = _mm_loadu_ps(pz + i);
+				__m128 velX = _mm_loadu_ps(vx + i), velY = _mm_loadu_ps(vy + i), velZ = _mm_loadu_ps(vz + i);
+
+				// Gravity and gusts of wind, and a spring towards the attractor
+				__m128 gust = _mm_add_ps(_mm_set1_ps(0.6f), _mm_mul_ps(_mm_set1_ps(0.4f),
+					Sin(_mm_add_ps(_mm_add_ps(_mm_set1_ps(time * 0.7f), _mm_mul_ps(x, _mm_set1_ps(0.3f))), _mm_mul_ps(z, _mm_set1_ps(0.2f))))));
+
+				__m128 strength = _mm_set1_ps(forces.attractorStrength);
+
+				__m128 ax = _mm_add_ps(_mm_add_ps(_mm_set1_ps(forces.gravity.x), _mm_mul_ps(_mm_set1_ps(forces.wind.x), gust)), _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(forces.attractor.x), x), strength));
+				__m128 ay = _mm_add_ps(_mm_add_ps(_mm_set1_ps(forces.gravity.y), _mm_mul_ps(_mm_set1_ps(forces.wind.y), gust)), _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(forces.attractor.y), y), strength));
+				__m128 az = _mm_add_ps(_mm_add_ps(_mm_set1_ps(forces.gravity.z), _mm_mul_ps(_mm_set1_ps(forces.wind.z), gust)), _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(forces.attractor.z), z), strength));
+
+				// Pushed out of the way by the player, skipped when no particle of the group is near
+				__m128 awayX = _mm_sub_ps(x, _mm_set1_ps(forces.player.x));
+				__m128 awayY = _mm_sub_ps(y, _mm_set1_ps(forces.player.y));
+				__m128 awayZ = _mm_sub_ps(z, _mm_set1_ps(forces.player.z));
+
+				__m128 distanceSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(awayX, awayX), _mm_mul_ps(awayY, awayY)), _mm_mul_ps(awayZ, awayZ));
+
+				if (_mm_movemask_ps(_mm_cmplt_ps(distanceSquared, _mm_set1_ps(radiusSquared)))) {
+					// Same operation order as the shader so the results match
+					__m128 distance = _mm_sqrt_ps(distanceSquared);
+					__m128 inside = _mm_and_ps(_mm_cmplt_ps(distance, _mm_set1_ps(forces.playerRadius)), _mm_cmpgt_ps(distance, _mm_set1_ps(0.0001f)));
+					__m128 depth = _mm_sub_ps(_mm_set1_ps(forces.playerRadius), distance);
+					__m128 forty = _mm_set1_ps(40.0f);
+
+					ax = _mm_add_ps(ax, _mm_and_ps(inside, _mm_mul_ps(_mm_mul_ps(_mm_div_ps(awayX, distance), depth), forty)));
+					ay = _mm_add_ps(ay, _mm_and_ps(inside, _mm_mul_ps(_mm_mul_ps(_mm_div_ps(awayY, distance), depth), forty)));
+					az = _mm_add_ps(az, _mm_and_ps(inside, _mm_mul_ps(_mm_mul_ps(_mm_div_ps(awayZ, distance), depth), forty)));
+				}
+
+				// Drag, then move. Particles that did not move keep their state
+				__m128 damping4 = _mm_set1_ps(damping);
+
+				__m128 newVelX = _mm_mul_ps(_mm_add_ps(velX, _mm_mul_ps(ax, dt)), damping4);
+				__m128 newVelY = _mm_mul_ps(_mm_add_ps(velY, _mm_mul_ps(ay, dt)), damping4);
+				__m128 newVelZ = _mm_mul_ps(_mm_add_ps(velZ, _mm_mul_ps(az, dt)), damping4);
+
+				_mm_storeu_ps(vx + i, Select(move, newVelX, velX));
+				_mm_storeu_ps(vy + i, Select(move, newVelY, velY));
+				_mm_storeu_ps(vz + i, Select(move, newVelZ, velZ));
+
+				_mm_storeu_ps(px + i, Select(move, _mm_add_ps(x, _mm_mul_ps(newVelX, dt)), x));
+				_mm_storeu_ps(py + i, Select(move, _mm_add_ps(y, _mm_mul_ps(newVelY, dt)), y));
+				_mm_storeu_ps(pz + i, Select(move, _mm_add_ps(z, _mm_mul_ps(newVelZ, dt)), z));
+			}
+
+			for (; i < count; i++) {
+				float previous = age[i];
+				age[i] += deltaTime;
+
+				bool spawn = (previous < 0.0f && age[i] >= 0.0f) || age[i] >= lifetime[i];
+				bool move = !spawn && age[i] >= 0.0f;
+
+				// Same bits as the SIMD masks
+				moved[i] = move ? 0xFFFFFFFFu : 0;
+
+				if (spawn) {
+					spawns.push_back(first + i);
+				}
+
+				if (move) {
+					glm::vec3 position(px[i], py[i], pz[i]);
+					glm::vec3 velocity(vx[i], vy[i], vz[i]);
+
+					Integrate(position, velocity, forces, deltaTime, time);
+
+					px[i] = position.x;
+					py[i] = position.y;
+					pz[i] = position.z;
+					vx[i] = velocity.x;
+					vy[i] = velocity.y;
+					vz[i] = velocity.z;
+				}
+			}
+
+			// Collide
+
+			if (terrain) {
+				terrain->GetHeightsAt(count, px, pz, heights.data());
+			}
+
+			i = 0;
+
+			__m128 ground = _mm_set1_ps(forces.groundHeight);
+			__m128 bounce = _mm_set1_ps(forces.bounce);
+			__m128 sign = _mm_set1_ps(-0.0f);
+
+			for (; i + 4 <= count; i += 4) {
+				__m128 move = _mm_loadu_ps((const float*)(moved.data() + i));
+
+				__m128 level = terrain ? _mm_max_ps(ground, _mm_loadu_ps(heights.data() + i)) : ground;
+
+				__m128 y = _mm_loadu_ps(py + i);
+				__m128 hit = _mm_and_ps(move, _mm_cmplt_ps(y, level));
+
+				if (!_mm_movemask_ps(hit)) {
+					continue;
+				}
+
+				__m128 velY = _mm_loadu_ps(vy + i);
+
+				// Falling particles bounce back up, all of them lose speed along the ground
+				__m128 bounced = Select(_mm_cmplt_ps(velY, _mm_setzero_ps()), _mm_mul_ps(_mm_xor_ps(velY, sign), bounce), velY);
+
+				_mm_storeu_ps(py + i, Select(hit, level, y));
+				_mm_storeu_ps(vy + i, Select(hit, bounced, velY));
+				_mm_storeu_ps(vx + i, Select(hit, _mm_mul_ps(_mm_loadu_ps(vx + i), bounce), _mm_loadu_ps(vx + i)));
+				_mm_storeu_ps(vz + i, Select(hit, _mm_mul_ps(_mm_loadu_ps(vz + i), bounce), _mm_loadu_ps(vz + i)));
+			}
+
+			for (; i < count; i++) {
+				if (!moved[i]) {
+					continue;
+				}
+
+				glm::vec3 position(px[i], py[i], pz[i]);
+				glm::vec3 velocity(vx[i], vy[i], vz[i]);
+
+				Collide(position, velocity, terrain ? std::max(forces.groundHeight, heights[i]) : forces.groundHeight, forces.bounce);
+
+				py[i] = position.y;
+				vx[i] = velocity.x;
+				vy[i] = velocity.y;
+				vz[i] = velocity.z;
+			}
+		}
+
+		// Recycle
+
+		for (int i = 0; i < spawns.size(); i++) {
+			Spawn(spawns[i], emitter, time);
+		}
+	}
+
+	int ParticleSimulation::GetAliveCount() const {
+		int alive = 0;
+
+		for (int i = 0; i < capacity; i++) {
+			if (ages[i] >= 0.0f) {
+				alive++;
+			}
+		}
+
+		return alive;
+	}
+
+	glm::vec3 ParticleSimulation::GetPosition(int i) const {
+		return glm::vec3(positionX[i], positionY[i], positionZ[i]);
+	}
+
+	glm::vec3 ParticleSimulation::GetVelocity(int i) const {
+		return glm::vec3(velocityX[i], velocityY[i], velocityZ[i]);
+	}
+
+	float ParticleSimulation::GetAge(int i) const {
+		return ages[i];
+	}
+
+	void ParticleSimulation::GetState(std::vector<float>& state) const {
+		state.resize(capacity * PARTICLE_ATTRIBUTES);
+
+		for (int i = 0; i < capacity; i++) {
+			float* p = &state[i * PARTICLE_ATTRIBUTES];
+
+			p[0] = positionX[i];
+			p[1] = positionY[i];
+			p[2] = positionZ[i];
+			p[3] = velocityX[i];
+			p[4] = velocityY[i];
+			p[5] = velocityZ[i];
+			p[6] = ages[i];
+			p[7] = lifetimes[i];
+			p[8] = seeds[i];
+		}
+	}
+
+	void ParticleSimulation::SortByDepth(const glm::mat4& viewMatrix, std::vector<int>& order, JobSystem* jobs) {
+		// Least significant digit radix sort of the depth bits. Every pass histograms the digits of each
+		// slice of the particles, then each slice scatters into its own range, so the passes are stable and
+		// the slices can run as separate jobs
+
+		order.resize(capacity);
+		sortKeys[0].resize(capacity);
+		sortKeys[1].resize(capacity);
+		sortIndices.resize(capacity);
+
+		int slices = jobs ? glm::max(1, glm::min(jobs->GetThreadCount() * 4, capacity / 4096)) : 1;
+		int grain = (capacity + slices - 1) / slices;
+
+		sortHistograms.assign(slices * SORT_BUCKETS, 0);
+
+		auto forSlices = [&](const std::function<void(int, int)>& function) {
+			if (jobs && slices > 1) {
+				jobs->ParallelFor(capacity, grain, function);
+			} else {
+				function(0, capacity);
+			}
+		};
+
+		// Distance in front of the camera, increasing keys are farther
+		glm::vec3 forward(-viewMatrix[0][2], -viewMatrix[1][2], -viewMatrix[2][2]);
+		float offset = -viewMatrix[3][2];
+
+		forSlices([&](int first, int last) {
+			for (int i = first; i < last; i++) {
+				float depth = forward.x * positionX[i] + forward.y * positionY[i] + forward.z * positionZ[i] + offset;
+
+				// Float bits ordered like integers: negative values are flipped, positive ones get the sign bit.
+				// Inverted so the farthest particle comes first
+				unsigned int bits;
+				std::memcpy(&bits, &depth, sizeof(bits));
+
+				sortKeys[0][i] = ~((bits & 0x80000000u) ? ~bits : (bits | 0x80000000u));
+				order[i] = i;
+			}
+		});
+
+		int current = 0;
+		int* indices[2] = { order.data(), sortIndices.data() };
+
+		for (int shift = 0; shift < 32; shift += SORT_RADIX_BITS) {
+			const unsigned int* keys = sortKeys[current].data();
+
+			std::fill(sortHistograms.begin(), sortHistograms.end(), 0);
+
+			forSlices([&](int first, int last) {
+				int* histogram = &sortHistograms[(first / grain) * SORT_BUCKETS];
+
+				for (int i = first; i < last; i++) {
+					histogram[(keys[i] >> shift) & (SORT_BUCKETS - 1)]++;
+				}
+			});
+
+			// Skip the pass when every particle has the same digit
+			bool sorted = false;
+
+			for (int digit = 0; digit < SORT_BUCKETS && !sorted; digit++) {
+				int total = 0;
+
+				for (int slice = 0; slice < slices; slice++) {
+					total += sortHistograms[slice * SORT_BUCKETS + digit];
+				}
+
+				sorted = total == capacity;
+			}
+
+			if (sorted) {
+				continue;
+			}
+
+			// Offsets ordered by digit, then by slice
+			int offset = 0;
+
+			for (int digit = 0; digit < SORT_BUCKETS; digit++) {
+				for (int slice = 0; slice < slices; slice++) {
+					int count = sortHistograms[slice * SORT_BUCKETS + digit];
+
+					sortHistograms[slice * SORT_BUCKETS + digit] = offset;
+					offset += count;
+				}
+			}
+
+			unsigned int* nextKeys = sortKeys[1 - current].data();
+			const int* sourceIndices = indices[current];
+			int* nextIndices = indices[1 - current];
+
+			forSlices([&](int first, int last) {
+				int* offsets = &sortHistograms[(first / grain) * SORT_BUCKETS];
+
+				for (int i = first; i < last; i++) {
+					int position = offsets[(keys[i] >> shift) & (SORT_BUCKETS - 1)]++;
+
+					nextKeys[position] = keys[i];
+					nextIndices[position] = sourceIndices[i];
+				}
+			});
+
+			current = 1 - current;
+		}
+
+		if (current == 1) {
+			std::memcpy(order.data(), sortIndices.data(), capacity * sizeof(int));
+		}
+	}
+}
@@ -0,0 +1,78 @@
+#ifndef PARTICLE_SIMULATION_H_
+#define PARTICLE_SIMULATION_H_
+
+#include <vector>
+#include <glm/glm.hpp>
+#include "particle_system.h"
+#include "terrain.h"
+#include "job_system.h"
+
+namespace Game {
+	// Particles simulated on the CPU with the rules of particle_update_vp.glsl, so particle behaviour can be run,
+	// profiled and checked without a GPU. The state is kept as one array per attribute, stepped with SSE2
+	// (AVX2 in builds configured with USE_AVX2), and respawns are handled one particle at a time since they
+	// are rare
+	class ParticleSimulation {
+
+	public:
+		ParticleSimulation();
+		~ParticleSimulation();
+
+		// Same starting state as ParticleSystem::Create with the same seed, see ParticleSystem::GetStartState
+		void Create(int capacity, float maxLifetime, unsigned int seed = 0);
+
+		int GetCapacity() const;
+
+		// Collide with the terrain heights, NULL to only collide with the ground height
+		void SetTerrain(const Terrain* terrain);
+
+		// Advance the particles by deltaTime
+		void Simulate(const ParticleEmitter& emitter, const ParticleForces& forces, float deltaTime, float time);
+		// Same step one particle at a time, written like the shader. Used as the reference for Simulate
+		void SimulateScalar(const ParticleEmitter& emitter, const ParticleForces& forces, float deltaTime, float time);
+
+		// Particles that have been spawned
+		int GetAliveCount() const;
+
+		glm::vec3 GetPosition(int i) const;
+		glm::vec3 GetVelocity(int i) const;
+		float GetAge(int i) const;
+
+		// State laid out like the GPU buffers, PARTICLE_ATTRIBUTES floats per particle
+		void GetState(std::vector<float>& state) const;
+
+		// Particle indices from the farthest to the closest along the view direction, for drawing with ordinary
+		// blending. A radix sort on the depths, split over the jobs when given
+		void SortByDepth(const glm::mat4& viewMatrix, std::vector<int>& order, JobSystem* jobs = NULL);
+
+	private:
+		int capacity = 0;
+
+		const Terrain* terrain = NULL;
+
+		// One array per attribute
+		std::vector<float> positionX;
+		std::vector<float> positionY;
+		std::vector<float> positionZ;
+		std::vector<float> velocityX;
+		std::vector<float> velocityY;
+		std::vector<float> velocityZ;
+		std::vector<float> ages;
+		std::vector<float> lifetimes;
+		std::vector<float> seeds;
+
+		// Scratch for a step: lanes that were moved (all bits set) or not, terrain heights, and particles to respawn
+		std::vector<unsigned int> moved;
+		std::vector<float> heights;
+		std::vector<int> spawns;
+
+		// Scratch for sorting: keys and indices of both passes, and a digit histogram per job
+		std::vector<unsigned int> sortKeys[2];
+		std::vector<int> sortIndices;
+		std::vector<int> sortHistograms;
+
+		void Spawn(int i, const ParticleEmitter& emitter, float time);
+	};
+}
+
+#endif
@@ -0,0 +1,151 @@
+#include <vector>
+#include <cstdlib>
+#include <glm/gtc/type_ptr.hpp>
+#include "particle_system.h"
+
+namespace Game {
+	// Counter based random number in [0, 1), only depends on the seed and the sample index
+	static inline float Hash(unsigned int seed, unsigned int index) {
+		unsigned int x = index * 0x9E3779B9u + seed;
+
+		x ^= x >> 16;
+		x *= 0x7FEB352Du;
+		x ^= x >> 15;
+		x *= 0x846CA68Bu;
+		x ^= x >> 16;
+
+		return (x >> 8) * (1.0f / 16777216.0f);
+	}
+
+	ParticleSystem::ParticleSystem(const std::string name) {
+		ParticleSystem::name = name;
+
+		arrayBuffers[0] = arrayBuffers[1] = 0;
+		feedbacks[0] = feedbacks[1] = 0;
+	}
+
+	ParticleSystem::~ParticleSystem() {}
+
+	const std::string ParticleSystem::GetName() const {
+		return name;
+	}
+
+	void ParticleSystem::Create(int capacity, float maxLifetime, unsigned int seed) {
+		if (capacity < 1) {
+			throw(std::string("Particle system error: capacity must be at least 1"));
+		}
+
+		ParticleSystem::capacity = capacity;
+
+		std::vector<GLfloat> particle;
+		GetStartState(capacity, maxLifetime, seed, particle);
+
+		// Both buffers start with the same state, each has a feedback object writing into it
+
+		glGenBuffers(2, arrayBuffers);
+		glGenTransformFeedbacks(2, feedbacks);
+
+		for (int i = 0; i < 2; i++) {
+			glBindBuffer(GL_ARRAY_BUFFER, arrayBuffers[i]);
+			glBufferData(GL_ARRAY_BUFFER, particle.size() * sizeof(GLfloat), particle.data(), GL_DYNAMIC_COPY);
+
+			glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, feedbacks[i]);
+			glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, arrayBuffers[i]);
+		}
+
+		glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, 0);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		current = 0;
+	}
+
+	int ParticleSystem::GetCapacity() const {
+		return capacity;
+	}
+
+	void ParticleSystem::GetStartState(int capacity, float maxLifetime, unsigned int seed, std::vector<GLfloat>& particles) {
+		particles.assign(capacity * PARTICLE_ATTRIBUTES, 0.0f);
+
+		// Every particle starts unborn with a negative age, it is spawned once the age reaches zero
+		for (int i = 0; i < capacity; i++) {
+			GLfloat* p = &particles[i * PARTICLE_ATTRIBUTES];
+
+			p[6] = -maxLifetime * Hash(seed, 2 * i);
+			p[7] = maxLifetime;
+			p[8] = Hash(seed, 2 * i + 1);
+		}
+	}
+
+	GLuint ParticleSystem::GetArrayBuffer() const {
+		return arrayBuffers[current];
+	}
+
+	void ParticleSystem::Simulate(GLuint program, const ParticleEmitter& emitter, const ParticleForces& forces, float deltaTime, float time, GLuint heightMap, int heightMapSize) {
+		glUseProgram(program);
+
+		// Read the current state
+
+		glBindBuffer(GL_ARRAY_BUFFER, arrayBuffers[current]);
+
+		GLint vertexAttribute = glGetAttribLocation(program, "vertex");
+		glVertexAttribPointer(vertexAttribute, 3, GL_FLOAT, GL_FALSE, PARTICLE_ATTRIBUTES * sizeof(GLfloat), 0);
+		glEnableVertexAttribArray(vertexAttribute);
+
+		GLint normalAttribute = glGetAttribLocation(program, "normal");
+		glVertexAttribPointer(normalAttribute, 3, GL_FLOAT, GL_FALSE, PARTICLE_ATTRIBUTES * sizeof(GLfloat), (void*)(3 * sizeof(GLfloat)));
+		glEnableVertexAttribArray(normalAttribute);
+
+		GLint colorAttribute = glGetAttribLocation(program, "color");
+		glVertexAttribPointer(colorAttribute, 3, GL_FLOAT, GL_FALSE, PARTICLE_ATTRIBUTES * sizeof(GLfloat), (void*)(6 * sizeof(GLfloat)));
+		glEnableVertexAttribArray(colorAttribute);
+
+		// Step
+
+		glUniform1f(glGetUniformLocation(program, "timer"), time);
+		glUniform1f(glGetUniformLocation(program, "delta_time"), deltaTime);
+
+		// Emitter
+
+		glUniform3fv(glGetUniformLocation(program, "emitter_position"), 1, glm::value_ptr(emitter.position));
+		glUniform1f(glGetUniformLocation(program, "emitter_radius"), emitter.radius);
+		glUniform3fv(glGetUniformLocation(program, "emitter_direction"), 1, glm::value_ptr(emitter.direction));
+		glUniform1f(glGetUniformLocation(program, "emitter_spread"), emitter.spread);
+		glUniform1f(glGetUniformLocation(program, "emitter_speed"), emitter.speed);
+		glUniform2f(glGetUniformLocation(program, "emitter_lifetime"), emitter.minLifetime, emitter.maxLifetime);
+
+		// Forces
+
+		glUniform3fv(glGetUniformLocation(program, "gravity"), 1, glm::value_ptr(forces.gravity));
+		glUniform1f(glGetUniformLocation(program, "drag"), forces.drag);
+		glUniform3fv(glGetUniformLocation(program, "wind"), 1, glm::value_ptr(forces.wind));
+		glUniform3fv(glGetUniformLocation(program, "attractor"), 1, glm::value_ptr(forces.attractor));
+		glUniform1f(glGetUniformLocation(program, "attractor_strength"), forces.attractorStrength);
+		glUniform3fv(glGetUniformLocation(program, "player_position"), 1, glm::value_ptr(forces.player));
+		glUniform1f(glGetUniformLocation(program, "player_radius"), forces.playerRadius);
+
+		// Collisions
+
+		glUniform1f(glGetUniformLocation(program, "ground_height"), forces.groundHeight);
+		glUniform1f(glGetUniformLocation(program, "bounce"), forces.bounce);
+
+		glUniform1i(glGetUniformLocation(program, "use_height_map"), heightMap ? 1 : 0);
+		glUniform1f(glGetUniformLocation(program, "height_map_size"), (float)heightMapSize);
+		glUniform1i(glGetUniformLocation(program, "height_map"), 0);
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D, heightMap);
+
+		// Write the other buffer, nothing is rasterized
+
+		glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, feedbacks[1 - current]);
+		glEnable(GL_RASTERIZER_DISCARD);
+
+		glBeginTransformFeedback(GL_POINTS);
+		glDrawArrays(GL_POINTS, 0, capacity);
+		glEndTransformFeedback();
+
+		glDisable(GL_RASTERIZER_DISCARD);
+		glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, 0);
+
+		current = 1 - current;
+	}
+}
@@ -0,0 +1,93 @@
+#ifndef PARTICLE_SYSTEM_H_
+#define PARTICLE_SYSTEM_H_
+
+#define GLEW_STATIC
+
+#include <string>
+#include <vector>
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+
+// Floats per particle: position (3), velocity (3), and age, lifetime and random seed (3)
+#define PARTICLE_ATTRIBUTES 9
+
+namespace Game {
+	// Where particles are spawned and how they start
+	struct ParticleEmitter {
+		glm::vec3 position;
+		// Spawn anywhere inside a box of this half size around the position
+		float radius;
+
+		glm::vec3 direction;
+		// Random offset added to the direction before normalizing, 0 is straight and large values any direction
+		float spread;
+		float speed;
+
+		// Lifetime of each particle is picked between these
+		float minLifetime;
+		float maxLifetime;
+	};
+
+	// Forces and collisions applied at every step
+	struct ParticleForces {
+		glm::vec3 gravity;
+		// Fraction of the velocity lost per second
+		float drag;
+
+		// Gusts vary around this velocity over time and space
+		glm::vec3 wind;
+
+		// Spring pulling the particles towards a point, 0 to disable
+		glm::vec3 attractor;
+		float attractorStrength;
+
+		// Particles are pushed out of a sphere around the player
+		glm::vec3 player;
+		float playerRadius;
+
+		// Particles land on the terrain, or on a flat ground above it, keeping this fraction of their speed
+		float groundHeight;
+		float bounce;
+	};
+
+	// Particle state kept on the GPU in two buffers. Each step reads one with a transform feedback program
+	// and writes the other, so the CPU never touches the particles after creation.
+	// Dead particles are respawned by the emitter, so the number alive stays at the capacity
+	class ParticleSystem {
+
+	public:
+		ParticleSystem(const std::string name);
+		~ParticleSystem();
+
+		const std::string GetName() const;
+
+		// Allocate the state buffers, starting from GetStartState
+		void Create(int capacity, float maxLifetime, unsigned int seed = 0);
+
+		int GetCapacity() const;
+
+		// State of capacity unborn particles, PARTICLE_ATTRIBUTES floats each. Spawn times are staggered over the
+		// longest lifetime for a steady stream. The same seed always gives the same particles
+		static void GetStartState(int capacity, float maxLifetime, unsigned int seed, std::vector<GLfloat>& particles);
+
+		// Buffer with the latest state, drawn as points with PARTICLE_ATTRIBUTES floats each
+		GLuint GetArrayBuffer() const;
+
+		// Advance the particles by deltaTime with the update program. heightMap is the terrain height texture
+		// with one texel per world unit, 0 to only collide with the ground height
+		void Simulate(GLuint program, const ParticleEmitter& emitter, const ParticleForces& forces, float deltaTime, float time, GLuint heightMap, int heightMapSize);
+
+	private:
+		std::string name;
+
+		int capacity = 0;
+
+		// Ping-pong state, current is the one last written
+		GLuint arrayBuffers[2];
+		GLuint feedbacks[2];
+		int current = 0;
+	};
+}
+
+#endif
@@ -0,0 +1,342 @@
+#include <string>
+#include <map>
+#include <glm/glm.hpp>
+#include "post_graph.h"
+
+namespace Game {
+	// Weight of the latest frame in the averaged pass times
+	const float TIMING_SMOOTHING = 0.1f;
+
+	PostGraph::PostGraph() {}
+
+	PostGraph::~PostGraph() {}
+
+	void PostGraph::Setup() {
+		// Set up quad for drawing to the screen
+		static const GLfloat quad_vertex_data[] = {
+			-1.0f, -1.0f, 0.0f, 0.0f, 0.0f,
+			 1.0f, -1.0f, 0.0f, 1.0f, 0.0f,
+			-1.0f,  1.0f, 0.0f, 0.0f, 1.0f,
+			-1.0f,  1.0f, 0.0f, 0.0f, 1.0f,
+			 1.0f, -1.0f, 0.0f, 1.0f, 0.0f,
+			 1.0f,  1.0f, 0.0f, 1.0f, 1.0f,
+		};
+
+		// Create buffer for quad
+
+		glGenBuffers(1, &quadArrayBuffer);
+		glBindBuffer(GL_ARRAY_BUFFER, quadArrayBuffer);
+		glBufferData(GL_ARRAY_BUFFER, sizeof(quad_vertex_data), quad_vertex_data, GL_STATIC_DRAW);
+	}
+
+	void PostGraph::Reset() {
+		resources.clear();
+		passes.clear();
+	}
+
+	int PostGraph::Import(GLuint texture, int width, int height) {
+		PostResource resource;
+
+		resource.width = width;
+		resource.height = height;
+		resource.format = 0;
+		resource.texture = texture;
+		resource.target = NULL;
+		resource.isImported = true;
+		resource.lastReader = -1;
+
+		resources.push_back(resource);
+
+		return (int)resources.size() - 1;
+	}
+
+	int PostGraph::CreateTarget(int width, int height, GLenum format) {
+		PostResource resource;
+
+		resource.width = width;
+		resource.height = height;
+		resource.format = format;
+		resource.texture = 0;
+		resource.target = NULL;
+		resource.isImported = false;
+		resource.lastReader = -1;
+
+		resources.push_back(resource);
+
+		return (int)resources.size() - 1;
+	}
+
+	void PostGraph::AddPass(const std::string name, GLuint program, const std::vector<PostInput>& inputs, int output, std::function<void(GLuint)> setup, float budget) {
+		if (output != POST_SCREEN && (output < 0 || output >= resources.size() || resources[output].isImported)) {
+			throw(std::string("Post pass \"") + name + std::string("\" must write a target or the screen"));
+		}
+
+		for (int i = 0; i < inputs.size(); i++) {
+			if (inputs[i].resource < 0 || inputs[i].resource >= resources.size() || inputs[i].resource == output) {
+				throw(std::string("Post pass \"") + name + std::string("\" reads an invalid resource"));
+			}
+		}
+
+		PostPass pass;
+
+		pass.name = name;
+		pass.program = program;
+		pass.inputs = inputs;
+		pass.output = output;
+		pass.setup = setup;
+		pass.budget = budget;
+		pass.isCulled = false;
+
+		passes.push_back(pass);
+	}
+
+	void PostGraph::Compile() {
+		// Passes only read what earlier passes wrote, so walking backwards from the screen sees every
+		// reader of a resource before its writer
+
+		std::vector<bool> isNeeded(resources.size(), false);
+
+		for (int i = (int)passes.size() - 1; i >= 0; i--) {
+			PostPass& pass = passes[i];
+
+			pass.isCulled = pass.output != POST_SCREEN && !isNeeded[pass.output];
+
+			if (pass.isCulled) {
+				continue;
+			}
+
+			for (int j = 0; j < pass.inputs.size(); j++) {
+				PostResource& resource = resources[pass.inputs[j].resource];
+
+				isNeeded[pass.inputs[j].resource] = true;
+				resource.lastReader = glm::max(resource.lastReader, i);
+			}
+		}
+	}
+
+	void PostGraph::Execute() {
+		Compile();
+
+		// The queries of this slot were issued POST_TIMER_FRAMES frames ago, their results are usually in by now
+		std::vector<PostQuery>& frameQueries = queries[frame % POST_TIMER_FRAMES];
+		ReadTimings(frameQueries);
+
+		GLint viewport[4];
+		glGetIntegerv(GL_VIEWPORT, viewport);
+
+		for (int i = 0; i < passes.size(); i++) {
+			const PostPass& pass = passes[i];
+
+			if (pass.isCulled) {
+				continue;
+			}
+
+			// Output, a target is taken from the pool when its pass runs
+
+			if (pass.output == POST_SCREEN) {
+				glBindFramebuffer(GL_FRAMEBUFFER, 0);
+				glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+			} else {
+				PostResource& output = resources[pass.output];
+
+				output.target = pool.Acquire(output.width, output.height, output.format);
+				output.texture = output.target->texture;
+
+				glBindFramebuffer(GL_FRAMEBUFFER, output.target->frameBuffer);
+				glViewport(0, 0, output.width, output.height);
+			}
+
+			glUseProgram(pass.program);
+
+			// Inputs
+
+			for (int j = 0; j < pass.inputs.size(); j++) {
+				glUniform1i(glGetUniformLocation(pass.program, pass.inputs[j].uniform.c_str()), j);
+				glActiveTexture(GL_TEXTURE0 + j);
+				glBindTexture(GL_TEXTURE_2D, resources[pass.inputs[j].resource].texture);
+			}
+
+			glActiveTexture(GL_TEXTURE0);
+
+			if (pass.setup) {
+				pass.setup(pass.program);
+			}
+
+			// Timestamps rather than a time elapsed query, which could not nest in the frame timing
+
+			PostQuery query;
+
+			query.name = pass.name;
+			query.budget = pass.budget;
+			query.start = NewQuery();
+			query.end = NewQuery();
+
+			glQueryCounter(query.start, GL_TIMESTAMP);
+
+			DrawQuad(pass.program);
+
+			glQueryCounter(query.end, GL_TIMESTAMP);
+
+			frameQueries.push_back(query);
+
+			// Targets read for the last time go back to the pool for the following passes
+			for (int j = 0; j < pass.inputs.size(); j++) {
+				PostResource& resource = resources[pass.inputs[j].resource];
+
+				if (resource.target && resource.lastReader == i) {
+					pool.Release(resource.target);
+					resource.target = NULL;
+				}
+			}
+		}
+
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+
+		pool.EndFrame();
+
+		frame++;
+	}
+
+	GLuint PostGraph::NewQuery() {
+		if (freeQueries.empty()) {
+			GLuint query;
+			glGenQueries(1, &query);
+
+			return query;
+		}
+
+		GLuint query = freeQueries.back();
+		freeQueries.pop_back();
+
+		return query;
+	}
+
+	void PostGraph::ReadTimings(std::vector<PostQuery>& frameQueries) {
+		// Queries finish in order, so the last one being available means the whole frame is. Reading a
+		// result that is not in yet would wait for the GPU to catch up
+		if (frameQueries.size() > 0) {
+			GLint available = 0;
+			glGetQueryObjectiv(frameQueries.back().end, GL_QUERY_RESULT_AVAILABLE, &available);
+
+			// More than POST_TIMER_FRAMES behind, skip the frame. Its queries are deleted rather than reused
+			// while they are still pending
+			if (!available) {
+				for (int i = 0; i < frameQueries.size(); i++) {
+					glDeleteQueries(1, &frameQueries[i].start);
+					glDeleteQueries(1, &frameQueries[i].end);
+				}
+
+				frameQueries.clear();
+				return;
+			}
+		}
+
+		// Time of every name in the frame, passes sharing a name are added up
+		std::map<std::string, float> frameTimes;
+
+		for (int i = 0; i < frameQueries.size(); i++) {
+			const PostQuery& query = frameQueries[i];
+
+			GLuint64 start = 0;
+			GLuint64 end = 0;
+			glGetQueryObjectui64v(query.start, GL_QUERY_RESULT, &start);
+			glGetQueryObjectui64v(query.end, GL_QUERY_RESULT, &end);
+
+			float milliseconds = (end - start) / 1e6f;
+
+			if (frameTimes.find(query.name) == frameTimes.end()) {
+				frameTimes[query.name] = milliseconds;
+
+				// Keep the order passes first ran in
+				bool isKnown = false;
+
+				for (int j = 0; j < timings.size() && !isKnown; j++) {
+					isKnown = timings[j].name == query.name;
+				}
+
+				if (!isKnown) {
+					PostTiming timing;
+
+					timing.name = query.name;
+					timing.milliseconds = milliseconds;
+					timing.budget = query.budget;
+					timing.frame = frame;
+
+					timings.push_back(timing);
+				}
+			} else {
+				frameTimes[query.name] += milliseconds;
+			}
+
+			freeQueries.push_back(query.start);
+			freeQueries.push_back(query.end);
+		}
+
+		frameQueries.clear();
+
+		for (int i = 0; i < timings.size(); i++) {
+			PostTiming& timing = timings[i];
+
+			std::map<std::string, float>::const_iterator frameTime = frameTimes.find(timing.name);
+
+			if (frameTime == frameTimes.end()) {
+				continue;
+			}
+
+			// A pass that did not run for a while starts over from its new time
+			if (timing.frame < frame - POST_TIMER_FRAMES) {
+				timing.milliseconds = frameTime->second;
+			} else {
+				timing.milliseconds += (frameTime->second - timing.milliseconds) * TIMING_SMOOTHING;
+			}
+
+			timing.frame = frame;
+		}
+	}
+
+	void PostGraph::DrawQuad(GLuint program) {
+		glBindBuffer(GL_ARRAY_BUFFER, quadArrayBuffer);
+
+		GLint pos_att = glGetAttribLocation(program, "position");
+		glEnableVertexAttribArray(pos_att);
+		glVertexAttribPointer(pos_att, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat), 0);
+
+		GLint tex_att = glGetAttribLocation(program, "uv");
+		glEnableVertexAttribArray(tex_att);
+		glVertexAttribPointer(tex_att, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat), (void*)(3 * sizeof(GLfloat)));
+
+		glDrawArrays(GL_TRIANGLES, 0, 6);
+	}
+
+	int PostGraph::GetPassCount() const {
+		return (int)passes.size();
+	}
+
+	int PostGraph::GetCulledPassCount() const {
+		int culled = 0;
+
+		for (int i = 0; i < passes.size(); i++) {
+			if (passes[i].isCulled) {
+				culled++;
+			}
+		}
+
+		return culled;
+	}
+
+	int PostGraph::GetPooledTargetCount() const {
+		return pool.GetTargetCount();
+	}
+
+	void PostGraph::GetTimings(std::vector<PostTiming>& timings) const {
+		timings.clear();
+
+		for (int i = 0; i < PostGraph::timings.size(); i++) {
+			// Results arrive POST_TIMER_FRAMES frames late, then every frame while the pass keeps running
+			if (PostGraph::timings[i].frame >= frame - 1) {
+				timings.push_back(PostGraph::timings[i]);
+			}
+		}
+	}
+}
@@ -0,0 +1,140 @@
+#ifndef POST_GRAPH_H_
+#define POST_GRAPH_H_
+
+#define GLEW_STATIC
+
+#include <string>
+#include <vector>
+#include <map>
+#include <functional>
+#include <GL/glew.h>
+#include "render_target_pool.h"
+
+// Resource handle of the window, as the output of the final pass
+#define POST_SCREEN -1
+
+// Frames the GPU timestamps of a pass wait before they are read, so reading them does not stall
+#define POST_TIMER_FRAMES 4
+
+namespace Game {
+	// Texture read by a pass, bound to the sampler uniform of that name
+	struct PostInput {
+		std::string uniform;
+		int resource;
+	};
+
+	// A full screen pass: draws the screen quad with a program, reading textures and writing one target
+	struct PostPass {
+		std::string name;
+
+		GLuint program;
+		std::vector<PostInput> inputs;
+		int output;
+
+		// Sets the other uniforms, after the program is bound
+		std::function<void(GLuint)> setup;
+
+		// GPU time the pass should fit in, in milliseconds, 0 for none
+		float budget;
+
+		bool isCulled;
+	};
+
+	// GPU time of the passes of one name, averaged over the frames they ran in
+	struct PostTiming {
+		std::string name;
+
+		float milliseconds;
+		float budget;
+
+		// Frame of the latest result
+		int frame;
+	};
+
+	// Post processing passes of a frame. Passes are added in order, reading textures imported from outside or
+	// written by earlier passes. Passes that do not lead to the screen are culled, and the transient targets
+	// come from a pool and go back to it after their last reader, so later passes reuse them
+	class PostGraph {
+
+	public:
+		PostGraph();
+		~PostGraph();
+
+		// Create the screen quad, needs a GL context
+		void Setup();
+
+		// Forget the passes and resources of the previous frame
+		void Reset();
+
+		// Texture made outside the graph, such as the scene, returns its resource handle
+		int Import(GLuint texture, int width, int height);
+		// Target written by one pass of this frame, returns its resource handle
+		int CreateTarget(int width, int height, GLenum format);
+
+		// Pass writing into a target, or into POST_SCREEN with the current viewport
+		void AddPass(const std::string name, GLuint program, const std::vector<PostInput>& inputs, int output, std::function<void(GLuint)> setup = NULL, float budget = 0.0f);
+
+		// Cull, then draw the passes that lead to the screen
+		void Execute();
+
+		// Draw the screen quad with a program, with the current frame buffer
+		void DrawQuad(GLuint program);
+
+		int GetPassCount() const;
+		int GetCulledPassCount() const;
+		// Targets in the pool, transient targets of the frame share them
+		int GetPooledTargetCount() const;
+
+		// GPU times of the passes that ran lately, in the order they first ran. Passes sharing a name are added up
+		void GetTimings(std::vector<PostTiming>& timings) const;
+
+	private:
+		struct PostResource {
+			int width;
+			int height;
+			GLenum format;
+
+			// Imported texture, or the pooled target while the resource is alive
+			GLuint texture;
+			RenderTarget* target;
+
+			bool isImported;
+
+			// Last pass reading the resource, -1 if none does
+			int lastReader;
+		};
+
+		std::vector<PostResource> resources;
+		std::vector<PostPass> passes;
+
+		RenderTargetPool pool;
+
+		GLuint quadArrayBuffer = 0;
+
+		// Timestamps around a pass that was drawn
+		struct PostQuery {
+			std::string name;
+			float budget;
+
+			GLuint start;
+			GLuint end;
+		};
+
+		// Queries of the last frames, reused once read
+		std::vector<PostQuery> queries[POST_TIMER_FRAMES];
+		std::vector<GLuint> freeQueries;
+
+		std::vector<PostTiming> timings;
+		int frame = 0;
+
+		GLuint NewQuery();
+		// Average the results of the queries of a frame into the timings, then free them. A frame whose results
+		// are not in yet is dropped instead of waited for
+		void ReadTimings(std::vector<PostQuery>& frameQueries);
+
+		// Mark the passes whose output never reaches the screen, and find the last reader of every resource
+		void Compile();
+	};
+}
+
+#endif
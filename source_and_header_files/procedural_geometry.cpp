@@ -0,0 +1,265 @@
+#include <algorithm>
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+#include "procedural_geometry.h"
+
+namespace Game {
+	bool GeometryKey::operator<(const GeometryKey& other) const {
+		if (generator != other.generator) {
+			return generator < other.generator;
+		}
+
+		return parameters < other.parameters;
+	}
+
+	bool GeometryKey::operator==(const GeometryKey& other) const {
+		return generator == other.generator && parameters == other.parameters;
+	}
+
+	GeometryGenerator::~GeometryGenerator() {}
+
+	void CylinderGenerator::GetSize(const std::vector<float>& parameters, int& vertices, int& indices) const {
+		int heightSamples = (int)parameters[2];
+		int circleSamples = (int)parameters[3];
+
+		// Rings plus the centers of the ends
+		vertices = heightSamples * circleSamples + 2;
+		// Two triangles per quad between the rings, and a fan at each end
+		indices = ((heightSamples - 1) * circleSamples * 2 + circleSamples * 2) * 3;
+	}
+
+	void CylinderGenerator::Generate(const std::vector<float>& parameters, GLfloat* vertices, GLuint* indices) const {
+		float height = parameters[0];
+		float radius = parameters[1];
+		int heightSamples = (int)parameters[2];
+		int circleSamples = (int)parameters[3];
+
+		// Every ring goes around the same circle
+		std::vector<glm::vec2> circle(circleSamples);
+
+		for (int j = 0; j < circleSamples; j++) {
+			float theta = 2.0f * glm::pi<float>() * j / (float)circleSamples;
+
+			circle[j] = glm::vec2(glm::cos(theta), glm::sin(theta));
+		}
+
+		// Rings along the side
+
+		for (int i = 0; i < heightSamples; i++) {
+			float s = i / (float)heightSamples;
+			float h = (-0.5f + s) * height;
+
+			for (int j = 0; j < circleSamples; j++) {
+				float t = j / (float)circleSamples;
+
+				GLfloat* att = vertices + (i * circleSamples + j) * GENERATED_VERTEX_ATTRIBUTES;
+
+				// Position
+				att[0] = circle[j].x * radius;
+				att[1] = h;
+				att[2] = circle[j].y * radius;
+
+				// Normal
+				att[3] = circle[j].x;
+				att[4] = 0.0f;
+				att[5] = circle[j].y;
+
+				// Color
+				att[6] = 1.0f - s;
+				att[7] = t;
+				att[8] = s;
+
+				// Texture coordinates
+				att[9] = s;
+				att[10] = t;
+			}
+		}
+
+		// Centers of the ends, at the height of the last and the first ring. No good way to texture them
+
+		const GLuint top = heightSamples * circleSamples;
+		const GLuint bottom = top + 1;
+
+		const GLfloat ends[2][GENERATED_VERTEX_ATTRIBUTES] = {
+			{ 0.0f, height * (heightSamples - 1) / (float)heightSamples - height * 0.5f, 0.0f, 0.0f, 1.0f, 0.0f, 1.0f, 0.6f, 0.4f, 0.0f, 0.0f },
+			{ 0.0f, -0.5f * height, 0.0f, 0.0f, -1.0f, 0.0f, 1.0f, 0.6f, 0.4f, 0.0f, 0.0f }
+		};
+
+		std::copy(ends[0], ends[0] + GENERATED_VERTEX_ATTRIBUTES, vertices + top * GENERATED_VERTEX_ATTRIBUTES);
+		std::copy(ends[1], ends[1] + GENERATED_VERTEX_ATTRIBUTES, vertices + bottom * GENERATED_VERTEX_ATTRIBUTES);
+
+		// Two triangles per quad between the rings
+
+		GLuint* face = indices;
+
+		for (int i = 0; i < heightSamples - 1; i++) {
+			for (int j = 0; j < circleSamples; j++) {
+				GLuint a = i * circleSamples + j;
+				GLuint b = i * circleSamples + (j + 1) % circleSamples;
+				GLuint c = a + circleSamples;
+				GLuint d = b + circleSamples;
+
+				face[0] = c;
+				face[1] = b;
+				face[2] = a;
+
+				face[3] = c;
+				face[4] = d;
+				face[5] = b;
+
+				face += 6;
+			}
+		}
+
+		// Fans pointing to the centers, the bottom one reversed so all triangles face outward
+
+		const GLuint last = (heightSamples - 1) * circleSamples;
+
+		for (int j = 0; j < circleSamples; j++) {
+			face[0] = last + j;
+			face[1] = top;
+			face[2] = last + (j + 1) % circleSamples;
+
+			face[circleSamples * 3 + 0] = (j + 1) % circleSamples;
+			face[circleSamples * 3 + 1] = bottom;
+			face[circleSamples * 3 + 2] = j;
+
+			face += 3;
+		}
+	}
+
+	GeometryCache::GeometryCache() {
+		AddGenerator("Cylinder", new CylinderGenerator());
+	}
+
+	GeometryCache::~GeometryCache() {
+		for (std::map<std::string, GeometryGenerator*>::iterator it = generators.begin(); it != generators.end(); ++it) {
+			delete it->second;
+		}
+	}
+
+	void GeometryCache::AddGenerator(const std::string name, GeometryGenerator* generator) {
+		delete GetGenerator(name);
+
+		generators[name] = generator;
+	}
+
+	void GeometryCache::Request(const GeometryKey& key) {
+		if (!GetGenerator(key.generator)) {
+			throw(std::string("Error: no geometry generator named ") + key.generator);
+		}
+
+		if (shapes.count(key) > 0 || std::find(pending.begin(), pending.end(), key) != pending.end()) {
+			return;
+		}
+
+		pending.push_back(key);
+	}
+
+	void GeometryCache::Build(JobSystem* jobs) {
+		if (pending.size() == 0) {
+			return;
+		}
+
+		std::vector<GLfloat> vertices;
+		std::vector<GLuint> indices;
+		std::vector<GeneratedGeometry> generated;
+
+		Generate(vertices, indices, generated, jobs);
+
+		// One pair of buffers for the whole arena
+
+		GLuint vbo, ebo;
+
+		glGenBuffers(1, &vbo);
+		glBindBuffer(GL_ARRAY_BUFFER, vbo);
+		glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(GLfloat), vertices.data(), GL_STATIC_DRAW);
+
+		glGenBuffers(1, &ebo);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
+
+		for (int i = 0; i < pending.size(); i++) {
+			generated[i].arrayBuffer = vbo;
+			generated[i].elementArrayBuffer = ebo;
+
+			shapes[pending[i]] = generated[i];
+		}
+
+		pending.clear();
+	}
+
+	void GeometryCache::Generate(std::vector<GLfloat>& vertices, std::vector<GLuint>& indices, std::vector<GeneratedGeometry>& generated, JobSystem* jobs) const {
+		const int count = (int)pending.size();
+
+		// Room of every shape in the arena, known up front so they can be generated side by side
+
+		generated.resize(count);
+
+		GLuint vertexCount = 0, indexCount = 0;
+
+		for (int i = 0; i < count; i++) {
+			int shapeVertices, shapeIndices;
+			GetGenerator(pending[i].generator)->GetSize(pending[i].parameters, shapeVertices, shapeIndices);
+
+			GeneratedGeometry& shape = generated[i];
+
+			shape.arrayBuffer = 0;
+			shape.elementArrayBuffer = 0;
+			shape.firstIndex = indexCount;
+			shape.count = shapeIndices;
+			shape.firstVertex = vertexCount;
+			shape.vertexCount = shapeVertices;
+
+			vertexCount += shapeVertices;
+			indexCount += shapeIndices;
+		}
+
+		vertices.assign(vertexCount * GENERATED_VERTEX_ATTRIBUTES, 0.0f);
+		indices.assign(indexCount, 0);
+
+		// Each shape writes its own range, then moves its indices past the shapes before it and finds its bounds
+
+		auto generate = [&](int first, int last) {
+			for (int i = first; i < last; i++) {
+				GeneratedGeometry& shape = generated[i];
+				GLuint* shapeIndices = indices.data() + shape.firstIndex;
+
+				GetGenerator(pending[i].generator)->Generate(pending[i].parameters, vertices.data() + shape.firstVertex * GENERATED_VERTEX_ATTRIBUTES, shapeIndices);
+
+				for (int j = 0; j < shape.count; j++) {
+					shapeIndices[j] += shape.firstVertex;
+				}
+
+				shape.min = glm::vec3(1e9f);
+				shape.max = glm::vec3(-1e9f);
+
+				for (int j = 0; j < shape.vertexCount; j++) {
+					const GLfloat* p = vertices.data() + (shape.firstVertex + j) * GENERATED_VERTEX_ATTRIBUTES;
+					glm::vec3 position(p[0], p[1], p[2]);
+
+					shape.min = glm::min(shape.min, position);
+					shape.max = glm::max(shape.max, position);
+				}
+			}
+		};
+
+		if (jobs) {
+			jobs->ParallelFor(count, 1, generate);
+		} else {
+			generate(0, count);
+		}
+	}
+
+	const GeneratedGeometry* GeometryCache::Find(const GeometryKey& key) const {
+		std::map<GeometryKey, GeneratedGeometry>::const_iterator it = shapes.find(key);
+
+		return it == shapes.end() ? NULL : &it->second;
+	}
+
+	GeometryGenerator* GeometryCache::GetGenerator(const std::string& name) const {
+		std::map<std::string, GeometryGenerator*>::const_iterator it = generators.find(name);
+
+		return it == generators.end() ? NULL : it->second;
+	}
+}
@@ -0,0 +1,100 @@
+#ifndef PROCEDURAL_GEOMETRY_H_
+#define PROCEDURAL_GEOMETRY_H_
+
+#define GLEW_STATIC
+
+#include <map>
+#include <string>
+#include <vector>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include "job_system.h"
+
+// Floats per generated vertex: position, normal, color, texture coordinates
+#define GENERATED_VERTEX_ATTRIBUTES 11
+
+namespace Game {
+	// Shape of a generator with its parameters, equal keys describe the same geometry
+	struct GeometryKey {
+		std::string generator;
+		std::vector<float> parameters;
+
+		bool operator<(const GeometryKey& other) const;
+		bool operator==(const GeometryKey& other) const;
+	};
+
+	// Builds the vertices and triangles of one kind of shape from its parameters
+	class GeometryGenerator {
+
+	public:
+		virtual ~GeometryGenerator();
+
+		// Vertices and indices the shape takes, so its room in the arena is known before anything is generated
+		virtual void GetSize(const std::vector<float>& parameters, int& vertices, int& indices) const = 0;
+
+		// Fill the room of the shape, indices counted from its first vertex. May run on any thread
+		virtual void Generate(const std::vector<float>& parameters, GLfloat* vertices, GLuint* indices) const = 0;
+	};
+
+	// Cylinder along y centered on the origin, parameters (height, radius, height samples, circle samples).
+	// The ends are closed by fans around a center vertex
+	class CylinderGenerator : public GeometryGenerator {
+
+	public:
+		void GetSize(const std::vector<float>& parameters, int& vertices, int& indices) const;
+		void Generate(const std::vector<float>& parameters, GLfloat* vertices, GLuint* indices) const;
+	};
+
+	// Where a generated shape lies in the buffers of its arena
+	struct GeneratedGeometry {
+		GLuint arrayBuffer;
+		GLuint elementArrayBuffer;
+
+		// Range of the index buffer, the indices point into the whole arena
+		GLuint firstIndex;
+		GLsizei count;
+
+		// Range of the vertex buffer the indices point to
+		GLuint firstVertex;
+		GLsizei vertexCount;
+
+		// Box around the positions of the shape
+		glm::vec3 min;
+		glm::vec3 max;
+	};
+
+	// Generated shapes, each made once however many resources ask for it. The shapes requested before a Build
+	// are generated in parallel into one arena: a vertex and an index buffer they all share
+	class GeometryCache {
+
+	public:
+		GeometryCache();
+		~GeometryCache();
+
+		// Generator for the keys with the given name, the cache takes ownership
+		void AddGenerator(const std::string name, GeometryGenerator* generator);
+
+		// Queue a shape for the next Build, unless it was already generated or queued
+		void Request(const GeometryKey& key);
+
+		// Generate the queued shapes into a new arena and copy it to OpenGL buffers, split over the jobs when given
+		void Build(JobSystem* jobs = NULL);
+
+		// Generate the queued shapes into an arena in memory only, one shape per key in the order they were
+		// queued, with no buffers yet. Split over the jobs when given
+		void Generate(std::vector<GLfloat>& vertices, std::vector<GLuint>& indices, std::vector<GeneratedGeometry>& generated, JobSystem* jobs = NULL) const;
+
+		// Generated shape, NULL until it was built
+		const GeneratedGeometry* Find(const GeometryKey& key) const;
+
+	private:
+		std::map<std::string, GeometryGenerator*> generators;
+
+		std::map<GeometryKey, GeneratedGeometry> shapes;
+		std::vector<GeometryKey> pending;
+
+		GeometryGenerator* GetGenerator(const std::string& name) const;
+	};
+}
+
+#endif
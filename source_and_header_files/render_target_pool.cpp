@@ -0,0 +1,99 @@
+#include <string>
+#include "render_target_pool.h"
+
+namespace Game {
+	RenderTargetPool::RenderTargetPool() {}
+
+	RenderTargetPool::~RenderTargetPool() {
+		for (int i = 0; i < targets.size(); i++) {
+			delete targets[i];
+		}
+	}
+
+	RenderTarget* RenderTargetPool::Acquire(int width, int height, GLenum format) {
+		for (int i = 0; i < targets.size(); i++) {
+			RenderTarget* target = targets[i];
+
+			if (!target->isInUse && target->width == width && target->height == height && target->format == format) {
+				target->isInUse = true;
+				target->lastUsed = frame;
+
+				return target;
+			}
+		}
+
+		RenderTarget* target = new RenderTarget;
+
+		target->width = width;
+		target->height = height;
+		target->format = format;
+		target->isInUse = true;
+		target->lastUsed = frame;
+
+		// Filtered and clamped, passes usually read between texels and up to the edges.
+		// No data is uploaded, so the same format and type work for every color format
+		glGenTextures(1, &target->texture);
+		glBindTexture(GL_TEXTURE_2D, target->texture);
+		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, GL_RGBA, GL_FLOAT, 0);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glBindTexture(GL_TEXTURE_2D, 0);
+
+		glGenFramebuffers(1, &target->frameBuffer);
+		glBindFramebuffer(GL_FRAMEBUFFER, target->frameBuffer);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target->texture, 0);
+
+		GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+		if (status != GL_FRAMEBUFFER_COMPLETE) {
+			DeleteTarget(target);
+			delete target;
+
+			throw(std::string("Error setting up pooled render target"));
+		}
+
+		targets.push_back(target);
+
+		return target;
+	}
+
+	void RenderTargetPool::Release(RenderTarget* target) {
+		target->isInUse = false;
+	}
+
+	void RenderTargetPool::EndFrame() {
+		for (int i = 0; i < targets.size(); i++) {
+			if (!targets[i]->isInUse && frame - targets[i]->lastUsed > RENDER_TARGET_RETENTION_FRAMES) {
+				DeleteTarget(targets[i]);
+				delete targets[i];
+
+				targets.erase(targets.begin() + i);
+				i--;
+			}
+		}
+
+		frame++;
+	}
+
+	void RenderTargetPool::Clear() {
+		for (int i = 0; i < targets.size(); i++) {
+			DeleteTarget(targets[i]);
+			delete targets[i];
+		}
+
+		targets.clear();
+	}
+
+	int RenderTargetPool::GetTargetCount() const {
+		return (int)targets.size();
+	}
+
+	void RenderTargetPool::DeleteTarget(RenderTarget* target) {
+		glDeleteFramebuffers(1, &target->frameBuffer);
+		glDeleteTextures(1, &target->texture);
+	}
+}
@@ -0,0 +1,58 @@
+#ifndef RENDER_TARGET_POOL_H_
+#define RENDER_TARGET_POOL_H_
+
+#define GLEW_STATIC
+
+#include <vector>
+#include <GL/glew.h>
+
+// Frames a released target is kept for before it is deleted, covers resizes and effects turning off
+#define RENDER_TARGET_RETENTION_FRAMES 60
+
+namespace Game {
+	// A texture with a frame buffer drawing into it
+	struct RenderTarget {
+		GLuint texture;
+		GLuint frameBuffer;
+
+		int width;
+		int height;
+		// Sized internal format of the texture
+		GLenum format;
+
+		bool isInUse;
+		// Frame the target was last acquired in
+		int lastUsed;
+	};
+
+	// Render targets shared by the passes of a frame. A released target is handed to the next request with the
+	// same size and format, so passes whose targets are not needed at the same time share textures
+	class RenderTargetPool {
+
+	public:
+		RenderTargetPool();
+		~RenderTargetPool();
+
+		// A free target of the size and format, created if there is none
+		RenderTarget* Acquire(int width, int height, GLenum format);
+		// Give a target back, its contents may be overwritten by the next pass acquiring it
+		void Release(RenderTarget* target);
+
+		// Delete the targets not used for RENDER_TARGET_RETENTION_FRAMES, call once per frame
+		void EndFrame();
+		// Delete every target
+		void Clear();
+
+		// Targets allocated, in use or not
+		int GetTargetCount() const;
+
+	private:
+		std::vector<RenderTarget*> targets;
+
+		int frame = 0;
+
+		void DeleteTarget(RenderTarget* target);
+	};
+}
+
+#endif
@@ -0,0 +1,251 @@
+#include <iostream>
+#include <iomanip>
+#include "render_thread.h"
+
+namespace Game {
+	RenderThread::RenderThread() {
+		for (int i = 0; i < FRAME_PACKETS; i++) {
+			freePackets.push_back(&packets[i]);
+		}
+	}
+
+	RenderThread::~RenderThread() {
+		Stop();
+	}
+
+	void RenderThread::Start(GLFWwindow* window, SceneGraph* scene, ResourceManager* resourceManager) {
+		Stop();
+
+		RenderThread::window = window;
+		RenderThread::scene = scene;
+		RenderThread::resourceManager = resourceManager;
+
+		error.clear();
+		running = true;
+
+		// A context can only be current on one thread
+		glfwMakeContextCurrent(NULL);
+
+		thread = std::thread(&RenderThread::Run, this);
+	}
+
+	void RenderThread::Stop() {
+		if (!thread.joinable()) {
+			return;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+
+			running = false;
+		}
+
+		condition.notify_all();
+
+		thread.join();
+
+		glfwMakeContextCurrent(window);
+	}
+
+	FramePacket* RenderThread::BeginFrame() {
+		std::unique_lock<std::mutex> lock(mutex);
+
+		condition.wait(lock, [this]() {
+			return !freePackets.empty() || !error.empty();
+		});
+
+		if (!error.empty()) {
+			throw(error);
+		}
+
+		FramePacket* packet = freePackets.front();
+		freePackets.pop_front();
+
+		return packet;
+	}
+
+	void RenderThread::SubmitFrame(FramePacket* packet) {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+
+			readyPackets.push_back(packet);
+		}
+
+		condition.notify_all();
+	}
+
+	void RenderThread::Run() {
+		glfwMakeContextCurrent(window);
+
+		glGenQueries(FRAME_TIMER_QUERIES, timerQueries);
+
+		for (int i = 0; i < FRAME_TIMER_QUERIES; i++) {
+			timerQueryIssued[i] = false;
+		}
+
+		try {
+			while (true) {
+				FramePacket* packet;
+
+				{
+					std::unique_lock<std::mutex> lock(mutex);
+
+					condition.wait(lock, [this]() {
+						return !running || !readyPackets.empty();
+					});
+
+					// Stopped, and everything submitted was drawn
+					if (readyPackets.empty()) {
+						break;
+					}
+
+					packet = readyPackets.front();
+					readyPackets.pop_front();
+				}
+
+				DrawFrame(*packet);
+
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+
+					freePackets.push_back(packet);
+				}
+
+				condition.notify_all();
+			}
+		} catch (std::string exception) {
+			// Handed to the game thread by the next BeginFrame
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+
+				error = exception;
+			}
+
+			condition.notify_all();
+		}
+
+		glDeleteQueries(FRAME_TIMER_QUERIES, timerQueries);
+
+		glfwMakeContextCurrent(NULL);
+	}
+
+	void RenderThread::ReadFrameTimes() {
+		for (int i = 0; i < FRAME_TIMER_QUERIES; i++) {
+			if (!timerQueryIssued[i]) {
+				continue;
+			}
+
+			GLint available = 0;
+			glGetQueryObjectiv(timerQueries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+
+			if (!available) {
+				continue;
+			}
+
+			GLuint64 nanoseconds = 0;
+			glGetQueryObjectui64v(timerQueries[i], GL_QUERY_RESULT, &nanoseconds);
+
+			resolution.AddFrameTime(nanoseconds / 1e6f);
+
+			timerQueryIssued[i] = false;
+		}
+	}
+
+	void RenderThread::UpdateRenderSize(const FramePacket& packet) {
+		float scale = packet.renderScale;
+
+		if (packet.targetFrameTime > 0.0f) {
+			resolution.SetTarget(packet.targetFrameTime);
+			resolution.SetScaleRange(packet.minRenderScale, packet.renderScale);
+
+			scale = resolution.GetScale();
+		}
+
+		scene->SetRenderSize((int)(packet.width * scale + 0.5f), (int)(packet.height * scale + 0.5f));
+	}
+
+	void RenderThread::ReportGpuTimes(const FramePacket& packet) {
+		std::vector<PostTiming> timings;
+		scene->GetPostTimings(timings);
+
+		std::cout << "GPU frame " << std::fixed << std::setprecision(2) << resolution.GetAverageFrameTime() << " ms at " << scene->GetRenderWidth() << "x" << scene->GetRenderHeight() << std::endl;
+		std::cout << std::setw(24) << "pass" << std::setw(10) << "ms" << std::setw(10) << "budget" << std::endl;
+
+		std::cout << std::setprecision(3);
+
+		for (int i = 0; i < timings.size(); i++) {
+			const PostTiming& timing = timings[i];
+
+			std::cout << std::setw(24) << timing.name << std::setw(10) << timing.milliseconds;
+
+			if (timing.budget > 0.0f) {
+				std::cout << std::setw(10) << timing.budget << (timing.milliseconds > timing.budget ? "  OVER" : "");
+			}
+
+			std::cout << std::endl;
+		}
+
+		// Triangles of the frame at the picked levels of detail, against every mesh and chunk at full detail
+		long long drawn = 0, full = 0;
+
+		for (int i = 0; i < packet.items.size() + packet.shadowItems.size(); i++) {
+			const DrawItem& item = i < packet.items.size() ? packet.items[i] : packet.shadowItems[i - packet.items.size()];
+
+			if (item.mode == GL_TRIANGLES) {
+				drawn += item.size / 3;
+				full += item.fullSize / 3;
+			}
+		}
+
+		std::cout << "Triangles " << drawn << " drawn of " << full << " at full detail, shadows included" << std::endl;
+
+		std::cout << std::endl;
+	}
+
+	void RenderThread::DrawFrame(const FramePacket& packet) {
+		// Recompile changed shaders, finished programs are swapped in before anything is drawn
+		if (packet.changedShaders.size() > 0) {
+			resourceManager->ReloadMaterials(packet.changedShaders);
+		}
+
+		resourceManager->UpdateReloadedMaterials();
+
+		// Advance the particle systems before anything draws them
+		for (int i = 0; i < packet.particleSteps.size(); i++) {
+			const ParticleStep& step = packet.particleSteps[i];
+
+			step.particles->Simulate(step.material->GetResource(), step.emitter, step.forces, packet.deltaTime, packet.time, step.heightMap, step.heightMapSize);
+		}
+
+		// Follow the window size, the scene is drawn at the render scale and scaled up when displayed
+		ReadFrameTimes();
+		UpdateRenderSize(packet);
+
+		glViewport(0, 0, packet.width, packet.height);
+
+		// Render scene, timed unless the query of this slot is still waiting for its result
+		int query = frame % FRAME_TIMER_QUERIES;
+		bool timed = !timerQueryIssued[query];
+
+		if (timed) {
+			glBeginQuery(GL_TIME_ELAPSED, timerQueries[query]);
+		}
+
+		scene->DrawToTexture(packet);
+		scene->DisplayTexture(packet.effect->GetResource(), packet.effectParameter, packet.overlay, packet.blurLevels);
+
+		if (timed) {
+			glEndQuery(GL_TIME_ELAPSED);
+			timerQueryIssued[query] = true;
+		}
+
+		frame++;
+
+		if (packet.reportGpuTimes && frame % GPU_TIME_REPORT_FRAMES == 0) {
+			ReportGpuTimes(packet);
+		}
+
+		// Push buffer drawn in the background onto the display
+		glfwSwapBuffers(window);
+	}
+}
@@ -0,0 +1,86 @@
+#ifndef RENDER_THREAD_H_
+#define RENDER_THREAD_H_
+
+#define GLEW_STATIC
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include "frame_packet.h"
+#include "scene_graph.h"
+#include "resource_manager.h"
+#include "dynamic_resolution.h"
+
+// Frame packets in flight: one being drawn and one being filled. 3 lets the game run a further frame ahead
+#define FRAME_PACKETS 2
+
+// GPU timer queries in flight, results are read a few frames late so reading them never waits
+#define FRAME_TIMER_QUERIES 4
+
+// Frames between GPU time reports
+#define GPU_TIME_REPORT_FRAMES 300
+
+namespace Game {
+	// Owns the GL context while running, draws the frame packets submitted by the game thread and swaps buffers.
+	// The game thread simulates the next frame while the previous one is drawn
+	class RenderThread {
+
+	public:
+		RenderThread();
+		~RenderThread();
+
+		// Take over the GL context of the window, the calling thread must not use GL until Stop
+		void Start(GLFWwindow* window, SceneGraph* scene, ResourceManager* resourceManager);
+		// Draw the queued packets, then give the GL context back to the calling thread
+		void Stop();
+
+		// Packet to fill for the next frame, waits while every packet is queued or being drawn.
+		// Throws the error that stopped the render thread, if any
+		FramePacket* BeginFrame();
+		// Queue a filled packet for drawing
+		void SubmitFrame(FramePacket* packet);
+
+	private:
+		GLFWwindow* window = NULL;
+		SceneGraph* scene = NULL;
+		ResourceManager* resourceManager = NULL;
+
+		FramePacket packets[FRAME_PACKETS];
+
+		std::thread thread;
+		std::mutex mutex;
+		std::condition_variable condition;
+
+		// Packets the game thread can fill, and packets waiting to be drawn in order
+		std::deque<FramePacket*> freePackets;
+		std::deque<FramePacket*> readyPackets;
+		bool running = false;
+
+		// Set if drawing threw
+		std::string error;
+
+		// Time taken by the GPU to draw each frame, picks the render scale
+		DynamicResolution resolution;
+		GLuint timerQueries[FRAME_TIMER_QUERIES];
+		bool timerQueryIssued[FRAME_TIMER_QUERIES];
+		int frame = 0;
+
+		// Size of the scene for a packet, from the window size and the render scale
+		void UpdateRenderSize(const FramePacket& packet);
+		// Read the finished timer queries into the dynamic resolution
+		void ReadFrameTimes();
+		// Print the frame time and the time of every screen pass against its budget, then the triangles of the
+		// frame with and without the levels of detail
+		void ReportGpuTimes(const FramePacket& packet);
+
+		void Run();
+		void DrawFrame(const FramePacket& packet);
+	};
+}
+
+#endif
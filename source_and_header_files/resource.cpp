@@ -7,14 +7,20 @@ namespace Game {
 		Resource::name = name;
 		Resource::resource = resource;
 		Resource::size = size;
+
+		hasBounds = false;
 	}
 
-	Resource::Resource(ResourceType type, std::string name, GLuint arrayBuffer, GLuint elementArrayBuffer, GLsizei size) {
+	Resource::Resource(ResourceType type, std::string name, GLuint arrayBuffer, GLuint elementArrayBuffer, GLsizei size, const VertexLayout* layout) {
 		Resource::type = type;
 		Resource::name = name;
 		Resource::arrayBuffer = arrayBuffer;
 		Resource::elementArrayBuffer = elementArrayBuffer;
 		Resource::size = size;
+		// Floats laid out like the generated geometry unless told otherwise
+		Resource::layout = layout ? *layout : *VertexLayout::GetFloats(11);
+
+		hasBounds = false;
 	}
 
 	Resource::~Resource() {}
@@ -42,4 +48,33 @@ namespace Game {
 	GLsizei Resource::GetSize() const {
 		return size;
 	}
+
+	const VertexLayout* Resource::GetLayout() const {
+		return &layout;
+	}
+
+	const std::vector<MeshLod>& Resource::GetLods() const {
+		return lods;
+	}
+
+	void Resource::SetLods(const std::vector<MeshLod>& lods) {
+		Resource::lods = lods;
+	}
+
+	bool Resource::GetBounds(glm::vec3& min, glm::vec3& max) const {
+		min = boundsMin;
+		max = boundsMax;
+
+		return hasBounds;
+	}
+
+	void Resource::SetBounds(glm::vec3 min, glm::vec3 max) {
+		boundsMin = min;
+		boundsMax = max;
+		hasBounds = true;
+	}
+
+	void Resource::SetResource(GLuint resource) {
+		Resource::resource = resource;
+	}
 }
\ No newline at end of file
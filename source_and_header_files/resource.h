@@ -4,8 +4,12 @@
 #define GLEW_STATIC
 
 #include <string>
+#include <vector>
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+#include "vertex_layout.h"
+#include "mesh_cooker.h"
 
 namespace Game {
 	typedef enum class ResourceType { Material, PointSet, Mesh, Texture };
@@ -14,7 +18,7 @@ namespace Game {
 
 	public:
 		Resource(ResourceType type, std::string name, GLuint resource, GLsizei size);
-		Resource(ResourceType type, std::string name, GLuint arrayBuffer, GLuint elementArrayBuffer, GLsizei size);
+		Resource(ResourceType type, std::string name, GLuint arrayBuffer, GLuint elementArrayBuffer, GLsizei size, const VertexLayout* layout = NULL);
 		~Resource();
 
 		ResourceType GetType() const;
@@ -23,6 +27,20 @@ namespace Game {
 		GLuint GetArrayBuffer() const;
 		GLuint GetElementArrayBuffer() const;
 		GLsizei GetSize() const;
+		// Vertex attributes of geometry
+		const VertexLayout* GetLayout() const;
+
+		// Levels of detail of a mesh, from the full one on, as ranges of its index buffer. None for geometry
+		// drawn from the start of the buffer
+		const std::vector<MeshLod>& GetLods() const;
+		void SetLods(const std::vector<MeshLod>& lods);
+
+		// Box around the positions of the geometry in model space, false when it is not known
+		bool GetBounds(glm::vec3& min, glm::vec3& max) const;
+		void SetBounds(glm::vec3 min, glm::vec3 max);
+
+		// Replace the OpenGL handle, used when a material is reloaded
+		void SetResource(GLuint resource);
 
 	private:
 		ResourceType type;
@@ -40,6 +58,12 @@ namespace Game {
 		};
 
 		GLsizei size;
+		VertexLayout layout;
+		std::vector<MeshLod> lods;
+
+		bool hasBounds;
+		glm::vec3 boundsMin;
+		glm::vec3 boundsMax;
 	};
 }
 
@@ -6,8 +6,10 @@
 #include <iostream>
 #include <SOIL/SOIL.h>
 #include <stack>
+#include <algorithm>
 #include "resource_manager.h"
 #include "model_loader.h"
+#include "mesh_cooker.h"
 
 namespace Game {
 	ResourceManager::ResourceManager() {}
@@ -22,14 +24,18 @@ namespace Game {
 		resources.push_back(res);
 	}
 
-	void ResourceManager::AddResource(ResourceType type, const std::string name, GLuint arrayBuffer, GLuint elementArrayBuffer, GLsizei size) {
+	void ResourceManager::AddResource(ResourceType type, const std::string name, GLuint arrayBuffer, GLuint elementArrayBuffer, GLsizei size, const VertexLayout* layout) {
 		Resource* res;
 
-		res = new Resource(type, name, arrayBuffer, elementArrayBuffer, size);
+		res = new Resource(type, name, arrayBuffer, elementArrayBuffer, size, layout);
 
 		resources.push_back(res);
 	}
 
+	void ResourceManager::SetMeshLayout(const VertexLayout& layout) {
+		meshLayout = layout;
+	}
+
 	void ResourceManager::LoadResource(ResourceType type, const std::string name, const char* filename) {
 		// Call appropriate method depending on type of resource
 		if (type == ResourceType::Material) {
@@ -55,7 +61,7 @@ namespace Game {
 		AddResource(ResourceType::Texture, name, texture, 0);
 	}
 
-	Resource* ResourceManager::GetResource(const std::string name) const {
+	Resource* ResourceManager::GetResource(const std::string name) {
 		// Find resource with the specified name
 		for (int i = 0; i < resources.size(); i++) {
 			if (resources[i]->GetName() == name) {
@@ -66,117 +72,371 @@ namespace Game {
 		return NULL;
 	}
 
+	void ResourceManager::CollectReadyMaterials() {
+		for (int i = 0; i < pendingMaterials.size(); ) {
+			// Leave programs that are still compiling for a later call
+			if (!IsProgramReady(pendingMaterials[i].program)) {
+				i++;
+				continue;
+			}
+
+			CollectMaterial(i);
+		}
+	}
+
+	void ResourceManager::CollectMaterials() {
+		while (pendingMaterials.size() > 0) {
+			CollectMaterial(0);
+		}
+	}
+
+	void ResourceManager::InitializeShaderCompiler() {
+		shaderCompilerInitialized = true;
+
+		// Let the driver pick the number of compiler threads
+		if (GLEW_KHR_parallel_shader_compile) {
+			glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+			parallelShaderCompile = true;
+		} else if (GLEW_ARB_parallel_shader_compile) {
+			glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+			parallelShaderCompile = true;
+		}
+	}
+
 	void ResourceManager::LoadMaterial(const std::string name, const char* prefix) {
-		// Load vertex program source code
+		LoadMaterial(name, prefix, "");
+	}
 
-		std::string filename = std::string(prefix) + std::string(VERTEX_PROGRAM_EXTENSION);
-		std::string vp = LoadTextFile(filename.c_str());
+	void ResourceManager::LoadMaterial(const std::string name, const std::string prefix, const std::string defines) {
+		MaterialSource source;
 
-		// Load fragment program source code
+		source.prefix = prefix;
+		source.defines = defines;
 
-		filename = std::string(prefix) + std::string(FRAGMENT_PROGRAM_EXTENSION);
-		std::string fp = LoadTextFile(filename.c_str());
+		PendingMaterial pending = SubmitMaterial(prefix, defines, source.files);
 
-		// Create a shader from the vertex program source code
+		// Add a resource for the shader program, usable as a handle now and checked once collected
+		AddResource(ResourceType::Material, name, pending.program, 0);
 
-		GLuint vs = glCreateShader(GL_VERTEX_SHADER);
-		const char* source_vp = vp.c_str();
-		glShaderSource(vs, 1, &source_vp, NULL);
-		glCompileShader(vs);
+		pending.resource = resources.back();
+		pendingMaterials.push_back(pending);
 
-		// Check if shader compiled successfully
+		// Remember where the sources came from so the material can be reloaded
+		source.resource = pending.resource;
+		materialSources.push_back(source);
+	}
 
-		GLint status;
-		glGetShaderiv(vs, GL_COMPILE_STATUS, &status);
+	Resource* ResourceManager::GetMaterialVariant(const std::string name, const std::string defines) {
+		// Sort the defines so that "A+B" and "B+A" are the same permutation
 
-		if (status != GL_TRUE) {
-			char buffer[512];
-			glGetShaderInfoLog(vs, 512, NULL, buffer);
-			throw(std::ios_base::failure(std::string("Error compiling vertex shader: ") + std::string(buffer)));
+		std::vector<std::string> define = string_split(defines, "+");
+		std::sort(define.begin(), define.end());
+
+		std::string key = "";
+
+		for (int i = 0; i < define.size(); i++) {
+			if (define[i] != "" && (i == 0 || define[i] != define[i - 1])) {
+				key += (key == "" ? "" : "+") + define[i];
+			}
 		}
 
-		// Create a shader from the fragment program source code
+		// Find the shader prefix of the base material
 
-		GLuint fs = glCreateShader(GL_FRAGMENT_SHADER);
-		const char* source_fp = fp.c_str();
-		glShaderSource(fs, 1, &source_fp, NULL);
-		glCompileShader(fs);
+		std::string prefix = "";
 
-		// Check if shader compiled successfully
+		for (int i = 0; i < materialSources.size(); i++) {
+			if (materialSources[i].resource->GetName() == name && materialSources[i].defines == "") {
+				prefix = materialSources[i].prefix;
+			}
+		}
 
-		glGetShaderiv(fs, GL_COMPILE_STATUS, &status);
+		if (prefix == "") {
+			throw(std::string("Could not find material \"") + name + std::string("\""));
+		}
 
-		if (status != GL_TRUE) {
-			char buffer[512];
-			glGetShaderInfoLog(fs, 512, NULL, buffer);
-			throw(std::string("Error compiling fragment shader: ") + std::string(buffer));
+		// Permutations are cached by shader prefix and define set
+		for (int i = 0; i < materialSources.size(); i++) {
+			if (materialSources[i].prefix == prefix && materialSources[i].defines == key) {
+				return GetResource(materialSources[i].resource->GetName());
+			}
+		}
+
+		LoadMaterial(key == "" ? name : name + "+" + key, prefix, key);
+
+		return GetResource(resources.back()->GetName());
+	}
+
+	ResourceManager::PendingMaterial ResourceManager::SubmitMaterial(const std::string prefix, const std::string defines, std::vector<std::string>& files) {
+		if (!shaderCompilerInitialized) {
+			InitializeShaderCompiler();
+		}
+
+		files.clear();
+
+		// Load vertex program source code
+
+		std::string filename = prefix + std::string(VERTEX_PROGRAM_EXTENSION);
+		std::string vp = LoadShaderSource(filename, defines, files);
+
+		// Outputs captured with transform feedback, declared as "#pragma feedback name name ..."
+
+		std::vector<std::string> varyings;
+		std::istringstream lines(vp);
+		std::string line;
+
+		while (std::getline(lines, line)) {
+			if (line.compare(0, 16, "#pragma feedback") == 0) {
+				std::istringstream names(line.substr(16));
+				std::string name;
+
+				while (names >> name) {
+					varyings.push_back(name);
+				}
+			}
+		}
+
+		// Load fragment program source code, optional for transform feedback programs since nothing is rasterized
+
+		filename = prefix + std::string(FRAGMENT_PROGRAM_EXTENSION);
+		bool fragment_program = false;
+		std::string fp = "";
+
+		try {
+			fp = LoadShaderSource(filename, defines, files);
+			fragment_program = true;
+		} catch (std::string exception) {
+			if (varyings.empty()) {
+				throw(exception);
+			}
 		}
 
 		// Try to also load a geometry shader
 
-		filename = std::string(prefix) + std::string(GEOMETRY_PROGRAM_EXTENSION);
+		filename = prefix + std::string(GEOMETRY_PROGRAM_EXTENSION);
 		bool geometry_program = false;
 		std::string gp = "";
-		GLuint gs;
 
 		try {
-			gp = LoadTextFile(filename.c_str());
+			gp = LoadShaderSource(filename, defines, files);
 			geometry_program = true;
 		} catch (std::string exception) {}
 
-		if (geometry_program) {
-			// Create a shader from the geometry program source code
+		// Submit the shaders for compilation. The status is not queried here so the
+		// driver can keep compiling while other resources are loaded
+
+		PendingMaterial pending;
 
-			gs = glCreateShader(GL_GEOMETRY_SHADER);
+		pending.resource = NULL;
+
+		pending.vs = glCreateShader(GL_VERTEX_SHADER);
+		const char* source_vp = vp.c_str();
+		glShaderSource(pending.vs, 1, &source_vp, NULL);
+		glCompileShader(pending.vs);
+
+		pending.fs = 0;
+
+		if (fragment_program) {
+			pending.fs = glCreateShader(GL_FRAGMENT_SHADER);
+			const char* source_fp = fp.c_str();
+			glShaderSource(pending.fs, 1, &source_fp, NULL);
+			glCompileShader(pending.fs);
+		}
+
+		pending.gs = 0;
+
+		if (geometry_program) {
+			pending.gs = glCreateShader(GL_GEOMETRY_SHADER);
 			const char* source_gp = gp.c_str();
-			glShaderSource(gs, 1, &source_gp, NULL);
-			glCompileShader(gs);
+			glShaderSource(pending.gs, 1, &source_gp, NULL);
+			glCompileShader(pending.gs);
+		}
 
-			// Check if shader compiled successfully
+		// Create a shader program linking all shaders together
 
-			GLint status;
-			glGetShaderiv(gs, GL_COMPILE_STATUS, &status);
+		pending.program = glCreateProgram();
+		glAttachShader(pending.program, pending.vs);
 
-			if (status != GL_TRUE) {
-				char buffer[512];
-				glGetShaderInfoLog(gs, 512, NULL, buffer);
-				throw(std::string("Error compiling geometry shader: ") + std::string(buffer));
+		if (fragment_program) {
+			glAttachShader(pending.program, pending.fs);
+		}
+
+		if (geometry_program) {
+			glAttachShader(pending.program, pending.gs);
+		}
+
+		// Captured outputs have to be set before linking, interleaved in one buffer
+		if (!varyings.empty()) {
+			std::vector<const char*> names;
+
+			for (int i = 0; i < varyings.size(); i++) {
+				names.push_back(varyings[i].c_str());
 			}
+
+			glTransformFeedbackVaryings(pending.program, (GLsizei)names.size(), names.data(), GL_INTERLEAVED_ATTRIBS);
 		}
 
-		// Create a shader program linking both vertex and fragment shaders together
+		glLinkProgram(pending.program);
 
-		GLuint sp = glCreateProgram();
-		glAttachShader(sp, vs);
-		glAttachShader(sp, fs);
+		return pending;
+	}
 
-		if (geometry_program) {
-			glAttachShader(sp, gs);
+	bool ResourceManager::IsProgramReady(GLuint program) const {
+		// Without the extension the status cannot be queried without blocking,
+		// so collection will simply wait for the driver
+		if (!parallelShaderCompile) {
+			return true;
 		}
 
-		glLinkProgram(sp);
+		GLint status;
+		glGetProgramiv(program, GL_COMPLETION_STATUS_KHR, &status);
+
+		return status == GL_TRUE;
+	}
+
+	std::string ResourceManager::FinishMaterial(const PendingMaterial& pending) {
+		std::string error = "";
 
-		// Check if shaders were linked successfully
+		// Check if shaders were linked successfully (blocks until the driver is done)
 
-		glGetProgramiv(sp, GL_LINK_STATUS, &status);
+		GLint status;
+		glGetProgramiv(pending.program, GL_LINK_STATUS, &status);
 
 		if (status != GL_TRUE) {
-			char buffer[512];
-			glGetShaderInfoLog(sp, 512, NULL, buffer);
-			throw(std::string("Error linking shaders: ") + std::string(buffer));
+			// Report the stage that failed to compile if there is one
+
+			GLuint shaders[3] = { pending.vs, pending.fs, pending.gs };
+			const char* stages[3] = { "vertex", "fragment", "geometry" };
+
+			for (int i = 0; i < 3 && error == ""; i++) {
+				if (!shaders[i]) {
+					continue;
+				}
+
+				glGetShaderiv(shaders[i], GL_COMPILE_STATUS, &status);
+
+				if (status != GL_TRUE) {
+					char buffer[512];
+					glGetShaderInfoLog(shaders[i], 512, NULL, buffer);
+					error = std::string("Error compiling ") + std::string(stages[i]) + std::string(" shader: ") + std::string(buffer);
+				}
+			}
+
+			if (error == "") {
+				char buffer[512];
+				glGetProgramInfoLog(pending.program, 512, NULL, buffer);
+				error = std::string("Error linking shaders: ") + std::string(buffer);
+			}
 		}
 
 		// Delete memory used by shaders, since they were already compiled and linked
 
-		glDeleteShader(vs);
-		glDeleteShader(fs);
+		glDeleteShader(pending.vs);
 
-		if (geometry_program) {
-			glDeleteShader(gs);
+		if (pending.fs) {
+			glDeleteShader(pending.fs);
+		}
+
+		if (pending.gs) {
+			glDeleteShader(pending.gs);
+		}
+
+		return error;
+	}
+
+	void ResourceManager::CollectMaterial(int index) {
+		PendingMaterial pending = pendingMaterials[index];
+		pendingMaterials.erase(pendingMaterials.begin() + index);
+
+		std::string error = FinishMaterial(pending);
+
+		if (error != "") {
+			throw(pending.resource->GetName() + std::string(": ") + error);
+		}
+	}
+
+	void ResourceManager::ReloadMaterials(const std::vector<std::string>& files) {
+		for (int i = 0; i < files.size(); i++) {
+			for (int j = 0; j < materialSources.size(); j++) {
+				// Check if the material was built from the file, including through #include
+				bool uses = false;
+
+				for (int k = 0; k < materialSources[j].files.size(); k++) {
+					std::string source = materialSources[j].files[k];
+					std::string name = source.substr(source.find_last_of("/\\") + 1);
+
+					if (name == files[i]) {
+						uses = true;
+					}
+				}
+
+				if (!uses) {
+					continue;
+				}
+
+				// Replace a reload of the same material that has not finished yet
+				for (int k = 0; k < reloadingMaterials.size(); k++) {
+					if (reloadingMaterials[k].resource == materialSources[j].resource) {
+						// Dropped without waiting for its link status
+						glDeleteShader(reloadingMaterials[k].vs);
+
+						if (reloadingMaterials[k].fs) {
+							glDeleteShader(reloadingMaterials[k].fs);
+						}
+
+						if (reloadingMaterials[k].gs) {
+							glDeleteShader(reloadingMaterials[k].gs);
+						}
+
+						glDeleteProgram(reloadingMaterials[k].program);
+
+						reloadingMaterials.erase(reloadingMaterials.begin() + k);
+						break;
+					}
+				}
+
+				PendingMaterial pending;
+
+				try {
+					pending = SubmitMaterial(materialSources[j].prefix, materialSources[j].defines, materialSources[j].files);
+				} catch (std::string exception) {
+					std::cerr << "Could not reload " << materialSources[j].resource->GetName() << ": " << exception << std::endl;
+					continue;
+				}
+
+				pending.resource = materialSources[j].resource;
+				reloadingMaterials.push_back(pending);
+			}
 		}
+	}
+
+	void ResourceManager::UpdateReloadedMaterials() {
+		for (int i = 0; i < reloadingMaterials.size(); ) {
+			PendingMaterial pending = reloadingMaterials[i];
+
+			// Leave programs that are still compiling for a later frame
+			if (!IsProgramReady(pending.program)) {
+				i++;
+				continue;
+			}
+
+			reloadingMaterials.erase(reloadingMaterials.begin() + i);
+
+			std::string error = FinishMaterial(pending);
+
+			// Keep the old program if the new one is broken
+			if (error != "") {
+				std::cerr << "Could not reload " << pending.resource->GetName() << ": " << error << std::endl;
+				glDeleteProgram(pending.program);
 
-		// Add a resource for the shader program
-		AddResource(ResourceType::Material, name, sp, 0);
+				continue;
+			}
+
+			// Swap the program, every node draws with the resource's current handle
+			glDeleteProgram(pending.resource->GetResource());
+			pending.resource->SetResource(pending.program);
+
+			std::cout << "Reloaded " << pending.resource->GetName() << std::endl;
+		}
 	}
 
 	std::string ResourceManager::LoadTextFile(const char* filename) {
@@ -204,6 +464,93 @@ namespace Game {
 		return content;
 	}
 
+	std::string ResourceManager::LoadShaderSource(const std::string filename, const std::string defines, std::vector<std::string>& files) {
+		std::string version = "";
+
+		// Snippets included by another stage are included again in this one
+		std::vector<std::string> included;
+		std::string body = PreprocessShader(filename, files, included, version);
+
+		// Compile time permutation, e.g. "INSTANCED+NO_FOG" or "CASCADES=4"
+
+		std::string header = "";
+		std::vector<std::string> define = string_split(defines, "+");
+
+		for (int i = 0; i < define.size(); i++) {
+			if (define[i] == "") {
+				continue;
+			}
+
+			size_t value = define[i].find("=");
+
+			if (value == std::string::npos) {
+				header += "#define " + define[i] + "\n";
+			} else {
+				header += "#define " + define[i].substr(0, value) + " " + define[i].substr(value + 1) + "\n";
+			}
+		}
+
+		// The version has to come first, and the defines have to precede the code that tests them
+		return (version == "" ? "" : version + "\n") + header + body;
+	}
+
+	std::string ResourceManager::PreprocessShader(const std::string filename, std::vector<std::string>& files, std::vector<std::string>& included, std::string& version) {
+		// Each file is only included once per stage, so snippets can include the snippets they depend on
+		if (std::find(included.begin(), included.end(), filename) != included.end()) {
+			return "";
+		}
+
+		included.push_back(filename);
+
+		// Files shared by the stages keep the index of their first use
+		int file_index = (int)(std::find(files.begin(), files.end(), filename) - files.begin());
+
+		if (file_index == files.size()) {
+			files.push_back(filename);
+		}
+
+		std::string content = LoadTextFile(filename.c_str());
+
+		// Includes are relative to the including file
+		std::string directory = filename.substr(0, filename.find_last_of("/\\") + 1);
+
+		// Number the lines by file, so compile errors can be traced back to the files list
+		std::string output = "#line 1 " + num_to_str<int>(file_index) + "\n";
+
+		std::istringstream stream(content);
+		std::string line;
+		int line_number = 0;
+
+		while (std::getline(stream, line)) {
+			line_number++;
+
+			size_t start = line.find_first_not_of(" \t");
+
+			if (start != std::string::npos && line.compare(start, 8, "#version") == 0) {
+				// Only the first version directive is kept, it is moved to the top of the source
+				if (version == "") {
+					version = line;
+				}
+
+				output += "\n";
+			} else if (start != std::string::npos && line.compare(start, 8, "#include") == 0) {
+				size_t open = line.find('"', start);
+				size_t close = (open == std::string::npos) ? std::string::npos : line.find('"', open + 1);
+
+				if (close == std::string::npos) {
+					throw(std::string("Error: invalid #include in ") + filename + std::string(": ") + line);
+				}
+
+				output += PreprocessShader(directory + line.substr(open + 1, close - open - 1), files, included, version);
+				output += "#line " + num_to_str<int>(line_number + 1) + " " + num_to_str<int>(file_index) + "\n";
+			} else {
+				output += line + "\n";
+			}
+		}
+
+		return output;
+	}
+
 	void ResourceManager::LoadTexture(const std::string name, const char* filename) {
 		// Load texture from file
 
@@ -217,11 +564,119 @@ namespace Game {
 		AddResource(ResourceType::Texture, name, texture, 0);
 	}
 
+	void ResourceManager::CreateNormalMap(std::string name, const char* heightFilename, float strength) {
+		int width, height, channels;
+
+		unsigned char* image = SOIL_load_image(heightFilename, &width, &height, &channels, SOIL_LOAD_L);
+
+		if (!image) {
+			throw(std::string("Error loading height map ") + std::string(heightFilename) + std::string(": ") + std::string(SOIL_last_result()));
+		}
+
+		// Slopes from central differences, wrapping around since the textures repeat
+
+		std::vector<GLubyte> normals(width * height * 3);
+
+		for (int y = 0; y < height; y++) {
+			for (int x = 0; x < width; x++) {
+				float left = image[y * width + (x + width - 1) % width] / 255.0f;
+				float right = image[y * width + (x + 1) % width] / 255.0f;
+				float down = image[((y + height - 1) % height) * width + x] / 255.0f;
+				float up = image[((y + 1) % height) * width + x] / 255.0f;
+
+				glm::vec3 normal = glm::normalize(glm::vec3((left - right) * strength, (down - up) * strength, 1.0f));
+
+				for (int i = 0; i < 3; i++) {
+					normals[(y * width + x) * 3 + i] = (GLubyte)glm::round((normal[i] * 0.5f + 0.5f) * 255.0f);
+				}
+			}
+		}
+
+		SOIL_free_image_data(image);
+
+		GLuint texture;
+
+		glGenTextures(1, &texture);
+		glBindTexture(GL_TEXTURE_2D, texture);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, normals.data());
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		glGenerateMipmap(GL_TEXTURE_2D);
+
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+		glBindTexture(GL_TEXTURE_2D, 0);
+
+		AddResource(ResourceType::Texture, name, texture, 0);
+	}
+
 	void ResourceManager::LoadMesh(const std::string name, const char* filename) {
+		// A cooked copy newer than the file skips the parsing and cooking
+
+		std::string cookedFilename = std::string(filename) + MESH_COOKED_EXTENSION;
+		CookedMesh cooked;
+
+		if (LoadCookedMesh(cookedFilename, filename, cooked)) {
+			AddMesh(name, cooked);
+			return;
+		}
+
 		// First load model into memory. If that goes well, we transfer the mesh to an OpenGL buffer
 
 		TriMesh mesh;
+		bool added_normal;
+
+		load_obj(filename, mesh, added_normal);
+
+		// Weld the faces into indexed vertices with tangent frames, simplify them into the levels of detail,
+		// and keep the result for the next launch
+		CookMesh(mesh, added_normal, cooked);
+		AddMeshLods(cooked);
+
+		SaveCookedMesh(cookedFilename, filename, cooked);
+
+		AddMesh(name, cooked);
+	}
+
+	void ResourceManager::AddMesh(const std::string name, const CookedMesh& mesh) {
+		// Each mesh quantizes its positions to its own bounds
+		VertexLayout layout = meshLayout;
+		std::vector<unsigned char> vertices;
+
+		layout.Encode(mesh.vertices.data(), (int)(mesh.vertices.size() / MESH_VERTEX_ATTRIBUTES), MESH_VERTEX_ATTRIBUTES, vertices);
 
+		// Create OpenGL buffers and copy data
+		GLuint vbo, ebo;
+
+		glGenBuffers(1, &vbo);
+		glBindBuffer(GL_ARRAY_BUFFER, vbo);
+		glBufferData(GL_ARRAY_BUFFER, vertices.size(), vertices.data(), GL_STATIC_DRAW);
+
+		glGenBuffers(1, &ebo);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.indices.size() * sizeof(GLuint), mesh.indices.data(), GL_STATIC_DRAW);
+
+		// Create resource, drawn at full detail unless the scene picks a level
+		AddResource(ResourceType::Mesh, name, vbo, ebo, mesh.lods[0].count, &layout);
+		resources.back()->SetLods(mesh.lods);
+
+		// Bounds of the positions before they were quantized, for culling
+		glm::vec3 min(1e9f), max(-1e9f);
+
+		for (int i = 0; i < mesh.vertices.size(); i += MESH_VERTEX_ATTRIBUTES) {
+			glm::vec3 position(mesh.vertices[i], mesh.vertices[i + 1], mesh.vertices[i + 2]);
+
+			min = glm::min(min, position);
+			max = glm::max(max, position);
+		}
+
+		resources.back()->SetBounds(min, max);
+	}
+
+	void load_obj(const char* filename, TriMesh& mesh, bool& has_normals) {
 		// Parse file
 		// Open file
 
@@ -412,72 +867,7 @@ namespace Game {
 			}
 		}
 
-		// Number of attributes for vertices and faces
-
-		const int vertex_att = 11;
-		const int face_att = 3;
-
-		// Create OpenGL buffers and copy data
-		GLuint vbo, ebo;
-
-		glGenBuffers(1, &vbo);
-		glBindBuffer(GL_ARRAY_BUFFER, vbo);
-		glBufferData(GL_ARRAY_BUFFER, mesh.face.size() * 3 * vertex_att * sizeof(GLuint), 0, GL_STATIC_DRAW);
-
-		glGenBuffers(1, &ebo);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.face.size() * face_att * sizeof(GLuint), 0, GL_STATIC_DRAW);
-
-		unsigned int vertex_index = 0;
-
-		for (unsigned int i = 0; i < mesh.face.size(); i++) {
-			// Add three vertices and their attributes
-			GLfloat att[3 * vertex_att] = { 0 };
-
-			for (int j = 0; j < 3; j++) {
-				// Position
-				att[j * vertex_att + 0] = mesh.position[mesh.face[i].i[j]][0];
-				att[j * vertex_att + 1] = mesh.position[mesh.face[i].i[j]][1];
-				att[j * vertex_att + 2] = mesh.position[mesh.face[i].i[j]][2];
-
-				// Normal
-				if (!added_normal) {
-					att[j * vertex_att + 3] = mesh.normal[mesh.face[i].i[j]][0];
-					att[j * vertex_att + 4] = mesh.normal[mesh.face[i].i[j]][1];
-					att[j * vertex_att + 5] = mesh.normal[mesh.face[i].i[j]][2];
-				} else {
-					if (mesh.face[i].n[j] >= 0) {
-						att[j * vertex_att + 3] = mesh.normal[mesh.face[i].n[j]][0];
-						att[j * vertex_att + 4] = mesh.normal[mesh.face[i].n[j]][1];
-						att[j * vertex_att + 5] = mesh.normal[mesh.face[i].n[j]][2];
-					}
-				}
-
-				// No color in (6, 7, 8)
-				// Texture coordinates
-
-				if (mesh.face[i].t[j] >= 0) {
-					att[j * vertex_att + 9] = mesh.tex_coord[mesh.face[i].t[j]][0];
-					att[j * vertex_att + 10] = mesh.tex_coord[mesh.face[i].t[j]][1];
-				}
-			}
-
-			// Copy attributes to buffer
-			glBufferSubData(GL_ARRAY_BUFFER, i * 3 * vertex_att * sizeof(GLfloat), 3 * vertex_att * sizeof(GLfloat), att);
-
-			// Add triangle
-
-			GLuint findex[face_att] = { 0 };
-			findex[0] = vertex_index;
-			findex[1] = vertex_index + 1;
-			findex[2] = vertex_index + 2;
-			vertex_index += 3;
-
-			glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, i * face_att * sizeof(GLuint), face_att * sizeof(GLuint), findex);
-		}
-
-		// Create resource
-		AddResource(ResourceType::Mesh, name, vbo, ebo, mesh.face.size() * face_att);
+		has_normals = added_normal;
 	}
 
 	void string_trim(std::string str, std::string to_trim) {
@@ -601,157 +991,12 @@ namespace Game {
 		return result;
 	}
 
-	void ResourceManager::CreateTerrain() {
-		const int dimension = MAP_SIZE * 2;
-
-		const GLuint vertex_num = dimension * dimension;
-		const GLuint face_num = dimension * dimension * 2;
-
-		// Number of attributes for vertices and faces
-
-		const int vertex_att = 11;
-		const int face_att = 3;
-
-		// Data buffers
-
-		GLfloat* vertex = NULL;
-		GLuint* face = NULL;
-
-		// Allocate memory for buffers
-		try {
-			vertex = new GLfloat[vertex_num * vertex_att]; // 11 attributes per vertex: 3D position (3), 3D normal (3), RGB color (3), 2D texture coordinates (2)
-			face = new GLuint[face_num * face_att]; // 3 indices per face
-		} catch (std::exception& e) {
-			throw(std::string("Terrain error: ") + e.what());
-		}
-
-		// Basic loop to determine heightfield
-		for (int i = 0; i < dimension; i++) {
-			for (int j = 0; j < dimension; j++) {
-				float height = 0.0f;
-
-				float rand1 = ((double)rand() / (RAND_MAX));
-
-				height = 2.0f * glm::pow(glm::max(0.0f, 20.0f - (glm::distance(glm::vec2(dimension / 2.0f, dimension / 2.0f), glm::vec2(i, j)) - 1.25f * rand1)), 0.9f);
-
-				// Now place height in the 2D heightfield array
-				heights[i][j] = height / 4.0f;
-			}
-		}
-
-		for (int i = 0; i < dimension; i++) {
-			for (int j = 0; j < dimension; j++) {
-				glm::vec3 vertex_position(j, heights[i][j], i);
-				glm::vec3 vertex_color(0.0f, 1.0f, 0.0f);
-				glm::vec3 vertex_normal(0.0f, 1.0f, 0.0f);
-				glm::vec2 vertex_coords(i / 2.0f, j / 2.0f);
-
-				if (((i < dimension - 33) && (i > 32)) && ((j < dimension - 33) && (j > 32))) {
-					// Calculate normal using adjacent heighfield values to create four triangles, take the average of the normals of those four triangles
-
-					glm::vec3 curvec, secondvec, thirdvec, firstline, secondline, cross1, cross2, cross3, cross4;
-
-					// First triangle
-
-					curvec = vertex_position;
-					secondvec = glm::vec3(j + 1, heights[i][j + 1] / 4, i);
-					thirdvec = glm::vec3(j + 1, heights[i + 1][j + 1] / 4, i + 1);
-
-					firstline = secondvec - curvec;
-					secondline = thirdvec - curvec;
-
-					cross1 = glm::cross(secondline, firstline);
-
-					// Second triangle
-
-					curvec = vertex_position;
-					secondvec = glm::vec3(j, heights[i + 1][j] / 4, i + 1);
-					thirdvec = glm::vec3(j - 1, heights[i + 1][j - 1] / 4, i + 1);
-
-					firstline = secondvec - curvec;
-					secondline = thirdvec - curvec;
-
-					cross2 = glm::cross(secondline, firstline);;
-
-					// Third triangle
-
-					curvec = vertex_position;
-					secondvec = glm::vec3(j - 1, heights[i][j - 1] / 4, i);
-					thirdvec = glm::vec3(j - 1, heights[i - 1][j - 1] / 4, i - 1);
-
-					firstline = secondvec - curvec;
-					secondline = thirdvec - curvec;
-
-					cross3 = glm::cross(secondline, firstline);
-
-					// Fourth triangle
-
-					curvec = vertex_position;
-					secondvec = glm::vec3(j, heights[i - 1][j] / 4, i - 1);
-					thirdvec = glm::vec3(j + 1, heights[i + 1][j + 1] / 4, i + 1);
-
-					firstline = secondvec - curvec;
-					secondline = thirdvec - curvec;
-
-					cross4 = glm::cross(secondline, firstline);
-
-					// Take average (add them) and use that
-
-					vertex_normal = glm::normalize(cross1 + cross2 + cross3 + cross4);
-				}
-
-				for (int k = 0; k < 3; k++) {
-					vertex[(i * dimension + j) * vertex_att + k] = vertex_position[k];
-					vertex[(i * dimension + j) * vertex_att + k + 3] = vertex_normal[k];
-					vertex[(i * dimension + j) * vertex_att + k + 6] = vertex_color[k];
-				}
-
-				vertex[(i * dimension + j) * vertex_att + 9] = vertex_coords[0];
-				vertex[(i * dimension + j) * vertex_att + 10] = vertex_coords[1];
-			}
-		}
-
-		// Use global variable for heighfield for now
-
-		// Make triangles
-		for (int i = 0; i < dimension - 1; i++) {
-			for (int j = 0; j < dimension - 1; j++) {
-				// Two triangles per quad
-
-				glm::vec3 t1(((i + 1) % dimension) * dimension + j,
-					i * dimension + ((j + 1) % dimension),
-					i * dimension + j);
-
-				glm::vec3 t2(((i + 1) % dimension) * dimension + j,
-					((i + 1) % dimension) * dimension + ((j + 1) % dimension),
-					i * dimension + ((j + 1) % dimension));
-
-				// Add two triangles to the data buffer
-				for (int k = 0; k < 3; k++) {
-					face[(i * dimension + j) * face_att * 2 + k] = (GLuint)t1[k];
-					face[(i * dimension + j) * face_att * 2 + k + face_att] = (GLuint)t2[k];
-				}
-			}
-		}
-
-		// Create OpenGL buffers and copy data
-
-		GLuint vbo, ebo;
-		glGenBuffers(1, &vbo);
-		glBindBuffer(GL_ARRAY_BUFFER, vbo);
-		glBufferData(GL_ARRAY_BUFFER, vertex_num * vertex_att * sizeof(GLfloat), vertex, GL_STATIC_DRAW);
-
-		glGenBuffers(1, &ebo);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, face_num * face_att * sizeof(GLuint), face, GL_STATIC_DRAW);
-
-		// Free data buffers
-
-		delete[] vertex;
-		delete[] face;
+	void ResourceManager::CreateTerrain(int size, unsigned int seed) {
+		terrain.Create(size, seed);
+	}
 
-		// Create resource
-		AddResource(ResourceType::Mesh, "Terrain", vbo, ebo, face_num * face_att);
+	const Terrain* ResourceManager::GetTerrain() const {
+		return &terrain;
 	}
 
 	void ResourceManager::CreateMaze() {
@@ -888,8 +1133,9 @@ namespace Game {
 		// Free data buffers
 		delete[] vertices;
 
-		// Create resource
+		// Create resource, bounded by the cubes the geometry program builds one unit around each point
 		AddResource(ResourceType::PointSet, "Maze", vbo, 0, numVertices);
+		resources.back()->SetBounds(glm::vec3(-1.0f, 0.0f, -1.0f), glm::vec3((size - 1) * 2.0f + 1.0f, 2.0f, (size - 1) * 2.0f + 1.0f));
 	}
 
 	void ResourceManager::CreateSkybox() {
@@ -951,337 +1197,62 @@ namespace Game {
 	}
 
 	void ResourceManager::CreateCylinder(std::string objectName, float height, float circleRadius, int numHeightSamples, int numCircleSamples) {
-		// Create a cylinder
-
-		// Number of vertices and faces to be created
-		const GLuint vertex_num = numHeightSamples * numCircleSamples + 2; // plus two for top and bottom
-		const GLuint face_num = numHeightSamples * (numCircleSamples - 1) * 2 + 2 * numCircleSamples; // two extra rings worth for top and bottom
-
-		// Number of attributes for vertices and faces
-		const int vertex_att = 11;  // 11 attributes per vertex: 3D position (3), 3D normal (3), RGB color (3), 2D texture coordinates (2)
-		const int face_att = 3; // Vertex indices (3)
-
-		// Data buffers for the shape
-		GLfloat* vertex = NULL;
-		GLuint* face = NULL;
-
-		GLuint vbo, ebo;
-
-		// Allocate memory for buffers
-		try {
-			vertex = new GLfloat[vertex_num * vertex_att];
-			face = new GLuint[face_num * face_att];
-		} catch (std::exception& e) {
-			throw e;
-		}
-
-		// Create vertices 
-
-		float theta; // Angle for circle
-		float h; // height
-		float s, t; // parameters zero to one
-
-		glm::vec3 loop_center;
-		glm::vec3 vertex_position;
-		glm::vec3 vertex_normal;
-		glm::vec3 vertex_color;
-		glm::vec2 vertex_coord;
-
-		for (int i = 0; i < numHeightSamples; i++) { // along the side
-			s = i / (float)numHeightSamples; // parameter s (vertical)
-			h = (-0.5 + s) * height;
-
-			for (int j = 0; j < numCircleSamples; j++) { // small circle
-				t = j / (float)numCircleSamples;
-				theta = 2.0 * glm::pi<GLfloat>() * t; // circle sample (angle theta)
-
-				// Define position, normal and color of vertex
-				vertex_normal = glm::vec3(cos(theta), 0.0f, sin(theta));
-				vertex_position = glm::vec3(cos(theta) * circleRadius, h, sin(theta) * circleRadius);
-				vertex_color = glm::vec3(1.0 - s, t, s);
-				vertex_coord = glm::vec2(s, t);
-
-				// Add vectors to the data buffer
-				for (int k = 0; k < 3; k++) {
-					vertex[(i * numCircleSamples + j) * vertex_att + k] = vertex_position[k];
-					vertex[(i * numCircleSamples + j) * vertex_att + k + 3] = vertex_normal[k];
-					vertex[(i * numCircleSamples + j) * vertex_att + k + 6] = vertex_color[k];
-				}
-
-				vertex[(i * numCircleSamples + j) * vertex_att + 9] = vertex_coord[0];
-				vertex[(i * numCircleSamples + j) * vertex_att + 10] = vertex_coord[1];
-			}
-		}
-
-		int topvertex = numCircleSamples * numHeightSamples;
-		int bottomvertex = numCircleSamples * numHeightSamples + 1; // indices for top and bottom vertex
-
-		vertex_position = glm::vec3(0, height * (numHeightSamples - 1) / (float)numHeightSamples - height * 0.5, 0); // location of top middle of cylinder
-		vertex_normal = glm::vec3(0, 1, 0);
-		vertex_color = glm::vec3(1, 0.6, 0.4);
-		vertex_coord = glm::vec2(0, 0); // no good way to texture top and bottom
-
-		for (int k = 0; k < 3; k++) {
-			vertex[topvertex * vertex_att + k] = vertex_position[k];
-			vertex[topvertex * vertex_att + k + 3] = vertex_normal[k];
-			vertex[topvertex * vertex_att + k + 6] = vertex_color[k];
-		}
-
-		vertex[(topvertex)*vertex_att + 9] = vertex_coord[0];
-		vertex[(topvertex)*vertex_att + 10] = vertex_coord[1];
-
-		//================== bottom vertex
-
-		vertex_position = glm::vec3(0, -0.5 * height, 0); // location of top middle of cylinder
-		vertex_normal = glm::vec3(0, -1, 0);
-
-		// leave the color and uv alone
-
-		for (int k = 0; k < 3; k++) {
-			vertex[bottomvertex * vertex_att + k] = vertex_position[k];
-			vertex[bottomvertex * vertex_att + k + 3] = vertex_normal[k];
-			vertex[bottomvertex * vertex_att + k + 6] = vertex_color[k];
-		}
-
-		vertex[(bottomvertex)*vertex_att + 9] = vertex_coord[0];
-		vertex[(bottomvertex)*vertex_att + 10] = vertex_coord[1];
-
-		//===================== end of vertices
-
-		// Create triangles
-		for (int i = 0; i < numHeightSamples - 1; i++) {
-			for (int j = 0; j < numCircleSamples; j++) {
-				// Two triangles per quad
-				glm::vec3 t1(((i + 1) % numHeightSamples) * numCircleSamples + j,
-					i * numCircleSamples + ((j + 1) % numCircleSamples),
-					i * numCircleSamples + j);
-				glm::vec3 t2(((i + 1) % numHeightSamples) * numCircleSamples + j,
-					((i + 1) % numHeightSamples) * numCircleSamples + ((j + 1) % numCircleSamples),
-					i * numCircleSamples + ((j + 1) % numCircleSamples));
-				// Add two triangles to the data buffer
-				for (int k = 0; k < 3; k++) {
-					face[(i * numCircleSamples + j) * face_att * 2 + k] = (GLuint)t1[k];
-					face[(i * numCircleSamples + j) * face_att * 2 + k + face_att] = (GLuint)t2[k];
-				}
-			}
-		}
-
-		int cylbodysize = numCircleSamples * (numHeightSamples - 1) * 2; // amount of array filled so far, start adding from here
-		// triangles for top disc (fan shape)
-		int i = numHeightSamples - 1;
-
-		for (int j = 0; j < numCircleSamples; j++) {
-			// Bunch of wedges pointing to the centre
-			glm::vec3 topwedge(
-				i * numCircleSamples + j,
-				topvertex,
-				i * numCircleSamples + (j + 1) % numCircleSamples
-			);
-
-			// note order reversed so that all triangles point outward
-			glm::vec3 botwedge(
-				0 + (j + 1) % numCircleSamples,
-				bottomvertex,
-				0 + j
-			);
-
-			// Add the triangles to the data buffer
-			for (int k = 0; k < 3; k++) {
-				face[(cylbodysize + j) * face_att + k] = (GLuint)topwedge[k];
-				face[(cylbodysize + j + numCircleSamples) * face_att + k] = (GLuint)botwedge[k];
-			}
-		}
-
-		// Create OpenGL buffer for vertices
-		glGenBuffers(1, &vbo);
-		glBindBuffer(GL_ARRAY_BUFFER, vbo);
-		glBufferData(GL_ARRAY_BUFFER, vertex_num * vertex_att * sizeof(GLfloat), vertex, GL_STATIC_DRAW);
-
-		// Create OpenGL buffer for faces
-		glGenBuffers(1, &ebo);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, face_num * face_att * sizeof(GLuint), face, GL_STATIC_DRAW);
+		GeometryKey key;
 
-		// Free data buffers
-		delete[] vertex;
-		delete[] face;
+		key.generator = "Cylinder";
+		key.parameters = { height, circleRadius, (float)numHeightSamples, (float)numCircleSamples };
 
-		// Create resource
-		AddResource(ResourceType::Mesh, objectName, vbo, ebo, face_num * face_att);
+		CreateGeometry(objectName, key);
 	}
 
-	void ResourceManager::CreateFountainParticles(std::string object_name, int num_particles) {
-		// Create a set of points which will be the particles
-
-		// Data buffer
-		GLfloat* particle = NULL;
-
-		// Number of attributes per particle: position (3), normal (3), and color (3), texture coordinates (2)
-		const int particle_att = 11;
-
-		// Allocate memory for buffer
-		try {
-			particle = new GLfloat[num_particles * particle_att];
-		} catch (std::exception& e) {
-			throw e;
-		}
-
-		float trad = 0.2; // Defines the starting point of the particles along the normal
-		float u, v, theta, phi; // Work variables
-
-		for (int i = 0; i < num_particles; i++) {
-			// Get three random numbers
-
-			u = ((double)rand() / (RAND_MAX));
-			v = ((double)rand() / (RAND_MAX));
-
-			// Use u to define the angle theta along one direction of the sphere
-			theta = u * 2.0 * glm::pi<float>();
-			// Use v to define the angle phi along the other direction of the sphere
-			phi = acos(2.0 * v - 1.0);
-
-			// Define the normal and point based on theta and phi
-			glm::vec3 normal(sinf(theta) * cosf(phi), cosf(theta), sinf(theta) * sinf(phi));
-			glm::vec3 position(normal.x * trad, normal.y * trad, normal.z * trad);
-			glm::vec3 color((float)i / num_particles); // Using color to store phase
+	void ResourceManager::CreateGeometry(const std::string name, const GeometryKey& key) {
+		const GeneratedGeometry* shape = geometry.Find(key);
 
-			// Add vectors to the data buffer
-			for (int k = 0; k < 3; k++) {
-				particle[i * particle_att + k] = position[k];
-				particle[i * particle_att + k + 3] = normal[k];
-				particle[i * particle_att + k + 6] = color[k];
-			}
+		if (shape) {
+			AddGeneratedMesh(name, *shape);
+			return;
 		}
 
-		// Create OpenGL buffer and copy data
-
-		GLuint vbo;
-		glGenBuffers(1, &vbo);
-		glBindBuffer(GL_ARRAY_BUFFER, vbo);
-		glBufferData(GL_ARRAY_BUFFER, num_particles * particle_att * sizeof(GLfloat), particle, GL_STATIC_DRAW);
-
-		// Free data buffers
-		delete[] particle;
-
-		AddResource(ResourceType::PointSet, object_name, vbo, 0, num_particles);
+		geometry.Request(key);
+		pendingGeometry.push_back({ name, key });
 	}
 
-	void ResourceManager::CreateMonsterParticles(int num_particles) {
-		// Data buffer
-		GLfloat* particle = NULL;
-
-		// Number of attributes per particle: position (3), normal (3), and color (3), texture coordinates (2)
-		const int particle_att = 11;
+	void ResourceManager::BuildGeometry(JobSystem* jobs) {
+		geometry.Build(jobs);
 
-		// Allocate memory for buffer
-		try {
-			particle = new GLfloat[num_particles * particle_att];
-		} catch (std::exception& e) {
-			throw e;
+		for (int i = 0; i < pendingGeometry.size(); i++) {
+			AddGeneratedMesh(pendingGeometry[i].name, *geometry.Find(pendingGeometry[i].key));
 		}
 
-		for (int i = 0; i < num_particles; i++) {
-
-			//idea is to have a bunch of particles swarming around a point
-
-			//firstly, make random x,y, and z points on the surface of a sphere
-
-			float twopi = 2 * glm::pi<float>();
-
-			float r1 = ((double)rand() / (RAND_MAX));
-			float r2 = ((double)rand() / (RAND_MAX));
-
-			float lat = acos((2 * r1) - 1) - twopi;
-			float lon = twopi * r2;
-
-			float x = (cos(lat) * cos(lon)) * 0.2;
-			float y = (cos(lat) * sin(lon)) * 0.2;
-			float z = (sin(lat)) * 0.2;
-
-			//do nothing with normal since motion can be determined with simple trig
-			glm::vec3 normal(0, 0, 0);
-			glm::vec3 position(x, y, z);
-			//use color x for offset
-			glm::vec3 color(i, 0, 0);
-
-			// Add vectors to the data buffer
-			for (int k = 0; k < 3; k++) {
-				particle[i * particle_att + k] = position[k];
-				particle[i * particle_att + k + 3] = normal[k];
-				particle[i * particle_att + k + 6] = color[k];
-			}
-		}
-
-		// Create OpenGL buffer and copy data
-		GLuint vbo;
-		glGenBuffers(1, &vbo);
-		glBindBuffer(GL_ARRAY_BUFFER, vbo);
-		glBufferData(GL_ARRAY_BUFFER, num_particles * particle_att * sizeof(GLfloat), particle, GL_STATIC_DRAW);
-
-		// Free data buffers
-		delete[] particle;
-
-		// Create resource
-		AddResource(ResourceType::PointSet, "MonsterParticles", vbo, 0, num_particles);
+		pendingGeometry.clear();
 	}
 
-	void ResourceManager::CreateLeafParticles(int num_particles) {
-		// Data buffer
-		GLfloat* particle = NULL;
-
-		// Number of attributes per particle: position (3), normal (3), and color (3), texture coordinates (2)
-		const int particle_att = 11;
+	void ResourceManager::AddGeneratedMesh(const std::string name, const GeneratedGeometry& shape) {
+		AddResource(ResourceType::Mesh, name, shape.arrayBuffer, shape.elementArrayBuffer, shape.count);
 
-		// Allocate memory for buffer
-		try {
-			particle = new GLfloat[num_particles * particle_att];
-		} catch (std::exception& e) {
-			throw e;
-		}
-
-		for (int i = 0; i < num_particles; i++) {
-
-			//get random numbers for x and z offset position on the disc, 
-			//the y is statically determined based off camera position.
-			//Math is done assuming center of circle is at (0,0) and radius is 0.5
-
-			//get random points in flat circle
-
-			double r = 5 * sqrt(((double)rand() / (RAND_MAX)));
-			float theta = ((double)rand() / (RAND_MAX)) * 2 * glm::pi<float>();
+		// The arena is shared, the mesh only draws its own range
+		resources.back()->SetLods(std::vector<MeshLod>(1, { shape.firstIndex, shape.count, 0.0f }));
+		resources.back()->SetBounds(shape.min, shape.max);
+	}
 
-			double x, z;
+	ParticleSystem* ResourceManager::CreateParticleSystem(std::string name, int capacity, float maxLifetime) {
+		ParticleSystem* particles = new ParticleSystem(name);
+		// A seed per system, so they do not all spawn in step
+		particles->Create(capacity, maxLifetime, (unsigned int)particleSystems.size());
 
-			x = r * cos(theta);
-			z = r * sin(theta);
+		particleSystems.push_back(particles);
 
-			// Normal will be straight down, since leaves are gonna be falling in downward half-arcs, rest of math handled in vertex shader
-			glm::vec3 normal(0, -1, 0);
-			//y position is gonna be a small interval above the camera, and then the random x and z coordinates
-			float y = ((double)rand() / (RAND_MAX)) * 0.5;
-			glm::vec3 position(x, y, z);
-			//use value of color vec3 for offset
-			glm::vec3 color(i, 0, 0);
+		return particles;
+	}
 
-			// Add vectors to the data buffer
-			for (int k = 0; k < 3; k++) {
-				particle[i * particle_att + k] = position[k];
-				particle[i * particle_att + k + 3] = normal[k];
-				particle[i * particle_att + k + 6] = color[k];
+	ParticleSystem* ResourceManager::GetParticleSystem(std::string name) {
+		for (int i = 0; i < particleSystems.size(); i++) {
+			if (particleSystems[i]->GetName() == name) {
+				return particleSystems[i];
 			}
 		}
 
-		// Create OpenGL buffer and copy data
-		GLuint vbo;
-		glGenBuffers(1, &vbo);
-		glBindBuffer(GL_ARRAY_BUFFER, vbo);
-		glBufferData(GL_ARRAY_BUFFER, num_particles * particle_att * sizeof(GLfloat), particle, GL_STATIC_DRAW);
-
-		// Free data buffers
-		delete[] particle;
-
-		// Create resource
-		AddResource(ResourceType::PointSet, "LeafParticles", vbo, 0, num_particles);
+		return NULL;
 	}
 
 	void ResourceManager::CreateLineParticles(std::string object_name, int num_particles) {
@@ -1328,31 +1299,18 @@ namespace Game {
 	}
 
 	float ResourceManager::GetTerrainHeightAt(float x, float y) {
-		if (x < 0.0f || x >= MAP_SIZE * 2.0f || y < 0.0f || y >= MAP_SIZE * 2.0f) {
-			return 0.0f;
-		}
-
-		int x1 = glm::floor(x);
-		int x2 = glm::ceil(x);
-
-		int y1 = glm::floor(y);
-		int y2 = glm::ceil(y);
-
-		float h1 = heights[x1][y1] * (1 - (x - x1)) + heights[x2][y1] * (x - x1);
-		float h2 = heights[x1][y2] * (1 - (x - x1)) + heights[x2][y2] * (x - x1);
+		return terrain.GetHeightAt(x, y);
+	}
 
-		return h1 * (1 - (y - y1)) + h2 * (y - y1);
+	void ResourceManager::GetTerrainHeightsAt(int count, const float* x, const float* y, float* heights, glm::vec3* normals) {
+		terrain.GetHeightsAt(count, x, y, heights, normals);
 	}
 
-	bool ResourceManager::GetMazeCollisions(int x, int y, glm::vec3 position) {
+	bool ResourceManager::IsMazeWall(int x, int y) const {
 		if (x < 0 || x >= MAP_SIZE || y < 0 || y >= MAP_SIZE) {
 			return true;
 		}
 
-		if (collisions[x][y] && position.x > (x * 2.0f - 1.1f) && position.x < (x * 2.0f + 1.1f) && position.z >(y * 2.0f - 1.1f) && position.z < (y * 2.0f + 1.1f)) {
-			return true;
-		}
-
-		return false;
+		return collisions[x][y];
 	}
 }
\ No newline at end of file
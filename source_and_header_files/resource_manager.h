@@ -8,6 +8,10 @@
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 #include "resource.h"
+#include "terrain.h"
+#include "particle_system.h"
+#include "mesh_cooker.h"
+#include "procedural_geometry.h"
 
 // Default extensions for different shader source files
 
@@ -28,61 +32,166 @@ namespace Game {
 		// Add a resource that was already loaded and allocated to memory
 
 		void AddResource(ResourceType type, const std::string name, GLuint resource, GLsizei size);
-		void AddResource(ResourceType type, const std::string name, GLuint arrayBuffer, GLuint elementArrayBuffer, GLsizei size);
+		// Vertices of 11 floats unless a layout is given
+		void AddResource(ResourceType type, const std::string name, GLuint arrayBuffer, GLuint elementArrayBuffer, GLsizei size, const VertexLayout* layout = NULL);
 
 		// Load a resource from a file, according to the specified type
 		void LoadResource(ResourceType type, const std::string name, const char* filename);
 
+		// Layout the meshes loaded afterwards are encoded into, the packed one by default
+		void SetMeshLayout(const VertexLayout& layout);
+
 		// Load cubemap texture
 		void LoadCubemap(const std::string name, const char* xpos, const char* xneg, const char* ypos, const char* yneg, const char* zpos, const char* zneg);
 
-		// Get the resource with the specified name
-		Resource* GetResource(const std::string name) const;
+		// Get the resource with the specified name. Materials may still be compiling, they are only drawn with
+		// after CollectMaterials
+		Resource* GetResource(const std::string name);
+
+		// Get a permutation of a loaded material compiled with extra defines, e.g. ("TexturedShader", "INSTANCED+NO_FOG")
+		// Each combination of shader prefix and define set is only compiled once
+		Resource* GetMaterialVariant(const std::string name, const std::string defines);
+
+		// Check the submitted materials the driver has finished for errors, without waiting for the others
+		void CollectReadyMaterials();
+		// Wait for all submitted materials and check them for errors
+		void CollectMaterials();
+
+		// Recompile the materials that use any of the given shader files (e.g. "water_fp.glsl")
+		void ReloadMaterials(const std::vector<std::string>& files);
+		// Swap in reloaded materials that finished compiling, call at a frame boundary
+		void UpdateReloadedMaterials();
 
 		// Methods to create specific resources
 
-		void CreateTerrain();
+		// Create the chunked terrain with size height samples along each side
+		void CreateTerrain(int size = MAP_SIZE * 2, unsigned int seed = 0);
 		void CreateMaze();
 
 		void CreateSkybox();
 
+		// Create a tangent space normal map from the brightness of an image taken as height, steeper for a
+		// larger strength
+		void CreateNormalMap(std::string name, const char* heightFilename, float strength = 2.0f);
+
 		// Create the geometry for a cylinder
 		void CreateCylinder(std::string objectName, float height = 1.0f, float radius = 0.6f, int numSamplesTheta = 90, int numSamplesPhi = 45);
 
+		// Create a mesh made by a generator of the geometry cache, sharing its buffers with every mesh of the same
+		// key. Available at once when the key was already built, otherwise after the next BuildGeometry
+		void CreateGeometry(const std::string name, const GeometryKey& key);
+		// Generate the geometry created since the last call, split over the jobs when given
+		void BuildGeometry(JobSystem* jobs = NULL);
+
 		// Particles
 
-		void CreateFountainParticles(std::string object_name, int num_particles = 8000);
-		void CreateMonsterParticles(int num_particles);
-		void CreateLeafParticles(int num_particles);
+		// Particles simulated on the GPU, spawn times are spread over maxLifetime
+		ParticleSystem* CreateParticleSystem(std::string name, int capacity, float maxLifetime);
+		ParticleSystem* GetParticleSystem(std::string name);
+
 		void CreateLineParticles(std::string object_name, int num_particles = 20000);
 
+		const Terrain* GetTerrain() const;
+
 		// Returns the height at (x, y)
 		float GetTerrainHeightAt(float x, float y);
-		// Returns if collision maze cell exists at (x, y)
-		bool GetMazeCollisions(int x, int y, glm::vec3 position);
+		// Heights (and optionally normals) at count points
+		void GetTerrainHeightsAt(int count, const float* x, const float* y, float* heights, glm::vec3* normals = NULL);
+		// Returns true if the maze cell (x, y) is a wall or outside the maze, cells are centered at (x, y) * 2
+		bool IsMazeWall(int x, int y) const;
 
 	private:
+		// Shader program whose compile and link were submitted but not yet checked
+		struct PendingMaterial {
+			Resource* resource;
+
+			GLuint program;
+			GLuint vs;
+			GLuint fs;
+			GLuint gs;
+		};
+
 		// List storing all resources
 		std::vector<Resource*> resources;
 
-		// Stores heightmap heights
-		float heights[MAP_SIZE * 2][MAP_SIZE * 2];
+		// Shader prefix of a loaded material
+		struct MaterialSource {
+			Resource* resource;
+
+			std::string prefix;
+			std::string defines;
+
+			// Every file the sources were built from, including the included ones
+			std::vector<std::string> files;
+		};
+
+		// Materials waiting to be collected
+		std::vector<PendingMaterial> pendingMaterials;
+
+		// New programs for materials whose sources changed
+		std::vector<PendingMaterial> reloadingMaterials;
+		std::vector<MaterialSource> materialSources;
+
+		// Set once the driver was asked for parallel shader compilation
+		bool shaderCompilerInitialized = false;
+		bool parallelShaderCompile = false;
+
+		// Layout of the loaded meshes
+		VertexLayout meshLayout = VertexLayout::GetPacked();
+
+		// Generated shapes, and the meshes waiting for theirs
+		struct PendingGeometry {
+			std::string name;
+			GeometryKey key;
+		};
+
+		GeometryCache geometry;
+		std::vector<PendingGeometry> pendingGeometry;
+
+		// Heightmap and chunk geometry of the terrain
+		Terrain terrain;
+		// State of the GPU particle systems
+		std::vector<ParticleSystem*> particleSystems;
 		// Stores maze collision matrix
 		bool collisions[MAP_SIZE][MAP_SIZE];
 
 		// Methods to load specific types of resources
 
-		// Load shaders programs
+		// Load shaders programs. Compilation and linking are only submitted here, see CollectMaterial
 		void LoadMaterial(const std::string name, const char* prefix);
+		void LoadMaterial(const std::string name, const std::string prefix, const std::string defines);
+		PendingMaterial SubmitMaterial(const std::string prefix, const std::string defines, std::vector<std::string>& files);
+
+		// Returns true if the driver finished the program, without stalling
+		bool IsProgramReady(GLuint program) const;
+		// Check a submitted program for errors and release its shaders, returns the error if any
+		std::string FinishMaterial(const PendingMaterial& pending);
+
+		// Enable driver side compiler threads if GL_KHR_parallel_shader_compile is available
+		void InitializeShaderCompiler();
+
+		// Check a submitted material for errors and release its shaders
+		void CollectMaterial(int index);
 
 		// Load a text file into memory (could be source code)
 		std::string LoadTextFile(const char* filename);
 
+		// Load a shader stage, resolving #include directives and adding the permutation defines
+		// All files read are appended to files
+		std::string LoadShaderSource(const std::string filename, const std::string defines, std::vector<std::string>& files);
+		// Files already in the stage are skipped, included lists them. The #line directives number the files by
+		// their index in files
+		std::string PreprocessShader(const std::string filename, std::vector<std::string>& files, std::vector<std::string>& included, std::string& version);
+
 		// Load a texture from an image file: png, jpg, etc.
 		void LoadTexture(const std::string name, const char* filename);
 
-		// Loads a mesh in obj format
+		// Loads a mesh in obj format, from its cooked copy when it is up to date
 		void LoadMesh(const std::string name, const char* filename);
+		// Copy a cooked mesh to OpenGL buffers, encoded into the mesh layout
+		void AddMesh(const std::string name, const CookedMesh& mesh);
+		// Add a mesh drawing a range of the arena of the geometry cache
+		void AddGeneratedMesh(const std::string name, const GeneratedGeometry& shape);
 	};
 }
 
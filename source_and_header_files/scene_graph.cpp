@@ -3,13 +3,56 @@
 #include <stdexcept>
 #include <iostream>
 #include <fstream>
+#include <algorithm>
+#include <cmath>
 #include <glm/gtc/quaternion.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include "scene_graph.h"
 
 namespace Game {
-	SceneGraph::SceneGraph() {}
+	const glm::vec3 FOG_COLOR(0.8f, 0.8f, 0.8f);
+
+	const float FOG_DENSITY = 0.02f;
+	const float FOG_FACTOR = 2.0f;
+
+	// Toward the sun, the light direction of textured_fp.glsl and shiny_fp.glsl
+	const glm::vec3 LIGHT_DIRECTION(0.3f, 1.2f, 1.0f);
+
+	// Depth bias of the shadow casters, scaled by their slope and in depth buffer units
+	const float SHADOW_SLOPE_BIAS = 2.0f;
+	const float SHADOW_CONSTANT_BIAS = 4.0f;
+
+	// Texture unit of the shadow map, the material texture is on unit 0
+	const int SHADOW_TEXTURE_UNIT = 1;
+	// First of the three texture units of the light grid
+	const int LIGHT_TEXTURE_UNIT = 2;
+	// Texture unit of the normal map, after the light grid
+	const int NORMAL_MAP_TEXTURE_UNIT = 5;
+
+	// View depths covered by the light clusters, past the far one the fog hides the lights
+	const float LIGHT_CLUSTER_NEAR = 0.1f;
+	const float LIGHT_CLUSTER_FAR = 150.0f;
+
+	// Scene brightness multiplier before tone mapping
+	const float EXPOSURE = 1.0f;
+
+	// Brightness the bloom starts at, softened over the knee below it, and how much of it is added
+	const float BLOOM_THRESHOLD = 1.0f;
+	const float BLOOM_KNEE = 0.5f;
+	const float BLOOM_INTENSITY = 0.6f;
+
+	// GPU budgets of the bloom levels in milliseconds, for a 1920x1080 scene
+	const float BLOOM_THRESHOLD_BUDGET = 0.25f;
+	const float BLOOM_DOWN_BUDGET = 0.08f;
+	const float BLOOM_UP_BUDGET = 0.15f;
+
+	// Format of the HDR targets: no alpha, a third of the size of RGBA16F
+	const GLenum HDR_FORMAT = GL_R11F_G11F_B10F;
+
+	SceneGraph::SceneGraph() {
+		lightClusters.SetDepthRange(LIGHT_CLUSTER_NEAR, LIGHT_CLUSTER_FAR);
+	}
 
 	SceneGraph::~SceneGraph() {}
 
@@ -43,19 +86,110 @@ namespace Game {
 		nodes.push_back(node);
 	}
 
-	void SceneGraph::Draw(Camera* camera) {
-		// Clear background
+	int SceneGraph::AddLight(const PointLight& light) {
+		lights.push_back(light);
 
-		glClearColor(backgroundColor[0], backgroundColor[1], backgroundColor[2], 0.0f);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		return (int)lights.size() - 1;
+	}
+
+	PointLight SceneGraph::GetLight(int i) const {
+		return lights[i];
+	}
+
+	void SceneGraph::SetLight(int i, const PointLight& light) {
+		lights[i] = light;
+	}
+
+	int SceneGraph::GetLightCount() const {
+		return (int)lights.size();
+	}
+
+	void SceneGraph::Update(Camera* camera, JobSystem* jobs) {
+		// Each node only writes to itself and its children
+		jobs->ParallelFor((int)nodes.size(), 16, [&](int first, int last) {
+			for (int i = first; i < last; i++) {
+				nodes[i]->Update(camera);
+			}
+		});
+
+		// Depth slices of the light grid are binned in parallel
+		lightClusters.Build(lights, camera->GetViewMatrix(), camera->GetProjectionMatrix(), lightGrid, jobs);
+	}
+
+	void SceneGraph::Collect(Camera* camera, FramePacket* packet) {
+		packet->viewMatrix = camera->GetViewMatrix();
+		packet->projectionMatrix = camera->GetProjectionMatrix();
+		packet->cameraPosition = camera->GetPosition();
+
+		packet->items.clear();
+		packet->particleSteps.clear();
 
-		// Draw all nodes
 		for (int i = 0; i < nodes.size(); i++) {
-			nodes[i]->Draw(camera);
+			nodes[i]->Collect(packet);
+		}
+
+		// Copied into the packet's own storage, which keeps its capacity from frame to frame
+		packet->lights.lights = lightGrid.lights;
+		packet->lights.clusters = lightGrid.clusters;
+		packet->lights.indices = lightGrid.indices;
+		packet->lights.nearDepth = lightGrid.nearDepth;
+		packet->lights.farDepth = lightGrid.farDepth;
+
+		// Shadow casters of every cascade
+		packet->shadows.Fit(packet->viewMatrix, packet->projectionMatrix, LIGHT_DIRECTION, shadowDistance, shadowCascades, shadowResolution);
+		packet->shadowItems.clear();
+
+		if (packet->shadows.count > 0) {
+			for (int i = 0; i < nodes.size(); i++) {
+				nodes[i]->CollectShadows(packet);
+			}
 		}
 	}
 
-	void SceneGraph::SetupDrawToTexture() {
+	void SceneGraph::SetShadows(int cascades, int resolution, float distance) {
+		shadowCascades = glm::clamp(cascades, 0, SHADOW_MAX_CASCADES);
+		shadowResolution = glm::max(resolution, 1);
+		shadowDistance = distance;
+	}
+
+	int SceneGraph::GetShadowCascades() const {
+		return shadowCascades;
+	}
+
+	int SceneGraph::GetShadowResolution() const {
+		return shadowResolution;
+	}
+
+	void SceneGraph::SetShadowMaterial(const Resource* material) {
+		shadowMaterial = material;
+	}
+
+	void SceneGraph::SetTransparencyMaterial(const Resource* material) {
+		transparencyMaterial = material;
+	}
+
+	void SceneGraph::SetBlurMaterials(const Resource* downsample, const Resource* upsample) {
+		blurDownMaterial = downsample;
+		blurUpMaterial = upsample;
+	}
+
+	void SceneGraph::SetBloomMaterials(const Resource* threshold, const Resource* upsample) {
+		bloomThresholdMaterial = threshold;
+		bloomUpMaterial = upsample;
+	}
+
+	void SceneGraph::Draw(const FramePacket& packet) {
+		// The transparent pass needs the render targets of the texture
+
+		DrawToTexture(packet);
+
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, frameBuffer);
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+		glBlitFramebuffer(0, 0, renderWidth, renderHeight, 0, 0, packet.width, packet.height, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	}
+
+	void SceneGraph::SetupDrawToTexture(int width, int height) {
 		// Set up frame buffer
 
 		glGenFramebuffers(1, &frameBuffer);
@@ -66,17 +200,27 @@ namespace Game {
 		glGenTextures(1, &texture);
 		glBindTexture(GL_TEXTURE_2D, texture);
 
-		// Set up an image for the texture
-
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, FRAME_BUFFER_WIDTH, FRAME_BUFFER_HEIGHT, 0, GL_RGB, GL_UNSIGNED_BYTE, 0);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 
 		// Set up a depth buffer for rendering
 
 		glGenRenderbuffers(1, &depthBuffer);
-		glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
-		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, FRAME_BUFFER_WIDTH, FRAME_BUFFER_HEIGHT);
+
+		// Set up the transparent pass targets, their images are set with the others
+
+		glGenTextures(1, &accumulationTexture);
+		glBindTexture(GL_TEXTURE_2D, accumulationTexture);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+
+		glGenTextures(1, &revealageTexture);
+		glBindTexture(GL_TEXTURE_2D, revealageTexture);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+
+		// Set up images for every target
+		SetRenderSize(width, height);
 
 		// Configure frame buffer (attach rendering buffers)
 
@@ -90,46 +234,117 @@ namespace Game {
 			throw(std::string("Error setting up frame buffer"));
 		}
 
+		// Set up the transparent pass: weighted colors are summed in floating point and the
+		// revealage, the product of (1 - alpha) of every fragment, is kept in a single channel
+
+		glGenFramebuffers(1, &transparencyFrameBuffer);
+		glBindFramebuffer(GL_FRAMEBUFFER, transparencyFrameBuffer);
+
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, accumulationTexture, 0);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, revealageTexture, 0);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+		GLenum transparencyBuffers[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+		glDrawBuffers(2, transparencyBuffers);
+
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+			throw(std::string("Error setting up transparency frame buffer"));
+		}
+
 		// Reset frame buffer
 		glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
-		// Set up quad for drawing to the screen
-		static const GLfloat quad_vertex_data[] = {
-			-1.0f, -1.0f, 0.0f, 0.0f, 0.0f,
-			 1.0f, -1.0f, 0.0f, 1.0f, 0.0f,
-			-1.0f,  1.0f, 0.0f, 0.0f, 1.0f,
-			-1.0f,  1.0f, 0.0f, 0.0f, 1.0f,
-			 1.0f, -1.0f, 0.0f, 1.0f, 0.0f,
-			 1.0f,  1.0f, 0.0f, 1.0f, 1.0f,
-		};
+		// Set up the light grid: a buffer and a texture reading it for the lights, clusters and indices
+
+		glGenBuffers(3, lightBuffers);
+		glGenTextures(3, lightTextures);
+
+		const GLenum lightFormats[3] = { GL_RGBA32F, GL_RG32UI, GL_R32UI };
+
+		for (int i = 0; i < 3; i++) {
+			glBindBuffer(GL_TEXTURE_BUFFER, lightBuffers[i]);
+			glBufferData(GL_TEXTURE_BUFFER, 16, 0, GL_STREAM_DRAW);
+
+			glBindTexture(GL_TEXTURE_BUFFER, lightTextures[i]);
+			glTexBuffer(GL_TEXTURE_BUFFER, lightFormats[i], lightBuffers[i]);
+		}
 
-		// Create buffer for quad
+		glBindBuffer(GL_TEXTURE_BUFFER, 0);
+		glBindTexture(GL_TEXTURE_BUFFER, 0);
 
-		glGenBuffers(1, &quadArrayBuffer);
-		glBindBuffer(GL_ARRAY_BUFFER, quadArrayBuffer);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(quad_vertex_data), quad_vertex_data, GL_STATIC_DRAW);
+		// A single texel pointing straight out of the surface, for normal mapped items without a map
+		const GLubyte flat[3] = { 128, 128, 255 };
+
+		glGenTextures(1, &flatNormalMap);
+		glBindTexture(GL_TEXTURE_2D, flatNormalMap);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, 1, 1, 0, GL_RGB, GL_UNSIGNED_BYTE, flat);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glBindTexture(GL_TEXTURE_2D, 0);
+
+		// Set up the shadow map and the post processing passes
+		shadowMap.Setup();
+		post.Setup();
+	}
+
+	void SceneGraph::SetRenderSize(int width, int height) {
+		width = glm::max(width, 1);
+		height = glm::max(height, 1);
+
+		if (width == renderWidth && height == renderHeight) {
+			return;
+		}
+
+		renderWidth = width;
+		renderHeight = height;
+
+		// New images for the same objects, the frame buffers keep them attached
+
+		glBindTexture(GL_TEXTURE_2D, texture);
+		glTexImage2D(GL_TEXTURE_2D, 0, HDR_FORMAT, width, height, 0, GL_RGB, GL_FLOAT, 0);
+
+		glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, width, height);
+
+		glBindTexture(GL_TEXTURE_2D, accumulationTexture);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, 0);
+
+		glBindTexture(GL_TEXTURE_2D, revealageTexture);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_R16F, width, height, 0, GL_RED, GL_FLOAT, 0);
+
+		glBindTexture(GL_TEXTURE_2D, 0);
+	}
+
+	int SceneGraph::GetRenderWidth() const {
+		return renderWidth;
+	}
+
+	int SceneGraph::GetRenderHeight() const {
+		return renderHeight;
 	}
 
-	void SceneGraph::DrawToTexture(Camera* camera) {
+	void SceneGraph::DrawToTexture(const FramePacket& packet) {
 		// Save current viewport
 
 		GLint viewport[4];
 		glGetIntegerv(GL_VIEWPORT, viewport);
 
+		// Shadows and lights first, the scene reads them
+		DrawShadows(packet);
+		UploadLights(packet);
+
 		// Enable frame buffer
 
 		glBindFramebuffer(GL_FRAMEBUFFER, frameBuffer);
-		glViewport(0, 0, FRAME_BUFFER_WIDTH, FRAME_BUFFER_HEIGHT);
+		glViewport(0, 0, renderWidth, renderHeight);
 
 		// Clear background
 
 		glClearColor(backgroundColor[0], backgroundColor[1], backgroundColor[2], 0.0);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-		// Draw all scene nodes
-		for (int i = 0; i < nodes.size(); i++) {
-			nodes[i]->Draw(camera);
-		}
+		// Draw all scene nodes, opaque ones first
+		DrawItems(packet);
+		DrawTransparency(packet);
 
 		// Reset frame buffer
 		glBindFramebuffer(GL_FRAMEBUFFER, 0);
@@ -138,44 +353,13 @@ namespace Game {
 		glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
 	}
 
-	void SceneGraph::DisplayTexture(GLuint program, float param, GLuint overlay) {
+	void SceneGraph::DisplayTexture(GLuint program, float param, GLuint overlay, int blurLevels) {
 		// Configure output to the screen
 
 		glDisable(GL_DEPTH_TEST);
 
-		// Set up quad geometry
-		glBindBuffer(GL_ARRAY_BUFFER, quadArrayBuffer);
-
-		// Select proper material (shader program)
-		glUseProgram(program);
-
-		// Setup attributes of screen-space shader
-
-		GLint pos_att = glGetAttribLocation(program, "position");
-		glEnableVertexAttribArray(pos_att);
-		glVertexAttribPointer(pos_att, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat), 0);
-
-		GLint tex_att = glGetAttribLocation(program, "uv");
-		glEnableVertexAttribArray(tex_att);
-		glVertexAttribPointer(tex_att, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat), (void*)(3 * sizeof(GLfloat)));
-
-		// Timer
-
-		GLint timer_var = glGetUniformLocation(program, "timer");
-		float current_time = glfwGetTime();
-		glUniform1f(timer_var, current_time);
-
-		// Distance
-
-		GLint proximity_var = glGetUniformLocation(program, "proximity");
-		glUniform1f(proximity_var, param);
-
-		// Bind texture
-		glUniform1i(texture, 0); // Assign the first texture to the map
-		glActiveTexture(GL_TEXTURE0);
+		// Define texture interpolation, mipmaps for drawing the scene smaller than it was rendered
 		glBindTexture(GL_TEXTURE_2D, texture);
-
-		// Define texture interpolation
 		glGenerateMipmap(GL_TEXTURE_2D);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_LINEAR);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
@@ -183,12 +367,7 @@ namespace Game {
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
 
 		if (overlay != NULL) {
-			GLint overlay_map = glGetUniformLocation(program, "overlay");
-			glUniform1i(overlay_map, 1); // Assign the second texture to the map
-			glActiveTexture(GL_TEXTURE1);
-			glBindTexture(GL_TEXTURE_2D, overlay); // Second texture we bind
-
-			// Define texture interpolation
+			glBindTexture(GL_TEXTURE_2D, overlay);
 			glGenerateMipmap(GL_TEXTURE_2D);
 			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_LINEAR);
 			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
@@ -196,10 +375,443 @@ namespace Game {
 			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
 		}
 
-		// Draw geometry
-		glDrawArrays(GL_TRIANGLES, 0, 6);
+		// Passes of the frame
+
+		post.Reset();
+
+		std::vector<PostInput> inputs;
+
+		int scene = post.Import(texture, renderWidth, renderHeight);
+		inputs.push_back({ "texture_map", scene });
+
+		if (overlay != NULL) {
+			inputs.push_back({ "overlay", post.Import(overlay, 0, 0) });
+		}
+
+		// The blur passes are culled unless the effect reads the blur
+		if (blurLevels > 0 && blurDownMaterial && blurUpMaterial) {
+			int blur = AddBlurPasses(scene, blurLevels);
+
+			if (glGetUniformLocation(program, "blur_map") >= 0) {
+				inputs.push_back({ "blur_map", blur });
+			}
+		}
+
+		bool hasBloom = bloomThresholdMaterial && bloomUpMaterial && blurDownMaterial && glGetUniformLocation(program, "bloom_map") >= 0;
+
+		if (hasBloom) {
+			inputs.push_back({ "bloom_map", AddBloomPasses(scene) });
+		}
+
+		post.AddPass("Display", program, inputs, POST_SCREEN, [param, hasBloom](GLuint program) {
+			// Timer
+
+			GLint timer_var = glGetUniformLocation(program, "timer");
+			float current_time = glfwGetTime();
+			glUniform1f(timer_var, current_time);
+
+			// Distance
+
+			GLint proximity_var = glGetUniformLocation(program, "proximity");
+			glUniform1f(proximity_var, param);
+
+			// Tone mapping
+
+			glUniform1f(glGetUniformLocation(program, "exposure"), EXPOSURE);
+			glUniform1f(glGetUniformLocation(program, "bloom_intensity"), hasBloom ? BLOOM_INTENSITY : 0.0f);
+		});
+
+		post.Execute();
 
 		// Reset current geometry
 		glEnable(GL_DEPTH_TEST);
 	}
+
+	int SceneGraph::AddBlurPasses(int source, int levels) {
+		// Dual filter blur: every level down and back up widens the blur, at a fraction of the cost of
+		// a kernel of the same radius at full resolution. Each level is half the size of the one before,
+		// the way back up reuses the pooled targets of the way down once they have been read
+
+		levels = glm::clamp(levels, 1, BLUR_LEVELS);
+
+		GLuint downsample = blurDownMaterial->GetResource();
+		GLuint upsample = blurUpMaterial->GetResource();
+
+		int widths[BLUR_LEVELS + 1];
+		int heights[BLUR_LEVELS + 1];
+
+		widths[0] = renderWidth;
+		heights[0] = renderHeight;
+
+		for (int i = 1; i <= levels; i++) {
+			widths[i] = glm::max(1, widths[i - 1] / 2);
+			heights[i] = glm::max(1, heights[i - 1] / 2);
+		}
+
+		int current = source;
+
+		for (int i = 1; i <= levels; i++) {
+			int target = post.CreateTarget(widths[i], heights[i], HDR_FORMAT);
+
+			AddBlurPass("Blur down 1/" + std::to_string(1 << i), downsample, current, widths[i - 1], heights[i - 1], target);
+			current = target;
+		}
+
+		for (int i = levels - 1; i >= 1; i--) {
+			int target = post.CreateTarget(widths[i], heights[i], HDR_FORMAT);
+
+			AddBlurPass("Blur up 1/" + std::to_string(1 << i), upsample, current, widths[i + 1], heights[i + 1], target);
+			current = target;
+		}
+
+		return current;
+	}
+
+	int SceneGraph::AddBloomPasses(int source) {
+		// The bright pass is folded into the first downsample, so the full size scene is read once
+
+		int halfWidth = glm::max(1, renderWidth / 2);
+		int halfHeight = glm::max(1, renderHeight / 2);
+		int quarterWidth = glm::max(1, halfWidth / 2);
+		int quarterHeight = glm::max(1, halfHeight / 2);
+
+		int sourceWidth = renderWidth;
+		int sourceHeight = renderHeight;
+
+		int half = post.CreateTarget(halfWidth, halfHeight, HDR_FORMAT);
+		std::vector<PostInput> inputs;
+		inputs.push_back({ "texture_map", source });
+
+		post.AddPass("Bloom threshold 1/2", bloomThresholdMaterial->GetResource(), inputs, half, [sourceWidth, sourceHeight](GLuint program) {
+			glUniform2f(glGetUniformLocation(program, "source_size"), (float)sourceWidth, (float)sourceHeight);
+			glUniform1f(glGetUniformLocation(program, "threshold"), BLOOM_THRESHOLD);
+			glUniform1f(glGetUniformLocation(program, "knee"), BLOOM_KNEE);
+		}, BLOOM_THRESHOLD_BUDGET);
+
+		int quarter = post.CreateTarget(quarterWidth, quarterHeight, HDR_FORMAT);
+		AddBlurPass("Bloom down 1/4", blurDownMaterial->GetResource(), half, halfWidth, halfHeight, quarter, BLOOM_DOWN_BUDGET);
+
+		// Back up, the quarter level widens the glow around the sharper half level
+		int bloom = post.CreateTarget(halfWidth, halfHeight, HDR_FORMAT);
+		inputs.clear();
+		inputs.push_back({ "texture_map", quarter });
+		inputs.push_back({ "level_map", half });
+
+		post.AddPass("Bloom up 1/2", bloomUpMaterial->GetResource(), inputs, bloom, [quarterWidth, quarterHeight](GLuint program) {
+			glUniform2f(glGetUniformLocation(program, "source_size"), (float)quarterWidth, (float)quarterHeight);
+			glUniform1f(glGetUniformLocation(program, "offset"), 1.0f);
+		}, BLOOM_UP_BUDGET);
+
+		return bloom;
+	}
+
+	void SceneGraph::AddBlurPass(const std::string name, GLuint program, int source, int sourceWidth, int sourceHeight, int target, float budget) {
+		std::vector<PostInput> inputs;
+		inputs.push_back({ "texture_map", source });
+
+		post.AddPass(name, program, inputs, target, [sourceWidth, sourceHeight](GLuint program) {
+			glUniform2f(glGetUniformLocation(program, "source_size"), (float)sourceWidth, (float)sourceHeight);
+			glUniform1f(glGetUniformLocation(program, "offset"), 1.0f);
+		}, budget);
+	}
+
+	void SceneGraph::GetPostTimings(std::vector<PostTiming>& timings) const {
+		post.GetTimings(timings);
+	}
+
+	void SceneGraph::UploadLights(const FramePacket& packet) {
+		const LightGrid& grid = packet.lights;
+
+		// New storage every frame, the previous frame may still be reading the old one
+		const void* data[3] = { grid.lights.data(), grid.clusters.data(), grid.indices.data() };
+		const size_t sizes[3] = { grid.lights.size() * sizeof(glm::vec4), grid.clusters.size() * sizeof(unsigned int), grid.indices.size() * sizeof(unsigned int) };
+
+		for (int i = 0; i < 3; i++) {
+			glBindBuffer(GL_TEXTURE_BUFFER, lightBuffers[i]);
+			glBufferData(GL_TEXTURE_BUFFER, std::max(sizes[i], (size_t)16), NULL, GL_STREAM_DRAW);
+
+			if (sizes[i] > 0) {
+				glBufferSubData(GL_TEXTURE_BUFFER, 0, sizes[i], data[i]);
+			}
+		}
+
+		glBindBuffer(GL_TEXTURE_BUFFER, 0);
+	}
+
+	void SceneGraph::DrawShadows(const FramePacket& packet) {
+		const ShadowCascades& shadows = packet.shadows;
+
+		if (shadows.count == 0 || !shadowMaterial) {
+			return;
+		}
+
+		shadowMap.SetSize(shadows.resolution, shadows.count);
+
+		GLuint program = shadowMaterial->GetResource();
+
+		// Pushed away from the light so lit surfaces do not shadow themselves
+		glEnable(GL_POLYGON_OFFSET_FILL);
+		glPolygonOffset(SHADOW_SLOPE_BIAS, SHADOW_CONSTANT_BIAS);
+
+		for (int i = 0; i < shadows.count; i++) {
+			shadowMap.BindCascade(i);
+
+			for (int j = 0; j < packet.shadowItems.size(); j++) {
+				const DrawItem& item = packet.shadowItems[j];
+
+				if (!(item.shadowCascades & (1 << i))) {
+					continue;
+				}
+
+				// Points are expanded by their own geometry shader
+				if (item.mode == GL_POINTS) {
+					DrawGeometry(item, packet, shadows.matrices[i], glm::mat4(1.0f));
+				} else {
+					DrawShadowCaster(item, program, shadows.matrices[i]);
+				}
+			}
+		}
+
+		glDisable(GL_POLYGON_OFFSET_FILL);
+
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	}
+
+	void SceneGraph::DrawShadowCaster(const DrawItem& item, GLuint program, const glm::mat4& shadowMatrix) {
+		glUseProgram(program);
+
+		glBindBuffer(GL_ARRAY_BUFFER, item.arrayBuffer);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, item.elementArrayBuffer);
+
+		// Positions only, the program has no other inputs
+		item.layout->Bind(program);
+
+		glUniformMatrix4fv(glGetUniformLocation(program, "world_mat"), 1, GL_FALSE, glm::value_ptr(item.worldMatrix));
+		glUniformMatrix4fv(glGetUniformLocation(program, "shadow_mat"), 1, GL_FALSE, glm::value_ptr(shadowMatrix));
+
+		glDrawElementsBaseVertex(item.mode, item.size, GL_UNSIGNED_INT, (void*)(item.firstIndex * sizeof(GLuint)), item.baseVertex);
+	}
+
+	void SceneGraph::DrawItems(const FramePacket& packet) {
+		for (int i = 0; i < packet.items.size(); i++) {
+			if (!packet.items[i].isBlended) {
+				DrawGeometry(packet.items[i], packet);
+			}
+		}
+	}
+
+	void SceneGraph::DrawTransparency(const FramePacket& packet) {
+		// Weighted blended order independent transparency: no sorting, overlapping particle sets
+		// blend the same whichever is drawn first
+
+		bool hasTransparent = false;
+
+		for (int i = 0; i < packet.items.size(); i++) {
+			hasTransparent = hasTransparent || packet.items[i].isBlended;
+		}
+
+		if (!hasTransparent || !transparencyMaterial) {
+			return;
+		}
+
+		glBindFramebuffer(GL_FRAMEBUFFER, transparencyFrameBuffer);
+
+		const GLfloat clearAccumulation[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+		const GLfloat clearRevealage[4] = { 1.0f, 0.0f, 0.0f, 0.0f };
+		glClearBufferfv(GL_COLOR, 0, clearAccumulation);
+		glClearBufferfv(GL_COLOR, 1, clearRevealage);
+
+		// Tested against the opaque depth but never written, so transparent fragments do not hide each other
+		glDepthMask(GL_FALSE);
+
+		glEnable(GL_BLEND);
+		glBlendFunci(0, GL_ONE, GL_ONE);
+		glBlendFunci(1, GL_ZERO, GL_ONE_MINUS_SRC_COLOR);
+
+		for (int i = 0; i < packet.items.size(); i++) {
+			if (packet.items[i].isBlended) {
+				DrawGeometry(packet.items[i], packet);
+			}
+		}
+
+		glDepthMask(GL_TRUE);
+
+		// Resolve over the opaque scene
+
+		glBindFramebuffer(GL_FRAMEBUFFER, frameBuffer);
+
+		glDisable(GL_DEPTH_TEST);
+		glBlendFunc(GL_ONE_MINUS_SRC_ALPHA, GL_SRC_ALPHA);
+
+		GLuint program = transparencyMaterial->GetResource();
+		glUseProgram(program);
+
+		glUniform1i(glGetUniformLocation(program, "accumulation_map"), 0);
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D, accumulationTexture);
+
+		glUniform1i(glGetUniformLocation(program, "revealage_map"), 1);
+		glActiveTexture(GL_TEXTURE1);
+		glBindTexture(GL_TEXTURE_2D, revealageTexture);
+
+		post.DrawQuad(program);
+
+		glActiveTexture(GL_TEXTURE0);
+
+		glDisable(GL_BLEND);
+		glEnable(GL_DEPTH_TEST);
+	}
+
+	void SceneGraph::DrawGeometry(const DrawItem& item, const FramePacket& packet) {
+		DrawGeometry(item, packet, packet.viewMatrix, packet.projectionMatrix);
+	}
+
+	void SceneGraph::DrawGeometry(const DrawItem& item, const FramePacket& packet, const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix) {
+		GLuint program = item.material->GetResource();
+
+		// Select proper material (shader program)
+		glUseProgram(program);
+
+		// Set geometry to draw
+
+		glBindBuffer(GL_ARRAY_BUFFER, item.particles ? item.particles->GetArrayBuffer() : item.arrayBuffer);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, item.elementArrayBuffer);
+
+		// Set attributes for shaders from the layout of the geometry, particle state has no texture coordinates
+		item.layout->Bind(program);
+
+		// Globals for camera
+
+		GLint view = glGetUniformLocation(program, "view_mat");
+		glUniformMatrix4fv(view, 1, GL_FALSE, glm::value_ptr(viewMatrix));
+
+		GLint projection = glGetUniformLocation(program, "projection_mat");
+		glUniformMatrix4fv(projection, 1, GL_FALSE, glm::value_ptr(projectionMatrix));
+
+		// World matrix
+
+		GLint worldMatrix = glGetUniformLocation(program, "world_mat");
+		glUniformMatrix4fv(worldMatrix, 1, GL_FALSE, glm::value_ptr(item.worldMatrix));
+
+		// Normal matrix
+
+		GLint normalMatrix = glGetUniformLocation(program, "normal_mat");
+		glUniformMatrix4fv(normalMatrix, 1, GL_FALSE, glm::value_ptr(item.normalMatrix));
+
+		// Texture
+		if (item.texture) {
+			if (item.isSkybox) {
+				GLint texture = glGetUniformLocation(program, "skybox_map");
+
+				glDepthFunc(GL_LEQUAL);
+
+				glUniform1i(texture, 0); // Assign the first texture to the map
+				glActiveTexture(GL_TEXTURE0);
+				glBindTexture(GL_TEXTURE_CUBE_MAP, item.texture); // First texture we bind
+
+				// Define texture interpolation
+				glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
+
+				glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_LINEAR);
+				glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+				glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+				glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+				glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+			} else {
+				GLint texture = glGetUniformLocation(program, "texture_map");
+				glUniform1i(texture, 0); // Assign the first texture to the map
+				glActiveTexture(GL_TEXTURE0);
+				glBindTexture(GL_TEXTURE_2D, item.texture); // First texture we bind
+
+				// Define texture interpolation
+				glGenerateMipmap(GL_TEXTURE_2D);
+
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_LINEAR);
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+			}
+		}
+
+		// Normal map, its mipmaps are made when it is loaded
+		GLint normalMapUniform = glGetUniformLocation(program, "normal_map");
+
+		if (normalMapUniform >= 0) {
+			glUniform1i(normalMapUniform, NORMAL_MAP_TEXTURE_UNIT);
+			glActiveTexture(GL_TEXTURE0 + NORMAL_MAP_TEXTURE_UNIT);
+			glBindTexture(GL_TEXTURE_2D, item.normalMap ? item.normalMap : flatNormalMap);
+			glActiveTexture(GL_TEXTURE0);
+		}
+
+		// Timer
+
+		GLint timer = glGetUniformLocation(program, "timer");
+		glUniform1f(timer, packet.time);
+
+		// Fog
+
+		GLint fogColor = glGetUniformLocation(program, "fogColor");
+		glUniform3fv(fogColor, 1, glm::value_ptr(FOG_COLOR));
+
+		GLint fogDensity = glGetUniformLocation(program, "fogDensity");
+		glUniform1f(fogDensity, FOG_DENSITY);
+
+		GLint fogFactor = glGetUniformLocation(program, "fogFactor");
+		glUniform1f(fogFactor, FOG_FACTOR);
+
+		// Point lights of the cluster of each fragment
+
+		GLint lightDataUniform = glGetUniformLocation(program, "light_data");
+
+		if (lightDataUniform >= 0) {
+			const char* samplers[3] = { "light_data", "light_clusters", "light_indices" };
+
+			for (int i = 0; i < 3; i++) {
+				glUniform1i(glGetUniformLocation(program, samplers[i]), LIGHT_TEXTURE_UNIT + i);
+				glActiveTexture(GL_TEXTURE0 + LIGHT_TEXTURE_UNIT + i);
+				glBindTexture(GL_TEXTURE_BUFFER, lightTextures[i]);
+			}
+
+			glActiveTexture(GL_TEXTURE0);
+
+			const LightGrid& grid = packet.lights;
+
+			// Cluster of a fragment: its pixel over the tile size, and the log of its depth scaled to the slices
+			float sliceScale = LIGHT_CLUSTERS_Z / std::log(grid.farDepth / grid.nearDepth);
+
+			glUniform1i(glGetUniformLocation(program, "light_count"), (int)grid.lights.size() / 2);
+			glUniform3i(glGetUniformLocation(program, "light_grid"), LIGHT_CLUSTERS_X, LIGHT_CLUSTERS_Y, LIGHT_CLUSTERS_Z);
+			glUniform2f(glGetUniformLocation(program, "light_tile_scale"), (float)LIGHT_CLUSTERS_X / renderWidth, (float)LIGHT_CLUSTERS_Y / renderHeight);
+			glUniform2f(glGetUniformLocation(program, "light_slice"), sliceScale, -std::log(grid.nearDepth) * sliceScale);
+		}
+
+		// Shadows, the map is bound even when they are off since the sampler may not share a unit with texture_map
+
+		GLint shadowMapUniform = glGetUniformLocation(program, "shadow_map");
+
+		if (shadowMapUniform >= 0) {
+			const ShadowCascades& shadows = packet.shadows;
+
+			glUniform1i(shadowMapUniform, SHADOW_TEXTURE_UNIT);
+			glActiveTexture(GL_TEXTURE0 + SHADOW_TEXTURE_UNIT);
+			glBindTexture(GL_TEXTURE_2D_ARRAY, shadowMap.GetTexture());
+			glActiveTexture(GL_TEXTURE0);
+
+			glUniform1i(glGetUniformLocation(program, "shadow_cascades"), shadowMaterial ? shadows.count : 0);
+			glUniform3fv(glGetUniformLocation(program, "shadow_light"), 1, glm::value_ptr(shadows.lightDirection));
+
+			if (shadows.count > 0) {
+				glUniformMatrix4fv(glGetUniformLocation(program, "shadow_mats"), shadows.count, GL_FALSE, glm::value_ptr(shadows.matrices[0]));
+				glUniform1fv(glGetUniformLocation(program, "shadow_splits"), shadows.count, shadows.splits);
+				glUniform1fv(glGetUniformLocation(program, "shadow_texel_sizes"), shadows.count, shadows.texelSizes);
+			}
+		}
+
+		// Draw geometry
+		if (item.mode == GL_POINTS) {
+			glDrawArrays(item.mode, 0, item.size);
+		} else {
+			glDrawElementsBaseVertex(item.mode, item.size, GL_UNSIGNED_INT, (void*)(item.firstIndex * sizeof(GLuint)), item.baseVertex);
+		}
+	}
 }
\ No newline at end of file
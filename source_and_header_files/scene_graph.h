@@ -10,11 +10,14 @@
 #include "scene_node.h"
 #include "resource.h"
 #include "camera.h"
+#include "job_system.h"
+#include "frame_packet.h"
+#include "post_graph.h"
+#include "shadow_map.h"
+#include "light_clusters.h"
 
-// Size of the texture that we will draw
-
-#define FRAME_BUFFER_WIDTH 1920
-#define FRAME_BUFFER_HEIGHT 1080
+// Halvings of the render size in the blur chain of the screen space effects
+#define BLUR_LEVELS 5
 
 namespace Game {
 	class SceneGraph {
@@ -31,18 +34,59 @@ namespace Game {
 		SceneNode* CreateNode(std::string name, Resource* geometry, Resource* material, Resource* texture = NULL, bool isSkybox = false);
 		void AddNode(SceneNode* node);
 
-		void Draw(Camera* camera);
+		// Point lights, binned for the camera in Update. Returns the index of the light
+		int AddLight(const PointLight& light);
+		PointLight GetLight(int i) const;
+		void SetLight(int i, const PointLight& light);
+		int GetLightCount() const;
+
+		// Evaluate transforms and cull, the nodes are split over the jobs. Call before drawing
+		void Update(Camera* camera, JobSystem* jobs);
+
+		// Copy the camera matrices and the draw items of every node into the packet, after Update
+		void Collect(Camera* camera, FramePacket* packet);
+
+		// Directional light shadows: cascades fitted to the camera up to a distance, each of resolution texels
+		// square. Takes effect from the next Collect, 0 cascades turns shadows off
+		void SetShadows(int cascades, int resolution, float distance);
+		int GetShadowCascades() const;
+		int GetShadowResolution() const;
+
+		// Program drawing the depth of the shadow casters
+		void SetShadowMaterial(const Resource* material);
+
+		// Program resolving the transparent pass, looked up when drawing so it follows shader reloads
+		void SetTransparencyMaterial(const Resource* material);
+		// Programs of the downsampling and upsampling steps of the blur chain
+		void SetBlurMaterials(const Resource* downsample, const Resource* upsample);
+		// Programs of the bright pass and the upsampling step of the bloom, its downsampling step is the blur's
+		void SetBloomMaterials(const Resource* threshold, const Resource* upsample);
+
+		// Drawing, only on the thread that owns the GL context
+
+		// Draw the scene through the frame buffer of DrawToTexture, then copy it to the screen
+		void Draw(const FramePacket& packet);
 
 		// Screen space effects
 
-		// Setup the texture
-		void SetupDrawToTexture();
+		// Setup the texture, drawn at the given size
+		void SetupDrawToTexture(int width, int height);
+
+		// Reallocate the render targets when the size changed, only on the thread that owns the GL context
+		void SetRenderSize(int width, int height);
+		int GetRenderWidth() const;
+		int GetRenderHeight() const;
 
 		// Draw the scene into a texture
-		void DrawToTexture(Camera* camera);
+		void DrawToTexture(const FramePacket& packet);
+
+		// Process and draw the texture on the screen, filtered up or down to the viewport size.
+		// With blur levels the program also gets the scene blurred over that many halvings as blur_map.
+		// The texture is HDR, the program tone maps it and adds the bloom_map from tone_mapping.glsl
+		void DisplayTexture(GLuint program, float param = 0.0f, GLuint overlay = NULL, int blurLevels = 0);
 
-		// Process and draw the texture on the screen
-		void DisplayTexture(GLuint program, float param = 0.0f, GLuint overlay = NULL);
+		// GPU times of the screen passes of the last frames, with their budgets
+		void GetPostTimings(std::vector<PostTiming>& timings) const;
 
 	private:
 		glm::vec3 backgroundColor = glm::vec3(0.0f, 0.0f, 0.0f);
@@ -52,13 +96,82 @@ namespace Game {
 		// Frame buffer for drawing to texture
 		GLuint frameBuffer = 0;
 
-		// Quad vertex array for drawing from texture
-		GLuint quadArrayBuffer = 0;
+		// Passes drawing the texture on the screen, rebuilt every frame
+		PostGraph post;
 
-		// Render targets
+		// Render targets, the scene color is linear and goes above 1 for emissive materials
 
 		GLuint texture = 0;
 		GLuint depthBuffer = 0;
+
+		int renderWidth = 0;
+		int renderHeight = 0;
+
+		// Transparent pass, sharing the depth buffer of the scene
+
+		const Resource* transparencyMaterial = NULL;
+
+		GLuint transparencyFrameBuffer = 0;
+		GLuint accumulationTexture = 0;
+		GLuint revealageTexture = 0;
+
+		// Point lights, and their clusters from the last Update
+
+		std::vector<PointLight> lights;
+
+		LightClusters lightClusters;
+		LightGrid lightGrid;
+
+		// Texture buffers of the light grid, filled for each frame: light data, clusters and indices
+		GLuint lightBuffers[3];
+		GLuint lightTextures[3];
+
+		// Normal map of items that have none
+		GLuint flatNormalMap = 0;
+
+		// Shadows, fitted on the game thread and drawn on the render thread
+
+		int shadowCascades = 0;
+		int shadowResolution = 0;
+		float shadowDistance = 0.0f;
+
+		const Resource* shadowMaterial = NULL;
+
+		ShadowMap shadowMap;
+
+		// Blur chain: the scene is downsampled level by level, then upsampled back to half the render size
+
+		const Resource* blurDownMaterial = NULL;
+		const Resource* blurUpMaterial = NULL;
+
+		// Bloom: the parts of the scene above the threshold, downsampled to half and quarter size and
+		// upsampled back to half size, each level adding to the one above
+
+		const Resource* bloomThresholdMaterial = NULL;
+		const Resource* bloomUpMaterial = NULL;
+
+		// Add the blur passes of a texture the size of the scene, returns the blurred resource
+		int AddBlurPasses(int source, int levels);
+		// Add the bloom passes of the scene, returns the bloom resource
+		int AddBloomPasses(int source);
+		void AddBlurPass(const std::string name, GLuint program, int source, int sourceWidth, int sourceHeight, int target, float budget = 0.0f);
+
+		// Fill the light texture buffers from a packet
+		void UploadLights(const FramePacket& packet);
+
+		// Draw the shadow casters of a packet into every cascade
+		void DrawShadows(const FramePacket& packet);
+		// Draw the depth of a caster with the shadow program
+		void DrawShadowCaster(const DrawItem& item, GLuint program, const glm::mat4& shadowMatrix);
+
+		// Draw the opaque items of a packet with the current frame buffer, in order
+		void DrawItems(const FramePacket& packet);
+		// Draw the blended items without depth writes and resolve them over the scene frame buffer
+		void DrawTransparency(const FramePacket& packet);
+		// Set vertex attributes, transformation and other shader input variables, then draw
+		void DrawGeometry(const DrawItem& item, const FramePacket& packet);
+		// Same, seen through other view and projection matrices
+		void DrawGeometry(const DrawItem& item, const FramePacket& packet, const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix);
 	};
 }
 
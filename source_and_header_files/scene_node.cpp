@@ -6,10 +6,11 @@
 #include "scene_node.h"
 
 namespace Game {
-	const glm::vec3 FOG_COLOR(0.8f, 0.8f, 0.8f);
-
-	const float FOG_DENSITY = 0.02f;
-	const float FOG_FACTOR = 2.0f;
+	// Largest error of a level of detail, as a fraction of the screen height, about four pixels at 1080 lines
+	const float LOD_SCREEN_ERROR = 0.004f;
+	// A coarser level is only taken once its error is this far under the limit, so a node at the distance
+	// where two levels meet does not switch between them every frame
+	const float LOD_HYSTERESIS = 0.75f;
 
 	SceneNode::SceneNode(const std::string name, const Resource* geometry, const Resource* material, const Resource* texture, bool isSkybox) {
 		SceneNode::name = name;
@@ -19,6 +20,10 @@ namespace Game {
 		arrayBuffer = geometry->GetArrayBuffer();
 		elementArrayBuffer = geometry->GetElementArrayBuffer();
 		size = geometry->GetSize();
+		layout = geometry->GetLayout();
+		lods = geometry->GetLods();
+		lod = 0;
+		hasBounds = geometry->GetBounds(boundsMin, boundsMax);
 
 		// Set geometry
 		if (geometry->GetType() == ResourceType::PointSet) {
@@ -29,14 +34,51 @@ namespace Game {
 			throw(std::string("Invalid type of geometry"));
 		}
 
+		SetMaterial(material, texture);
+		normalMap = 0;
+
+		SceneNode::isSkybox = isSkybox;
+
+		scale = glm::vec3(1.0f, 1.0f, 1.0f);
+
+		worldMatrix = glm::mat4(1.0f);
+		normalMatrix = glm::mat4(1.0f);
+	}
+
+	SceneNode::SceneNode(const std::string name, GLenum mode, const Resource* material, const Resource* texture) {
+		SceneNode::name = name;
+
+		parent = NULL;
+
+		arrayBuffer = 0;
+		elementArrayBuffer = 0;
+		size = 0;
+		layout = VertexLayout::GetFloats(11);
+		lod = 0;
+		hasBounds = false;
+		SceneNode::mode = mode;
+
+		SetMaterial(material, texture);
+		normalMap = 0;
+
+		isSkybox = false;
+
+		scale = glm::vec3(1.0f, 1.0f, 1.0f);
+
+		worldMatrix = glm::mat4(1.0f);
+		normalMatrix = glm::mat4(1.0f);
+	}
+
+	SceneNode::~SceneNode() {}
+
+	void SceneNode::SetMaterial(const Resource* material, const Resource* texture) {
 		// Set material (shader program)
 		if (material->GetType() != ResourceType::Material) {
 			throw(std::string("Invalid type of material"));
 		}
 
-		SceneNode::material = material->GetResource();
-
-		SceneNode::isSkybox = isSkybox;
+		// Keep the resource so reloaded programs are picked up
+		SceneNode::material = material;
 
 		// Set texture
 		if (texture) {
@@ -44,11 +86,11 @@ namespace Game {
 		} else {
 			SceneNode::texture = 0;
 		}
-
-		scale = glm::vec3(1.0f, 1.0f, 1.0f);
 	}
 
-	SceneNode::~SceneNode() {}
+	void SceneNode::SetNormalMap(const Resource* normalMap) {
+		SceneNode::normalMap = normalMap ? normalMap->GetResource() : 0;
+	}
 
 	const std::string SceneNode::GetName() const {
 		return name;
@@ -91,7 +133,7 @@ namespace Game {
 	}
 
 	GLuint SceneNode::GetMaterial() const {
-		return material;
+		return material->GetResource();
 	}
 
 	glm::mat4 SceneNode::GetTransform(bool useScale = false) {
@@ -174,126 +216,134 @@ namespace Game {
 		SceneNode::scale *= scale;
 	}
 
-	void SceneNode::Draw(Camera* camera) {
-		// Select proper material (shader program)
-		glUseProgram(material);
-
-		// Set geometry to draw
-
-		glBindBuffer(GL_ARRAY_BUFFER, arrayBuffer);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, elementArrayBuffer);
+	void SceneNode::Update(Camera* camera) {
+		worldMatrix = GetTransform(true);
+		normalMatrix = glm::transpose(glm::inverse(worldMatrix));
 
-		// Set globals for camera
-		camera->SetupShader(material);
+		if (hasBounds) {
+			// Box around the transformed one: the center moves with the matrix, each of its axes adds to the
+			// half size as much as it reaches along the world axes
+			glm::vec3 center = glm::vec3(worldMatrix * glm::vec4((boundsMin + boundsMax) * 0.5f, 1.0f));
+			glm::vec3 half = (boundsMax - boundsMin) * 0.5f;
+			glm::vec3 extent = glm::abs(glm::vec3(worldMatrix[0])) * half.x + glm::abs(glm::vec3(worldMatrix[1])) * half.y + glm::abs(glm::vec3(worldMatrix[2])) * half.z;
 
-		// Set world matrix and other shader input variables
-		SetupShader(material);
-
-		// Draw geometry
-		if (mode == GL_POINTS) {
-			if (name != "Maze") {
-				glEnable(GL_BLEND);
-				glBlendFunc(GL_SRC_ALPHA, GL_ONE);
-			}
-
-			glDrawArrays(mode, 0, size);
-
-			glDisable(GL_BLEND);
-		} else {
-			glDrawElements(mode, size, GL_UNSIGNED_INT, 0);
+			worldMin = center - extent;
+			worldMax = center + extent;
 		}
 
-		// Draw children
+		SelectLod(camera);
+
 		for (int i = 0; i < children.size(); i++) {
-			children[i]->Draw(camera);
+			children[i]->Update(camera);
 		}
 	}
 
-	void SceneNode::SetupShader(GLuint program) {
-		// Set attributes for shaders
-
-		GLint vertexAttribute = glGetAttribLocation(program, "vertex");
-		glVertexAttribPointer(vertexAttribute, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(GLfloat), 0);
-		glEnableVertexAttribArray(vertexAttribute);
+	void SceneNode::SelectLod(Camera* camera) {
+		if (lods.size() < 2) {
+			return;
+		}
 
-		GLint normalAttribute = glGetAttribLocation(program, "normal");
-		glVertexAttribPointer(normalAttribute, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(GLfloat), (void*)(3 * sizeof(GLfloat)));
-		glEnableVertexAttribArray(normalAttribute);
+		// Errors are in model space, the largest scale of the node brings them to the world
+		float scale = glm::max(glm::length(glm::vec3(worldMatrix[0])), glm::max(glm::length(glm::vec3(worldMatrix[1])), glm::length(glm::vec3(worldMatrix[2]))));
+		float distance = glm::max(glm::length(camera->GetPosition() - glm::vec3(worldMatrix[3])), 1e-3f);
 
-		GLint colorAttribute = glGetAttribLocation(program, "color");
-		glVertexAttribPointer(colorAttribute, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(GLfloat), (void*)(6 * sizeof(GLfloat)));
-		glEnableVertexAttribArray(colorAttribute);
+		// Share of the screen height taken by a world unit at that distance
+		float projection = camera->GetProjectionMatrix()[1][1] / (2.0f * distance) * scale;
 
-		GLint textureAttribute = glGetAttribLocation(program, "uv");
-		glVertexAttribPointer(textureAttribute, 2, GL_FLOAT, GL_FALSE, 11 * sizeof(GLfloat), (void*)(9 * sizeof(GLfloat)));
-		glEnableVertexAttribArray(textureAttribute);
+		while (lod + 1 < lods.size() && lods[lod + 1].error * projection < LOD_SCREEN_ERROR * LOD_HYSTERESIS) {
+			lod++;
+		}
 
-		// World transformation
-		glm::mat4 transform = GetTransform(true);
+		while (lod > 0 && lods[lod].error * projection > LOD_SCREEN_ERROR) {
+			lod--;
+		}
+	}
 
-		// World matrix
+	void SceneNode::Collect(FramePacket* packet) {
+		DrawItem item = GetDrawItem();
 
-		GLint worldMatrix = glGetUniformLocation(program, "world_mat");
-		glUniformMatrix4fv(worldMatrix, 1, GL_FALSE, glm::value_ptr(transform));
+		item.arrayBuffer = arrayBuffer;
+		item.elementArrayBuffer = elementArrayBuffer;
+		item.size = size;
 
-		// Normal matrix
+		if (lods.size() > 0) {
+			item.firstIndex = lods[lod].first;
+			item.size = lods[lod].count;
+		}
 
-		glm::mat4 normalMatrix = glm::transpose(glm::inverse(transform));
-		GLint normalMatrixLocation = glGetUniformLocation(program, "normal_mat");
-		glUniformMatrix4fv(normalMatrixLocation, 1, GL_FALSE, glm::value_ptr(normalMatrix));
+		// Particles are blended, the maze is also a point set but opaque
+		item.isBlended = mode == GL_POINTS && name != "Maze";
 
-		// Texture
-		if (texture) {
-			if (isSkybox) {
-				glm::mat4 modelMatrix = glm::mat4();
+		packet->items.push_back(item);
 
-				GLint texture = glGetUniformLocation(program, "skybox_map");
+		// Draw children
+		for (int i = 0; i < children.size(); i++) {
+			children[i]->Collect(packet);
+		}
+	}
 
-				glDepthFunc(GL_LEQUAL);
+	void SceneNode::CollectShadows(FramePacket* packet) {
+		// Particles are too thin to cast a shadow, the maze is drawn with its own program into the map
+		if (!isSkybox && (mode != GL_POINTS || name == "Maze")) {
+			DrawItem item = GetDrawItem();
 
-				glUniform1i(texture, 0); // Assign the first texture to the map
-				glActiveTexture(GL_TEXTURE0);
-				glBindTexture(GL_TEXTURE_CUBE_MAP, SceneNode::texture); // First texture we bind
+			item.arrayBuffer = arrayBuffer;
+			item.elementArrayBuffer = elementArrayBuffer;
+			item.size = size;
 
-				// Define texture interpolation
-				glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
+			if (lods.size() > 0) {
+				item.firstIndex = lods[lod].first;
+				item.size = lods[lod].count;
+			}
 
-				glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_LINEAR);
-				glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-				glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-				glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-				glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+			// Only into the cascades the node reaches, every one when its bounds are not known
+			if (hasBounds) {
+				for (int i = 0; i < packet->shadows.count; i++) {
+					if (packet->shadows.frusta[i].IsBoxVisible(worldMin, worldMax)) {
+						item.shadowCascades |= 1 << i;
+					}
+				}
 			} else {
-				GLint texture = glGetUniformLocation(program, "texture_map");
-				glUniform1i(texture, 0); // Assign the first texture to the map
-				glActiveTexture(GL_TEXTURE0);
-				glBindTexture(GL_TEXTURE_2D, SceneNode::texture); // First texture we bind
-
-				// Define texture interpolation
-				glGenerateMipmap(GL_TEXTURE_2D);
-
-				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_LINEAR);
-				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+				item.shadowCascades = (1 << packet->shadows.count) - 1;
+			}
+
+			if (item.shadowCascades != 0) {
+				packet->shadowItems.push_back(item);
 			}
 		}
 
-		// Timer
+		for (int i = 0; i < children.size(); i++) {
+			children[i]->CollectShadows(packet);
+		}
+	}
+
+	DrawItem SceneNode::GetDrawItem() const {
+		DrawItem item;
+
+		item.arrayBuffer = 0;
+		item.elementArrayBuffer = 0;
+		item.size = 0;
+		item.firstIndex = 0;
+		item.fullSize = size;
+		item.baseVertex = 0;
+		item.mode = mode;
+		item.layout = layout;
+
+		item.particles = NULL;
 
-		GLint timer = glGetUniformLocation(program, "timer");
-		double currentTime = glfwGetTime();
-		glUniform1f(timer, (float)currentTime);
+		item.material = material;
+		item.texture = texture;
+		item.normalMap = normalMap;
 
-		// Fog
+		item.isSkybox = isSkybox;
+		item.isBlended = false;
 
-		GLint fogColor = glGetUniformLocation(program, "fogColor");
-		glUniform3fv(fogColor, 1, glm::value_ptr(FOG_COLOR));
+		item.shadowCascades = 0;
 
-		GLint fogDensity = glGetUniformLocation(program, "fogDensity");
-		glUniform1f(fogDensity, FOG_DENSITY);
+		// Positions stored relative to the bounds of the mesh are scaled back first
+		item.worldMatrix = worldMatrix * layout->GetPositionDecode();
+		item.normalMatrix = normalMatrix;
 
-		GLint fogFactor = glGetUniformLocation(program, "fogFactor");
-		glUniform1f(fogFactor, FOG_FACTOR);
+		return item;
 	}
-}
\ No newline at end of file
+}
@@ -11,6 +11,7 @@
 #include <glm/gtc/quaternion.hpp>
 #include "resource.h"
 #include "camera.h"
+#include "frame_packet.h"
 #include <vector>
 
 namespace Game {
@@ -38,6 +39,11 @@ namespace Game {
 		GLsizei GetSize() const;
 		GLenum GetMode() const;
 		GLuint GetMaterial() const;
+
+		// Tangent space normals to bend the lighting with, for materials compiled with NORMAL_MAP and geometry
+		// with tangents
+		void SetNormalMap(const Resource* normalMap);
+
 		virtual glm::mat4 GetTransform(bool useScale);
 
 		glm::vec3 GetPosition() const;
@@ -52,7 +58,21 @@ namespace Game {
 		void Rotate(glm::quat rotation);
 		void Scale(glm::vec3 scale);
 
-		virtual void Draw(Camera* camera);
+		// Evaluate the transforms used for drawing this node and its children, may run on any thread
+		virtual void Update(Camera* camera);
+
+		// Add what to draw for this node and its children to the frame, after Update
+		virtual void Collect(FramePacket* packet);
+
+		// Add the shadow casters of this node and its children to the frame, into the cascades of the packet
+		virtual void CollectShadows(FramePacket* packet);
+
+	protected:
+		// Used by nodes that manage their own geometry, drawn with the given primitive mode
+		SceneNode(const std::string name, GLenum mode, const Resource* material, const Resource* texture);
+
+		// Draw item with the material, texture and transforms of the node, but no geometry
+		DrawItem GetDrawItem() const;
 
 	private:
 		std::string name;
@@ -65,9 +85,15 @@ namespace Game {
 		GLuint arrayBuffer;
 		GLuint elementArrayBuffer;
 		GLsizei size;
+		const VertexLayout* layout;
+
+		// Index ranges of the geometry for each level of detail, and the one picked by the last Update
+		std::vector<MeshLod> lods;
+		int lod;
 		GLenum mode;
-		GLuint material;
+		const Resource* material;
 		GLuint texture;
+		GLuint normalMap;
 
 		bool isSkybox;
 
@@ -75,7 +101,22 @@ namespace Game {
 		glm::quat orientation;
 		glm::vec3 scale;
 
-		void SetupShader(GLuint program);
+		// World and normal matrices from the last Update
+		glm::mat4 worldMatrix;
+		glm::mat4 normalMatrix;
+
+		// Box around the geometry in model space when it is known, and around the node in the world from the
+		// last Update
+		bool hasBounds;
+		glm::vec3 boundsMin;
+		glm::vec3 boundsMax;
+		glm::vec3 worldMin;
+		glm::vec3 worldMax;
+
+		void SetMaterial(const Resource* material, const Resource* texture);
+
+		// Pick the coarsest level of detail whose error stays under a fraction of the screen
+		void SelectLod(Camera* camera);
 	};
 }
 
@@ -0,0 +1,166 @@
+#include <iostream>
+#include "shader_watcher.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#endif
+
+namespace Game {
+	// How long the watcher thread sleeps before checking if it should stop
+	const int WATCH_TIMEOUT_MS = 250;
+
+	ShaderWatcher::ShaderWatcher() {
+		running = false;
+	}
+
+	ShaderWatcher::~ShaderWatcher() {
+		Stop();
+	}
+
+	void ShaderWatcher::Start(const std::string directory) {
+		Stop();
+
+		ShaderWatcher::directory = directory;
+
+#ifdef _WIN32
+		HANDLE handle = CreateFileA(directory.c_str(), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, NULL);
+
+		if (handle == INVALID_HANDLE_VALUE) {
+			throw(std::string("Could not watch directory ") + directory);
+		}
+
+		directoryHandle = handle;
+#else
+		watchDescriptor = inotify_init1(IN_NONBLOCK);
+
+		if (watchDescriptor < 0) {
+			throw(std::string("Could not watch directory ") + directory);
+		}
+
+		if (inotify_add_watch(watchDescriptor, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+			close(watchDescriptor);
+			watchDescriptor = -1;
+
+			throw(std::string("Could not watch directory ") + directory);
+		}
+#endif
+
+		running = true;
+		thread = std::thread(&ShaderWatcher::Run, this);
+	}
+
+	void ShaderWatcher::Stop() {
+		if (!running) {
+			return;
+		}
+
+		running = false;
+		thread.join();
+
+#ifdef _WIN32
+		CloseHandle((HANDLE)directoryHandle);
+		directoryHandle = NULL;
+#else
+		close(watchDescriptor);
+		watchDescriptor = -1;
+#endif
+	}
+
+	std::vector<std::string> ShaderWatcher::GetChangedFiles() {
+		std::lock_guard<std::mutex> lock(mutex);
+
+		std::vector<std::string> files;
+		files.swap(changedFiles);
+
+		return files;
+	}
+
+	void ShaderWatcher::AddChangedFile(const std::string filename) {
+		std::lock_guard<std::mutex> lock(mutex);
+
+		// Editors often save in several steps, only report each file once
+		for (int i = 0; i < changedFiles.size(); i++) {
+			if (changedFiles[i] == filename) {
+				return;
+			}
+		}
+
+		changedFiles.push_back(filename);
+	}
+
+	void ShaderWatcher::Run() {
+#ifdef _WIN32
+		DWORD buffer[4096];
+		OVERLAPPED overlapped = {};
+		overlapped.hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+
+		while (running) {
+			DWORD bytes = 0;
+
+			if (!ReadDirectoryChangesW((HANDLE)directoryHandle, buffer, sizeof(buffer), FALSE, FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME, NULL, &overlapped, NULL)) {
+				std::cerr << "Error watching directory " << directory << std::endl;
+				break;
+			}
+
+			// Wait for a change while still checking if the watcher was stopped
+			while (running && WaitForSingleObject(overlapped.hEvent, WATCH_TIMEOUT_MS) == WAIT_TIMEOUT);
+
+			if (!running) {
+				CancelIo((HANDLE)directoryHandle);
+				break;
+			}
+
+			GetOverlappedResult((HANDLE)directoryHandle, &overlapped, &bytes, FALSE);
+			ResetEvent(overlapped.hEvent);
+
+			if (bytes == 0) {
+				continue;
+			}
+
+			// Go through all the notifications in the buffer
+			FILE_NOTIFY_INFORMATION* info = (FILE_NOTIFY_INFORMATION*)buffer;
+
+			while (true) {
+				std::wstring name(info->FileName, info->FileNameLength / sizeof(WCHAR));
+				AddChangedFile(std::string(name.begin(), name.end()));
+
+				if (info->NextEntryOffset == 0) {
+					break;
+				}
+
+				info = (FILE_NOTIFY_INFORMATION*)((char*)info + info->NextEntryOffset);
+			}
+		}
+
+		CloseHandle(overlapped.hEvent);
+#else
+		char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+
+		while (running) {
+			// Wait for a change while still checking if the watcher was stopped
+			pollfd descriptor = { watchDescriptor, POLLIN, 0 };
+
+			if (poll(&descriptor, 1, WATCH_TIMEOUT_MS) <= 0) {
+				continue;
+			}
+
+			ssize_t length = read(watchDescriptor, buffer, sizeof(buffer));
+
+			// Go through all the events in the buffer
+			for (char* event = buffer; event < buffer + length; ) {
+				inotify_event* info = (inotify_event*)event;
+
+				if (info->len > 0) {
+					AddChangedFile(std::string(info->name));
+				}
+
+				event += sizeof(inotify_event) + info->len;
+			}
+		}
+#endif
+	}
+}
@@ -0,0 +1,45 @@
+#ifndef SHADER_WATCHER_H_
+#define SHADER_WATCHER_H_
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+
+namespace Game {
+	// Watches a directory on a background thread and records which files were modified
+	// Uses inotify on Linux and ReadDirectoryChangesW on Windows
+	class ShaderWatcher {
+
+	public:
+		ShaderWatcher();
+		~ShaderWatcher();
+
+		// Start watching the directory
+		void Start(const std::string directory);
+		void Stop();
+
+		// Returns the names of the files modified since the last call (without the directory)
+		std::vector<std::string> GetChangedFiles();
+
+	private:
+		std::string directory;
+
+		std::thread thread;
+		std::atomic<bool> running;
+
+		// Files changed since the last call to GetChangedFiles
+		std::mutex mutex;
+		std::vector<std::string> changedFiles;
+
+		// Platform specific handle to the watch
+		int watchDescriptor = -1;
+		void* directoryHandle = NULL;
+
+		void Run();
+		void AddChangedFile(const std::string filename);
+	};
+}
+
+#endif
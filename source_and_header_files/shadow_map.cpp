@@ -0,0 +1,182 @@
+#define GLM_FORCE_RADIANS
+
+#include <string>
+#include <glm/gtc/matrix_transform.hpp>
+#include "shadow_map.h"
+
+namespace Game {
+	// Blend of the logarithmic split depths into the uniform ones, 1 for logarithmic only
+	const float SPLIT_LAMBDA = 0.75f;
+	// Depth the logarithmic splits start from, the camera near plane is too close to give useful splits
+	const float SPLIT_START = 1.0f;
+
+	// Distance behind a cascade that still casts shadows into it, toward the light
+	const float CASTER_DISTANCE = 50.0f;
+
+	ShadowCascades::ShadowCascades() {
+		count = 0;
+		resolution = 0;
+		lightDirection = glm::vec3(0.0f, 1.0f, 0.0f);
+
+		for (int i = 0; i < SHADOW_MAX_CASCADES; i++) {
+			matrices[i] = glm::mat4(1.0f);
+			splits[i] = 0.0f;
+			texelSizes[i] = 0.0f;
+		}
+	}
+
+	void ShadowCascades::Fit(const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix, glm::vec3 lightDirection, float distance, int count, int resolution) {
+		ShadowCascades::count = glm::clamp(count, 0, SHADOW_MAX_CASCADES);
+		ShadowCascades::resolution = glm::max(resolution, 1);
+		ShadowCascades::lightDirection = glm::normalize(lightDirection);
+
+		if (ShadowCascades::count == 0) {
+			return;
+		}
+
+		// Planes and half extents at depth 1 of the camera frustum, from its perspective projection
+
+		float nearPlane = projectionMatrix[3][2] / (projectionMatrix[2][2] - 1.0f);
+		float farPlane = projectionMatrix[3][2] / (projectionMatrix[2][2] + 1.0f);
+
+		float tanX = 1.0f / projectionMatrix[0][0];
+		float tanY = 1.0f / projectionMatrix[1][1];
+
+		farPlane = glm::min(farPlane, distance);
+
+		glm::mat4 inverseView = glm::inverse(viewMatrix);
+
+		glm::vec3 direction = ShadowCascades::lightDirection;
+		glm::vec3 up = glm::abs(direction.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+
+		float logStart = glm::max(nearPlane, SPLIT_START);
+		float start = nearPlane;
+
+		for (int i = 0; i < ShadowCascades::count; i++) {
+			// Practical split scheme: logarithmic splits match the texel density to the perspective,
+			// the uniform share keeps the far cascades from getting too long
+
+			float fraction = (i + 1) / (float)ShadowCascades::count;
+
+			float logarithmic = logStart * glm::pow(farPlane / logStart, fraction);
+			float uniform = nearPlane + (farPlane - nearPlane) * fraction;
+
+			float end = glm::mix(uniform, logarithmic, SPLIT_LAMBDA);
+
+			// Bounding sphere of the slice, in view space. The slice has the same shape wherever the camera
+			// looks, so the sphere and the texel size stay the same
+
+			glm::vec3 corners[8];
+
+			for (int j = 0; j < 8; j++) {
+				float depth = j < 4 ? start : end;
+
+				corners[j] = glm::vec3((j & 1 ? tanX : -tanX) * depth, (j & 2 ? tanY : -tanY) * depth, -depth);
+			}
+
+			glm::vec3 center(0.0f);
+
+			for (int j = 0; j < 8; j++) {
+				center += corners[j] / 8.0f;
+			}
+
+			float radius = 0.0f;
+
+			for (int j = 0; j < 8; j++) {
+				radius = glm::max(radius, glm::length(corners[j] - center));
+			}
+
+			// Rounded up so float error does not make it flicker
+			radius = glm::ceil(radius * 16.0f) / 16.0f;
+
+			center = glm::vec3(inverseView * glm::vec4(center, 1.0f));
+
+			// Orthographic light volume around the sphere, reaching back toward the light for casters outside it
+
+			glm::mat4 lightView = glm::lookAt(center + direction * (radius + CASTER_DISTANCE), center, up);
+			glm::mat4 lightProjection = glm::ortho(-radius, radius, -radius, radius, 0.0f, 2.0f * radius + CASTER_DISTANCE);
+
+			// Snap: move the volume so the world origin lands on a texel corner, then every point of the world
+			// falls on the same place of a texel whatever the camera position
+
+			glm::vec4 origin = lightProjection * lightView * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+			glm::vec2 texels = glm::vec2(origin) * (ShadowCascades::resolution / 2.0f);
+			glm::vec2 offset = (glm::round(texels) - texels) * (2.0f / ShadowCascades::resolution);
+
+			lightProjection[3][0] += offset.x;
+			lightProjection[3][1] += offset.y;
+
+			matrices[i] = lightProjection * lightView;
+			frusta[i] = Frustum(matrices[i]);
+
+			splits[i] = end;
+			texelSizes[i] = 2.0f * radius / ShadowCascades::resolution;
+
+			start = end;
+		}
+	}
+
+	ShadowMap::ShadowMap() {}
+
+	ShadowMap::~ShadowMap() {}
+
+	void ShadowMap::Setup() {
+		glGenFramebuffers(1, &frameBuffer);
+
+		glGenTextures(1, &texture);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+
+		// Linear filtering of a comparison averages the four nearest results, the cheapest smoothing of the edges
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+
+		// Lit outside the map
+		const GLfloat border[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+		glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, border);
+
+		glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+		// A texture to bind while shadows are off, so the samplers always have one
+		SetSize(1, 1);
+	}
+
+	void ShadowMap::SetSize(int resolution, int cascades) {
+		resolution = glm::max(resolution, 1);
+		cascades = glm::clamp(cascades, 1, SHADOW_MAX_CASCADES);
+
+		if (resolution == ShadowMap::resolution && cascades == layers) {
+			return;
+		}
+
+		ShadowMap::resolution = resolution;
+		layers = cascades;
+
+		glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+		glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT24, resolution, resolution, layers, 0, GL_DEPTH_COMPONENT, GL_FLOAT, 0);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+	}
+
+	void ShadowMap::BindCascade(int cascade) {
+		glBindFramebuffer(GL_FRAMEBUFFER, frameBuffer);
+		glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, texture, 0, cascade);
+
+		// Depth only
+		glDrawBuffer(GL_NONE);
+		glReadBuffer(GL_NONE);
+
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+			throw(std::string("Error setting up shadow frame buffer"));
+		}
+
+		glViewport(0, 0, resolution, resolution);
+		glClear(GL_DEPTH_BUFFER_BIT);
+	}
+
+	GLuint ShadowMap::GetTexture() const {
+		return texture;
+	}
+}
@@ -0,0 +1,67 @@
+#ifndef SHADOW_MAP_H_
+#define SHADOW_MAP_H_
+
+#define GLEW_STATIC
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include "camera.h"
+
+// Most cascades a frame can have, shadows.glsl has room for as many
+#define SHADOW_MAX_CASCADES 4
+
+namespace Game {
+	// Cascades of a directional light for one frame: the camera frustum up to the shadow distance is cut into
+	// slices along the view depth, each covered by its own layer of the shadow map
+	struct ShadowCascades {
+		int count;
+		int resolution;
+
+		// Toward the light, in world space
+		glm::vec3 lightDirection;
+
+		// World to light clip space of each cascade, and the frustum its casters are culled against
+		glm::mat4 matrices[SHADOW_MAX_CASCADES];
+		Frustum frusta[SHADOW_MAX_CASCADES];
+
+		// View depth each cascade ends at
+		float splits[SHADOW_MAX_CASCADES];
+		// World size of a shadow map texel, for offsetting the lookups off the surface
+		float texelSizes[SHADOW_MAX_CASCADES];
+
+		ShadowCascades();
+
+		// Fit count cascades of resolution texels to the camera, none for 0. Each slice is bound by a sphere so
+		// the cascade keeps its size as the camera turns, and moves in whole texels so the edges do not shimmer
+		void Fit(const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix, glm::vec3 lightDirection, float distance, int count, int resolution);
+	};
+
+	// Depth texture with a layer per cascade, and the frame buffer drawing into one layer at a time
+	class ShadowMap {
+
+	public:
+		ShadowMap();
+		~ShadowMap();
+
+		// Create the texture and frame buffer, needs a GL context
+		void Setup();
+
+		// Reallocate the texture when the resolution or the cascade count changed
+		void SetSize(int resolution, int cascades);
+
+		// Draw into the layer of a cascade, cleared, with a viewport covering it
+		void BindCascade(int cascade);
+
+		// Array texture comparing depths when sampled, lit (1) outside the cascades
+		GLuint GetTexture() const;
+
+	private:
+		GLuint frameBuffer = 0;
+		GLuint texture = 0;
+
+		int resolution = 0;
+		int layers = 0;
+	};
+}
+
+#endif
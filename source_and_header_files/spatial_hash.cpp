@@ -0,0 +1,317 @@
+#include <stdexcept>
+#include <string>
+#include <algorithm>
+#include "spatial_hash.h"
+
+namespace Game {
+	SpatialHash::SpatialHash(float cellSize) {
+		SpatialHash::cellSize = cellSize;
+	}
+
+	SpatialHash::~SpatialHash() {}
+
+	int SpatialHash::AddCircle(glm::vec2 center, float radius, bool isDynamic) {
+		Collider collider;
+
+		collider.isCircle = true;
+		collider.isDynamic = isDynamic;
+		collider.isActive = true;
+		collider.center = center;
+		collider.halfExtents = glm::vec2(radius, radius);
+
+		colliders.push_back(collider);
+
+		int id = colliders.size() - 1;
+
+		if (isDynamic) {
+			Move(id, center);
+		}
+
+		return id;
+	}
+
+	int SpatialHash::AddBox(glm::vec2 center, glm::vec2 halfExtents, bool isDynamic) {
+		Collider collider;
+
+		collider.isCircle = false;
+		collider.isDynamic = isDynamic;
+		collider.isActive = true;
+		collider.center = center;
+		collider.halfExtents = halfExtents;
+
+		colliders.push_back(collider);
+
+		int id = colliders.size() - 1;
+
+		if (isDynamic) {
+			Move(id, center);
+		}
+
+		return id;
+	}
+
+	void SpatialHash::Move(int id, glm::vec2 center) {
+		Collider& collider = colliders[id];
+
+		if (!collider.isDynamic) {
+			throw(std::string("Spatial hash error: cannot move a static collider"));
+		}
+
+		glm::ivec2 first, last;
+
+		// Take the collider out of its old cells, a new collider is not in any yet
+		if (collider.isActive) {
+			GetCells(collider, first, last);
+
+			for (int y = first.y; y <= last.y; y++) {
+				for (int x = first.x; x <= last.x; x++) {
+					std::vector<int>& cell = dynamicCells[Hash(x, y) % SPATIAL_HASH_DYNAMIC_BUCKETS];
+
+					std::vector<int>::iterator it = std::find(cell.begin(), cell.end(), id);
+
+					if (it != cell.end()) {
+						*it = cell.back();
+						cell.pop_back();
+					}
+				}
+			}
+		}
+
+		collider.center = center;
+		collider.isActive = true;
+
+		GetCells(collider, first, last);
+
+		for (int y = first.y; y <= last.y; y++) {
+			for (int x = first.x; x <= last.x; x++) {
+				std::vector<int>& cell = dynamicCells[Hash(x, y) % SPATIAL_HASH_DYNAMIC_BUCKETS];
+
+				// Cells sharing a bucket would add the collider twice
+				if (std::find(cell.begin(), cell.end(), id) == cell.end()) {
+					cell.push_back(id);
+				}
+			}
+		}
+	}
+
+	void SpatialHash::Remove(int id) {
+		Collider& collider = colliders[id];
+
+		if (collider.isDynamic) {
+			for (int i = 0; i < SPATIAL_HASH_DYNAMIC_BUCKETS; i++) {
+				dynamicCells[i].erase(std::remove(dynamicCells[i].begin(), dynamicCells[i].end(), id), dynamicCells[i].end());
+			}
+		}
+
+		// Static colliders stay in the grid but are skipped
+		collider.isActive = false;
+	}
+
+	void SpatialHash::Build() {
+		// About two buckets per occupied cell, as a power of two
+		int cells = 0;
+
+		for (int i = 0; i < colliders.size(); i++) {
+			if (!colliders[i].isDynamic) {
+				glm::ivec2 first, last;
+				GetCells(colliders[i], first, last);
+
+				cells += (last.x - first.x + 1) * (last.y - first.y + 1);
+			}
+		}
+
+		staticBuckets = 1;
+
+		while (staticBuckets < cells * 2) {
+			staticBuckets *= 2;
+		}
+
+		// Count, prefix sum, then fill
+
+		staticOffsets.assign(staticBuckets + 1, 0);
+		staticIds.resize(cells);
+
+		for (int pass = 0; pass < 2; pass++) {
+			std::vector<int> cursor;
+
+			if (pass == 1) {
+				for (int b = 0; b < staticBuckets; b++) {
+					staticOffsets[b + 1] += staticOffsets[b];
+				}
+
+				cursor.assign(staticOffsets.begin(), staticOffsets.end() - 1);
+			}
+
+			for (int i = 0; i < colliders.size(); i++) {
+				if (colliders[i].isDynamic) {
+					continue;
+				}
+
+				glm::ivec2 first, last;
+				GetCells(colliders[i], first, last);
+
+				for (int y = first.y; y <= last.y; y++) {
+					for (int x = first.x; x <= last.x; x++) {
+						unsigned int b = Hash(x, y) & (staticBuckets - 1);
+
+						if (pass == 0) {
+							staticOffsets[b + 1]++;
+						} else {
+							staticIds[cursor[b]++] = i;
+						}
+					}
+				}
+			}
+		}
+	}
+
+	void SpatialHash::Clear() {
+		colliders.clear();
+		staticOffsets.clear();
+		staticIds.clear();
+		staticBuckets = 0;
+
+		for (int i = 0; i < SPATIAL_HASH_DYNAMIC_BUCKETS; i++) {
+			dynamicCells[i].clear();
+		}
+	}
+
+	const SpatialHash::Collider& SpatialHash::GetCollider(int id) const {
+		return colliders[id];
+	}
+
+	int SpatialHash::GetColliderCount() const {
+		return colliders.size();
+	}
+
+	bool SpatialHash::Overlaps(glm::vec2 point) const {
+		glm::ivec2 cell = GetCell(point);
+
+		unsigned int hash = Hash(cell.x, cell.y);
+
+		// A point only needs its own cell, colliders are stored in every cell they touch
+		if (staticBuckets) {
+			unsigned int b = hash & (staticBuckets - 1);
+
+			for (int i = staticOffsets[b]; i < staticOffsets[b + 1]; i++) {
+				const Collider& collider = colliders[staticIds[i]];
+
+				if (collider.isActive && Contains(collider, point)) {
+					return true;
+				}
+			}
+		}
+
+		const std::vector<int>& dynamic = dynamicCells[hash % SPATIAL_HASH_DYNAMIC_BUCKETS];
+
+		for (int i = 0; i < dynamic.size(); i++) {
+			if (Contains(colliders[dynamic[i]], point)) {
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	bool SpatialHash::Overlaps(glm::vec2 center, float radius) const {
+		glm::ivec2 first = GetCell(center - radius);
+		glm::ivec2 last = GetCell(center + radius);
+
+		for (int y = first.y; y <= last.y; y++) {
+			for (int x = first.x; x <= last.x; x++) {
+				unsigned int hash = Hash(x, y);
+
+				if (staticBuckets) {
+					unsigned int b = hash & (staticBuckets - 1);
+
+					for (int i = staticOffsets[b]; i < staticOffsets[b + 1]; i++) {
+						const Collider& collider = colliders[staticIds[i]];
+
+						if (collider.isActive && Intersects(collider, center, radius)) {
+							return true;
+						}
+					}
+				}
+
+				const std::vector<int>& dynamic = dynamicCells[hash % SPATIAL_HASH_DYNAMIC_BUCKETS];
+
+				for (int i = 0; i < dynamic.size(); i++) {
+					if (Intersects(colliders[dynamic[i]], center, radius)) {
+						return true;
+					}
+				}
+			}
+		}
+
+		return false;
+	}
+
+	void SpatialHash::Query(glm::vec2 min, glm::vec2 max, std::vector<int>& ids) const {
+		glm::ivec2 first = GetCell(min);
+		glm::ivec2 last = GetCell(max);
+
+		int start = ids.size();
+
+		for (int y = first.y; y <= last.y; y++) {
+			for (int x = first.x; x <= last.x; x++) {
+				unsigned int hash = Hash(x, y);
+
+				if (staticBuckets) {
+					unsigned int b = hash & (staticBuckets - 1);
+
+					for (int i = staticOffsets[b]; i < staticOffsets[b + 1]; i++) {
+						if (colliders[staticIds[i]].isActive) {
+							ids.push_back(staticIds[i]);
+						}
+					}
+				}
+
+				const std::vector<int>& dynamic = dynamicCells[hash % SPATIAL_HASH_DYNAMIC_BUCKETS];
+
+				ids.insert(ids.end(), dynamic.begin(), dynamic.end());
+			}
+		}
+
+		// Colliders spanning several cells are found more than once
+		std::sort(ids.begin() + start, ids.end());
+		ids.erase(std::unique(ids.begin() + start, ids.end()), ids.end());
+	}
+
+	void SpatialHash::GetCells(const Collider& collider, glm::ivec2& first, glm::ivec2& last) const {
+		first = GetCell(collider.center - collider.halfExtents);
+		last = GetCell(collider.center + collider.halfExtents);
+	}
+
+	glm::ivec2 SpatialHash::GetCell(glm::vec2 position) const {
+		return glm::ivec2((int)glm::floor(position.x / cellSize), (int)glm::floor(position.y / cellSize));
+	}
+
+	unsigned int SpatialHash::Hash(int x, int y) {
+		return (unsigned int)x * 73856093u ^ (unsigned int)y * 19349663u;
+	}
+
+	bool SpatialHash::Contains(const Collider& collider, glm::vec2 point) {
+		glm::vec2 offset = point - collider.center;
+
+		if (collider.isCircle) {
+			return glm::dot(offset, offset) < collider.halfExtents.x * collider.halfExtents.x;
+		}
+
+		return glm::abs(offset.x) < collider.halfExtents.x && glm::abs(offset.y) < collider.halfExtents.y;
+	}
+
+	bool SpatialHash::Intersects(const Collider& collider, glm::vec2 center, float radius) {
+		glm::vec2 offset = center - collider.center;
+
+		if (collider.isCircle) {
+			float distance = collider.halfExtents.x + radius;
+
+			return glm::dot(offset, offset) < distance * distance;
+		}
+
+		// Distance from the circle to the closest point of the box
+		glm::vec2 outside = glm::max(glm::abs(offset) - collider.halfExtents, glm::vec2(0.0f));
+
+		return glm::dot(outside, outside) < radius * radius;
+	}
+}
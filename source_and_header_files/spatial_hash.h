@@ -0,0 +1,76 @@
+#ifndef SPATIAL_HASH_H_
+#define SPATIAL_HASH_H_
+
+#include <vector>
+#include <glm/glm.hpp>
+
+// Number of buckets for moving colliders, static colliders get a table sized to them when built
+#define SPATIAL_HASH_DYNAMIC_BUCKETS 256
+
+namespace Game {
+	// Broadphase for 2D colliders on the ground plane (x, z). Every collider is stored in each grid cell its
+	// bounds touch, and the cells are hashed into buckets so the grid does not need to cover the whole world
+	class SpatialHash {
+
+	public:
+		// Circle or axis aligned box
+		struct Collider {
+			bool isCircle;
+			bool isDynamic;
+			bool isActive;
+
+			glm::vec2 center;
+			// Radius of circles is stored in halfExtents.x
+			glm::vec2 halfExtents;
+		};
+
+		SpatialHash(float cellSize = 4.0f);
+		~SpatialHash();
+
+		// Add a collider, returns its id. Static colliders are only queryable after Build
+		int AddCircle(glm::vec2 center, float radius, bool isDynamic = false);
+		int AddBox(glm::vec2 center, glm::vec2 halfExtents, bool isDynamic = false);
+
+		// Move or remove a dynamic collider
+		void Move(int id, glm::vec2 center);
+		void Remove(int id);
+
+		// Pack the static colliders into the grid, call once they are all added
+		void Build();
+		void Clear();
+
+		const Collider& GetCollider(int id) const;
+		int GetColliderCount() const;
+
+		// Returns true if the point is strictly inside any collider
+		bool Overlaps(glm::vec2 point) const;
+		// Returns true if the circle overlaps any collider
+		bool Overlaps(glm::vec2 center, float radius) const;
+
+		// Ids of the colliders whose cells touch the area, each id once
+		void Query(glm::vec2 min, glm::vec2 max, std::vector<int>& ids) const;
+
+	private:
+		float cellSize;
+
+		std::vector<Collider> colliders;
+
+		// Static colliders packed by bucket: the ids of bucket b are staticIds[staticOffsets[b]] to staticIds[staticOffsets[b + 1]]
+		std::vector<int> staticOffsets;
+		std::vector<int> staticIds;
+		int staticBuckets = 0;
+
+		std::vector<int> dynamicCells[SPATIAL_HASH_DYNAMIC_BUCKETS];
+
+		// Range of cells touched by the bounds of a collider
+		void GetCells(const Collider& collider, glm::ivec2& first, glm::ivec2& last) const;
+		glm::ivec2 GetCell(glm::vec2 position) const;
+
+		static unsigned int Hash(int x, int y);
+
+		static bool Contains(const Collider& collider, glm::vec2 point);
+		static bool Intersects(const Collider& collider, glm::vec2 center, float radius);
+	};
+}
+
+#endif
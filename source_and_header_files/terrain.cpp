@@ -0,0 +1,608 @@
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <functional>
+#include <emmintrin.h>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+#include "terrain.h"
+
+namespace Game {
+	// How far the skirts around each chunk hang down, hides cracks between levels of detail
+	const float TERRAIN_SKIRT_DEPTH = 1.0f;
+
+	// Number of attributes per vertex: position (3), normal (3), color (3), texture coordinates (2)
+	const int TERRAIN_VERTEX_ATT = 11;
+
+	// Vertices along one side of a chunk, and the total including the four skirts
+	const int CHUNK_SIDE = TERRAIN_CHUNK_SIZE + 1;
+	const int CHUNK_VERTICES = CHUNK_SIDE * CHUNK_SIDE + 4 * CHUNK_SIDE;
+
+	// Split [0, count) in contiguous ranges, one per thread, and wait for them
+	static void ParallelRows(int count, int threads, const std::function<void(int, int)>& function) {
+		if (threads <= 0) {
+			threads = glm::max(1, (int)std::thread::hardware_concurrency());
+		}
+
+		threads = glm::min(threads, count);
+
+		if (threads <= 1) {
+			function(0, count);
+			return;
+		}
+
+		std::vector<std::thread> workers;
+
+		for (int t = 1; t < threads; t++) {
+			workers.push_back(std::thread(function, count * t / threads, count * (t + 1) / threads));
+		}
+
+		function(0, count / threads);
+
+		for (int t = 0; t < workers.size(); t++) {
+			workers[t].join();
+		}
+	}
+
+	// Counter based random number in [0, 1), only depends on the seed and the sample index
+	static inline float Random(unsigned int seed, unsigned int index) {
+		unsigned int x = index * 0x9E3779B9u + seed;
+
+		x ^= x >> 16;
+		x *= 0x7FEB352Du;
+		x ^= x >> 15;
+		x *= 0x846CA68Bu;
+		x ^= x >> 16;
+
+		return (x >> 8) * (1.0f / 16777216.0f);
+	}
+
+	// Approximate log2 of four positive floats, accurate to about 1e-5
+	static inline __m128 Log2(__m128 x) {
+		__m128i bits = _mm_castps_si128(x);
+
+		// Split into exponent and mantissa in [1, 2)
+		__m128 exponent = _mm_cvtepi32_ps(_mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(127)));
+		__m128 m = _mm_castsi128_ps(_mm_or_si128(_mm_and_si128(bits, _mm_set1_epi32(0x007FFFFF)), _mm_set1_epi32(0x3F800000)));
+
+		// log2(m) = 2 / ln(2) * atanh(t), with t = (m - 1) / (m + 1) in [0, 1/3]
+		__m128 t = _mm_div_ps(_mm_sub_ps(m, _mm_set1_ps(1.0f)), _mm_add_ps(m, _mm_set1_ps(1.0f)));
+		__m128 t2 = _mm_mul_ps(t, t);
+
+		__m128 p = _mm_set1_ps(1.0f / 9.0f);
+		p = _mm_add_ps(_mm_mul_ps(p, t2), _mm_set1_ps(1.0f / 7.0f));
+		p = _mm_add_ps(_mm_mul_ps(p, t2), _mm_set1_ps(1.0f / 5.0f));
+		p = _mm_add_ps(_mm_mul_ps(p, t2), _mm_set1_ps(1.0f / 3.0f));
+		p = _mm_add_ps(_mm_mul_ps(p, t2), _mm_set1_ps(1.0f));
+		p = _mm_mul_ps(_mm_mul_ps(p, t), _mm_set1_ps(2.8853900817779268f));
+
+		return _mm_add_ps(exponent, p);
+	}
+
+	// Approximate 2^x of four floats in [-126, 127], accurate to about 1e-6
+	static inline __m128 Exp2(__m128 x) {
+		// Split into integer and fraction in [0, 1)
+		__m128 n = _mm_cvtepi32_ps(_mm_cvttps_epi32(x));
+		n = _mm_sub_ps(n, _mm_and_ps(_mm_cmpgt_ps(n, x), _mm_set1_ps(1.0f)));
+
+		__m128 f = _mm_sub_ps(x, n);
+
+		// Taylor series of e^(f * ln(2))
+		__m128 p = _mm_set1_ps(1.5403530393381606e-4f);
+		p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(1.3333558146428443e-3f));
+		p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(9.6181291076284772e-3f));
+		p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(5.5504108664821580e-2f));
+		p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(2.4022650695910071e-1f));
+		p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(6.9314718055994531e-1f));
+		p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(1.0f));
+
+		// Scale by 2^n through the exponent bits
+		__m128i scale = _mm_slli_epi32(_mm_add_epi32(_mm_cvtps_epi32(n), _mm_set1_epi32(127)), 23);
+
+		return _mm_mul_ps(p, _mm_castsi128_ps(scale));
+	}
+
+	Terrain::Terrain() {
+		for (int i = 0; i < TERRAIN_LOD_LEVELS; i++) {
+			elementArrayBuffers[i] = 0;
+			elementCounts[i] = 0;
+		}
+	}
+
+	Terrain::~Terrain() {}
+
+	void Terrain::Create(int size, unsigned int seed) {
+		CreateHeightfield(size, seed);
+
+		CreateChunks();
+		CreateIndices();
+		CreateHeightTexture();
+	}
+
+	void Terrain::CreateHeightfield(int size, unsigned int seed) {
+		if (size < 2) {
+			throw(std::string("Terrain error: size must be at least 2"));
+		}
+
+		Terrain::size = size;
+
+		heights.resize(size * size);
+		normals.resize(size * size * 3);
+
+		GenerateHeights(size, seed, heights.data());
+		ComputeNormals(size, heights.data(), normals.data());
+	}
+
+	int Terrain::GetSize() const {
+		return size;
+	}
+
+	void Terrain::SetLodDistance(float distance) {
+		lodDistance = distance;
+	}
+
+	float Terrain::GetHeight(int x, int z) const {
+		x = glm::clamp(x, 0, size - 1);
+		z = glm::clamp(z, 0, size - 1);
+
+		return heights[z * size + x];
+	}
+
+	float Terrain::GetHeightAt(float x, float z) const {
+		if (x < 0.0f || x > size - 1.0f || z < 0.0f || z > size - 1.0f) {
+			return 0.0f;
+		}
+
+		int x1 = glm::floor(x);
+		int z1 = glm::floor(z);
+
+		float fx = x - x1;
+		float fz = z - z1;
+
+		float h1 = GetHeight(x1, z1) * (1 - fx) + GetHeight(x1 + 1, z1) * fx;
+		float h2 = GetHeight(x1, z1 + 1) * (1 - fx) + GetHeight(x1 + 1, z1 + 1) * fx;
+
+		return h1 * (1 - fz) + h2 * fz;
+	}
+
+	glm::vec3 Terrain::GetNormalAt(float x, float z) const {
+		if (x < 0.0f || x > size - 1.0f || z < 0.0f || z > size - 1.0f) {
+			return glm::vec3(0.0f, 1.0f, 0.0f);
+		}
+
+		int x1 = glm::min((int)x, size - 2);
+		int z1 = glm::min((int)z, size - 2);
+
+		float fx = x - x1;
+		float fz = z - z1;
+
+		float h00 = GetHeight(x1, z1), h10 = GetHeight(x1 + 1, z1);
+		float h01 = GetHeight(x1, z1 + 1), h11 = GetHeight(x1 + 1, z1 + 1);
+
+		// Slopes of the bilinear patch along x and z
+		float dx = (h10 - h00) * (1 - fz) + (h11 - h01) * fz;
+		float dz = (h01 - h00) * (1 - fx) + (h11 - h10) * fx;
+
+		return glm::normalize(glm::vec3(-dx, 1.0f, -dz));
+	}
+
+	void Terrain::GetHeightsAt(int count, const float* x, const float* z, float* heights, glm::vec3* normals) const {
+		// Points are processed in groups, corner indices are computed with SIMD and the four corners
+		// are gathered per point. The rest of the group falls back to the scalar queries
+
+		int i = 0;
+
+		const float* data = Terrain::heights.data();
+
+		__m128 one = _mm_set1_ps(1.0f);
+		__m128 zero = _mm_setzero_ps();
+
+#ifdef __AVX2__
+		__m256 max8 = _mm256_set1_ps(size - 1.0f);
+		__m256i last8 = _mm256_set1_epi32(size - 2);
+		__m256i size8 = _mm256_set1_epi32(size);
+		__m256 one8 = _mm256_set1_ps(1.0f);
+
+		for (; i + 8 <= count; i += 8) {
+			__m256 px = _mm256_loadu_ps(x + i);
+			__m256 pz = _mm256_loadu_ps(z + i);
+
+			// Points outside the map get height 0
+			__m256 inside = _mm256_and_ps(_mm256_and_ps(_mm256_cmp_ps(px, _mm256_setzero_ps(), _CMP_GE_OQ), _mm256_cmp_ps(px, max8, _CMP_LE_OQ)),
+				_mm256_and_ps(_mm256_cmp_ps(pz, _mm256_setzero_ps(), _CMP_GE_OQ), _mm256_cmp_ps(pz, max8, _CMP_LE_OQ)));
+
+			px = _mm256_and_ps(inside, px);
+			pz = _mm256_and_ps(inside, pz);
+
+			__m256i x1 = _mm256_min_epi32(_mm256_cvttps_epi32(px), last8);
+			__m256i z1 = _mm256_min_epi32(_mm256_cvttps_epi32(pz), last8);
+
+			__m256 fx = _mm256_sub_ps(px, _mm256_cvtepi32_ps(x1));
+			__m256 fz = _mm256_sub_ps(pz, _mm256_cvtepi32_ps(z1));
+
+			__m256i index = _mm256_add_epi32(_mm256_mullo_epi32(z1, size8), x1);
+
+			__m256 h00 = _mm256_i32gather_ps(data, index, 4);
+			__m256 h10 = _mm256_i32gather_ps(data + 1, index, 4);
+			__m256 h01 = _mm256_i32gather_ps(data + size, index, 4);
+			__m256 h11 = _mm256_i32gather_ps(data + size + 1, index, 4);
+
+			__m256 h1 = _mm256_add_ps(h00, _mm256_mul_ps(_mm256_sub_ps(h10, h00), fx));
+			__m256 h2 = _mm256_add_ps(h01, _mm256_mul_ps(_mm256_sub_ps(h11, h01), fx));
+
+			_mm256_storeu_ps(heights + i, _mm256_and_ps(inside, _mm256_add_ps(h1, _mm256_mul_ps(_mm256_sub_ps(h2, h1), fz))));
+
+			if (normals) {
+				__m256 dx = _mm256_add_ps(_mm256_mul_ps(_mm256_sub_ps(h10, h00), _mm256_sub_ps(one8, fz)), _mm256_mul_ps(_mm256_sub_ps(h11, h01), fz));
+				__m256 dz = _mm256_add_ps(_mm256_mul_ps(_mm256_sub_ps(h01, h00), _mm256_sub_ps(one8, fx)), _mm256_mul_ps(_mm256_sub_ps(h11, h10), fx));
+
+				dx = _mm256_and_ps(inside, dx);
+				dz = _mm256_and_ps(inside, dz);
+
+				__m256 length = _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), one8), _mm256_mul_ps(dz, dz)));
+
+				float nx[8], ny[8], nz[8];
+
+				_mm256_storeu_ps(nx, _mm256_div_ps(_mm256_sub_ps(_mm256_setzero_ps(), dx), length));
+				_mm256_storeu_ps(ny, _mm256_div_ps(one8, length));
+				_mm256_storeu_ps(nz, _mm256_div_ps(_mm256_sub_ps(_mm256_setzero_ps(), dz), length));
+
+				for (int k = 0; k < 8; k++) {
+					normals[i + k] = glm::vec3(nx[k], ny[k], nz[k]);
+				}
+			}
+		}
+#endif
+
+		__m128 max = _mm_set1_ps(size - 1.0f);
+		__m128 last = _mm_set1_ps(size - 2.0f);
+
+		for (; i + 4 <= count; i += 4) {
+			__m128 px = _mm_loadu_ps(x + i);
+			__m128 pz = _mm_loadu_ps(z + i);
+
+			// Points outside the map get height 0
+			__m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(px, zero), _mm_cmple_ps(px, max)), _mm_and_ps(_mm_cmpge_ps(pz, zero), _mm_cmple_ps(pz, max)));
+
+			px = _mm_and_ps(inside, px);
+			pz = _mm_and_ps(inside, pz);
+
+			// Truncation is floor for positive values, the last row and column use the cell before them
+			__m128 x1 = _mm_min_ps(_mm_cvtepi32_ps(_mm_cvttps_epi32(px)), last);
+			__m128 z1 = _mm_min_ps(_mm_cvtepi32_ps(_mm_cvttps_epi32(pz)), last);
+
+			__m128 fx = _mm_sub_ps(px, x1);
+			__m128 fz = _mm_sub_ps(pz, z1);
+
+			int ix[4], iz[4];
+
+			_mm_storeu_si128((__m128i*)ix, _mm_cvttps_epi32(x1));
+			_mm_storeu_si128((__m128i*)iz, _mm_cvttps_epi32(z1));
+
+			// Gather the four corners of every cell
+			const float* c0 = data + iz[0] * size + ix[0];
+			const float* c1 = data + iz[1] * size + ix[1];
+			const float* c2 = data + iz[2] * size + ix[2];
+			const float* c3 = data + iz[3] * size + ix[3];
+
+			__m128 h00 = _mm_set_ps(c3[0], c2[0], c1[0], c0[0]);
+			__m128 h10 = _mm_set_ps(c3[1], c2[1], c1[1], c0[1]);
+			__m128 h01 = _mm_set_ps(c3[size], c2[size], c1[size], c0[size]);
+			__m128 h11 = _mm_set_ps(c3[size + 1], c2[size + 1], c1[size + 1], c0[size + 1]);
+
+			__m128 h1 = _mm_add_ps(h00, _mm_mul_ps(_mm_sub_ps(h10, h00), fx));
+			__m128 h2 = _mm_add_ps(h01, _mm_mul_ps(_mm_sub_ps(h11, h01), fx));
+
+			_mm_storeu_ps(heights + i, _mm_and_ps(inside, _mm_add_ps(h1, _mm_mul_ps(_mm_sub_ps(h2, h1), fz))));
+
+			if (normals) {
+				__m128 dx = _mm_add_ps(_mm_mul_ps(_mm_sub_ps(h10, h00), _mm_sub_ps(one, fz)), _mm_mul_ps(_mm_sub_ps(h11, h01), fz));
+				__m128 dz = _mm_add_ps(_mm_mul_ps(_mm_sub_ps(h01, h00), _mm_sub_ps(one, fx)), _mm_mul_ps(_mm_sub_ps(h11, h10), fx));
+
+				// Flat outside the map
+				dx = _mm_and_ps(inside, dx);
+				dz = _mm_and_ps(inside, dz);
+
+				__m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), one), _mm_mul_ps(dz, dz)));
+
+				float nx[4], ny[4], nz[4];
+
+				_mm_storeu_ps(nx, _mm_div_ps(_mm_sub_ps(zero, dx), length));
+				_mm_storeu_ps(ny, _mm_div_ps(one, length));
+				_mm_storeu_ps(nz, _mm_div_ps(_mm_sub_ps(zero, dz), length));
+
+				for (int k = 0; k < 4; k++) {
+					normals[i + k] = glm::vec3(nx[k], ny[k], nz[k]);
+				}
+			}
+		}
+
+		for (; i < count; i++) {
+			heights[i] = GetHeightAt(x[i], z[i]);
+
+			if (normals) {
+				normals[i] = GetNormalAt(x[i], z[i]);
+			}
+		}
+	}
+
+	void Terrain::GetVisibleChunks(const Frustum& frustum, glm::vec3 position, std::vector<ChunkDraw>& draws) const {
+		for (int i = 0; i < chunks.size(); i++) {
+			const Chunk& chunk = chunks[i];
+
+			if (!frustum.IsBoxVisible(chunk.min, chunk.max)) {
+				continue;
+			}
+
+			// Distance from the camera to the closest point of the chunk
+			glm::vec3 offset = glm::max(glm::max(chunk.min - position, position - chunk.max), glm::vec3(0.0f));
+			float distance = glm::length(offset);
+
+			ChunkDraw draw;
+
+			draw.baseVertex = chunk.baseVertex;
+			draw.lod = 0;
+
+			float threshold = lodDistance;
+
+			while (draw.lod < TERRAIN_LOD_LEVELS - 1 && distance > threshold) {
+				draw.lod++;
+				threshold *= 2.0f;
+			}
+
+			draws.push_back(draw);
+		}
+	}
+
+	GLuint Terrain::GetArrayBuffer() const {
+		return arrayBuffer;
+	}
+
+	GLuint Terrain::GetElementArrayBuffer(int lod) const {
+		return elementArrayBuffers[lod];
+	}
+
+	GLsizei Terrain::GetElementCount(int lod) const {
+		return elementCounts[lod];
+	}
+
+	GLuint Terrain::GetHeightTexture() const {
+		return heightTexture;
+	}
+
+	void Terrain::GenerateHeights(int size, unsigned int seed, float* heights, int threads) {
+		// A hill in the middle of the map, height = 2 * max(0, 20 - (distance - 1.25 * random)) ^ 0.9 / 4
+		// Rows are padded to a multiple of four so every sample goes through the same SIMD path
+
+		int paddedSize = (size + 3) & ~3;
+
+		ParallelRows(size, threads, [=](int first, int last) {
+			std::vector<float> row(paddedSize);
+
+			__m128 center = _mm_set1_ps(size / 2.0f);
+			__m128 zero = _mm_setzero_ps();
+
+			for (int i = first; i < last; i++) {
+				__m128 dz = _mm_sub_ps(_mm_set1_ps((float)i), center);
+				__m128 dz2 = _mm_mul_ps(dz, dz);
+
+				for (int j = 0; j < paddedSize; j += 4) {
+					__m128 noise = _mm_set_ps(Random(seed, i * size + j + 3), Random(seed, i * size + j + 2), Random(seed, i * size + j + 1), Random(seed, i * size + j));
+
+					__m128 dx = _mm_sub_ps(_mm_set_ps(j + 3.0f, j + 2.0f, j + 1.0f, (float)j), center);
+					__m128 distance = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(dx, dx), dz2));
+
+					__m128 base = _mm_sub_ps(_mm_set1_ps(20.0f), _mm_sub_ps(distance, _mm_mul_ps(_mm_set1_ps(1.25f), noise)));
+					__m128 positive = _mm_cmpgt_ps(base, zero);
+
+					// pow(base, 0.9) as 2^(0.9 * log2(base)), zero where base <= 0
+					__m128 safe = _mm_or_ps(_mm_and_ps(positive, base), _mm_andnot_ps(positive, _mm_set1_ps(1.0f)));
+					__m128 power = Exp2(_mm_mul_ps(_mm_set1_ps(0.9f), Log2(safe)));
+
+					_mm_storeu_ps(&row[j], _mm_and_ps(positive, _mm_mul_ps(power, _mm_set1_ps(0.5f))));
+				}
+
+				std::copy(row.begin(), row.begin() + size, heights + i * size);
+			}
+		});
+	}
+
+	void Terrain::ComputeNormals(int size, const float* heights, float* normals, int threads) {
+		// Normal at (x, z) is normalize(h(x - 1, z) - h(x + 1, z), 2, h(x, z - 1) - h(x, z + 1)),
+		// samples past the edge of the map are clamped
+
+		ParallelRows(size, threads, [=](int first, int last) {
+			for (int z = first; z < last; z++) {
+				const float* row = heights + z * size;
+				const float* up = heights + glm::max(z - 1, 0) * size;
+				const float* down = heights + glm::min(z + 1, size - 1) * size;
+
+				float* out = normals + z * size * 3;
+
+				int x = 0;
+
+				// Scalar version for the edges, same operations as the SIMD loop
+				auto computeNormal = [&](int x) {
+					float nx = row[glm::max(x - 1, 0)] - row[glm::min(x + 1, size - 1)];
+					float nz = up[x] - down[x];
+					float length = sqrtf((nx * nx + 4.0f) + nz * nz);
+
+					out[x * 3 + 0] = nx / length;
+					out[x * 3 + 1] = 2.0f / length;
+					out[x * 3 + 2] = nz / length;
+				};
+
+				computeNormal(x++);
+
+				for (; x + 4 < size; x += 4) {
+					__m128 nx = _mm_sub_ps(_mm_loadu_ps(row + x - 1), _mm_loadu_ps(row + x + 1));
+					__m128 nz = _mm_sub_ps(_mm_loadu_ps(up + x), _mm_loadu_ps(down + x));
+
+					__m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, nx), _mm_set1_ps(4.0f)), _mm_mul_ps(nz, nz)));
+
+					float a[4], b[4], c[4];
+
+					_mm_storeu_ps(a, _mm_div_ps(nx, length));
+					_mm_storeu_ps(b, _mm_div_ps(_mm_set1_ps(2.0f), length));
+					_mm_storeu_ps(c, _mm_div_ps(nz, length));
+
+					// Interleave into xyz triples
+					for (int k = 0; k < 4; k++) {
+						out[(x + k) * 3 + 0] = a[k];
+						out[(x + k) * 3 + 1] = b[k];
+						out[(x + k) * 3 + 2] = c[k];
+					}
+				}
+
+				for (; x < size; x++) {
+					computeNormal(x);
+				}
+			}
+		});
+	}
+
+	void Terrain::CreateChunks() {
+		// Split the map in chunks, the last row and column may reach past the map and are clamped to its edge
+
+		int chunksPerSide = (size - 2) / TERRAIN_CHUNK_SIZE + 1;
+
+		chunks.resize(chunksPerSide * chunksPerSide);
+
+		std::vector<GLfloat> vertex(chunks.size() * CHUNK_VERTICES * TERRAIN_VERTEX_ATT);
+
+		// Chunks are independent, fill rows of them in parallel
+		ParallelRows(chunksPerSide, 0, [&](int first, int last) {
+			for (int cz = first; cz < last; cz++) {
+				for (int cx = 0; cx < chunksPerSide; cx++) {
+					Chunk& chunk = chunks[cz * chunksPerSide + cx];
+
+					chunk.baseVertex = (cz * chunksPerSide + cx) * CHUNK_VERTICES;
+					chunk.min = glm::vec3(size, 1e9f, size);
+					chunk.max = glm::vec3(0.0f, -1e9f, 0.0f);
+
+					// Grid vertices first, then the skirts of the four edges (z = 0, z = max, x = 0, x = max)
+					for (int k = 0; k < CHUNK_VERTICES; k++) {
+						int lx, lz;
+						float depth = 0.0f;
+
+						if (k < CHUNK_SIDE * CHUNK_SIDE) {
+							lx = k % CHUNK_SIDE;
+							lz = k / CHUNK_SIDE;
+						} else {
+							int edge = (k - CHUNK_SIDE * CHUNK_SIDE) / CHUNK_SIDE;
+							int t = (k - CHUNK_SIDE * CHUNK_SIDE) % CHUNK_SIDE;
+
+							lx = (edge < 2) ? t : (edge == 2 ? 0 : TERRAIN_CHUNK_SIZE);
+							lz = (edge < 2) ? (edge == 0 ? 0 : TERRAIN_CHUNK_SIZE) : t;
+
+							depth = TERRAIN_SKIRT_DEPTH;
+						}
+
+						int x = glm::min(cx * TERRAIN_CHUNK_SIZE + lx, size - 1);
+						int z = glm::min(cz * TERRAIN_CHUNK_SIZE + lz, size - 1);
+
+						glm::vec3 vertex_position(x, GetHeight(x, z) - depth, z);
+						glm::vec3 vertex_normal(normals[(z * size + x) * 3], normals[(z * size + x) * 3 + 1], normals[(z * size + x) * 3 + 2]);
+						glm::vec3 vertex_color(0.0f, 1.0f, 0.0f);
+						glm::vec2 vertex_coords(z / 2.0f, x / 2.0f);
+
+						GLfloat* v = &vertex[(chunk.baseVertex + k) * TERRAIN_VERTEX_ATT];
+
+						for (int a = 0; a < 3; a++) {
+							v[a] = vertex_position[a];
+							v[a + 3] = vertex_normal[a];
+							v[a + 6] = vertex_color[a];
+						}
+
+						v[9] = vertex_coords[0];
+						v[10] = vertex_coords[1];
+
+						chunk.min = glm::min(chunk.min, vertex_position);
+						chunk.max = glm::max(chunk.max, vertex_position);
+					}
+				}
+			}
+		});
+
+		// Create OpenGL buffer and copy data
+
+		if (!arrayBuffer) {
+			glGenBuffers(1, &arrayBuffer);
+		}
+
+		glBindBuffer(GL_ARRAY_BUFFER, arrayBuffer);
+		glBufferData(GL_ARRAY_BUFFER, vertex.size() * sizeof(GLfloat), vertex.data(), GL_STATIC_DRAW);
+	}
+
+	void Terrain::CreateHeightTexture() {
+		glGenTextures(1, &heightTexture);
+		glBindTexture(GL_TEXTURE_2D, heightTexture);
+
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, size, size, 0, GL_RED, GL_FLOAT, heights.data());
+
+		// Filtered like GetHeightAt, and zero off the map
+		const GLfloat border[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+		glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, border);
+
+		glBindTexture(GL_TEXTURE_2D, 0);
+	}
+
+	void Terrain::CreateIndices() {
+		// Every chunk has the same layout, so the index buffers are shared and offset by the chunk's base vertex
+
+		for (int lod = 0; lod < TERRAIN_LOD_LEVELS; lod++) {
+			int step = 1 << lod;
+
+			std::vector<GLuint> face;
+
+			// Two triangles per quad
+			for (int i = 0; i < TERRAIN_CHUNK_SIZE; i += step) {
+				for (int j = 0; j < TERRAIN_CHUNK_SIZE; j += step) {
+					GLuint t1[3] = { (GLuint)((i + step) * CHUNK_SIDE + j), (GLuint)(i * CHUNK_SIDE + j + step), (GLuint)(i * CHUNK_SIDE + j) };
+					GLuint t2[3] = { (GLuint)((i + step) * CHUNK_SIDE + j), (GLuint)((i + step) * CHUNK_SIDE + j + step), (GLuint)(i * CHUNK_SIDE + j + step) };
+
+					face.insert(face.end(), t1, t1 + 3);
+					face.insert(face.end(), t2, t2 + 3);
+				}
+			}
+
+			// Skirts, one quad hanging down from every edge segment
+			for (int edge = 0; edge < 4; edge++) {
+				for (int t = 0; t < TERRAIN_CHUNK_SIZE; t += step) {
+					int lx1 = (edge < 2) ? t : (edge == 2 ? 0 : TERRAIN_CHUNK_SIZE);
+					int lz1 = (edge < 2) ? (edge == 0 ? 0 : TERRAIN_CHUNK_SIZE) : t;
+					int lx2 = (edge < 2) ? t + step : lx1;
+					int lz2 = (edge < 2) ? lz1 : t + step;
+
+					GLuint top1 = lz1 * CHUNK_SIDE + lx1;
+					GLuint top2 = lz2 * CHUNK_SIDE + lx2;
+					GLuint bottom1 = CHUNK_SIDE * CHUNK_SIDE + edge * CHUNK_SIDE + t;
+					GLuint bottom2 = bottom1 + step;
+
+					GLuint t1[3] = { top1, top2, bottom1 };
+					GLuint t2[3] = { bottom1, top2, bottom2 };
+
+					face.insert(face.end(), t1, t1 + 3);
+					face.insert(face.end(), t2, t2 + 3);
+				}
+			}
+
+			// Create OpenGL buffer and copy data
+
+			if (!elementArrayBuffers[lod]) {
+				glGenBuffers(1, &elementArrayBuffers[lod]);
+			}
+
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, elementArrayBuffers[lod]);
+			glBufferData(GL_ELEMENT_ARRAY_BUFFER, face.size() * sizeof(GLuint), face.data(), GL_STATIC_DRAW);
+
+			elementCounts[lod] = face.size();
+		}
+	}
+}
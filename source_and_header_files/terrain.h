@@ -0,0 +1,105 @@
+#ifndef TERRAIN_H_
+#define TERRAIN_H_
+
+#define GLEW_STATIC
+
+#include <vector>
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+#include "camera.h"
+
+// Number of quads along each side of a chunk, divisible by the coarsest level of detail step
+#define TERRAIN_CHUNK_SIZE 32
+// Each level of detail doubles the sample step: 1, 2, 4, 8
+#define TERRAIN_LOD_LEVELS 4
+
+namespace Game {
+	// Heightfield terrain split into fixed size chunks, each with several levels of detail
+	class Terrain {
+
+	public:
+		// A chunk selected for drawing
+		struct ChunkDraw {
+			GLint baseVertex;
+			int lod;
+		};
+
+		Terrain();
+		~Terrain();
+
+		// Generate the heightfield and the chunk geometry. Size is the number of height samples
+		// along each side of the map, one world unit apart. The same seed always gives the same map
+		void Create(int size, unsigned int seed = 0);
+		// Generate only the heightfield, without any OpenGL geometry
+		void CreateHeightfield(int size, unsigned int seed = 0);
+
+		int GetSize() const;
+
+		// Distance from the camera at which the first coarser level of detail is used, each
+		// further level starts at twice the previous distance
+		void SetLodDistance(float distance);
+
+		// Returns the height at (x, z), bilinearly interpolated
+		float GetHeightAt(float x, float z) const;
+		// Returns the normal of the interpolated surface at (x, z)
+		glm::vec3 GetNormalAt(float x, float z) const;
+
+		// Height (and optionally normal) for count points at once, using SIMD gathers: 4 wide with SSE2, 8 wide
+		// with AVX2 in builds configured with USE_AVX2
+		void GetHeightsAt(int count, const float* x, const float* z, float* heights, glm::vec3* normals = NULL) const;
+
+		// Select the chunks inside the frustum and their level of detail
+		void GetVisibleChunks(const Frustum& frustum, glm::vec3 position, std::vector<ChunkDraw>& draws) const;
+
+		// Buffers holding the geometry of all chunks
+		GLuint GetArrayBuffer() const;
+		GLuint GetElementArrayBuffer(int lod) const;
+		GLsizei GetElementCount(int lod) const;
+
+		// Single channel float texture with one texel per height sample, for collisions on the GPU
+		GLuint GetHeightTexture() const;
+
+		// Generation kernels, split by rows over the given number of threads (0 uses every core)
+		// Results do not depend on the number of threads
+
+		// Fill size * size heights, row major with z selecting the row
+		static void GenerateHeights(int size, unsigned int seed, float* heights, int threads = 0);
+		// Fill size * size normals (3 floats each) from central differences of the heights
+		static void ComputeNormals(int size, const float* heights, float* normals, int threads = 0);
+
+	private:
+		struct Chunk {
+			GLint baseVertex;
+
+			// Bounds used for culling and level of detail selection
+			glm::vec3 min;
+			glm::vec3 max;
+		};
+
+		int size = 0;
+
+		float lodDistance = 48.0f;
+
+		// Height samples, row major with z selecting the row
+		std::vector<float> heights;
+		std::vector<float> normals;
+
+		std::vector<Chunk> chunks;
+
+		// One vertex buffer for all chunks, and index buffers shared by all chunks
+		GLuint arrayBuffer = 0;
+		GLuint elementArrayBuffers[TERRAIN_LOD_LEVELS];
+		GLsizei elementCounts[TERRAIN_LOD_LEVELS];
+
+		GLuint heightTexture = 0;
+
+		float GetHeight(int x, int z) const;
+
+		void CreateChunks();
+		void CreateIndices();
+		void CreateHeightTexture();
+	};
+}
+
+#endif
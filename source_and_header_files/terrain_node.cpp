@@ -0,0 +1,59 @@
+#include "terrain_node.h"
+
+namespace Game {
+	TerrainNode::TerrainNode(const std::string name, const Terrain* terrain, const Resource* material, const Resource* texture) : SceneNode(name, GL_TRIANGLES, material, texture) {
+		TerrainNode::terrain = terrain;
+	}
+
+	TerrainNode::~TerrainNode() {}
+
+	void TerrainNode::Update(Camera* camera) {
+		SceneNode::Update(camera);
+
+		draws.clear();
+		terrain->GetVisibleChunks(camera->GetFrustum(), camera->GetPosition(), draws);
+	}
+
+	void TerrainNode::Collect(FramePacket* packet) {
+		DrawItem item = GetDrawItem();
+
+		// All chunks share one vertex buffer
+		item.arrayBuffer = terrain->GetArrayBuffer();
+		item.fullSize = terrain->GetElementCount(0);
+
+		// Chunks selected in Update
+		for (int i = 0; i < draws.size(); i++) {
+			int lod = draws[i].lod;
+
+			item.elementArrayBuffer = terrain->GetElementArrayBuffer(lod);
+			item.size = terrain->GetElementCount(lod);
+			item.baseVertex = draws[i].baseVertex;
+
+			packet->items.push_back(item);
+		}
+	}
+
+	void TerrainNode::CollectShadows(FramePacket* packet) {
+		DrawItem item = GetDrawItem();
+
+		item.arrayBuffer = terrain->GetArrayBuffer();
+		item.fullSize = terrain->GetElementCount(0);
+
+		for (int i = 0; i < packet->shadows.count; i++) {
+			shadowDraws.clear();
+			terrain->GetVisibleChunks(packet->shadows.frusta[i], packet->cameraPosition, shadowDraws);
+
+			item.shadowCascades = 1 << i;
+
+			for (int j = 0; j < shadowDraws.size(); j++) {
+				int lod = shadowDraws[j].lod;
+
+				item.elementArrayBuffer = terrain->GetElementArrayBuffer(lod);
+				item.size = terrain->GetElementCount(lod);
+				item.baseVertex = shadowDraws[j].baseVertex;
+
+				packet->shadowItems.push_back(item);
+			}
+		}
+	}
+}
@@ -0,0 +1,40 @@
+#ifndef TERRAIN_NODE_H_
+#define TERRAIN_NODE_H_
+
+#define GLEW_STATIC
+
+#include <string>
+#include <vector>
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include "scene_node.h"
+#include "terrain.h"
+
+namespace Game {
+	// Scene node drawing the visible chunks of a terrain
+	class TerrainNode : public SceneNode {
+
+	public:
+		TerrainNode(const std::string name, const Terrain* terrain, const Resource* material, const Resource* texture = NULL);
+		~TerrainNode();
+
+		// Culls the chunks and picks their level of detail
+		virtual void Update(Camera* camera);
+
+		// One draw item per visible chunk
+		virtual void Collect(FramePacket* packet);
+
+		// The chunks in each cascade, culled against it with the levels of detail of the camera
+		virtual void CollectShadows(FramePacket* packet);
+
+	private:
+		const Terrain* terrain;
+
+		// Chunks selected by the last Update
+		std::vector<Terrain::ChunkDraw> draws;
+		// Scratch for the chunks of a cascade
+		std::vector<Terrain::ChunkDraw> shadowDraws;
+	};
+}
+
+#endif
@@ -0,0 +1,270 @@
+#define GLM_FORCE_RADIANS
+
+#include <map>
+#include <mutex>
+#include <cstring>
+#include <string>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
+#include "vertex_layout.h"
+#include "mesh_cooker.h"
+
+namespace Game {
+	// Value of a mesh input the layout does not have
+	struct MissingInput {
+		const char* name;
+		GLfloat value[4];
+	};
+
+	// The color is black as the float meshes leave it, a missing tangent is any direction along the surface
+	static const MissingInput MESH_INPUTS[] = {
+		{ "normal", { 0.0f, 0.0f, 1.0f, 0.0f } },
+		{ "color", { 0.0f, 0.0f, 0.0f, 1.0f } },
+		{ "uv", { 0.0f, 0.0f, 0.0f, 1.0f } },
+		{ "tangent", { 1.0f, 0.0f, 0.0f, 1.0f } }
+	};
+
+	// Size in the buffer, rounded up to 4 bytes
+	static GLsizei GetSize(int components, VertexFormat format) {
+		switch (format) {
+		case VertexFormat::Float:
+			return components * 4;
+		case VertexFormat::Half:
+		case VertexFormat::Unorm16:
+		case VertexFormat::Snorm16:
+			return (components * 2 + 3) / 4 * 4;
+		default:
+			return 4;
+		}
+	}
+
+	VertexLayout::VertexLayout() {
+		stride = 0;
+		position = -1;
+		positionDecode = glm::mat4(1.0f);
+	}
+
+	VertexLayout::~VertexLayout() {}
+
+	void VertexLayout::Add(const std::string name, int source, int components, VertexFormat format) {
+		if (components < 1 || components > 4) {
+			throw(std::string("Error: vertex attribute ") + name + std::string(" should have 1 to 4 components"));
+		}
+
+		VertexAttribute attribute;
+
+		attribute.name = name;
+		attribute.components = components;
+		attribute.format = format;
+		attribute.offset = stride;
+		attribute.source = source;
+
+		attributes.push_back(attribute);
+
+		stride += GetSize(components, format);
+	}
+
+	void VertexLayout::AddPosition(const std::string name, int source, VertexFormat format) {
+		position = (int)attributes.size();
+
+		Add(name, source, 3, format);
+	}
+
+	GLsizei VertexLayout::GetStride() const {
+		return stride;
+	}
+
+	int VertexLayout::GetAttributeCount() const {
+		return (int)attributes.size();
+	}
+
+	const VertexAttribute& VertexLayout::GetAttribute(int i) const {
+		return attributes[i];
+	}
+
+	const glm::mat4& VertexLayout::GetPositionDecode() const {
+		return positionDecode;
+	}
+
+	void VertexLayout::Encode(const GLfloat* vertices, int count, int sourceStride, std::vector<unsigned char>& data) {
+		data.assign(count * stride, 0);
+
+		// Quantized positions: one scale on every axis, so the decode does not bend the directions transformed
+		// with the world matrix
+
+		glm::vec3 origin(0.0f);
+		float scale = 1.0f;
+
+		positionDecode = glm::mat4(1.0f);
+
+		if (position >= 0 && count > 0 && (attributes[position].format == VertexFormat::Unorm16 || attributes[position].format == VertexFormat::Snorm16)) {
+			const int source = attributes[position].source;
+
+			glm::vec3 min(vertices[source], vertices[source + 1], vertices[source + 2]);
+			glm::vec3 max = min;
+
+			for (int i = 1; i < count; i++) {
+				const GLfloat* p = vertices + i * sourceStride + source;
+
+				min = glm::min(min, glm::vec3(p[0], p[1], p[2]));
+				max = glm::max(max, glm::vec3(p[0], p[1], p[2]));
+			}
+
+			glm::vec3 size = max - min;
+			scale = glm::max(glm::max(size.x, size.y), glm::max(size.z, 1e-6f));
+
+			// Unorm16 spans the bounds from their corner, Snorm16 from their center
+			if (attributes[position].format == VertexFormat::Unorm16) {
+				origin = min;
+			} else {
+				origin = (min + max) * 0.5f;
+				scale *= 0.5f;
+			}
+
+			positionDecode = glm::scale(glm::translate(glm::mat4(1.0f), origin), glm::vec3(scale));
+		}
+
+		for (int i = 0; i < count; i++) {
+			for (int j = 0; j < attributes.size(); j++) {
+				const VertexAttribute& attribute = attributes[j];
+
+				const GLfloat* in = vertices + i * sourceStride + attribute.source;
+				unsigned char* out = &data[i * stride + attribute.offset];
+
+				GLfloat values[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+				for (int k = 0; k < attribute.components; k++) {
+					values[k] = j == position ? (in[k] - origin[k]) / scale : in[k];
+				}
+
+				switch (attribute.format) {
+				case VertexFormat::Float:
+					std::memcpy(out, values, attribute.components * sizeof(GLfloat));
+					break;
+				case VertexFormat::Half:
+					for (int k = 0; k < attribute.components; k++) {
+						glm::uint16 half = glm::packHalf1x16(values[k]);
+						std::memcpy(out + k * 2, &half, 2);
+					}
+					break;
+				case VertexFormat::Unorm16:
+					for (int k = 0; k < attribute.components; k++) {
+						glm::uint16 unorm = glm::packUnorm1x16(values[k]);
+						std::memcpy(out + k * 2, &unorm, 2);
+					}
+					break;
+				case VertexFormat::Snorm16:
+					for (int k = 0; k < attribute.components; k++) {
+						glm::uint16 snorm = glm::packSnorm1x16(values[k]);
+						std::memcpy(out + k * 2, &snorm, 2);
+					}
+					break;
+				case VertexFormat::Int2_10_10_10: {
+					glm::uint32 packed = glm::packSnorm3x10_1x2(glm::vec4(values[0], values[1], values[2], values[3]));
+					std::memcpy(out, &packed, 4);
+					break;
+				}
+				}
+			}
+		}
+	}
+
+	void VertexLayout::Bind(GLuint program) const {
+		for (int i = 0; i < attributes.size(); i++) {
+			const VertexAttribute& attribute = attributes[i];
+
+			GLint location = glGetAttribLocation(program, attribute.name.c_str());
+
+			if (location < 0) {
+				continue;
+			}
+
+			GLint size = attribute.components;
+			GLenum type = GL_FLOAT;
+			GLboolean normalized = GL_FALSE;
+
+			switch (attribute.format) {
+			case VertexFormat::Half:
+				type = GL_HALF_FLOAT;
+				break;
+			case VertexFormat::Unorm16:
+				type = GL_UNSIGNED_SHORT;
+				normalized = GL_TRUE;
+				break;
+			case VertexFormat::Snorm16:
+				type = GL_SHORT;
+				normalized = GL_TRUE;
+				break;
+			case VertexFormat::Int2_10_10_10:
+				// Packed formats are always read as four components
+				size = 4;
+				type = GL_INT_2_10_10_10_REV;
+				normalized = GL_TRUE;
+				break;
+			default:
+				break;
+			}
+
+			glVertexAttribPointer(location, size, type, normalized, stride, (void*)(size_t)attribute.offset);
+			glEnableVertexAttribArray(location);
+		}
+
+		// An array left enabled by the layout of the previous draw would be read past the end of this buffer
+
+		for (int i = 0; i < sizeof(MESH_INPUTS) / sizeof(MESH_INPUTS[0]); i++) {
+			bool found = false;
+
+			for (int j = 0; j < attributes.size(); j++) {
+				found = found || attributes[j].name == MESH_INPUTS[i].name;
+			}
+
+			GLint location = found ? -1 : glGetAttribLocation(program, MESH_INPUTS[i].name);
+
+			if (location >= 0) {
+				glDisableVertexAttribArray(location);
+				glVertexAttrib4fv(location, MESH_INPUTS[i].value);
+			}
+		}
+	}
+
+	const VertexLayout* VertexLayout::GetFloats(int stride) {
+		static std::mutex mutex;
+		static std::map<int, VertexLayout*> layouts;
+
+		std::lock_guard<std::mutex> lock(mutex);
+
+		VertexLayout*& layout = layouts[stride];
+
+		if (!layout) {
+			layout = new VertexLayout();
+
+			layout->AddPosition("vertex", 0, VertexFormat::Float);
+			layout->Add("normal", 3, 3, VertexFormat::Float);
+			layout->Add("color", 6, 3, VertexFormat::Float);
+
+			if (stride >= 11) {
+				layout->Add("uv", 9, 2, VertexFormat::Float);
+			}
+
+			if (stride >= MESH_VERTEX_ATTRIBUTES) {
+				layout->Add("tangent", MESH_TANGENT_OFFSET, 4, VertexFormat::Float);
+			}
+
+			// Room for whatever else the vertices carry
+			layout->stride = stride * sizeof(GLfloat);
+		}
+
+		return layout;
+	}
+
+	VertexLayout VertexLayout::GetPacked() {
+		VertexLayout layout;
+
+		layout.AddPosition("vertex", 0, VertexFormat::Unorm16);
+		layout.Add("normal", 3, 3, VertexFormat::Int2_10_10_10);
+		layout.Add("uv", 9, 2, VertexFormat::Half);
+		layout.Add("tangent", MESH_TANGENT_OFFSET, 4, VertexFormat::Int2_10_10_10);
+
+		return layout;
+	}
+}
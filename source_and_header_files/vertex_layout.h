@@ -0,0 +1,87 @@
+#ifndef VERTEX_LAYOUT_H_
+#define VERTEX_LAYOUT_H_
+
+#define GLEW_STATIC
+
+#include <string>
+#include <vector>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+namespace Game {
+	// How the components of an attribute are stored
+	typedef enum class VertexFormat {
+		// 32 bit float
+		Float,
+		// 16 bit float
+		Half,
+		// 16 bit integer read as 0 to 1, or -1 to 1 for Snorm16
+		Unorm16,
+		Snorm16,
+		// Three 10 bit and one 2 bit signed integers in 4 bytes, read as -1 to 1
+		Int2_10_10_10
+	};
+
+	// An input of the vertex programs and where it is in the buffer
+	struct VertexAttribute {
+		// Name of the input in the shaders
+		std::string name;
+
+		int components;
+		VertexFormat format;
+
+		// In bytes from the start of the vertex
+		GLsizei offset;
+		// In floats from the start of the vertex it is encoded from
+		int source;
+	};
+
+	// Attributes of the vertices of a buffer. Vertices are cooked as floats and encoded into the layout when
+	// copied to a buffer, quantized positions are stored relative to the bounds of the mesh and the decode
+	// matrix maps them back
+	class VertexLayout {
+
+	public:
+		VertexLayout();
+		~VertexLayout();
+
+		// Add an attribute read from the components floats at source of the cooked vertex. Every attribute starts
+		// on 4 bytes
+		void Add(const std::string name, int source, int components, VertexFormat format);
+		// Add the position, the 16 bit integer formats cover the bounds of the mesh
+		void AddPosition(const std::string name, int source, VertexFormat format);
+
+		// Bytes per vertex
+		GLsizei GetStride() const;
+
+		int GetAttributeCount() const;
+		const VertexAttribute& GetAttribute(int i) const;
+
+		// Model space of the stored positions, from the last Encode
+		const glm::mat4& GetPositionDecode() const;
+
+		// Encode count vertices of sourceStride floats each into data
+		void Encode(const GLfloat* vertices, int count, int sourceStride, std::vector<unsigned char>& data);
+
+		// Point the inputs of the program at the array buffer bound. The mesh inputs the layout does not
+		// have are given constant values
+		void Bind(GLuint program) const;
+
+		// Layout of vertices of stride floats: position, normal and color, then texture coordinates and the
+		// tangent when there is room. Shared, never freed
+		static const VertexLayout* GetFloats(int stride);
+		// Compact layout of cooked meshes: 16 bit positions, 10 bit normal and tangent, half float texture
+		// coordinates, 20 bytes in all
+		static VertexLayout GetPacked();
+
+	private:
+		std::vector<VertexAttribute> attributes;
+		GLsizei stride;
+
+		// Attribute that is quantized to the bounds, -1 for none
+		int position;
+		glm::mat4 positionDecode;
+	};
+}
+
+#endif